@@ -0,0 +1,233 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlGraphics/GeometryPrimitives.hpp>
+#include <vlCore/LoadWriterManager.hpp>
+#include <vlCore/Image.hpp>
+#include <vlCore/Thread.hpp>
+
+using namespace vl;
+
+// Stress test of LoadWriterManager::loadResourceAsync(): hundreds of images are loaded in batches, one batch per
+// simulated frame, while the main thread finalizes the decoded ones at every frame. The longest time spent by the main
+// thread in a frame is compared with the one of the synchronous loadResource() and every decoded image is checked
+// against the synchronously loaded one. Some of the images are then shown on screen.
+namespace
+{
+  // simple hash of the pixels of an image
+  unsigned int hashImage(const Image* img)
+  {
+    unsigned int hash = 0;
+    const unsigned char* px = img->pixels();
+    for(int i=0, size=img->requiredMemory(); i<size; ++i)
+      hash = hash * 31 + px[i];
+    return hash;
+  }
+
+  class CountLoadCallback: public LoadCallback
+  {
+  public:
+    CountLoadCallback(): mCount(0) {}
+    void operator()(ResourceDatabase*) { ++mCount; }
+    int mCount;
+  };
+}
+
+class App_AsyncLoadingStressTest: public BaseDemo
+{
+public:
+  App_AsyncLoadingStressTest(): mFileCount(480), mBatchSize(40) {}
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- 1-8: loads the images asynchronously using 1 to 8 loader threads.\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    const char* names[] = { "/images/toy.jpg", "/images/normalmap.jpg", "/images/spheremap_klimt.jpg", "/images/detroit.tif", 
+                            "/images/holebox.tif", "/images/noise.png", "/images/spheremap.png", "/images/pattern.bmp", 
+                            "/images/holebox.dds", "/images/tree.png", "/images/star2.tif", "/images/detail.tif" };
+    mNames.assign( names, names + sizeof(names)/sizeof(names[0]) );
+
+    Log::print( Say("\nAsynchronous loading stress test, %n files in batches of %n:\n") << mFileCount << mBatchSize );
+    loadSynchronously();
+    loadAsynchronously(1);
+    loadAsynchronously( Thread::hardwareConcurrency() );
+    finalizeExplicitly();
+
+    // show the images loaded by the last run
+    for(size_t i=0; i<mImages.size(); ++i)
+    {
+      ref<Effect> fx = new Effect;
+      fx->shader()->enable(EN_DEPTH_TEST);
+      fx->shader()->gocTextureSampler(0)->setTexture( new Texture( mImages[i].get() ) );
+      ref<Geometry> quad = makeGrid( vec3( (real)(i % 4) * 5 - 7.5f, 0, (real)(i / 4) * 5 - 5 ), 4.5f, 4.5f, 2, 2, true );
+      sceneManager()->tree()->addActor( quad.get(), fx.get() );
+    }
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (key >= Key_1 && key <= Key_8)
+      loadAsynchronously(key - Key_0);
+  }
+
+  // reference: the same batches loaded with loadResource()
+  void loadSynchronously()
+  {
+    const int name_count = (int)mNames.size();
+    mHashes.assign( name_count, 0 );
+    mImages.clear();
+    double longest = 0;
+    int frames = 0;
+    Time timer;
+    timer.start();
+    for(int i=0; i<mFileCount; ++frames)
+    {
+      Time frame;
+      frame.start();
+      for(int j=0; j<mBatchSize && i<mFileCount; ++j, ++i)
+      {
+        ref<ResourceDatabase> db = loadResource( mNames[i % name_count] );
+        if (i < name_count)
+        {
+          Image* img = db ? db->get<Image>(0) : NULL;
+          if (!img)
+            Log::error( Say("loadResource() could not load '%s'.\n") << mNames[i] );
+          mHashes[i] = img ? hashImage(img) : 0;
+          mImages.push_back(img);
+        }
+      }
+      longest = vl::max( longest, frame.elapsed() );
+      // the rest of the frame
+      Time::sleep(5);
+    }
+    Log::print( Say("synchronous: %.0nms in %n frames, longest main thread stall %.1nms\n") 
+      << timer.elapsed() * 1000.0 << frames << longest * 1000.0 );
+  }
+
+  // every frame issues a batch of requests and finalizes the resources decoded so far
+  void loadAsynchronously(int threads)
+  {
+    const int name_count = (int)mNames.size();
+    LoadWriterManager* lwm = defLoadWriterManager();
+    ref<CountLoadCallback> callback = new CountLoadCallback;
+    lwm->loadCallbacks().push_back( callback );
+    lwm->setLoaderThreadCount( threads );
+
+    std::vector< ref<ResourceLoadRequest> > requests;
+    double longest = 0;
+    int frames = 0;
+    Time timer;
+    timer.start();
+    for(int issued=0, finalized=0; finalized < mFileCount; ++frames)
+    {
+      Time frame;
+      frame.start();
+      for(int j=0; j<mBatchSize && issued<mFileCount; ++j, ++issued)
+        requests.push_back( loadResourceAsync( mNames[issued % name_count] ) );
+      finalized += lwm->finalizeLoadedResources();
+      longest = vl::max( longest, frame.elapsed() );
+      // the rest of the frame
+      Time::sleep(5);
+    }
+    double sec = timer.elapsed();
+    Log::print( Say("asynchronous, %n loader threads: %.0nms in %n frames, longest main thread stall %.1nms\n") 
+      << threads << sec * 1000.0 << frames << longest * 1000.0 );
+
+    // the LoadCallbacks run once per resource, on the main thread, when it is finalized
+    if ( callback->mCount != mFileCount )
+      Log::error( Say("%n LoadCallback calls for %n finalized resources.\n") << callback->mCount << mFileCount );
+
+    for(int i=0; i<mFileCount; ++i)
+    {
+      Image* img = requests[i]->resource() ? requests[i]->resource()->get<Image>(0) : NULL;
+      if ( !img || hashImage(img) != mHashes[i % name_count] )
+      {
+        Log::error( Say("request #%n: '%s' differs from the synchronously loaded image.\n") << i << mNames[i % name_count] );
+        break;
+      }
+      if (i >= mFileCount - name_count)
+        mImages[i % name_count] = img;
+    }
+
+    removeCallback(callback.get());
+    lwm->setLoaderThreadCount(0);
+  }
+
+  // finalizing a request explicitly while others are still queued returns its resource right away
+  void finalizeExplicitly()
+  {
+    const int name_count = (int)mNames.size();
+    LoadWriterManager* lwm = defLoadWriterManager();
+    std::vector< ref<ResourceLoadRequest> > requests;
+    for(int i=0; i<100; ++i)
+      requests.push_back( loadResourceAsync( mNames[i % name_count] ) );
+    ref<ResourceDatabase> db = requests.back()->finalize();
+    if ( !db || !db->get<Image>(0) || hashImage( db->get<Image>(0) ) != mHashes[99 % name_count] )
+      Log::error("ResourceLoadRequest::finalize() did not return the requested image.\n");
+    lwm->waitLoadedResources();
+    lwm->finalizeLoadedResources();
+    if ( lwm->pendingResourceCount() != 0 )
+      Log::error( Say("%n requests still pending after waitLoadedResources() and finalizeLoadedResources().\n") << lwm->pendingResourceCount() );
+  }
+
+  void removeCallback(LoadCallback* callback)
+  {
+    std::vector< ref<LoadCallback> >& callbacks = defLoadWriterManager()->loadCallbacks();
+    for(size_t i=0; i<callbacks.size(); ++i)
+    {
+      if ( callbacks[i] == callback )
+      {
+        callbacks.erase( callbacks.begin() + i );
+        break;
+      }
+    }
+  }
+
+protected:
+  std::vector<String> mNames;
+  std::vector< ref<Image> > mImages;
+  std::vector<unsigned int> mHashes;
+  int mFileCount;
+  int mBatchSize;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_AsyncLoadingStressTest() { return new App_AsyncLoadingStressTest; }
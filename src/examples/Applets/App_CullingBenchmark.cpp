@@ -31,6 +31,7 @@
 
 #include "BaseDemo.hpp"
 #include <vlGraphics/SceneManagerActorKdTree.hpp>
+#include <vlGraphics/SceneManagerLinearBVH.hpp>
 #include <vlGraphics/Light.hpp>
 #include <vlGraphics/Text.hpp>
 #include <vlGraphics/FontManager.hpp>
@@ -49,6 +50,10 @@ public:
 
     rendering()->as<vl::Rendering>()->sceneManagers()->push_back(mSceneKdTree.get());
 
+    mSceneLinearBVH = new vl::SceneManagerLinearBVH;
+
+    rendering()->as<vl::Rendering>()->sceneManagers()->push_back(mSceneLinearBVH.get());
+
     createScene(mActors);
 
     sceneManager()->tree()->actors()->set(mActors);
@@ -62,14 +67,71 @@ public:
     mText->translate(0,-10,0);
     vl::Actor* text_act = sceneManager()->tree()->addActor(mText.get(), new vl::Effect);
     text_act->effect()->shader()->enable(vl::EN_BLEND);
-    mText->setText("Press 1, 2 or 3 to select culling method");
+    mText->setText("Press 1, 2, 3, 4 or 5 to select culling method\nPress R to compare refitting and rebuilding a KdTree");
   }
 
   void keyPressEvent(unsigned short ch, vl::EKey key)
   {
     BaseDemo::keyPressEvent(ch,key);
+    if (key == vl::Key_R)
+      benchmarkRefit();
+    else
+    if (key == vl::Key_5)
+    {
+      sceneManager()->tree()->actors()->clear();
+      mSceneKdTree->setTree(new vl::ActorKdTree);
+      vl::Time timer;
+
+      // the Linear BVH is compiled from an SAH KdTree, both are culled from the same point of view
+      vl::ref<vl::ActorKdTree> kdtree = new vl::ActorKdTree;
+      kdtree->buildKdTreeSAH(mActors, 100, 0);
+      timer.start();
+      vl::Log::print("Linear BVH compilation in progres...\n");
+      mSceneLinearBVH->compile(kdtree.get());
+      vl::Log::print( vl::Say("Linear BVH compilation time: %.1n, %.1n obj/s\n") << timer.elapsed() << mActors.size() / timer.elapsed() );
+
+      std::vector<vl::Actor*> visible, visible_bvh;
+      benchmarkCulling(kdtree.get(), "SAH KdTree", visible);
+      benchmarkCulling(mSceneLinearBVH.get(), "Linear BVH", visible_bvh);
+      checkSameVisibleActors(visible, visible_bvh, "Linear BVH");
+
+      vl::Actor* text_act = sceneManager()->tree()->addActor(mText.get(), new vl::Effect);
+      text_act->effect()->shader()->enable(vl::EN_BLEND);
+      mText->setText("Linear BVH culling");
+    }
+    else
+    if (key == vl::Key_4)
+    {
+      mSceneLinearBVH->clear();
+      sceneManager()->tree()->actors()->clear();
+      vl::Time timer;
+
+      // the KdTree of key 3 is built too on a separate tree to compare both build and culling times
+      vl::ref<vl::ActorKdTree> kdtree = new vl::ActorKdTree;
+      timer.start();
+      vl::Log::print("KdTree compilation in progres...\n");
+      kdtree->buildKdTree(mActors);
+      vl::Log::print( vl::Say("KdTree compilation time: %.1n, %.1n obj/s\n") << timer.elapsed() << mActors.size() / timer.elapsed() );
+
+      timer.start();
+      vl::Log::print("SAH KdTree compilation in progres...\n");
+      mSceneKdTree->tree()->buildKdTreeSAH(mActors, 100, 0);
+      mSceneKdTree->setBoundsDirty(true);
+      vl::Log::print( vl::Say("SAH KdTree compilation time: %.1n, %.1n obj/s\n") << timer.elapsed() << mActors.size() / timer.elapsed() );
+
+      std::vector<vl::Actor*> visible, visible_sah;
+      benchmarkCulling(kdtree.get(), "KdTree", visible);
+      benchmarkCulling(mSceneKdTree->tree(), "SAH KdTree", visible_sah);
+      checkSameVisibleActors(visible, visible_sah, "SAH KdTree");
+
+      vl::Actor* text_act = sceneManager()->tree()->addActor(mText.get(), new vl::Effect);
+      text_act->effect()->shader()->enable(vl::EN_BLEND);
+      mText->setText("SAH KdTree culling");
+    }
+    else
     if (key == vl::Key_3)
     {
+      mSceneLinearBVH->clear();
       sceneManager()->tree()->actors()->clear();
       vl::Time timer;
       timer.start();
@@ -85,6 +147,7 @@ public:
     else
     if (key == vl::Key_2)
     {
+      mSceneLinearBVH->clear();
       sceneManager()->tree()->actors()->clear();
       sceneManager()->tree()->actors()->set(mActors);
       sceneManager()->setCullingEnabled(true);
@@ -96,6 +159,7 @@ public:
     else
     if (key == vl::Key_1)
     {
+      mSceneLinearBVH->clear();
       sceneManager()->tree()->actors()->clear();
       sceneManager()->tree()->actors()->set(mActors);
       sceneManager()->setCullingEnabled(false);
@@ -106,6 +170,98 @@ public:
     }
   }
 
+  // logs the average time taken to extract the visible actors from the current point of view, returns them sorted by address
+  template<class T_Culler>
+  void benchmarkCulling(T_Culler* tree, const char* name, std::vector<vl::Actor*>& visible_actors)
+  {
+    vl::Camera* camera = rendering()->as<vl::Rendering>()->camera();
+    camera->computeFrustumPlanes();
+
+    const int iterations = 20;
+    vl::ActorCollection visible;
+    vl::Time timer;
+    timer.start();
+    for(int i=0; i<iterations; ++i)
+    {
+      visible.clear();
+      tree->extractVisibleActors(visible, camera);
+    }
+    vl::Log::print( vl::Say("%s culling time: %.2nms, %n visible actors\n") << name << timer.elapsed() * 1000.0 / iterations << visible.size() );
+
+    visible_actors.clear();
+    for(int i=0; i<visible.size(); ++i)
+      visible_actors.push_back( visible.at(i) );
+    std::sort( visible_actors.begin(), visible_actors.end() );
+  }
+
+  // Moves 1%, 10% and 100% of the actors for a few frames and compares the time taken to update a KdTree with
+  // ActorKdTree::refitKdTree() and with a full SAH rebuild. The actors are moved back to their place at the end.
+  void benchmarkRefit()
+  {
+    std::vector<vl::mat4> positions;
+    for(int i=0; i<mActors.size(); ++i)
+      positions.push_back( mActors[i]->transform()->localMatrix() );
+
+    // the refitted tree keeps its structure during the whole benchmark
+    vl::ref<vl::ActorKdTree> refitted = new vl::ActorKdTree;
+    refitted->buildKdTreeSAH(mActors, 100, 0);
+    refitted->setRefitRebuildThreshold(0);
+    vl::ref<vl::ActorKdTree> rebuilt = new vl::ActorKdTree;
+
+    const int frames = 5;
+    const int percents[] = { 1, 10, 100 };
+    for(int ip=0; ip<3; ++ip)
+    {
+      double refit_time = 0, rebuild_time = 0;
+      for(int frame=0; frame<frames; ++frame)
+      {
+        for(int i=0; i<mActors.size() * percents[ip] / 100; ++i)
+        {
+          vl::Transform* tr = mActors[ (i * 7919) % mActors.size() ]->transform();
+          tr->setLocalMatrix( vl::mat4::getTranslation(rand()%21-10.0f, rand()%21-10.0f, rand()%21-10.0f) * tr->localMatrix() );
+          tr->computeWorldMatrix();
+        }
+
+        vl::Time timer;
+        timer.start();
+        refitted->refitKdTree();
+        refit_time += timer.elapsed();
+
+        timer.start();
+        rebuilt->buildKdTreeSAH(mActors, 100, 0);
+        rebuild_time += timer.elapsed();
+      }
+      vl::Log::print( vl::Say("%n%% moving: refit %.2nms, SAH rebuild %.1nms, refitted tree cost %.2nx\n") 
+        << percents[ip] << refit_time * 1000.0 / frames << rebuild_time * 1000.0 / frames << refitted->refitQuality() );
+
+      // the refitted tree must still find every actor inside the frustum
+      std::vector<vl::Actor*> visible, visible_refit;
+      benchmarkCulling(rebuilt.get(), "rebuilt KdTree", visible);
+      benchmarkCulling(refitted.get(), "refitted KdTree", visible_refit);
+      checkSameVisibleActors(visible, visible_refit, "refitted KdTree");
+    }
+
+    for(int i=0; i<mActors.size(); ++i)
+    {
+      mActors[i]->transform()->setLocalMatrix( positions[i] );
+      mActors[i]->transform()->computeWorldMatrix();
+    }
+  }
+
+  // The trees cull their nodes by bounding box and the actors by bounding sphere, so they can disagree
+  // only on the actors whose bounding sphere, but not their bounding box, touches the frustum.
+  void checkSameVisibleActors(const std::vector<vl::Actor*>& reference, const std::vector<vl::Actor*>& visible, const char* name)
+  {
+    std::vector<vl::Actor*> diff;
+    std::set_symmetric_difference( reference.begin(), reference.end(), visible.begin(), visible.end(), std::back_inserter(diff) );
+    const vl::Camera* camera = rendering()->as<vl::Rendering>()->camera();
+    int missing = 0;
+    for(size_t i=0; i<diff.size(); ++i)
+      missing += camera->frustum().cull( diff[i]->boundingBox() ) ? 0 : 1;
+    if (missing)
+      vl::Log::error( vl::Say("%s: %n actors inside the frustum are not returned by both trees.\n") << name << missing );
+  }
+
   void createScene(vl::ActorCollection& actors)
   {
     actors.clear();
@@ -131,6 +287,7 @@ public:
 
 protected:
   vl::ref<vl::SceneManagerActorKdTree> mSceneKdTree;
+  vl::ref<vl::SceneManagerLinearBVH> mSceneLinearBVH;
   vl::ActorCollection mActors;
   vl::ref<vl::Text> mText;
 };
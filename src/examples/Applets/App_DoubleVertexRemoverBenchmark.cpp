@@ -0,0 +1,146 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlGraphics/DoubleVertexRemover.hpp>
+#include <vlGraphics/DrawArrays.hpp>
+
+using namespace vl;
+
+// Compares the sort based and the hash based DoubleVertexRemover on triangle soups of growing size, in which every
+// vertex is shared by up to 6 triangles. A soup of g x g quads must be welded into exactly (g+1)^2 vertices and every
+// original vertex must be found unchanged at the position given by the old to new vertex mapping.
+// The smallest welded grid is shown in wireframe.
+namespace
+{
+  // a grid of g x g quads, each quad made of 2 independent triangles
+  ref<Geometry> makeTriangleSoup(int g)
+  {
+    const int count = g * g * 6;
+    ref<ArrayFloat3> verts = new ArrayFloat3;
+    ref<ArrayFloat3> norms = new ArrayFloat3;
+    ref<ArrayFloat2> texcoords = new ArrayFloat2;
+    verts->resize(count);
+    norms->resize(count);
+    texcoords->resize(count);
+
+    const int ox[] = { 0, 1, 1, 0, 1, 0 };
+    const int oy[] = { 0, 0, 1, 0, 1, 1 };
+    int k = 0;
+    for(int y=0; y<g; ++y)
+    {
+      for(int x=0; x<g; ++x)
+      {
+        for(int c=0; c<6; ++c, ++k)
+        {
+          float fx = (float)(x + ox[c]);
+          float fy = (float)(y + oy[c]);
+          verts->at(k) = fvec3( fx, fy, (float)((int)(fx*fy) % 7) );
+          norms->at(k) = fvec3( 0, 0, 1 );
+          texcoords->at(k) = fvec2( fx / g, fy / g );
+        }
+      }
+    }
+
+    ref<Geometry> geom = new Geometry;
+    geom->setVertexArray( verts.get() );
+    geom->setNormalArray( norms.get() );
+    geom->setTexCoordArray( 0, texcoords.get() );
+    geom->drawCalls()->push_back( new DrawArrays(PT_TRIANGLES, 0, count) );
+    return geom;
+  }
+
+  // every original vertex must be found unchanged at its new position
+  bool checkWelding(const Geometry* orig, const Geometry* geom, const std::vector<u32>& old_to_new, const std::vector<u32>& new_to_old)
+  {
+    const ArrayFloat3* va = orig->vertexArray()->as<ArrayFloat3>();
+    const ArrayFloat3* vb = geom->vertexArray()->as<ArrayFloat3>();
+    const ArrayFloat2* ta = orig->texCoordArray(0)->as<ArrayFloat2>();
+    const ArrayFloat2* tb = geom->texCoordArray(0)->as<ArrayFloat2>();
+    if ( vb->size() != new_to_old.size() || va->size() != old_to_new.size() )
+      return false;
+    for(size_t i=0; i<old_to_new.size(); ++i)
+    {
+      u32 n = old_to_new[i];
+      if ( va->at(i) != vb->at(n) || ta->at(i) != tb->at(n) || old_to_new[ new_to_old[n] ] != n )
+        return false;
+    }
+    return true;
+  }
+}
+
+class App_DoubleVertexRemoverBenchmark: public BaseDemo
+{
+public:
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    ref<Geometry> welded;
+    const int grids[] = { 100, 300, 700 };
+    for(int igrid=0; igrid<3; ++igrid)
+    {
+      const int g = grids[igrid];
+      ref<Geometry> orig = makeTriangleSoup(g);
+      double sec[2] = { 0, 0 };
+      for(int hashing=0; hashing<2; ++hashing)
+      {
+        ref<Geometry> geom = makeTriangleSoup(g);
+        DoubleVertexRemover dvr;
+        dvr.setUseHashing( hashing == 1 );
+        dvr.setThreadCount(0);
+        Time timer;
+        timer.start();
+        dvr.removeDoubles( geom.get() );
+        sec[hashing] = timer.elapsed();
+        if ( geom->vertexArray()->size() != (size_t)(g+1)*(g+1) || !checkWelding( orig.get(), geom.get(), dvr.mapOldToNew(), dvr.mapNewToOld() ) )
+          Log::error( Say("%s, %nx%n grid: %n vertices welded into %n, %n expected.\n") << (hashing ? "hashing" : "sorting") 
+            << g << g << orig->vertexArray()->size() << geom->vertexArray()->size() << (g+1)*(g+1) );
+        if (igrid == 0)
+          welded = geom;
+      }
+      Log::print( Say("%nx%n grid, %n vertices: sorting %.1nms, hashing %.1nms (%.1n Mvert/s)\n") 
+        << g << g << orig->vertexArray()->size() << sec[0] * 1000.0 << sec[1] * 1000.0 << orig->vertexArray()->size() / sec[1] / 1000000.0 );
+    }
+
+    ref<Effect> fx = new Effect;
+    fx->shader()->enable(EN_DEPTH_TEST);
+    fx->shader()->gocPolygonMode()->set(PM_LINE, PM_LINE);
+    fx->shader()->gocColor()->setValue(royalblue);
+    ref<Transform> tr = new Transform( mat4::getScaling(0.1f, 0.1f, 0.1f) * mat4::getTranslation(-50, -50, 0) );
+    rendering()->as<Rendering>()->transform()->addChild(tr.get());
+    sceneManager()->tree()->addActor( welded.get(), fx.get(), tr.get() );
+  }
+};
+
+// Have fun!
+
+BaseDemo* Create_App_DoubleVertexRemoverBenchmark() { return new App_DoubleVertexRemoverBenchmark; }
@@ -0,0 +1,146 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlCore/Thread.hpp>
+#include <vlGraphics/EdgeExtractor.hpp>
+#include <vlGraphics/GeometryPrimitives.hpp>
+#include <vlGraphics/Light.hpp>
+
+using namespace vl;
+
+// Extracts the edges of a grid of 100 tessellated objects with the std::set based EdgeExtractor and with the hash based one
+// using a growing number of threads, one Geometry per task. Every run must produce the same edges, normals and crease flags
+// in the same order as the std::set based one.
+namespace
+{
+  bool sameEdges(const std::vector<EdgeExtractor::Edge>& a, const std::vector<EdgeExtractor::Edge>& b, size_t& first_difference)
+  {
+    for(first_difference=0; first_difference<a.size() && first_difference<b.size(); ++first_difference)
+    {
+      const EdgeExtractor::Edge& ea = a[first_difference];
+      const EdgeExtractor::Edge& eb = b[first_difference];
+      if ( ea.vertex1() != eb.vertex1() || ea.vertex2() != eb.vertex2() || 
+           ea.normal1() != eb.normal1() || ea.normal2() != eb.normal2() || ea.isCrease() != eb.isCrease() )
+        return false;
+    }
+    return a.size() == b.size();
+  }
+}
+
+class App_EdgeExtractorBenchmark: public BaseDemo
+{
+public:
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- 1-8: extracts the edges with hashing enabled using 1 to 8 threads.\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    ref<Effect> fx = new Effect;
+    fx->shader()->enable(EN_DEPTH_TEST);
+    fx->shader()->enable(EN_LIGHTING);
+    fx->shader()->setRenderState( new Light, 0 );
+    fx->shader()->gocMaterial()->setDiffuse(gold);
+
+    mActors = new ActorCollection;
+    int triangles = 0;
+    for(int y=0; y<10; ++y)
+    {
+      for(int x=0; x<10; ++x)
+      {
+        vec3 pos( x*2.0f - 9.0f, y*2.0f - 9.0f, 0 );
+        ref<Geometry> geom;
+        switch( (x + y) % 3 )
+        {
+          case 0: geom = makeIcosphere( pos, 1.5f, 4 ); break;
+          case 1: geom = makeTorus( pos, 1.5f, 0.4f, 64, 64 ); break;
+          case 2: geom = makeCylinder( pos, 1.2f, 1.5f, 96, 16 ); break;
+        }
+        geom->computeNormals();
+        for(int i=0; i<geom->drawCalls()->size(); ++i)
+          triangles += geom->drawCalls()->at(i)->countTriangles();
+        mActors->push_back( sceneManager()->tree()->addActor( geom.get(), fx.get(), NULL ) );
+      }
+    }
+
+    EdgeExtractor extractor;
+    Time timer;
+    timer.start();
+    extractor.extractEdges( mActors.get() );
+    mSortingTime = timer.elapsed();
+    mReference = extractor.edges();
+    Log::print( Say("%n objects, %n triangles, %n edges: std::set %.1nms\n") << mActors->size() << triangles << mReference.size() << mSortingTime*1000.0 );
+
+    extractHashing(1);
+    extractHashing( Thread::hardwareConcurrency() );
+  }
+
+  void extractHashing(int threads)
+  {
+    EdgeExtractor extractor;
+    extractor.setUseHashing(true);
+    extractor.setThreadCount(threads);
+    Time timer;
+    timer.start();
+    extractor.extractEdges( mActors.get() );
+    double sec = timer.elapsed();
+
+    size_t diff = 0;
+    if ( !sameEdges(mReference, extractor.edges(), diff) )
+      Log::error( Say("Hashing with %n thread(s): %n edges instead of %n, first difference at edge #%n.\n") 
+        << threads << extractor.edges().size() << mReference.size() << diff );
+    else
+      Log::print( Say("hashing, %n thread(s): %.1nms, %.1nx faster than std::set\n") << threads << sec*1000.0 << mSortingTime / sec );
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch, key);
+
+    if (key >= Key_1 && key <= Key_8)
+      extractHashing(key - Key_0);
+  }
+
+protected:
+  ref<ActorCollection> mActors;
+  std::vector<EdgeExtractor::Edge> mReference;
+  double mSortingTime;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_EdgeExtractorBenchmark() { return new App_EdgeExtractorBenchmark; }
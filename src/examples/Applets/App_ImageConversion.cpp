@@ -0,0 +1,297 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlCore/Image.hpp>
+#include <vlCore/ImageTools.hpp>
+
+using namespace vl;
+
+// Times Image::convertType() and Image::convertFormat() on every pair of supported types and formats plus the
+// ImageTools in place conversions. The lossless conversions must round trip exactly, the rows split across threads must
+// give the same result as a single thread and the in place expansions must match a straightforward out of place version.
+namespace
+{
+  const EImageType types[] = { IT_UNSIGNED_BYTE, IT_BYTE, IT_UNSIGNED_SHORT, IT_SHORT, IT_UNSIGNED_INT, IT_INT, IT_FLOAT };
+  const char* type_names[] = { "ubyte", "byte", "ushort", "short", "uint", "int", "float" };
+  const EImageFormat formats[] = { IF_RGB, IF_RGBA, IF_BGR, IF_BGRA, IF_RED, IF_GREEN, IF_BLUE, IF_ALPHA, IF_LUMINANCE, IF_LUMINANCE_ALPHA };
+  const char* format_names[] = { "RGB", "RGBA", "BGR", "BGRA", "RED", "GREEN", "BLUE", "ALPHA", "L", "LA" };
+
+  bool samePixels(const Image* a, const Image* b)
+  {
+    return a && b && a->requiredMemory() == b->requiredMemory() && memcmp(a->pixels(), b->pixels(), a->requiredMemory()) == 0;
+  }
+}
+
+class App_ImageConversion: public BaseDemo
+{
+public:
+  App_ImageConversion(): mSize(512), mSeed(12345) {}
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- 1-8: times convertType() and convertFormat() using 1 to 8 threads.\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+    Log::print( Say("\nImage conversion, %nx%n pixels, best of 3 runs:\n") << mSize << mSize );
+    timeConversions(1);
+    checkRoundTrips();
+    checkThreads(4);
+    checkImageTools();
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (key >= Key_1 && key <= Key_8)
+    {
+      timeConversions(key - Key_0);
+      checkThreads(key - Key_0);
+    }
+  }
+
+  unsigned int random()
+  {
+    mSeed ^= mSeed << 13;
+    mSeed ^= mSeed >> 17;
+    mSeed ^= mSeed << 5;
+    return mSeed;
+  }
+
+  ref<Image> randomImage(EImageFormat format, EImageType type)
+  {
+    ref<Image> img = new Image;
+    img->allocate2D(mSize, mSize, 1, format, type);
+    int bytes = img->requiredMemory();
+    if (img->type() == IT_FLOAT)
+    {
+      // mostly in [0,1] with some values out of range on both sides
+      float* ptr = (float*)img->pixels();
+      for(int i=0; i<bytes/4; ++i)
+        ptr[i] = (random() % 15000) / 10000.0f - 0.25f;
+    }
+    else
+    {
+      for(int i=0; i<bytes; ++i)
+        img->pixels()[i] = (unsigned char)random();
+    }
+    return img;
+  }
+
+  // total of the best of 3 times of every conversion of a group
+  void timeConversions(int threads)
+  {
+    for(int f=0; f<2; ++f)
+    {
+      double total = 0;
+      for(int s=0; s<7; ++s)
+      {
+        ref<Image> src = randomImage(f ? IF_LUMINANCE : IF_RGBA, types[s]);
+        for(int d=0; d<7; ++d)
+          total += bestOf3(src.get(), types[d], threads);
+      }
+      Log::print( Say("convertType() %s, 49 pairs, %n thread(s): %.1nms\n") << (f ? "L" : "RGBA") << threads << total * 1000.0 );
+    }
+
+    const int format_types[] = { 0, 2, 6 };
+    for(int t=0; t<3; ++t)
+    {
+      double total = 0;
+      for(int s=0; s<10; ++s)
+      {
+        ref<Image> src = randomImage(formats[s], types[format_types[t]]);
+        for(int d=0; d<10; ++d)
+          total += bestOf3(src.get(), formats[d], threads);
+      }
+      Log::print( Say("convertFormat() %s, 100 pairs, %n thread(s): %.1nms\n") << type_names[format_types[t]] << threads << total * 1000.0 );
+    }
+  }
+
+  double bestOf3(const Image* src, EImageType type, int threads)
+  {
+    double sec = 1.0e9;
+    for(int r=0; r<3; ++r)
+    {
+      Time timer;
+      timer.start();
+      ref<Image> img = src->convertType(type, threads);
+      sec = vl::min(sec, timer.elapsed());
+    }
+    return sec;
+  }
+
+  double bestOf3(const Image* src, EImageFormat format, int threads)
+  {
+    double sec = 1.0e9;
+    for(int r=0; r<3; ++r)
+    {
+      Time timer;
+      timer.start();
+      ref<Image> img = src->convertFormat(format, threads);
+      sec = vl::min(sec, timer.elapsed());
+    }
+    return sec;
+  }
+
+  // widening conversions and channel swizzles lose nothing and must give back the original pixels
+  void checkRoundTrips()
+  {
+    ref<Image> ub = randomImage(IF_RGBA, IT_UNSIGNED_BYTE);
+    const EImageType wider[] = { IT_UNSIGNED_SHORT, IT_UNSIGNED_INT, IT_FLOAT };
+    const char* wider_names[] = { "ushort", "uint", "float" };
+    for(int i=0; i<3; ++i)
+    {
+      if ( !samePixels( ub.get(), ub->convertType(wider[i])->convertType(IT_UNSIGNED_BYTE).get() ) )
+        Log::error( Say("convertType() ubyte -> %s -> ubyte changed the pixels.\n") << wider_names[i] );
+    }
+
+    const EImageFormat swizzles[] = { IF_BGRA, IF_RGBA };
+    const EImageFormat formats3[] = { IF_BGR, IF_RGB };
+    ref<Image> rgba = randomImage(IF_RGBA, IT_UNSIGNED_BYTE);
+    ref<Image> rgb  = randomImage(IF_RGB, IT_UNSIGNED_SHORT);
+    for(int i=0; i<2; ++i)
+    {
+      if ( !samePixels( rgba.get(), rgba->convertFormat(swizzles[i])->convertFormat(IF_RGBA).get() ) )
+        Log::error( Say("convertFormat() ubyte RGBA -> %s -> RGBA changed the pixels.\n") << (i ? "RGBA" : "BGRA") );
+      if ( !samePixels( rgb.get(), rgb->convertFormat(formats3[i])->convertFormat(IF_RGBA)->convertFormat(IF_RGB).get() ) )
+        Log::error( Say("convertFormat() ushort RGB -> %s -> RGBA -> RGB changed the pixels.\n") << (i ? "RGB" : "BGR") );
+    }
+  }
+
+  // the rows split in bands across threads must be converted exactly as on a single thread
+  void checkThreads(int threads)
+  {
+    for(int s=0; s<7; ++s)
+    {
+      ref<Image> src = randomImage(IF_RGBA, types[s]);
+      for(int d=0; d<7; ++d)
+      {
+        if ( !samePixels( src->convertType(types[d], 1).get(), src->convertType(types[d], threads).get() ) )
+          Log::error( Say("convertType() %s -> %s differs with %n threads.\n") << type_names[s] << type_names[d] << threads );
+      }
+      for(int d=0; d<10; ++d)
+      {
+        if ( !samePixels( src->convertFormat(formats[d], 1).get(), src->convertFormat(formats[d], threads).get() ) )
+          Log::error( Say("convertFormat() %s RGBA -> %s differs with %n threads.\n") << type_names[s] << format_names[d] << threads );
+      }
+    }
+  }
+
+  // the in place expansions compared with an out of place version, the odd width exercises the row padding
+  void checkImageTools()
+  {
+    const int w = mSize - 1;
+    const int h = mSize;
+    const int pitch3 = (w*3 + 3) / 4 * 4;
+    const int pitch1 = (w + 3) / 4 * 4;
+    ref<Image> img = new Image;
+    img->allocate2D(mSize, mSize, 1, IF_RGBA, IT_UNSIGNED_BYTE);
+    std::vector<unsigned char> src( img->requiredMemory() ), expected( w * h * 4 );
+    for(size_t i=0; i<src.size(); ++i)
+      src[i] = (unsigned char)random();
+
+    memcpy( img->pixels(), &src[0], src.size() );
+    Time timer;
+    timer.start();
+    convertRGBToRGBA(img->pixels(), w, h, 0xFF, 4);
+    double sec = timer.elapsed();
+    for(int y=0; y<h; ++y)
+    {
+      for(int x=0; x<w; ++x)
+      {
+        const unsigned char* rgb = &src[ y*pitch3 + x*3 ];
+        unsigned char* rgba = &expected[ (y*w + x)*4 ];
+        rgba[0] = rgb[0]; rgba[1] = rgb[1]; rgba[2] = rgb[2]; rgba[3] = 0xFF;
+      }
+    }
+    reportImageTools("convertRGBToRGBA()", sec, img->pixels(), expected);
+
+    TPalette3x256 palette3;
+    for(int i=0; i<256*3; ++i)
+      palette3[i] = (unsigned char)(i*5);
+    memcpy( img->pixels(), &src[0], src.size() );
+    timer.start();
+    convert8ToRGBA(palette3, img->pixels(), w, h, 0x33, 4);
+    sec = timer.elapsed();
+    for(int y=0; y<h; ++y)
+    {
+      for(int x=0; x<w; ++x)
+      {
+        const unsigned char* entry = palette3 + src[ y*pitch1 + x ]*3;
+        unsigned char* rgba = &expected[ (y*w + x)*4 ];
+        rgba[0] = entry[0]; rgba[1] = entry[1]; rgba[2] = entry[2]; rgba[3] = 0x33;
+      }
+    }
+    reportImageTools("convert8ToRGBA() RGB palette", sec, img->pixels(), expected);
+
+    TPalette4x256 palette4;
+    for(int i=0; i<256*4; ++i)
+      palette4[i] = (unsigned char)(i*7);
+    memcpy( img->pixels(), &src[0], src.size() );
+    timer.start();
+    convert8ToRGBA(palette4, img->pixels(), w, h, 4);
+    sec = timer.elapsed();
+    for(int y=0; y<h; ++y)
+      for(int x=0; x<w; ++x)
+        memcpy( &expected[ (y*w + x)*4 ], palette4 + src[ y*pitch1 + x ]*4, 4 );
+    reportImageTools("convert8ToRGBA() RGBA palette", sec, img->pixels(), expected);
+
+    // swapping twice gives back the original pixels
+    memcpy( img->pixels(), &src[0], src.size() );
+    timer.start();
+    swapBytes32_BGRA_RGBA(img->pixels(), img->requiredMemory());
+    sec = timer.elapsed();
+    swapBytes32_BGRA_RGBA(img->pixels(), img->requiredMemory());
+    expected.assign( src.begin(), src.end() );
+    reportImageTools("swapBytes32_BGRA_RGBA()", sec, img->pixels(), expected);
+  }
+
+  void reportImageTools(const char* what, double sec, const unsigned char* pixels, const std::vector<unsigned char>& expected)
+  {
+    if ( memcmp( pixels, &expected[0], expected.size() ) != 0 )
+      Log::error( Say("%s: the in place result differs from the out of place one.\n") << what );
+    else
+      Log::print( Say("%s: %.2nms, %.1n MP/s\n") << what << sec * 1000.0 << (double)mSize * mSize / 1000000.0 / sec );
+  }
+
+protected:
+  int mSize;
+  unsigned int mSeed;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_ImageConversion() { return new App_ImageConversion; }
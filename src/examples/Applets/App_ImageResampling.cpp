@@ -0,0 +1,225 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlGraphics/GeometryPrimitives.hpp>
+#include <vlCore/Image.hpp>
+#include <vlCore/Thread.hpp>
+
+using namespace vl;
+
+// Measures the throughput of Image::resample() and Image::generateMipmaps() in megapixels per second of source image,
+// for every filter with and without sRGB correct filtering. Every mipmap chain must halve down to 1x1, the linear box
+// filter must average each 2x2 block and no filter may change the color of a constant image. The generated mipmaps are
+// then shown on a textured quad.
+namespace
+{
+  const char* filterName(EImageResampleFilter filter)
+  {
+    switch(filter)
+    {
+      case IRF_Box:    return "box";
+      case IRF_Kaiser: return "kaiser";
+      default:         return "lanczos";
+    }
+  }
+}
+
+class App_ImageResampling: public BaseDemo
+{
+public:
+  App_ImageResampling(): mSize(2048), mSRGB(true) {}
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- 1-3: regenerates the mipmaps shown with the box, kaiser or lanczos filter.\n" +
+    "- S: toggles sRGB correct filtering for the keys 1-3.\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    // random noise defeats any shortcut and makes the mipmap levels easy to tell apart
+    mImage = new Image;
+    mImage->allocate2D(mSize, mSize, 4, IF_RGBA, IT_UNSIGNED_BYTE);
+    unsigned int seed = 1;
+    for(int i=0; i<mImage->requiredMemory(); ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      mImage->pixels()[i] = (unsigned char)(seed >> 16);
+    }
+
+    Log::print( Say("\nImage resampling, %nx%n RGBA8 source, %n threads:\n") << mSize << mSize << Thread::hardwareConcurrency() );
+    for(int filter=0; filter<3; ++filter)
+    {
+      generateMipmaps( (EImageResampleFilter)filter, false );
+      if (filter == IRF_Box)
+        checkBoxAverage();
+      generateMipmaps( (EImageResampleFilter)filter, true );
+    }
+    timeResample();
+    checkConstantImage();
+
+    ref<Image> img_float = mImage->convertType(IT_FLOAT);
+    Time timer;
+    timer.start();
+    img_float->generateMipmaps(IRF_Box);
+    double sec = timer.elapsed();
+    Log::print( Say("generateMipmaps() box, float: %.1nms, %.1n MP/s\n") << sec * 1000.0 << (double)mSize * mSize / 1000000.0 / sec );
+
+    // show the gamma correct box filtered chain
+    mEffect = new Effect;
+    mEffect->shader()->enable(EN_DEPTH_TEST);
+    generateMipmaps(IRF_Box, true);
+    ref<Geometry> quad = makeGrid( vec3(0,0,0), 10, 10, 2, 2, true );
+    sceneManager()->tree()->addActor( quad.get(), mEffect.get() );
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (key >= Key_1 && key <= Key_3)
+      generateMipmaps( (EImageResampleFilter)(key - Key_1), mSRGB );
+    else
+    if (key == Key_S)
+    {
+      mSRGB = !mSRGB;
+      Log::print( Say("sRGB filtering %s\n") << (mSRGB ? "on" : "off") );
+    }
+  }
+
+  // times the mipmap chain generation, checks its dimensions and shows it if the scene has been set up
+  void generateMipmaps(EImageResampleFilter filter, bool srgb)
+  {
+    Time timer;
+    timer.start();
+    mImage->generateMipmaps(filter, srgb);
+    double sec = timer.elapsed();
+    Log::print( Say("generateMipmaps() %s%s: %.1nms, %.1n MP/s\n") << filterName(filter) << (srgb ? " sRGB" : "") << sec * 1000.0 << (double)mSize * mSize / 1000000.0 / sec );
+
+    const std::vector< ref<Image> >& mips = mImage->mipmaps();
+    int size = mSize;
+    for(size_t i=0; i<mips.size(); ++i)
+    {
+      size /= 2;
+      if ( mips[i]->width() != size || mips[i]->height() != size )
+      {
+        Log::error( Say("mipmap level %n is %nx%n instead of %nx%n.\n") << i+1 << mips[i]->width() << mips[i]->height() << size << size );
+        return;
+      }
+    }
+    if (size != 1)
+      Log::error( Say("the mipmap chain stops at %nx%n.\n") << size << size );
+
+    if (mEffect)
+    {
+      mEffect->shader()->gocTextureSampler(0)->setTexture( new Texture( mImage.get(), TF_RGBA, true ) );
+      mEffect->shader()->gocTextureSampler(0)->texture()->getTexParameter()->setMinFilter(TPF_LINEAR_MIPMAP_LINEAR);
+    }
+  }
+
+  // the linear box filter averages each 2x2 block of the previous level
+  void checkBoxAverage()
+  {
+    const Image* level1 = mImage->mipmaps()[0].get();
+    const unsigned char* src = mImage->pixels();
+    const unsigned char* dst = level1->pixels();
+    for(int y=0; y<level1->height(); y+=7)
+    {
+      for(int x=0; x<level1->width(); x+=7)
+      {
+        for(int c=0; c<4; ++c)
+        {
+          int sum = src[ ((2*y  )*mSize + 2*x  )*4 + c ] + src[ ((2*y  )*mSize + 2*x+1)*4 + c ] +
+                    src[ ((2*y+1)*mSize + 2*x  )*4 + c ] + src[ ((2*y+1)*mSize + 2*x+1)*4 + c ];
+          int value = dst[ (y*level1->width() + x)*4 + c ];
+          if ( value*4 < sum - 4 || value*4 > sum + 4 )
+          {
+            Log::error( Say("box mipmap pixel %n,%n component %n is %n, the average of its 2x2 block is %.2n.\n") << x << y << c << value << sum / 4.0f );
+            return;
+          }
+        }
+      }
+    }
+  }
+
+  void timeResample()
+  {
+    for(int filter=0; filter<3; ++filter)
+    {
+      Time timer;
+      timer.start();
+      ref<Image> img = mImage->resample( 1920, 1080, 0, (EImageResampleFilter)filter );
+      double sec = timer.elapsed();
+      Log::print( Say("resample() to 1920x1080 %s: %.1nms, %.1n MP/s\n") << filterName((EImageResampleFilter)filter) << sec * 1000.0 << (double)mSize * mSize / 1000000.0 / sec );
+    }
+  }
+
+  // the filter weights are normalized: a constant image stays constant, also in the sRGB path and with ringing filters
+  void checkConstantImage()
+  {
+    ref<Image> flat = new Image;
+    flat->allocate2D(257, 129, 4, IF_RGBA, IT_UNSIGNED_BYTE);
+    const unsigned char color[] = { 200, 90, 17, 255 };
+    for(int i=0; i<flat->requiredMemory(); ++i)
+      flat->pixels()[i] = color[i % 4];
+
+    for(int filter=0; filter<3; ++filter)
+    {
+      for(int srgb=0; srgb<2; ++srgb)
+      {
+        ref<Image> img = flat->resample( 100, 300, 0, (EImageResampleFilter)filter, srgb != 0 );
+        for(int i=0; img && i<img->requiredMemory(); ++i)
+        {
+          if ( img->pixels()[i] < color[i % 4] - 1 || img->pixels()[i] > color[i % 4] + 1 )
+          {
+            Log::error( Say("resample() %s%s changed a constant image: %n instead of %n.\n") 
+              << filterName((EImageResampleFilter)filter) << (srgb ? " sRGB" : "") << img->pixels()[i] << color[i % 4] );
+            break;
+          }
+        }
+      }
+    }
+  }
+
+protected:
+  ref<Image> mImage;
+  ref<Effect> mEffect;
+  int mSize;
+  bool mSRGB;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_ImageResampling() { return new App_ImageResampling; }
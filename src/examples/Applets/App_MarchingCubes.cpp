@@ -36,7 +36,9 @@
 #include <vlGraphics/DepthSortCallback.hpp>
 #include <vlVolume/MarchingCubes.hpp>
 #include <vlVolume/VolumePlot.hpp>
+#include <vlCore/Thread.hpp>
 #include <ctime>
+#include <map>
 
 class App_MarchingCubes: public BaseDemo
 //
@@ -51,6 +53,8 @@ class App_MarchingCubes: public BaseDemo
 // Test 4: animated metaball demo implemented on top of the marching cube algorithm.
 // Test 5: animated fountain based on marching cubes.
 // Test 6: 3D function plotting with vl::VolumePlot
+// Test 7: a brush carves the test volume, only the blocks touched by the brush are re-extracted, see MarchingCubes::setBlockSize().
+//         Press N to toggle the high quality normals, which re-extracts all the blocks.
 //
 {
 public:
@@ -122,6 +126,9 @@ public:
     else
     if (mTest == 5)
       runTest5();
+    else
+    if (mTest == 7)
+      runTest7();
   }
 
   void runTest4()
@@ -239,10 +246,13 @@ public:
       mTest--;
       update = true;
     }
+    else
+    if (key == vl::Key_N && mTest == 7)
+      toggleNormals();
     if (update)
     {
-      if (mTest > 6) mTest = 0;
-      if (mTest < 0) mTest = 6;
+      if (mTest > 7) mTest = 0;
+      if (mTest < 0) mTest = 7;
       setupTest();
       updateText();
     }
@@ -534,10 +544,19 @@ public:
     mMarchingCubes.reset();
     mMarchingCubes.volumeInfo()->push_back( new vl::VolumeInfo(volume.get(), mThreshold) );
 
-    // run MarchingCubes with timing.
-    time.start();
-    mMarchingCubes.run(false);
-    vl::Log::print( vl::Say("Marching cubes: time = %.2n, verts = %n\n") << time.elapsed() << mMarchingCubes.mVertsArray->size() );
+    // run MarchingCubes with timing: single threaded first, then using all the available cores.
+    volume->setupInternalData();
+    double voxels = (double)volume->slices().x() * volume->slices().y() * volume->slices().z();
+    for(int i=0; i<2; ++i)
+    {
+      int threads = i == 0 ? 1 : vl::Thread::hardwareConcurrency();
+      mMarchingCubes.setThreadCount(threads);
+      time.start();
+      mMarchingCubes.run(false);
+      double elapsed = time.elapsed();
+      vl::Log::print( vl::Say("Marching cubes: threads = %n, time = %.2n, verts = %n, voxels/sec = %.0n\n") 
+        << threads << elapsed << mMarchingCubes.mVertsArray->size() << (elapsed > 0 ? voxels / elapsed : 0) );
+    }
 
     // setup isosurface geometry, actor and effect
 
@@ -585,9 +604,130 @@ public:
     updateText();
   }
 
+  // Carves a copy of the test volume using the block mode so that each stroke re-extracts only a few blocks.
+  void setupSculpting()
+  {
+    rendering()->as<vl::Rendering>()->camera()->setModelingMatrix( vl::mat4::getTranslation(0,0,20) );
+
+    sceneManager()->tree()->actors()->clear();
+    sceneManager()->tree()->addActor( mTextActor.get() );
+
+    // the brush modifies the voxels so we work on a copy of the image data
+    vl::ref<vl::Volume> volume = new vl::Volume;
+    volume->setup( (float*)mVolumeImage->pixels(), false, true, vl::fvec3(-5,-5,-5), vl::fvec3(+5,+5,+5), vl::ivec3(mVolumeImage->width(), mVolumeImage->height(), mVolumeImage->depth()) );
+
+    mMarchingCubes.reset();
+    mMarchingCubes.setBlockSize(8);
+    mMarchingCubes.volumeInfo()->push_back( new vl::VolumeInfo(volume.get(), mThreshold) );
+    mMarchingCubes.run(false);
+    mBrushStroke = 0;
+
+    // the arrays are updated in place by MarchingCubes::updateBufferObjects()
+    vl::ref<vl::Geometry> geom = new vl::Geometry;
+    geom->setVertexArray(mMarchingCubes.mVertsArray.get());
+    geom->setNormalArray(mMarchingCubes.mNormsArray.get());
+    geom->drawCalls()->push_back(mMarchingCubes.mDrawElements.get());
+
+    vl::ref<vl::Effect> fx = new vl::Effect;
+    fx->shader()->setRenderState( new vl::Light, 0 );
+    fx->shader()->enable(vl::EN_DEPTH_TEST);
+    fx->shader()->enable(vl::EN_LIGHTING);
+    fx->shader()->gocLightModel()->setTwoSide(true);
+    fx->shader()->gocMaterial()->setDiffuse(vl::gold);
+    fx->shader()->gocMaterial()->setBackDiffuse(vl::green);
+
+    sceneManager()->tree()->addActor(geom.get(), fx.get(), mTransform.get());
+    mTransform->setLocalMatrix(vl::mat4());
+  }
+
+  void runTest7()
+  {
+    vl::Volume* volume = mMarchingCubes.volumeInfo()->at(0)->volume();
+    const vl::ivec3& slices = volume->slices();
+
+    // the brush wanders inside the volume halving the density of the voxels it touches
+    const float t = mBrushStroke++ * 0.05f;
+    const int radius = 4;
+    vl::ivec3 center( (int)(slices.x() * (0.5f + 0.35f * cos(t))), (int)(slices.y() * (0.5f + 0.35f * sin(t * 1.3f))), (int)(slices.z() * (0.5f + 0.35f * sin(t))) );
+    vl::ivec3 min_corner = vl::max( center - vl::ivec3(radius,radius,radius), vl::ivec3(0,0,0) );
+    vl::ivec3 max_corner = vl::min( center + vl::ivec3(radius,radius,radius), slices - vl::ivec3(1,1,1) );
+    for(int z=min_corner.z(); z<=max_corner.z(); ++z)
+    for(int y=min_corner.y(); y<=max_corner.y(); ++y)
+    for(int x=min_corner.x(); x<=max_corner.x(); ++x)
+    {
+      if ( (vl::ivec3(x,y,z) - center).lengthSquared() <= radius * radius )
+        volume->value(x,y,z) *= 0.5f;
+    }
+    volume->setDataDirty(min_corner, max_corner);
+
+    vl::Time time;
+    time.start();
+    mMarchingCubes.run(false);
+    mMarchingCubes.updateBufferObjects();
+    double stroke_time = time.elapsed();
+
+    // from time to time check the incremental surface against a full extraction of the same voxels
+    if (mBrushStroke % 100 == 1)
+    {
+      vl::MarchingCubes full;
+      full.volumeInfo()->push_back( new vl::VolumeInfo(volume, mThreshold) );
+      time.start();
+      full.run(false);
+      double full_time = time.elapsed();
+
+      // the unused part of each block is padded with degenerate triangles
+      int triangles = 0;
+      const vl::ArrayAbstract* indices = mMarchingCubes.mDrawElements->indexBuffer();
+      for(size_t i=0; i+2<indices->size(); i+=3)
+      {
+        if (indices->getAsVec4(i).x() != indices->getAsVec4(i+1).x() || indices->getAsVec4(i+1).x() != indices->getAsVec4(i+2).x())
+          ++triangles;
+      }
+      int full_triangles = (int)full.mDrawElements->indexBuffer()->size() / 3;
+      if (triangles != full_triangles)
+        vl::Log::error( vl::Say("Incremental marching cubes: %n triangles, the full extraction generated %n.\n") << triangles << full_triangles );
+      else
+        vl::Log::print( vl::Say("Incremental marching cubes: stroke #%n, %n triangles, stroke update = %.2nms, full extraction = %.2nms\n") 
+          << mBrushStroke << triangles << stroke_time * 1000.0 << full_time * 1000.0 );
+    }
+  }
+
+  // Switching the normals mode must re-extract every block: with high quality normals each vertex normal
+  // must then be the same as the one computed by a full extraction for the vertex at the same position.
+  void toggleNormals()
+  {
+    mMarchingCubes.setHighQualityNormals( !mMarchingCubes.highQualityNormals() );
+    mMarchingCubes.run(false);
+    mMarchingCubes.updateBufferObjects();
+    vl::Log::print( vl::Say("Incremental marching cubes: high quality normals %s.\n") << (mMarchingCubes.highQualityNormals() ? "on" : "off") );
+    if (!mMarchingCubes.highQualityNormals())
+      return;
+
+    vl::MarchingCubes full;
+    full.volumeInfo()->push_back( new vl::VolumeInfo(mMarchingCubes.volumeInfo()->at(0)->volume(), mThreshold) );
+    full.run(false);
+    std::map<vl::fvec3, vl::fvec3> normals;
+    for(size_t i=0; i<full.mVertsArray->size(); ++i)
+      normals[full.mVertsArray->at(i)] = full.mNormsArray->at(i);
+
+    // the vertices of the unused part of each block have no counterpart and are skipped
+    int mismatches = 0;
+    for(size_t i=0; i<mMarchingCubes.mVertsArray->size(); ++i)
+    {
+      std::map<vl::fvec3, vl::fvec3>::const_iterator it = normals.find( mMarchingCubes.mVertsArray->at(i) );
+      if ( it != normals.end() && (it->second - mMarchingCubes.mNormsArray->at(i)).length() > 1.0e-5f )
+        ++mismatches;
+    }
+    if (mismatches)
+      vl::Log::error( vl::Say("Incremental marching cubes: %n normals differ from the full extraction after switching to high quality normals.\n") << mismatches );
+  }
+
   void setupTest()
   {
     sceneManager()->tree()->eraseAllChildren();
+    // only test #7 uses the block mode and low quality normals
+    mMarchingCubes.setBlockSize(0);
+    mMarchingCubes.setHighQualityNormals(true);
     if (mTest == 1)
       showVolumes(true);
     else
@@ -605,6 +745,9 @@ public:
     else
     if (mTest == 6)
       setup3Dplot();
+    else
+    if (mTest == 7)
+      setupSculpting();
 
     updateText();
   }
@@ -632,6 +775,9 @@ public:
     else
     if(mTest == 6)
       str = "Marching Cubes Test #6 - 3D Function Plotting";
+    else
+    if(mTest == 7)
+      str = "Marching Cubes Test #7 - Incremental Block Updates";
 
     str += "\n(press the <- or -> key to change test)";
     mText->setText( str );
@@ -715,6 +861,7 @@ protected:
   vl::ref<vl::Image> mColorImage;
   vl::ref<vl::Image> mDropImage;
   vl::ref<vl::Geometry> mIsosurfGeom;
+  int mBrushStroke;
   int mTest;
 };
 
@@ -42,6 +42,8 @@
 #include <vlGraphics/DoubleVertexRemover.hpp>
 #include <vlGraphics/FontManager.hpp>
 #include <vlGraphics/plugins/ioVLX.hpp>
+#include <vlGraphics/plugins/ioOBJ.hpp>
+#include <vlCore/Time.hpp>
 
 using namespace vl;
 
@@ -53,6 +55,11 @@ public:
     vl::Log::notify(appletInfo());
     openglContext()->setContinuousUpdate(false);
     rendering()->as<Rendering>()->setNearFarClippingPlanesOptimized(true);
+
+    // load OBJ files with the memory mapped, parallel parser
+    LoadWriterOBJ* obj_load_writer = defLoadWriterManager()->loadWriter<LoadWriterOBJ>();
+    if (obj_load_writer)
+      obj_load_writer->setFastParsing(true);
   }
 
   void loadModel(const std::vector<String>& files)
@@ -74,7 +81,15 @@ public:
 
     for(unsigned int i=0; i<files.size(); ++i)
     {
+      ref<VirtualFile> file = defFileSystem()->locateFile(files[i]);
+      long long file_size = file ? file->size() : 0;
+
+      Time timer;
+      timer.start();
       ref<ResourceDatabase> resource_db = loadResource(files[i], false);
+      double load_time = timer.elapsed();
+      if (load_time > 0)
+        Log::print( Say("Loaded '%s' in %.2n s, %.1n MB/s\n") << files[i] << load_time << file_size / (1024.0 * 1024.0) / load_time );
 
       if (!resource_db || resource_db->count<Actor>() == 0)
       {
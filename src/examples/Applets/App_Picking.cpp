@@ -32,15 +32,142 @@
 #include "BaseDemo.hpp"
 #include <vlGraphics/GeometryPrimitives.hpp>
 #include <vlGraphics/RayIntersector.hpp>
+#include <vlGraphics/TriangleBVH.hpp>
 #include <vlGraphics/ReadPixels.hpp>
 #include <vlGraphics/Light.hpp>
 #include <ctime>
+#include <limits>
 
 using namespace vl;
 
 class App_Picking: public BaseDemo
 {
 public:
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- Left Mouse Button: picks the object under the mouse.\n" +
+    "- B: times a grid of rays with the brute force, TriangleBVH, packet and any-hit queries.\n" +
+    "\n";
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch, key);
+
+    if (key == Key_B)
+      benchmarkRays();
+  }
+
+  // Casts a 32x32 grid of parallel rays at the scene with a brute force RayIntersector, 
+  // a TriangleBVH based one and directly through TriangleBVH::intersectPacket() and 
+  // TriangleBVH::intersectAny(), checking that they all see the same hits.
+  void benchmarkRays()
+  {
+    const int side = 32;
+    std::vector<Ray> rays(side*side);
+    for(int y=0; y<side; ++y)
+    for(int x=0; x<side; ++x)
+    {
+      rays[x+y*side].setOrigin( vec3(-4.0f + 8.0f*x/(side-1), -4.0f + 8.0f*y/(side-1), 10) );
+      rays[x+y*side].setDirection( vec3(0,0,-1) );
+    }
+
+    // build the TriangleBVH[s] beforehand so that the timings below only measure the queries
+    Time timer;
+    timer.start();
+    for(int i=0; i<mPickables->size(); ++i)
+    {
+      mPickables->at(i)->computeBounds();
+      cast<Geometry>(mPickables->at(i)->lod(0))->triangleBVH();
+    }
+    real build_time = timer.elapsed();
+
+    // closest hit distance of each ray, -1 if it misses everything
+    std::vector<float> brute_force, bvh, packet;
+    timer.start();
+    traceRays(rays, false, brute_force);
+    real brute_force_time = timer.elapsed();
+    timer.start();
+    traceRays(rays, true, bvh);
+    real bvh_time = timer.elapsed();
+
+    // the TriangleBVH queries work in object space, the transforms of this scene are pure translations 
+    // so the direction and the distances along the rays are the same as in world space
+    std::vector<fvec3> orig(rays.size()), dir(rays.size());
+    std::vector<TriangleBVH::Hit> hits(rays.size());
+    packet.assign(rays.size(), -1.0f);
+    timer.start();
+    for(int i=0; i<mPickables->size(); ++i)
+    {
+      Actor* act = mPickables->at(i);
+      mat4 inverse = act->transform()->worldMatrix().getInverse();
+      for(size_t j=0; j<rays.size(); ++j)
+      {
+        orig[j] = (fvec3)(inverse * rays[j].origin());
+        dir[j]  = (fvec3)rays[j].direction();
+      }
+      cast<Geometry>(act->lod(0))->triangleBVH()->intersectPacket(&orig[0], &dir[0], (int)rays.size(), std::numeric_limits<float>::max(), &hits[0]);
+      for(size_t j=0; j<rays.size(); ++j)
+        if (hits[j].triangle != -1 && (packet[j] < 0 || hits[j].t < packet[j]))
+          packet[j] = hits[j].t;
+    }
+    real packet_time = timer.elapsed();
+
+    // occlusion query: we only need to know whether something is in the way
+    std::vector<bool> occluded(rays.size(), false);
+    timer.start();
+    for(size_t j=0; j<rays.size(); ++j)
+    {
+      for(int i=0; i<mPickables->size() && !occluded[j]; ++i)
+      {
+        Actor* act = mPickables->at(i);
+        fvec3 o = (fvec3)(act->transform()->worldMatrix().getInverse() * rays[j].origin());
+        occluded[j] = cast<Geometry>(act->lod(0))->triangleBVH()->intersectAny(o, (fvec3)rays[j].direction(), std::numeric_limits<float>::max());
+      }
+    }
+    real any_time = timer.elapsed();
+
+    int hit_count = 0;
+    for(size_t j=0; j<rays.size(); ++j)
+    {
+      hit_count += brute_force[j] >= 0 ? 1 : 0;
+      if ( !sameDistance(brute_force[j], bvh[j]) || !sameDistance(brute_force[j], packet[j]) || occluded[j] != (brute_force[j] >= 0) )
+      {
+        Log::error( Say("Ray #%n: brute force distance %n, TriangleBVH %n, packet %n, any-hit %s.\n") 
+          << j << brute_force[j] << bvh[j] << packet[j] << (occluded[j] ? "hit" : "miss") );
+        return;
+      }
+    }
+
+    Log::print( Say("%n rays, %n hits, TriangleBVH build %.2nms:\n") << rays.size() << hit_count << build_time*1000.0 );
+    Log::print( Say("  brute force   %.2nms\n") << brute_force_time*1000.0 );
+    Log::print( Say("  TriangleBVH   %.2nms\n") << bvh_time*1000.0 );
+    Log::print( Say("  packets of 4  %.2nms\n") << packet_time*1000.0 );
+    Log::print( Say("  any-hit       %.2nms\n") << any_time*1000.0 );
+  }
+
+  void traceRays(const std::vector<Ray>& rays, bool use_bvh, std::vector<float>& distances)
+  {
+    RayIntersector intersector;
+    intersector.setUseTriangleBVH(use_bvh);
+    intersector.setClosestHitOnly(true);
+    intersector.actors()->set(*mPickables);
+    distances.resize(rays.size());
+    for(size_t i=0; i<rays.size(); ++i)
+    {
+      intersector.setRay(rays[i]);
+      intersector.intersect();
+      distances[i] = intersector.intersections().empty() ? -1.0f : intersector.intersections()[0]->distance();
+    }
+  }
+
+  static bool sameDistance(float a, float b)
+  {
+    if (a < 0 || b < 0)
+      return a < 0 && b < 0;
+    return fabs(a - b) < 1.0e-3f;
+  }
 
   void mouseDownEvent(EMouseButton, int x, int y)
   {
@@ -56,7 +183,11 @@ public:
     intersector.setFrustum( camera->computeRayFrustum( x,y ) );
     // compute the intersections!
     // (1) short way
+    // note: the first intersection with a Geometry also builds its TriangleBVH, see Geometry::triangleBVH()
+    Time timer;
+    timer.start();
     intersector.intersect(ray, sceneManager());
+    real elapsed = timer.elapsed();
     // (2) long way
     /*
     // specify the Actor[s] to be tested
@@ -77,7 +208,7 @@ public:
       mIntersectionPoint->computeWorldMatrix();
 
       // print the name of the picked object
-      Log::print( Say("Intersections detected = %n (%s).\n") << intersector.intersections().size() << intersector.intersections()[0]->actor()->objectName() );
+      Log::print( Say("Intersections detected = %n (%s) in %.3nms.\n") << intersector.intersections().size() << intersector.intersections()[0]->actor()->objectName() << elapsed*1000.0 );
     }
     else
       Log::print("No intersections detected.\n");
@@ -91,6 +222,8 @@ public:
 
     // populate our scene with some random objects
 
+    mPickables = new ActorCollection;
+
     int   count    = 1;
     float displace = 2.0f;
     for(int z=-count; z<=count; ++z)
@@ -109,6 +242,7 @@ public:
       act->setObjectName(geom->objectName().c_str());
       act->transform()->translate(x*displace, y*displace, z*displace);
       act->transform()->computeWorldMatrix();
+      mPickables->push_back(act);
     }
 
     // create a uv-sphere used to highlight the intersection point
@@ -124,6 +258,8 @@ public:
     intersection_point_geom->computeNormals();
     Actor* intersection_point_act = sceneManager()->tree()->addActor( intersection_point_geom.get(), fx.get(), new Transform );
     mIntersectionPoint = intersection_point_act->transform();
+
+    benchmarkRays();
   }
 
   // generate random objects
@@ -149,6 +285,7 @@ public:
 
 protected:
   Transform* mIntersectionPoint;
+  ref<ActorCollection> mPickables;
 };
 
 // Have fun!
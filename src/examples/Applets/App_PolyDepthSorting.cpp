@@ -37,7 +37,14 @@
 class App_PolyDepthSorting: public BaseDemo
 {
 public:
-  App_PolyDepthSorting(const vl::String& filename): mFileName(filename) {}
+  App_PolyDepthSorting(const vl::String& filename): mFileName(filename), mSortTime(0), mSortFrames(0), mLastReport(0) {}
+
+  virtual vl::String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- T: cycles the DepthSortCallback sort threshold among 0, 1, 5 and 15 degrees.\n" +
+    "\n";
+  }
 
   void initEvent()
   {
@@ -91,7 +98,11 @@ public:
     vl::ref<vl::Actor> actor_no_sort = sceneManager()->tree()->addActor( geom_no_sort.get(), effect.get(), mTransform_Left.get() );
     vl::ref<vl::Actor> actor_sort    = sceneManager()->tree()->addActor( geom_sorted.get(),  effect.get(), mTransform_Right.get() );
     /* install the vl::DepthSortCallback that will depth-sort each primitive of the Actor upon rendering */
-    actor_sort->actorEventCallbacks()->push_back( new vl::DepthSortCallback );
+    mDepthSort = new vl::DepthSortCallback;
+    actor_sort->actorEventCallbacks()->push_back( mDepthSort.get() );
+    /* the sorting is done ahead of rendering by updateScene(), see vl::DepthSortCallback::sortActors() */
+    mSortedActors = new vl::ActorCollection;
+    mSortedActors->push_back( actor_sort.get() );
 
     /* compute the appropriate offset to be used in updateTransforms() */
     geom_no_sort->computeBounds();
@@ -104,6 +115,8 @@ public:
     /* Position the camera to nicely see the objects in the scene. 
        You must call this function after having positioned your objects in the scene! */
     trackball()->adjustView( sceneManager(), vl::vec3(0,0,1), vl::vec3(0,1,0), 1.0f );
+
+    mLastReport = vl::Time::currentTime();
   }
 
   void updateTransforms()
@@ -114,13 +127,55 @@ public:
     mTransform_Right->setLocalMatrix(vl::mat4::getTranslation(+mOffset,0,0) * matrix );
   }
 
-  void updateScene() { updateTransforms(); }
+  void updateScene() 
+  { 
+    updateTransforms(); 
+
+    /* sort the transparent object before the rendering starts and report the average time spent every 2 seconds */
+    mTransform_Right->computeWorldMatrix();
+    vl::Time timer;
+    timer.start();
+    vl::DepthSortCallback::sortActors( mSortedActors.get(), rendering()->as<vl::Rendering>()->camera() );
+    mSortTime += timer.elapsed();
+    ++mSortFrames;
+    if ( vl::Time::currentTime() - mLastReport > 2.0 )
+    {
+      vl::Log::print( vl::Say("DepthSortCallback::sortActors(): %.2nms per frame, sort threshold %.0n degrees\n") 
+        << mSortTime * 1000.0 / mSortFrames << mDepthSort->sortThreshold() );
+      mSortTime = 0;
+      mSortFrames = 0;
+      mLastReport = vl::Time::currentTime();
+    }
+  }
+
+  void keyPressEvent(unsigned short ch, vl::EKey key)
+  {
+    BaseDemo::keyPressEvent(ch, key);
+
+    /* with a threshold the previous order is kept until the object has rotated by more than the given angle */
+    if (key == vl::Key_T)
+    {
+      const float thresholds[] = { 0, 1, 5, 15 };
+      int i = 0;
+      while( i < 3 && thresholds[i] != mDepthSort->sortThreshold() )
+        ++i;
+      mDepthSort->setSortThreshold( thresholds[ (i+1) % 4 ] );
+      mSortTime = 0;
+      mSortFrames = 0;
+      mLastReport = vl::Time::currentTime();
+    }
+  }
 
 protected:
   vl::ref<vl::Transform> mTransform_Left;
   vl::ref<vl::Transform> mTransform_Right;
+  vl::ref<vl::DepthSortCallback> mDepthSort;
+  vl::ref<vl::ActorCollection> mSortedActors;
   float mOffset;
   vl::String mFileName;
+  double mSortTime;
+  int mSortFrames;
+  vl::real mLastReport;
 };
 
 // Have fun!
@@ -108,6 +108,7 @@ public:
 
     PolygonSimplifier simplifier;
     simplifier.setQuick(false);
+    simplifier.setCompactMode(true);
     simplifier.setVerbose(true);
 
     simplifier.setIntput( geom );
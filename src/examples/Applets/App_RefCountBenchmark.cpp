@@ -0,0 +1,137 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlCore/Thread.hpp>
+
+using namespace vl;
+
+// Compares the cost of the three reference counting modes of vl::Object: plain counter (VL_ATOMIC_REFERENCE_COUNT 0),
+// lock-free atomic counter (Object::setAtomicRefCount()) and counter protected by a mutex (Object::setRefCountMutex()).
+// The atomic and mutex modes are also checked for lost updates with several threads copying ref<> at the same time.
+namespace
+{
+  const int SlotCount = 64;
+
+  // Stores the shared object in a ring of ref<> so that every iteration takes a reference and releases an older one.
+  void copyRefs(Object* obj, int iterations)
+  {
+    ref<Object> slots[SlotCount];
+    for(int i=0; i<iterations; ++i)
+      slots[i & (SlotCount-1)] = obj;
+  }
+
+  class CopyRefTasks: public ParallelTasks
+  {
+  public:
+    CopyRefTasks(Object* obj, int iterations): mObject(obj), mIterations(iterations) {}
+    virtual void runTask(int) { copyRefs(mObject, mIterations); }
+  protected:
+    Object* mObject;
+    int mIterations;
+  };
+}
+
+class App_RefCountBenchmark: public BaseDemo
+{
+public:
+  App_RefCountBenchmark(): mIterations(10000000) {}
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- 1-8: shares an object among the given number of threads.\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    Log::print( Say("VL_ATOMIC_REFERENCE_COUNT = %n\n") << VL_ATOMIC_REFERENCE_COUNT );
+
+    // single threaded cost of each mode
+    const char* modes[] = { "plain", "atomic", "mutex" };
+    ref<Object> obj = new Object;
+    for(int mode=0; mode<3; ++mode)
+    {
+      setMode(obj.get(), mode);
+      Time timer;
+      timer.start();
+      copyRefs(obj.get(), mIterations);
+      Log::print( Say("%s: %.2nns per reference taken and released\n") << modes[mode] << timer.elapsed() * 1000000000.0 / mIterations );
+    }
+
+    shareObject(4);
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (key >= Key_1 && key <= Key_8)
+      shareObject(key - Key_0);
+  }
+
+  void setMode(Object* obj, int mode)
+  {
+    obj->setRefCountMutex( mode == 2 ? &mMutex : NULL );
+    obj->setAtomicRefCount( mode == 1 );
+  }
+
+  // Several threads take and release references to the same object: the plain mode would lose updates here.
+  void shareObject(int thread_count)
+  {
+    ref<Object> obj = new Object;
+    for(int mode=1; mode<3; ++mode)
+    {
+      setMode(obj.get(), mode);
+      CopyRefTasks tasks(obj.get(), mIterations / thread_count);
+      Time timer;
+      timer.start();
+      Thread::runTasks(&tasks, thread_count, thread_count);
+      double ns = timer.elapsed() * 1000000000.0 / (mIterations / thread_count * thread_count);
+      if (obj->referenceCount() != 1)
+        Log::error( Say("%s mode, %n threads: the reference count is %n instead of 1.\n") << (mode == 1 ? "atomic" : "mutex") << thread_count << obj->referenceCount() );
+      else
+        Log::print( Say("%s mode, %n threads: %.2nns per reference taken and released\n") << (mode == 1 ? "atomic" : "mutex") << thread_count << ns );
+    }
+    // the object can go back to the plain mode once it is not shared anymore
+    setMode(obj.get(), 0);
+  }
+
+protected:
+  Mutex mMutex;
+  int mIterations;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_RefCountBenchmark() { return new App_RefCountBenchmark; }
@@ -0,0 +1,260 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlGraphics/GeometryPrimitives.hpp>
+#include <vlGraphics/DistanceLODEvaluator.hpp>
+#include <vlCore/Thread.hpp>
+
+using namespace vl;
+
+// Benchmarks the CPU side of the render queue construction. Nothing is rendered: the Actors are never added to a
+// SceneManager and the queue is filled calling Rendering::fillRenderQueue() directly. The queue filled by several
+// threads must contain the same tokens in the same order as the single threaded one, including the multipass
+// tokens and the LOD chosen for each Actor.
+// RenderQueue::sort() is then timed with the comparison sort and with the radix sort of the packed sort keys: the radix
+// sorted queue must respect the sorter's ordering, only the ties broken by pointer comparisons may come out differently.
+namespace
+{
+  // exposes the protected queue filling of Rendering
+  class QueueRendering: public Rendering
+  {
+  public:
+    void fill(ActorCollection* actors)
+    {
+      renderQueue()->clear();
+      fillRenderQueue(actors);
+    }
+    RenderQueue* queue() { return renderQueue(); }
+  };
+
+  struct TokenInfo
+  {
+    const Actor* mActor;
+    const Renderable* mRenderable;
+    const Shader* mShader;
+    bool operator!=(const TokenInfo& other) const { return mActor != other.mActor || mRenderable != other.mRenderable || mShader != other.mShader; }
+  };
+
+  // the tokens of every pass in queue order
+  void collectTokens(const RenderQueue* queue, std::vector<TokenInfo>& tokens)
+  {
+    tokens.clear();
+    for(int i=0; i<queue->size(); ++i)
+    {
+      for(const RenderToken* tok = queue->at(i); tok; tok = tok->mNextPass)
+      {
+        TokenInfo info = { tok->mActor, tok->mRenderable, tok->mShader };
+        tokens.push_back(info);
+      }
+    }
+  }
+
+  // true if "b" must precede "a" according to the sorter for reasons other than the pointer comparisons used to break the ties
+  bool isInversion(const RenderQueueSorter* sorter, const RenderToken* a, const RenderToken* b)
+  {
+    if ( !(*sorter)(b, a) )
+      return false;
+    return a->mActor->renderBlock() != b->mActor->renderBlock() || a->mActor->renderRank() != b->mActor->renderRank() ||
+           a->mEffectRenderRank != b->mEffectRenderRank || a->mShader->isBlendingEnabled() != b->mShader->isBlendingEnabled() ||
+           (float)a->mCameraDistance != (float)b->mCameraDistance;
+  }
+}
+
+class App_RenderQueueBenchmark: public BaseDemo
+{
+public:
+  App_RenderQueueBenchmark(): mActorCount(200000) {}
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- 1-8: fills the render queue with the given number of threads.\n" +
+    "- S: compares the comparison sort and the radix sort of the render queue.\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    // a few shared geometries and effects, some of them with 2 LODs or 2 passes
+    std::vector< ref<Geometry> > geoms;
+    for(int i=0; i<100; ++i)
+      geoms.push_back( makeBox( vec3(0,0,0), 1+i%3, 1+i%5, 1+i%7 ) );
+
+    std::vector< ref<Effect> > effects;
+    for(int i=0; i<50; ++i)
+    {
+      ref<Effect> fx = new Effect;
+      if (i % 2)
+        fx->shader()->enable(EN_DEPTH_TEST);
+      if (i % 5 == 0)
+        fx->shader()->enable(EN_BLEND);
+      if (i % 4 == 0)
+        fx->lod(0)->push_back( new Shader );
+      effects.push_back(fx);
+    }
+
+    for(int i=0; i<200; ++i)
+    {
+      mShaders.push_back( new Shader );
+      if (i % 5 == 0)
+        mShaders.back()->enable(EN_BLEND);
+      if (i % 3 == 0)
+        mShaders.back()->enable(EN_DEPTH_TEST);
+    }
+
+    ref<DistanceLODEvaluator> lod_eval = new DistanceLODEvaluator;
+    lod_eval->distanceRangeSet().push_back(250);
+
+    mActors = new ActorCollection;
+    unsigned int seed = 1;
+    for(int i=0; i<mActorCount; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      ref<Actor> act = new Actor( geoms[(seed >> 8) % geoms.size()].get(), effects[(seed >> 16) % effects.size()].get() );
+      act->setTransform( new Transform( mat4::getTranslation( (real)(i % 1000), 0, -(real)(i / 1000) * 5 ) ) );
+      act->transform()->computeWorldMatrix();
+      act->setRenderRank( (seed >> 4) % 3 );
+      if (i % 4 == 0)
+      {
+        act->setLod( 1, geoms[(i / 4) % geoms.size()].get() );
+        act->setLODEvaluator( lod_eval.get() );
+      }
+      mActors->push_back(act.get());
+    }
+
+    mRendering = new QueueRendering;
+    mRendering->camera()->setViewMatrix( mat4::getLookAt( vec3(500,100,100), vec3(500,0,-500), vec3(0,1,0) ) );
+
+    // the first fill computes the Actors' bounds, the single threaded queue is the reference
+    mRendering->setThreadCount(1);
+    mRendering->fill( mActors.get() );
+    Time timer;
+    timer.start();
+    mRendering->fill( mActors.get() );
+    double sec = timer.elapsed();
+    collectTokens( mRendering->queue(), mReference );
+    Log::print( Say("%n Actors, %n tokens\n1 thread: %.1nms, %.1nns per Actor\n") << mActorCount << mReference.size() << sec * 1000.0 << sec * 1000000000.0 / mActorCount );
+
+    fillQueue( Thread::hardwareConcurrency() );
+    compareSorts();
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (key >= Key_1 && key <= Key_8)
+      fillQueue(key - Key_0);
+    else
+    if (key == Key_S)
+      compareSorts();
+  }
+
+  void compareSorts()
+  {
+    ref<RenderQueueSorter> sorters[] = { new RenderQueueSorterStandard, new RenderQueueSorterAggressive };
+    const char* names[] = { "RenderQueueSorterStandard", "RenderQueueSorterAggressive" };
+    const int sizes[] = { 10000, 100000, 1000000 };
+
+    ref<RenderQueue> queue = new RenderQueue;
+    for(int isorter=0; isorter<2; ++isorter)
+    {
+      for(int isize=0; isize<3; ++isize)
+      {
+        const int count = sizes[isize];
+        double sec[2] = { 0, 0 };
+        int inversions = 0;
+        for(int radix=0; radix<2; ++radix)
+        {
+          // the same tokens for both runs, the Actors are reused if there are more tokens than Actors
+          queue->clear();
+          unsigned int seed = 1;
+          for(int i=0; i<count; ++i)
+          {
+            seed = seed * 1103515245 + 12345;
+            Actor* act = mActors->at( i % mActors->size() );
+            RenderToken* tok = queue->newToken(false);
+            tok->mActor = act;
+            tok->mRenderable = act->lod(0);
+            tok->mShader = mShaders[ (seed >> 8) % mShaders.size() ].get();
+            tok->mEffectRenderRank = (seed >> 4) % 2;
+          }
+
+          sorters[isorter]->setSortKeyEnabled( radix == 1 );
+          Time timer;
+          timer.start();
+          queue->sort( sorters[isorter].get(), mRendering->camera() );
+          sec[radix] = timer.elapsed();
+
+          for(int i=0; radix && i+1<queue->size(); ++i)
+            inversions += isInversion( sorters[isorter].get(), queue->at(i), queue->at(i+1) ) ? 1 : 0;
+        }
+        if (inversions)
+          Log::error( Say("%s, %n tokens: the radix sort left %n tokens out of order.\n") << names[isorter] << count << inversions );
+        else
+          Log::print( Say("%s, %n tokens: comparison sort %.1nns per token, radix sort %.1nns per token\n")
+            << names[isorter] << count << sec[0] * 1000000000.0 / count << sec[1] * 1000000000.0 / count );
+      }
+    }
+  }
+
+  void fillQueue(int thread_count)
+  {
+    mRendering->setThreadCount(thread_count);
+    Time timer;
+    timer.start();
+    mRendering->fill( mActors.get() );
+    double sec = timer.elapsed();
+
+    std::vector<TokenInfo> tokens;
+    collectTokens( mRendering->queue(), tokens );
+    size_t first_diff = 0;
+    while( first_diff < tokens.size() && first_diff < mReference.size() && !(tokens[first_diff] != mReference[first_diff]) )
+      ++first_diff;
+    if (tokens.size() != mReference.size() || first_diff != tokens.size())
+      Log::error( Say("%n thread(s): the queue differs from the single threaded one at token %n (%n tokens instead of %n).\n") << thread_count << first_diff << tokens.size() << mReference.size() );
+    else
+      Log::print( Say("%n thread(s): %.1nms, %.1nns per Actor\n") << thread_count << sec * 1000.0 << sec * 1000000000.0 / mActorCount );
+  }
+
+protected:
+  ref<QueueRendering> mRendering;
+  ref<ActorCollection> mActors;
+  std::vector< ref<Shader> > mShaders;
+  std::vector<TokenInfo> mReference;
+  int mActorCount;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_RenderQueueBenchmark() { return new App_RenderQueueBenchmark; }
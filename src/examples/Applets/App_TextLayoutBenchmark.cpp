@@ -0,0 +1,296 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlGraphics/Text.hpp>
+#include <vlGraphics/TextBatch.hpp>
+#include <vlGraphics/FontManager.hpp>
+#include <vlGraphics/ReadPixels.hpp>
+#include <vlCore/Colors.hpp>
+
+using namespace vl;
+
+// Measures the CPU side of the text rendering: the generation of the glyph quads of many labels by Text::updateLayout(),
+// the cost of the cached layout and of the Font::glyph() lookups. A layout generated again from scratch must be identical
+// to the first one and every glyph quad must lie within the boundingRect() of its label. Some of the labels are shown on screen,
+// either as one Actor each or all together through a TextBatch: the two must render the same pixels.
+class App_TextLayoutBenchmark: public BaseDemo
+{
+public:
+  App_TextLayoutBenchmark(): mLabelCount(20000), mGridCount(45), mBatchCount(2000), mUseBatch(false), mBatchChecked(false), mLookupSink(0) {}
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- L: lays out all the labels again and checks the result.\n" +
+    "- B: switches the labels on screen between one Actor each and a single TextBatch.\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    mFont = defFontManager()->acquireFont("/font/bitstream-vera/Vera.ttf", 10);
+
+    mEffect = new Effect;
+    mEffect->shader()->enable(EN_BLEND);
+
+    mLabels.clear();
+    mGridActors.clear();
+    mGridBatch = new TextBatch;
+    mGridBatchActor = new Actor( mGridBatch.get(), mEffect.get() );
+    for(int i=0; i<mLabelCount; ++i)
+    {
+      ref<Text> text = new Text;
+      text->setFont( mFont.get() );
+      text->setText( Say("Label number %n\nx = %.3n, y = %.3n") << i << i * 0.5f << i * 0.25f );
+      text->setAlignment( AlignLeft | AlignBottom );
+      text->setViewportAlignment( AlignLeft | AlignBottom );
+      mLabels.push_back(text);
+
+      // show a grid of labels, some of them with shadow or outline
+      if ( i < mGridCount )
+      {
+        text->translate( (float)(10 + (i % 3) * 170), (float)(10 + (i / 3) * 33), 0 );
+        text->setColor( i % 2 ? white : gold );
+        text->setShadowEnabled( i % 3 == 0 );
+        text->setOutlineEnabled( i % 5 == 0 );
+        text->setOutlineColor( crimson );
+        mGridActors.push_back( new Actor( text.get(), mEffect.get() ) );
+        mGridBatch->addText( text.get() );
+      }
+    }
+    showGrid();
+
+    // creates the glyphs, this requires the OpenGL context
+    Time timer;
+    timer.start();
+    mReferenceVertices.resize( mLabels.size() );
+    for(size_t i=0; i<mLabels.size(); ++i)
+    {
+      mLabels[i]->updateLayout();
+      mReferenceVertices[i] = mLabels[i]->layoutVertices();
+    }
+    Log::print( Say("First layout of %n labels, glyph creation included: %.1nms\n") << mLabelCount << timer.elapsed() * 1000.0 );
+
+    relayout();
+    timeGlyphLookup();
+    mBatchChecked = false;
+  }
+
+  // the viewport is known only after the first resize event
+  void updateScene()
+  {
+    if (!mBatchChecked)
+    {
+      mBatchChecked = true;
+      compareBatch();
+      timeBatch();
+    }
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (key == Key_L)
+      relayout();
+    else
+    if (key == Key_B)
+    {
+      mUseBatch = !mUseBatch;
+      showGrid();
+      Log::print( Say("Labels on screen: %s\n") << (mUseBatch ? "one TextBatch" : "one Actor each") );
+    }
+  }
+
+  void showGrid()
+  {
+    ActorCollection* actors = sceneManager()->tree()->actors();
+    actors->erase( mGridBatchActor.get() );
+    for(size_t i=0; i<mGridActors.size(); ++i)
+      actors->erase( mGridActors[i].get() );
+    if (mUseBatch)
+      actors->push_back( mGridBatchActor.get() );
+    else
+    {
+      for(size_t i=0; i<mGridActors.size(); ++i)
+        actors->push_back( mGridActors[i].get() );
+    }
+  }
+
+  ref<Image> renderGrid(bool use_batch)
+  {
+    bool use_batch_prev = mUseBatch;
+    mUseBatch = use_batch;
+    showGrid();
+    rendering()->render();
+    const Viewport* viewport = rendering()->as<Rendering>()->camera()->viewport();
+    ref<Image> image = new Image( viewport->width(), viewport->height(), 0, 1, IF_RGBA, IT_UNSIGNED_BYTE );
+    readPixels( image.get(), viewport->x(), viewport->y(), viewport->width(), viewport->height(), RDB_BACK_LEFT, false );
+    mUseBatch = use_batch_prev;
+    showGrid();
+    return image;
+  }
+
+  // the labels on screen don't overlap so the TextBatch layering must give exactly the same pixels as one Actor per label
+  void compareBatch()
+  {
+    ref<Image> actors = renderGrid(false);
+    ref<Image> batch = renderGrid(true);
+    int differences = 0;
+    const unsigned int* a = (const unsigned int*)actors->pixels();
+    const unsigned int* b = (const unsigned int*)batch->pixels();
+    for(int i=0; i<actors->width() * actors->height(); ++i)
+      differences += a[i] != b[i] ? 1 : 0;
+    if (differences)
+      Log::error( Say("TextBatch: %n pixels differ from the labels rendered one Actor each.\n") << differences );
+    else
+      Log::print( Say("TextBatch: %n labels in %n draw calls, same pixels as one Actor each.\n") << mGridCount << mGridBatch->lastDrawCount() );
+  }
+
+  // CPU and driver cost of rendering many labels, the z-buffer and the blending are left as they are
+  void timeBatch()
+  {
+    ref<TextBatch> batch = new TextBatch;
+    for(int i=0; i<mBatchCount; ++i)
+      batch->addText( mLabels[i].get() );
+
+    const Camera* camera = rendering()->as<Rendering>()->camera();
+    const int frames = 10;
+    Time timer;
+    double sec[] = { 0, 0 };
+    for(int use_batch=0; use_batch<2; ++use_batch)
+    {
+      glFinish();
+      timer.start();
+      for(int f=0; f<frames; ++f)
+      {
+        if (use_batch)
+          batch->render_Implementation( NULL, NULL, camera, openglContext() );
+        else
+        {
+          for(int i=0; i<mBatchCount; ++i)
+            mLabels[i]->render_Implementation( NULL, NULL, camera, openglContext() );
+        }
+      }
+      glFinish();
+      sec[use_batch] = timer.elapsed() / frames;
+    }
+    Log::print( Say("%n labels: one render per Text %.1nms, TextBatch %.1nms with %n draw calls\n") 
+      << mBatchCount << sec[0] * 1000.0 << sec[1] * 1000.0 << batch->lastDrawCount() );
+  }
+
+  void relayout()
+  {
+    // setting the text again marks the layout dirty without changing it
+    for(size_t i=0; i<mLabels.size(); ++i)
+      mLabels[i]->setText( mLabels[i]->text() );
+
+    Time timer;
+    timer.start();
+    size_t glyphs = 0;
+    for(size_t i=0; i<mLabels.size(); ++i)
+    {
+      mLabels[i]->updateLayout();
+      glyphs += mLabels[i]->layoutVertices().size() / 4;
+    }
+    double sec = timer.elapsed();
+    Log::print( Say("layout: %.1nms, %n glyphs, %.1n Mglyph/s\n") << sec * 1000.0 << glyphs << glyphs / sec / 1000000.0 );
+
+    // nothing changed: the cached quads are reused
+    timer.start();
+    for(size_t i=0; i<mLabels.size(); ++i)
+      mLabels[i]->updateLayout();
+    Log::print( Say("cached layout: %.2nms\n") << timer.elapsed() * 1000.0 );
+
+    timer.start();
+    AABB bounds;
+    for(size_t i=0; i<mLabels.size(); ++i)
+      bounds += mLabels[i]->boundingRect();
+    Log::print( Say("boundingRect(): %.2nms\n") << timer.elapsed() * 1000.0 );
+
+    checkLayout();
+  }
+
+  void checkLayout()
+  {
+    for(size_t i=0; i<mLabels.size(); ++i)
+    {
+      const std::vector<fvec2>& verts = mLabels[i]->layoutVertices();
+      if ( verts != mReferenceVertices[i] )
+      {
+        Log::error( Say("Label #%n: the new layout has %n vertices, the first one had %n or different positions.\n") << i << verts.size() << mReferenceVertices[i].size() );
+        return;
+      }
+      AABB rect = mLabels[i]->boundingRect();
+      for(size_t j=0; j<verts.size(); ++j)
+      {
+        if ( verts[j].x() < rect.minCorner().x() || verts[j].y() < rect.minCorner().y() || verts[j].x() > rect.maxCorner().x() || verts[j].y() > rect.maxCorner().y() )
+        {
+          Log::error( Say("Label #%n: glyph vertex %n,%n lies outside of the boundingRect() %n,%n - %n,%n.\n") << i << verts[j].x() << verts[j].y() 
+            << rect.minCorner().x() << rect.minCorner().y() << rect.maxCorner().x() << rect.maxCorner().y() );
+          return;
+        }
+      }
+    }
+  }
+
+  void timeGlyphLookup()
+  {
+    const int lookups = 10000000;
+    Time timer;
+    timer.start();
+    for(int i=0; i<lookups; ++i)
+      mLookupSink += (size_t)mFont->glyph( 32 + i % 90 );
+    Log::print( Say("Font::glyph(): %.2nns per lookup\n") << timer.elapsed() * 1000000000.0 / lookups );
+  }
+
+protected:
+  ref<Font> mFont;
+  ref<Effect> mEffect;
+  std::vector< ref<Text> > mLabels;
+  std::vector< ref<Actor> > mGridActors;
+  ref<TextBatch> mGridBatch;
+  ref<Actor> mGridBatchActor;
+  std::vector< std::vector<fvec2> > mReferenceVertices;
+  int mLabelCount;
+  int mGridCount;
+  int mBatchCount;
+  bool mUseBatch;
+  bool mBatchChecked;
+  // keeps the glyph lookups from being optimized away
+  volatile size_t mLookupSink;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_TextLayoutBenchmark() { return new App_TextLayoutBenchmark; }
@@ -0,0 +1,202 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlGraphics/GLSL.hpp>
+#include <vlGraphics/GeometryPrimitives.hpp>
+
+using namespace vl;
+
+// Checks GLSLProgram's uniform delta binding by counting the glUniform4fv() calls that actually reach OpenGL:
+// while the checks run the glUniform4fv entry point is replaced by a recording function forwarding to the driver.
+namespace
+{
+  PFNGLUNIFORM4FVPROC gDriverUniform4fv = NULL;
+  int gUniform4fvCalls = 0;
+
+  void APIENTRY recordUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+  {
+    ++gUniform4fvCalls;
+    gDriverUniform4fv(location, count, value);
+  }
+}
+
+class App_UniformDeltaBinding: public BaseDemo
+{
+public:
+  App_UniformDeltaBinding(): mUniformCount(64), mChecks(0), mFailed(0) {}
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- D: toggles the delta binding of the program drawing the quad and times applyUniformSet().\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    if (!Has_GLSL)
+    {
+      Log::error("OpenGL Shading Language not supported.\n");
+      Time::sleep(2000);
+      exit(1);
+    }
+
+    Log::notify(appletInfo());
+
+    mProgramA = createProgram();
+    mProgramB = createProgram();
+
+    // the same uniforms drive a visible quad every frame
+    mUniforms = new UniformSet;
+    for(int i=0; i<mUniformCount; ++i)
+    {
+      String name = Say("u%n") << i;
+      mUniforms->gocUniform( name.toStdString().c_str() )->setUniform( fvec4(0.5f, (float)i/mUniformCount, 1.0f, 1.0f) );
+    }
+
+    ref<Effect> fx = new Effect;
+    fx->shader()->setRenderState( mProgramA.get() );
+    Actor* act = sceneManager()->tree()->addActor( makeGrid(vec3(0,0,0), 10, 10, 2, 2).get(), fx.get() );
+    act->setUniformSet( mUniforms.get() );
+
+    runChecks();
+    timeApplyUniformSet();
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (key == Key_D)
+    {
+      mProgramA->setUniformDeltaBinding( !mProgramA->uniformDeltaBinding() );
+      timeApplyUniformSet();
+      openglContext()->update();
+    }
+  }
+
+  ref<GLSLProgram> createProgram()
+  {
+    String fs;
+    for(int i=0; i<mUniformCount; ++i)
+      fs += Say("uniform vec4 u%n;\n") << i;
+    fs += "void main(void)\n{\n  vec4 c = vec4(0.0);\n";
+    for(int i=0; i<mUniformCount; ++i)
+      fs += Say("  c += u%n;\n") << i;
+    fs += Say("  gl_FragColor = c / %n.0;\n}\n") << mUniformCount;
+
+    ref<GLSLProgram> glsl = new GLSLProgram;
+    glsl->attachShader( new GLSLVertexShader("void main(void) { gl_Position = ftransform(); }\n") );
+    glsl->attachShader( new GLSLFragmentShader(fs) );
+    glsl->linkProgram();
+    return glsl;
+  }
+
+  void check(const char* what, GLSLProgram* glsl, int expected)
+  {
+    glsl->useProgram();
+    gUniform4fvCalls = 0;
+    glsl->applyUniformSet( mUniforms.get() );
+    ++mChecks;
+    if (gUniform4fvCalls != expected)
+    {
+      ++mFailed;
+      Log::error( Say("%s: %n glUniform4fv() calls instead of %n.\n") << what << gUniform4fvCalls << expected );
+    }
+  }
+
+  void runChecks()
+  {
+    mChecks = mFailed = 0;
+
+    gDriverUniform4fv = vl::glUniform4fv;
+    vl::glUniform4fv = recordUniform4fv;
+
+    mProgramA->invalidateUniformCache();
+    mProgramB->invalidateUniformCache();
+    check("first apply", mProgramA.get(), mUniformCount);
+    check("unchanged values", mProgramA.get(), 0);
+
+    mUniforms->uniforms()[3]->setUniform( fvec4(1,0,0,1) );
+    check("one value changed", mProgramA.get(), 1);
+
+    ref<Uniform> clone = mUniforms->uniforms()[5]->clone();
+    mUniforms->setUniform( clone.get() );
+    check("cloned uniform", mProgramA.get(), 1);
+
+    // a second program sharing the same uniforms keeps its own cache entries
+    check("second program, first apply", mProgramB.get(), mUniformCount);
+    check("second program, unchanged values", mProgramB.get(), 0);
+    check("first program after the second one", mProgramA.get(), 0);
+
+    // writes through rawData() can't be tracked: the uniform is transmitted every time
+    Uniform* raw = mUniforms->uniforms()[7].get();
+    float* value = (float*)raw->rawData();
+    check("rawData() accessed", mProgramA.get(), 1);
+    value[0] = 0.25f;
+    check("rawData() written after access", mProgramA.get(), 1);
+
+    mProgramA->invalidateUniformCache();
+    check("invalidateUniformCache()", mProgramA.get(), mUniformCount);
+
+    vl::glUniform4fv = gDriverUniform4fv;
+    glUseProgram(0);
+
+    Log::print( Say("Uniform delta binding: %n of %n glUniform4fv() call counts as expected.\n") << mChecks - mFailed << mChecks );
+  }
+
+  // cost of applyUniformSet() with unchanged values
+  void timeApplyUniformSet()
+  {
+    const int iterations = 20000;
+    mProgramA->useProgram();
+    Time timer;
+    timer.start();
+    for(int i=0; i<iterations; ++i)
+      mProgramA->applyUniformSet( mUniforms.get() );
+    glFinish();
+    glUseProgram(0);
+    Log::print( Say("applyUniformSet() of %n unchanged uniforms, delta binding %s: %.2nus\n") 
+      << mUniformCount << (mProgramA->uniformDeltaBinding() ? "on" : "off") << timer.elapsed() * 1000000.0 / iterations );
+  }
+
+protected:
+  ref<GLSLProgram> mProgramA;
+  ref<GLSLProgram> mProgramB;
+  ref<UniformSet> mUniforms;
+  int mUniformCount;
+  int mChecks;
+  int mFailed;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_UniformDeltaBinding() { return new App_UniformDeltaBinding; }
@@ -36,6 +36,7 @@
 #include <vlGraphics/plugins/ioVLX.hpp>
 #include <vlCore/ZippedFile.hpp>
 #include <vlCore/GlobalSettings.hpp>
+#include <vlCore/Time.hpp>
 #include <vlGraphics/DistanceLODEvaluator.hpp>
 #include <vlGraphics/PixelLODEvaluator.hpp>
 #include <vlGraphics/TriangleStripGenerator.hpp>
@@ -338,6 +339,14 @@ public:
     vl::writeResource(vlx_path, res_db.get()); // save
     res_db = vl::loadResource(vlx_path); // load
     vl::writeResource(vlx_path, res_db.get()); // save
+
+    // VLB load time
+    const int load_count = 10;
+    Time timer;
+    timer.start();
+    for(int i=0; i<load_count; ++i)
+      vl::loadResource(vlx_path);
+    Log::print( Say("VLB load time: %.2n ms\n") << timer.elapsed() * 1000.0 / load_count );
   }
 
 };
@@ -0,0 +1,313 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlCore/ZippedDirectory.hpp>
+#include <vlCore/GZipCodec.hpp>
+#include <vlCore/DiskFile.hpp>
+#include <vlCore/Thread.hpp>
+#include <cstdio>
+
+using namespace vl;
+
+// Decompresses all the entries of a zip archive with ZippedDirectory::extractFiles() and ZippedDirectory::prefetchFiles()
+// and compares them with the serial file()/open()/read() of the same entries. The archive is generated in the current
+// directory on startup and deleted on exit, the content of every entry is procedural so that it can be verified.
+namespace
+{
+  const int EntryCount = 500;
+  const int EntrySize  = 256*1024;
+
+  void generateData(unsigned char* buf, int entry, int count)
+  {
+    for(int i=0; i<count; ++i)
+    {
+      unsigned int x = (unsigned int)(entry * 7919 + i / 16) * 2654435761u;
+      buf[i] = (unsigned char)( 0x20 + ((x >> 24) & 0x3F) );
+    }
+  }
+
+  String entryName(int entry) { return Say("entry_%n.bin") << entry; }
+}
+
+class App_ZipBatchExtraction: public BaseDemo
+{
+public:
+  App_ZipBatchExtraction(): mZipPath("zip_batch.zip"), mTempPath("zip_batch_entry.gz"), mSerialTime(0), mCheckSum(false), mGenerated(false) {}
+
+  ~App_ZipBatchExtraction()
+  {
+    mDirectory = NULL;
+    remove( mZipPath.toStdString().c_str() );
+  }
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- 1-8: extracts all the entries with extractFiles() using 1 to 8 threads.\n" +
+    "- C: toggles the CRC check of extractFiles(), off by default like file()/read().\n" +
+    "- P: reads all the entries with 1ms of processing each, serially and after prefetchFiles().\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    for(int i=0; i<EntryCount; ++i)
+      mNames.push_back( entryName(i) );
+    mExpected.resize(EntrySize);
+
+    Time timer;
+    timer.start();
+    if ( !generateZip() )
+    {
+      Log::error("App_ZipBatchExtraction: could not generate the test archive.\n");
+      return;
+    }
+    mGenerated = true;
+    mDirectory = new ZippedDirectory( mZipPath );
+    Log::print( Say("Generated %n entries, %nMB uncompressed, in %.1ns\n") << EntryCount << EntryCount * (EntrySize / 1024) / 1024 << timer.elapsed() );
+
+    std::vector< ref<MemoryFile> > files;
+    mSerialTime = readSerially(0, files);
+    if ( checkFiles( files, "file()" ) )
+      Log::print( Say("serial file()/open()/read(): %.1nms\n") << mSerialTime * 1000.0 );
+    extract(1);
+    extract( Thread::hardwareConcurrency() );
+    prefetch();
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (!mGenerated)
+      return;
+    if (key >= Key_1 && key <= Key_8)
+      extract(key - Key_0);
+    else
+    if (key == Key_P)
+      prefetch();
+    else
+    if (key == Key_C)
+    {
+      mCheckSum = !mCheckSum;
+      Log::print( Say("extractFiles() CRC check %s\n") << (mCheckSum ? "on" : "off") );
+    }
+  }
+
+  bool generateZip()
+  {
+    std::vector<unsigned char> buf(EntrySize);
+    std::vector<unsigned int> crcs, compressed_sizes, offsets;
+
+    ref<DiskFile> zip = new DiskFile( mZipPath );
+    if ( !zip->open(OM_WriteOnly) )
+      return false;
+
+    for(int i=0; i<EntryCount; ++i)
+    {
+      // the deflate data of a gzip stream is preceded by a 10 bytes header and followed by the CRC32 and the uncompressed size
+      ref<GZipCodec> gz = new GZipCodec( new DiskFile(mTempPath) );
+      gz->setCompressionLevel(1);
+      if ( !gz->open(OM_WriteOnly) )
+        return false;
+      generateData( &buf[0], i, EntrySize );
+      gz->write( &buf[0], EntrySize );
+      gz->close();
+
+      ref<DiskFile> in = new DiskFile( mTempPath );
+      if ( !in->open(OM_ReadOnly) )
+        return false;
+      std::vector<unsigned char> gz_data( (size_t)in->size() );
+      in->read( &gz_data[0], gz_data.size() );
+      in->close();
+      const unsigned int deflate_size = (unsigned int)gz_data.size() - 18;
+      const unsigned char* crc = &gz_data[ gz_data.size() - 8 ];
+      crcs.push_back( crc[0] | (crc[1] << 8) | (crc[2] << 16) | (crc[3] << 24) );
+      compressed_sizes.push_back( deflate_size );
+      offsets.push_back( (unsigned int)zip->position() );
+
+      // local file header
+      const std::string name = mNames[i].toStdString();
+      zip->writeUInt32(0x04034b50);
+      zip->writeUInt16(20); // version needed
+      zip->writeUInt16(0);  // flags
+      zip->writeUInt16(8);  // deflate
+      zip->writeUInt16(0);  // time
+      zip->writeUInt16(0x21); // date: 1 January 1980
+      zip->writeUInt32( crcs.back() );
+      zip->writeUInt32( deflate_size );
+      zip->writeUInt32( EntrySize );
+      zip->writeUInt16( (unsigned short)name.size() );
+      zip->writeUInt16(0);  // extra field length
+      zip->write( name.c_str(), name.size() );
+      zip->write( &gz_data[10], deflate_size );
+    }
+    remove( mTempPath.toStdString().c_str() );
+
+    // central directory
+    const unsigned int cd_offset = (unsigned int)zip->position();
+    for(int i=0; i<EntryCount; ++i)
+    {
+      const std::string name = mNames[i].toStdString();
+      zip->writeUInt32(0x02014b50);
+      zip->writeUInt16(20); // version made by
+      zip->writeUInt16(20); // version needed
+      zip->writeUInt16(0);
+      zip->writeUInt16(8);
+      zip->writeUInt16(0);
+      zip->writeUInt16(0x21);
+      zip->writeUInt32( crcs[i] );
+      zip->writeUInt32( compressed_sizes[i] );
+      zip->writeUInt32( EntrySize );
+      zip->writeUInt16( (unsigned short)name.size() );
+      zip->writeUInt16(0);  // extra field length
+      zip->writeUInt16(0);  // comment length
+      zip->writeUInt16(0);  // disk number
+      zip->writeUInt16(0);  // internal attributes
+      zip->writeUInt32(0);  // external attributes
+      zip->writeUInt32( offsets[i] );
+      zip->write( name.c_str(), name.size() );
+    }
+    const unsigned int cd_size = (unsigned int)zip->position() - cd_offset;
+
+    // end of central directory
+    zip->writeUInt32(0x06054b50);
+    zip->writeUInt16(0);
+    zip->writeUInt16(0);
+    zip->writeUInt16(EntryCount);
+    zip->writeUInt16(EntryCount);
+    zip->writeUInt32(cd_size);
+    zip->writeUInt32(cd_offset);
+    zip->writeUInt16(0);
+    zip->close();
+    return true;
+  }
+
+  // every file must contain the generated content of its entry
+  bool checkFiles(const std::vector< ref<MemoryFile> >& files, const char* method)
+  {
+    for(int i=0; i<EntryCount; ++i)
+    {
+      generateData( &mExpected[0], i, EntrySize );
+      if ( !files[i] || files[i]->size() != EntrySize || memcmp( files[i]->ptr(), &mExpected[0], EntrySize ) != 0 )
+      {
+        Log::error( Say("%s: wrong data for '%s'.\n") << method << mNames[i] );
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // file()/open()/read() of every entry into a MemoryFile followed by the given milliseconds of processing, returns the seconds elapsed
+  double readSerially(int processing_ms, std::vector< ref<MemoryFile> >& files)
+  {
+    files.clear();
+    files.resize(EntryCount);
+    Time timer;
+    timer.start();
+    for(int i=0; i<EntryCount; ++i)
+    {
+      ref<VirtualFile> file = mDirectory->file( mNames[i] );
+      if (!file)
+        continue;
+      // after a prefetchFiles() the directory returns the already decompressed data
+      files[i] = file->as<MemoryFile>();
+      if (!files[i])
+      {
+        files[i] = new MemoryFile;
+        files[i]->allocateBuffer( file->size() );
+        if ( file->open(OM_ReadOnly) )
+        {
+          file->read( files[i]->ptr(), file->size() );
+          file->close();
+        }
+      }
+      if (processing_ms)
+        Time::sleep(processing_ms);
+    }
+    return timer.elapsed();
+  }
+
+  void extract(int threads)
+  {
+    std::vector< ref<MemoryFile> > files;
+    Time timer;
+    timer.start();
+    bool ok = mDirectory->extractFiles( mNames, files, threads, mCheckSum );
+    double sec = timer.elapsed();
+    if ( !ok )
+      Log::error( Say("extractFiles() with %n thread(s) failed.\n") << threads );
+    else
+    if ( checkFiles( files, "extractFiles()" ) )
+      Log::print( Say("extractFiles(), %n thread(s): %.1nms, %.2nx the serial time\n") << threads << sec * 1000.0 << sec / mSerialTime );
+  }
+
+  void prefetch()
+  {
+    std::vector< ref<MemoryFile> > files;
+    double serial = readSerially(1, files);
+    checkFiles( files, "file()" );
+
+    mDirectory->prefetchFiles( mNames );
+    double prefetched = readSerially(1, files);
+    for(int i=0; i<EntryCount; ++i)
+    {
+      if ( !files[i]->path().endsWith( mNames[i] ) )
+      {
+        Log::error( Say("prefetchFiles(): '%s' returned for '%s'.\n") << files[i]->path() << mNames[i] );
+        return;
+      }
+    }
+    if ( checkFiles( files, "prefetchFiles()" ) )
+      Log::print( Say("with 1ms of processing per entry: serial %.1nms, prefetchFiles() %.1nms\n") << serial * 1000.0 << prefetched * 1000.0 );
+
+    // each prefetched file is handed out only once, the next file() returns a ZippedFile
+    ref<VirtualFile> again = mDirectory->file( mNames[0] );
+    if ( !again || again->as<MemoryFile>() )
+      Log::error("prefetchFiles(): a prefetched file has been returned twice.\n");
+  }
+
+protected:
+  std::vector<String> mNames;
+  std::vector<unsigned char> mExpected;
+  ref<ZippedDirectory> mDirectory;
+  String mZipPath;
+  String mTempPath;
+  double mSerialTime;
+  bool mCheckSum;
+  bool mGenerated;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_ZipBatchExtraction() { return new App_ZipBatchExtraction; }
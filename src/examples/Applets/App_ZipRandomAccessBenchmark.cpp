@@ -0,0 +1,297 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlCore/ZippedDirectory.hpp>
+#include <vlCore/GZipCodec.hpp>
+#include <vlCore/DiskFile.hpp>
+#include <cstdio>
+
+using namespace vl;
+
+// Measures the latency of random reads inside a large compressed file, both in a zip archive and in a .gz file,
+// without and with the InflateIndex checkpoints, every byte read being checked against the generated content. The test files are generated in the current directory on startup
+// and deleted on exit: the gzip stream is written with GZipCodec and its deflate data is then wrapped into a zip archive.
+namespace
+{
+  const int ReadSize = 64*1024;
+
+  // procedural, fairly compressible content so that any byte read can be verified without keeping a copy
+  void generateData(unsigned char* buf, long long pos, int count)
+  {
+    for(int i=0; i<count; ++i, ++pos)
+    {
+      unsigned int x = (unsigned int)(pos / 16) * 2654435761u;
+      buf[i] = (unsigned char)( 0x20 + ((x >> 24) & 0x3F) );
+    }
+  }
+}
+
+class App_ZipRandomAccessBenchmark: public BaseDemo
+{
+public:
+  App_ZipRandomAccessBenchmark(): mSize(2048ll*1024*1024), mGzPath("zip_benchmark.gz"), mZipPath("zip_benchmark.zip"), mGenerated(false) {}
+
+  ~App_ZipRandomAccessBenchmark()
+  {
+    remove( mGzPath.toStdString().c_str() );
+    remove( mZipPath.toStdString().c_str() );
+  }
+
+  virtual String appletInfo()
+  {
+    return BaseDemo::appletInfo() + 
+    "- 1-8: sets the checkpoint span to 1-8 MB and measures the random reads again.\n" +
+    "\n";
+  }
+
+  void initEvent()
+  {
+    Log::notify(appletInfo());
+
+    Time timer;
+    timer.start();
+    if ( !generateFiles() )
+    {
+      Log::error("App_ZipRandomAccessBenchmark: could not generate the test files.\n");
+      return;
+    }
+    mGenerated = true;
+    Log::print( Say("Generated %nMB of test data in %.1ns\n") << (int)(mSize / (1024*1024)) << timer.elapsed() );
+
+    // random offsets, the same for every run
+    unsigned int seed = 7;
+    mOffsets.clear();
+    for(int i=0; i<100; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      long long hi = seed >> 8;
+      seed = seed * 1103515245 + 12345;
+      mOffsets.push_back( ((hi << 24) | (seed >> 8)) % (mSize - ReadSize) );
+    }
+
+    runBenchmark(4);
+  }
+
+  void keyPressEvent(unsigned short ch, EKey key)
+  {
+    BaseDemo::keyPressEvent(ch,key);
+    if (key >= Key_1 && key <= Key_8 && mGenerated)
+      runBenchmark(key - Key_0);
+  }
+
+  bool generateFiles()
+  {
+    std::vector<unsigned char> buf(1024*1024);
+
+    ref<GZipCodec> gz = new GZipCodec( new DiskFile(mGzPath) );
+    gz->setCompressionLevel(1);
+    if ( !gz->open(OM_WriteOnly) )
+      return false;
+    for(long long pos=0; pos<mSize; pos+=buf.size())
+    {
+      generateData( &buf[0], pos, (int)buf.size() );
+      gz->write( &buf[0], buf.size() );
+    }
+    gz->close();
+
+    // a gzip stream is a 10 bytes header, the raw deflate data, the CRC32 and the uncompressed size
+    ref<DiskFile> in = new DiskFile( mGzPath );
+    if ( !in->open(OM_ReadOnly) )
+      return false;
+    const long long deflate_size = in->size() - 18;
+    in->seekSet( in->size() - 8 );
+    const unsigned int crc32 = in->readUInt32();
+    in->seekSet(10);
+
+    ref<DiskFile> zip = new DiskFile( mZipPath );
+    if ( !zip->open(OM_WriteOnly) )
+      return false;
+    const std::string name = "data.bin";
+
+    // local file header
+    zip->writeUInt32(0x04034b50);
+    zip->writeUInt16(20); // version needed
+    zip->writeUInt16(0);  // flags
+    zip->writeUInt16(8);  // deflate
+    zip->writeUInt16(0);  // time
+    zip->writeUInt16(0x21); // date: 1 January 1980
+    zip->writeUInt32(crc32);
+    zip->writeUInt32( (unsigned int)deflate_size );
+    zip->writeUInt32( (unsigned int)mSize );
+    zip->writeUInt16( (unsigned short)name.size() );
+    zip->writeUInt16(0);  // extra field length
+    zip->write( name.c_str(), name.size() );
+
+    for(long long left = deflate_size; left > 0; )
+    {
+      long long bytes = left < (long long)buf.size() ? left : (long long)buf.size();
+      in->read( &buf[0], bytes );
+      zip->write( &buf[0], bytes );
+      left -= bytes;
+    }
+    in->close();
+
+    // central directory with a single entry
+    const unsigned int cd_offset = (unsigned int)zip->position();
+    zip->writeUInt32(0x02014b50);
+    zip->writeUInt16(20); // version made by
+    zip->writeUInt16(20); // version needed
+    zip->writeUInt16(0);
+    zip->writeUInt16(8);
+    zip->writeUInt16(0);
+    zip->writeUInt16(0x21);
+    zip->writeUInt32(crc32);
+    zip->writeUInt32( (unsigned int)deflate_size );
+    zip->writeUInt32( (unsigned int)mSize );
+    zip->writeUInt16( (unsigned short)name.size() );
+    zip->writeUInt16(0);  // extra field length
+    zip->writeUInt16(0);  // comment length
+    zip->writeUInt16(0);  // disk number
+    zip->writeUInt16(0);  // internal attributes
+    zip->writeUInt32(0);  // external attributes
+    zip->writeUInt32(0);  // local header offset
+    zip->write( name.c_str(), name.size() );
+    const unsigned int cd_size = (unsigned int)zip->position() - cd_offset;
+
+    // end of central directory
+    zip->writeUInt32(0x06054b50);
+    zip->writeUInt16(0);
+    zip->writeUInt16(0);
+    zip->writeUInt16(1);
+    zip->writeUInt16(1);
+    zip->writeUInt32(cd_size);
+    zip->writeUInt32(cd_offset);
+    zip->writeUInt16(0);
+    zip->close();
+    return true;
+  }
+
+  // reads ReadSize bytes at each offset and checks them against the generated content, returns the average time
+  double randomReads(VirtualFile* file, int count, int& errors, long long& first_error)
+  {
+    std::vector<unsigned char> buf(ReadSize), expected(ReadSize);
+    Time timer;
+    timer.start();
+    for(int i=0; i<count; ++i)
+    {
+      bool ok = file->seekSet( mOffsets[i] ) && file->read( &buf[0], ReadSize ) == ReadSize;
+      generateData( &expected[0], mOffsets[i], ReadSize );
+      if ( !ok || memcmp( &buf[0], &expected[0], ReadSize ) != 0 )
+      {
+        if (!errors)
+          first_error = mOffsets[i];
+        ++errors;
+      }
+    }
+    return timer.elapsed() / count;
+  }
+
+  void benchmarkFile(const char* name, VirtualFile* file, InflateIndex* (*index)(VirtualFile*), void (*set_span)(VirtualFile*, long long), int span_mb)
+  {
+    std::vector<unsigned char> buf(1024*1024);
+    int errors = 0;
+    long long first_error = 0;
+
+    // without index every backward seek restarts the decompression from the beginning of the file
+    set_span(file, 0);
+    file->open(OM_ReadOnly);
+    double no_index = randomReads(file, 5, errors, first_error);
+    file->close();
+
+    // the index is built while reading the whole file once
+    set_span(file, span_mb*1024ll*1024);
+    file->open(OM_ReadOnly);
+    Time timer;
+    timer.start();
+    while( file->read( &buf[0], buf.size() ) > 0 ) {}
+    double first_pass = timer.elapsed();
+    double with_index = randomReads(file, (int)mOffsets.size(), errors, first_error);
+    int checkpoints = index(file) ? index(file)->checkpointCount() : 0;
+    checkIndex(name, index(file), span_mb*1024ll*1024);
+    file->close();
+
+    Log::print( Say("%s: random %nKB read %.1nms without index, %.2nms with %n checkpoints (first pass %.1ns)\n")
+      << name << ReadSize / 1024 << no_index * 1000.0 << with_index * 1000.0 << checkpoints << first_pass );
+    if (errors)
+      Log::error( Say("%s: %n random reads returned wrong data, the first at offset %n.\n") << name << errors << first_error );
+  }
+
+  // after a full pass the index is complete and its checkpoints are at least one span apart
+  void checkIndex(const char* name, const InflateIndex* index, long long span)
+  {
+    if ( !index || !index->isComplete() )
+    {
+      Log::error( Say("%s: the checkpoint index was not completed by the first pass.\n") << name );
+      return;
+    }
+    for(int i=1; i<index->checkpointCount(); ++i)
+    {
+      if ( index->checkpoint(i).uncompressedOffset() - index->checkpoint(i-1).uncompressedOffset() < span )
+      {
+        Log::error( Say("%s: checkpoints #%n and #%n are closer than %n bytes.\n") << name << i-1 << i << span );
+        return;
+      }
+    }
+  }
+
+  static InflateIndex* zipIndex(VirtualFile* file) { return file->as<ZippedFile>()->checkpointIndex(); }
+  static void zipSpan(VirtualFile* file, long long span) { file->as<ZippedFile>()->setCheckpointSpan(span); }
+  static InflateIndex* gzIndex(VirtualFile* file) { return file->as<GZipCodec>()->checkpointIndex(); }
+  static void gzSpan(VirtualFile* file, long long span) { file->as<GZipCodec>()->setCheckpointSpan(span); }
+
+  void runBenchmark(int span_mb)
+  {
+    Log::print( Say("\nCompressed file random access, %nMB, one checkpoint every %nMB:\n") << (int)(mSize / (1024*1024)) << span_mb );
+
+    ref<ZippedDirectory> zdir = new ZippedDirectory( mZipPath );
+    ref<ZippedFile> zfile = zdir->zippedFile("data.bin");
+    if (zfile)
+      benchmarkFile("zip", zfile.get(), zipIndex, zipSpan, span_mb);
+    else
+      Log::error("App_ZipRandomAccessBenchmark: cannot open the test zip file.\n");
+
+    ref<GZipCodec> gz = new GZipCodec( new DiskFile(mGzPath) );
+    gz->setWarnOnSeek(false);
+    benchmarkFile("gz", gz.get(), gzIndex, gzSpan, span_mb);
+  }
+
+protected:
+  std::vector<long long> mOffsets;
+  long long mSize;
+  String mGzPath;
+  String mZipPath;
+  bool mGenerated;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_ZipRandomAccessBenchmark() { return new App_ZipRandomAccessBenchmark; }
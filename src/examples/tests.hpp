@@ -89,6 +89,17 @@ BaseDemo* Create_App_ShaderOverride();
 BaseDemo* Create_App_Primitives();
 BaseDemo* Create_App_DrawCalls();
 BaseDemo* Create_App_VLX();
+BaseDemo* Create_App_RefCountBenchmark();
+BaseDemo* Create_App_RenderQueueBenchmark();
+BaseDemo* Create_App_UniformDeltaBinding();
+BaseDemo* Create_App_DoubleVertexRemoverBenchmark();
+BaseDemo* Create_App_EdgeExtractorBenchmark();
+BaseDemo* Create_App_TextLayoutBenchmark();
+BaseDemo* Create_App_ZipRandomAccessBenchmark();
+BaseDemo* Create_App_ZipBatchExtraction();
+BaseDemo* Create_App_AsyncLoadingStressTest();
+BaseDemo* Create_App_ImageResampling();
+BaseDemo* Create_App_ImageConversion();
 
 // win32 console for sdtout output
 #if defined(WIN32) && !defined(NDEBUG)
@@ -196,6 +207,17 @@ public:
       { "bezier_patch", Create_App_BezierSurfaces(), 10,10, 512, 512, vl::black, vl::vec3(4.5f,5,13), vl::vec3(4.5f,0,0) },
       { "picking", Create_App_Picking(), 10,10, 512, 512, vl::black, vl::vec3(0,0,10), vl::vec3(0,0,0) },
       { "tessellation_shader", Create_App_TessellationShader(), 10,10, 512, 512, vl::skyblue, vl::vec3(300,40,0), vl::vec3(1000,0,0) },
+      { "refcount_benchmark", Create_App_RefCountBenchmark(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
+      { "render_queue_benchmark", Create_App_RenderQueueBenchmark(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
+      { "uniform_delta_binding", Create_App_UniformDeltaBinding(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
+      { "double_vertex_remover_benchmark", Create_App_DoubleVertexRemoverBenchmark(), 10,10, 512, 512, vl::black, vl::vec3(0,0,12), vl::vec3(0,0,0) },
+      { "edge_extractor_benchmark", Create_App_EdgeExtractorBenchmark(), 10,10, 512, 512, vl::black, vl::vec3(0,0,25), vl::vec3(0,0,0) },
+      { "text_layout_benchmark", Create_App_TextLayoutBenchmark(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
+      { "zip_random_access_benchmark", Create_App_ZipRandomAccessBenchmark(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
+      { "zip_batch_extraction", Create_App_ZipBatchExtraction(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
+      { "async_loading_stress_test", Create_App_AsyncLoadingStressTest(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
+      { "image_resampling", Create_App_ImageResampling(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
+      { "image_conversion", Create_App_ImageConversion(), 10,10, 512, 512, vl::black, vl::vec3(0,10,10), vl::vec3(0,0,0) },
       // { "mini_earth", Create_App_MiniEarth(), 10,10, 512, 512, vl::black, vl::vec3(0,0,4), vl::vec3(0,0,0) },
     };
 
@@ -0,0 +1,80 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef Atomic_INCLUDE_ONCE
+#define Atomic_INCLUDE_ONCE
+
+#include <vlCore/checks.hpp>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace vl
+{
+  //! Atomically increments \p value and returns the incremented value. Implies a full memory barrier.
+  inline int atomicIncrement(volatile int& value)
+  {
+  #if defined(_MSC_VER)
+    return (int)_InterlockedIncrement((volatile long*)&value);
+  #elif defined(__GNUC__)
+    return __sync_add_and_fetch(&value, 1);
+  #else
+    #error vl::atomicIncrement() not supported on this compiler.
+  #endif
+  }
+
+  //! Atomically decrements \p value and returns the decremented value. Implies a full memory barrier.
+  inline int atomicDecrement(volatile int& value)
+  {
+  #if defined(_MSC_VER)
+    return (int)_InterlockedDecrement((volatile long*)&value);
+  #elif defined(__GNUC__)
+    return __sync_sub_and_fetch(&value, 1);
+  #else
+    #error vl::atomicDecrement() not supported on this compiler.
+  #endif
+  }
+
+  //! Atomically adds \p amount to \p value and returns the value held before the addition. Implies a full memory barrier.
+  inline int atomicFetchAdd(volatile int& value, int amount)
+  {
+  #if defined(_MSC_VER)
+    return (int)_InterlockedExchangeAdd((volatile long*)&value, (long)amount);
+  #elif defined(__GNUC__)
+    return __sync_fetch_and_add(&value, amount);
+  #else
+    #error vl::atomicFetchAdd() not supported on this compiler.
+  #endif
+  }
+}
+
+#endif
@@ -32,6 +32,11 @@
 #include <vlCore/DiskFile.hpp>
 #include <stdio.h>
 
+#if !defined(VL_PLATFORM_WINDOWS)
+  #include <sys/mman.h>
+  #include <fcntl.h>
+#endif
+
 #if defined(__APPLE__) || (__FreeBSD__)
   #define fseeko64 fseeko
 #endif
@@ -44,12 +49,15 @@ using namespace vl;
 DiskFile::DiskFile(const String& path)
 {
   mHandle = NULL;
+  mMappedMemory = NULL;
+  mMappedSize = 0;
   setPath(path);
 }
 //-----------------------------------------------------------------------------
 DiskFile::~DiskFile()
 {
   close();
+  unmapMemory();
 }
 //-----------------------------------------------------------------------------
 bool DiskFile::open(const String& path, EOpenMode mode)
@@ -328,3 +336,59 @@ ref<VirtualFile> DiskFile::clone() const
   return file;
 }
 //-----------------------------------------------------------------------------
+const void* DiskFile::mapMemory()
+{
+  if (mMappedMemory)
+    return mMappedMemory;
+
+  long long file_size = size();
+  if (file_size <= 0 || (unsigned long long)file_size > (unsigned long long)(size_t)-1)
+    return NULL;
+
+  #if defined(VL_PLATFORM_WINDOWS)
+    HANDLE hdl = CreateFile( (const wchar_t*)path().ptr(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if (hdl == INVALID_HANDLE_VALUE)
+      return NULL;
+    HANDLE mapping = CreateFileMapping( hdl, NULL, PAGE_READONLY, 0, 0, NULL );
+    // the view keeps the mapping alive after the handles are closed
+    if (mapping)
+    {
+      mMappedMemory = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+      CloseHandle(mapping);
+    }
+    CloseHandle(hdl);
+  #elif defined(__GNUG__)
+    std::vector<unsigned char> utf8;
+    path().toUTF8( utf8, false );
+    int fd = ::open( (char*)&utf8[0], O_RDONLY );
+    if (fd == -1)
+      return NULL;
+    void* ptr = mmap( NULL, (size_t)file_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close(fd);
+    mMappedMemory = ptr != MAP_FAILED ? ptr : NULL;
+  #endif
+
+  if (!mMappedMemory)
+  {
+    Log::error( Say("DiskFile::mapMemory(): could not map file '%s'\n") << path() );
+    return NULL;
+  }
+
+  mMappedSize = file_size;
+  return mMappedMemory;
+}
+//-----------------------------------------------------------------------------
+void DiskFile::unmapMemory()
+{
+  if (mMappedMemory)
+  {
+    #if defined(VL_PLATFORM_WINDOWS)
+      UnmapViewOfFile(mMappedMemory);
+    #elif defined(__GNUG__)
+      munmap(mMappedMemory, (size_t)mMappedSize);
+    #endif
+  }
+  mMappedMemory = NULL;
+  mMappedSize = 0;
+}
+//-----------------------------------------------------------------------------
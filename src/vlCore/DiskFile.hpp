@@ -66,7 +66,7 @@ namespace vl
 
     friend class DiskDirectory;
   protected:
-    DiskFile(const DiskFile& other): VirtualFile(other) {}
+    DiskFile(const DiskFile& other): VirtualFile(other), mMappedMemory(NULL), mMappedSize(0) {}
 
   public:
     DiskFile(const String& path = String());
@@ -87,10 +87,23 @@ namespace vl
 
     virtual bool exists() const;
 
-    DiskFile& operator=(const DiskFile& other) { close(); super::operator=(other); return *this; }
+    DiskFile& operator=(const DiskFile& other) { close(); unmapMemory(); super::operator=(other); return *this; }
 
     virtual ref<VirtualFile> clone() const;
 
+    /** Maps the whole file read-only in memory and returns a pointer to its content, or NULL if the file is empty or could not be mapped.
+     * The mapping is independent from open() and close() and remains valid until unmapMemory() is called or the DiskFile is destroyed. */
+    const void* mapMemory();
+
+    //! Releases the memory mapping created by mapMemory().
+    void unmapMemory();
+
+    //! The memory mapped by mapMemory() or NULL.
+    const void* mappedMemory() const { return mMappedMemory; }
+
+    //! The size in bytes of the memory mapped by mapMemory().
+    long long mappedSize() const { return mMappedSize; }
+
   protected:
     virtual long long read_Implementation(void* buffer, long long byte_count);
 
@@ -108,6 +121,8 @@ namespace vl
     #else
       FILE*  mHandle;
     #endif
+    void* mMappedMemory;
+    long long mMappedSize;
 
   protected:
   };
@@ -49,6 +49,7 @@ GZipCodec::GZipCodec(VirtualFile* stream): mStream(stream)
   memset(mZStream, 0, sizeof(z_stream_s));
   mUncompressedSize = -1;
   mWarnOnSeek = true;
+  mCheckpointSpan = 4*1024*1024;
 }
 //-----------------------------------------------------------------------------
 GZipCodec::GZipCodec(const String& gz_path): mStream(NULL) 
@@ -61,6 +62,7 @@ GZipCodec::GZipCodec(const String& gz_path): mStream(NULL)
   mUncompressedSize = -1;
   setPath(gz_path);
   mWarnOnSeek = true;
+  mCheckpointSpan = 4*1024*1024;
 }
 //-----------------------------------------------------------------------------
 GZipCodec::~GZipCodec() 
@@ -128,6 +130,17 @@ bool GZipCodec::open(EOpenMode mode)
     return false;
   }
   mStreamSize = stream()->size();
+  // build the checkpoint index while reading
+  if (mMode == ZDecompress)
+  {
+    if ( !mCheckpointIndex && checkpointSpan() > 0 )
+    {
+      mCheckpointIndex = new InflateIndex(checkpointSpan());
+      mCheckpointIndex->setCompressedSize(mStreamSize);
+    }
+    if (mCheckpointIndex)
+      mCheckpointIndex->beginStream();
+  }
   return true;
 }
 //-----------------------------------------------------------------------------
@@ -187,6 +200,8 @@ GZipCodec& GZipCodec::operator=(const GZipCodec& other)
   close(); 
   super::operator=(other); 
   mCompressionLevel = other.mCompressionLevel;
+  mCheckpointSpan = other.mCheckpointSpan;
+  mCheckpointIndex = NULL;
   if (other.mStream)
     mStream = other.mStream->clone();
   return *this; 
@@ -272,9 +287,26 @@ bool GZipCodec::seekSet_Implementation(long long pos)
 {
   if (mMode == ZDecompress)
   {
-    if (warnOnSeek())
+    if (warnOnSeek() && !(mCheckpointIndex && mCheckpointIndex->checkpointCount()))
       Log::print( Say("Performance warning: GZipCodec::seek() requested for file %s. For maximum performances avoid seeking a GZipCodec, especially avoid seeking backwards.\n") << path() );
 
+    // seek inside the data already decompressed
+    long long buffer_start = mReadBytes - mUncompressedBufferPtr;
+    if ( pos >= buffer_start && pos < buffer_start + (long long)mUncompressedBuffer.size() )
+    {
+      mUncompressedBufferPtr = (int)(pos - buffer_start);
+      mReadBytes = pos;
+      return true;
+    }
+
+    // restart from the nearest checkpoint if it saves some decompression
+    const InflateIndex::Checkpoint* cp = mCheckpointIndex ? mCheckpointIndex->findCheckpoint(pos) : NULL;
+    if ( cp && (pos < position() || cp->uncompressedOffset() > position()) )
+    {
+      if ( !restoreCheckpoint(cp) )
+        return false;
+    }
+    else
     if (pos<position())
       resetStream();
 
@@ -304,18 +336,20 @@ bool GZipCodec::fillUncompressedBuffer()
     return false;*/
   int have = 0;
   int ret  = 0;
-  /*long long compressed_read_bytes = stream()->position();*/
   long long bytes_to_read = CHUNK_SIZE < (mStreamSize - stream()->position())?
                             CHUNK_SIZE : (mStreamSize - stream()->position());
   mZStream->avail_in = (uInt)stream()->read(mZipBufferIn, bytes_to_read);
   if (mZStream->avail_in == 0)
     return true;
   mZStream->next_in = mZipBufferIn;
+  long long compressed_read_bytes = stream()->position();
+  // stop at every block boundary while the checkpoint index is being built
+  bool build_index = mCheckpointIndex && !mCheckpointIndex->isComplete();
   do
   {
     mZStream->avail_out = CHUNK_SIZE;
     mZStream->next_out  = mZipBufferOut;
-    ret = inflate(mZStream, Z_NO_FLUSH);
+    ret = inflate(mZStream, build_index ? Z_BLOCK : Z_NO_FLUSH);
     switch (ret)
     {
     case Z_STREAM_ERROR:
@@ -327,16 +361,54 @@ bool GZipCodec::fillUncompressedBuffer()
         return false;
     }
     have = CHUNK_SIZE - mZStream->avail_out;
+    if (build_index)
+      mCheckpointIndex->update(mZStream, mZipBufferOut, have, compressed_read_bytes - mZStream->avail_in, ret == Z_STREAM_END);
     if (!have)
+    {
+      if (build_index && mZStream->avail_in && ret != Z_STREAM_END)
+        continue;
       break;
+    }
     int start = (int)mUncompressedBuffer.size();
     mUncompressedBuffer.resize(start + have);
     memcpy(&mUncompressedBuffer[0] + start, mZipBufferOut, have);
   }
-  while ( mZStream->avail_out == 0 );
+  while ( mZStream->avail_out == 0 || (build_index && mZStream->avail_in && ret != Z_STREAM_END) );
   return true;
 }
 //-----------------------------------------------------------------------------
+bool GZipCodec::restoreCheckpoint(const InflateIndex::Checkpoint* cp)
+{
+  mUncompressedBufferPtr = 0;
+  mUncompressedBuffer.clear();
+  // the data following a checkpoint is decompressed as a raw deflate stream, the gzip header has already been skipped
+  if ( !mCheckpointIndex->restore(cp, mZStream, stream(), 0) )
+  {
+    Log::error("GZStream: error restoring gzip stream.\n");
+    close();
+    return false;
+  }
+  mReadBytes = cp->uncompressedOffset();
+  return true;
+}
+//-----------------------------------------------------------------------------
+void GZipCodec::setCheckpointIndex(InflateIndex* index)
+{
+  if ( index && stream() && index->compressedSize() != -1 && index->compressedSize() != compressedSize() )
+  {
+    Log::error( Say("GZipCodec::setCheckpointIndex(): the index does not match the stream '%s'.\n") << path() );
+    return;
+  }
+  mCheckpointIndex = index;
+  // restart the stream so that the index is tracked from the beginning
+  if (mCheckpointIndex && mMode == ZDecompress)
+  {
+    long long pos = position();
+    resetStream();
+    seekSet(pos);
+  }
+}
+//-----------------------------------------------------------------------------
 long long GZipCodec::uncompressedSize()
 {
   if (mMode == ZDecompress || mMode == ZNone)
@@ -377,6 +449,7 @@ void GZipCodec::setStream(VirtualFile* str)
   if (stream() && stream()->isOpen()) 
     stream()->close(); 
   mStream = str; 
+  mCheckpointIndex = NULL;
   mUncompressedSize = -1; 
   mWrittenBytes = -1; 
   setPath( str ? str->path() : String() );
@@ -33,12 +33,17 @@
 #define GZipCodec_INCLUDE_ONCE
 
 #include <vlCore/VirtualFile.hpp>
+#include <vlCore/InflateIndex.hpp>
 struct z_stream_s;
 
 namespace vl
 {
   /**
    * The GZipCodec class is a VirtualFile that transparently encodes and decodes a stream of data using the GZip compression algorithm.
+   *
+   * While decompressing, a checkpoint is taken every checkpointSpan() bytes (see InflateIndex) so that subsequent
+   * seeks restart the decompression from the nearest checkpoint instead of from the beginning of the stream.
+   * The index can be saved and reinstalled with setCheckpointIndex() to make random access fast from the first read.
    */
   class VLCORE_EXPORT GZipCodec: public VirtualFile
   {
@@ -110,6 +115,22 @@ namespace vl
     
     void setWarnOnSeek(bool warn_on) { mWarnOnSeek = warn_on; }
 
+    //! The index used to seek quickly inside the compressed stream, NULL if none has been built or installed yet.
+    InflateIndex* checkpointIndex() { return mCheckpointIndex.get(); }
+
+    //! The index used to seek quickly inside the compressed stream, NULL if none has been built or installed yet.
+    const InflateIndex* checkpointIndex() const { return mCheckpointIndex.get(); }
+
+    //! Installs an index previously built for this stream, for example loaded with InflateIndex::load(). 
+    //! An index built for a stream of a different compressed size is rejected.
+    void setCheckpointIndex(InflateIndex* index);
+
+    //! Distance in bytes between the checkpoints of an automatically built index. 0 disables the automatic index. Default is 4MB.
+    void setCheckpointSpan(long long span) { mCheckpointSpan = span; }
+
+    //! Distance in bytes between the checkpoints of an automatically built index. 0 disables the automatic index. Default is 4MB.
+    long long checkpointSpan() const { return mCheckpointSpan; }
+
   protected:
     virtual long long read_Implementation(void* buffer, long long bytes_to_read);
     virtual long long write_Implementation(const void* buffer, long long byte_count);
@@ -117,10 +138,13 @@ namespace vl
     void resetStream();
     bool seekSet_Implementation(long long pos);
     bool fillUncompressedBuffer();
+    bool restoreCheckpoint(const InflateIndex::Checkpoint* cp);
 
   protected:
     int mCompressionLevel;
     ref<VirtualFile> mStream;
+    ref<InflateIndex> mCheckpointIndex;
+    long long mCheckpointSpan;
     long long mReadBytes;
     long long mWrittenBytes;
     bool mWarnOnSeek;
@@ -39,10 +39,25 @@
 #include <vlCore/glsl_math.hpp>
 #include <vlCore/ResourceDatabase.hpp>
 #include <vlCore/LoadWriterManager.hpp>
+#include <vlCore/Thread.hpp>
 
 #include <map>
 #include <cmath>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+  #define VL_IMAGE_SSE 1
+  #include <xmmintrin.h>
+#else
+  #define VL_IMAGE_SSE 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define VL_IMAGE_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define VL_IMAGE_SSE2 0
+#endif
+
 using namespace vl;
 
 //-----------------------------------------------------------------------------
@@ -1266,7 +1281,220 @@ ref<Image> vl::loadRAW(VirtualFile* file, long long file_offset, int width, int
   }
 }
 //-----------------------------------------------------------------------------
-ref<Image> vl::Image::convertType(EImageType new_type) const
+namespace
+{
+  //! Number of rows converted by a single task by convertType() and convertFormat().
+  const int ConvertBandRows = 64;
+
+  //! Images with less samples than this are converted on the calling thread.
+  const int ConvertParallelSamples = 1 << 18;
+
+  //! Converts one row of pixels for convertType() and convertFormat().
+  class RowConverter
+  {
+  public:
+    virtual ~RowConverter() {}
+    virtual void convertRow(const unsigned char* src, unsigned char* dst) const = 0;
+  };
+
+  //! Converts the rows of an image in bands distributed over several threads.
+  class ConvertTasks: public ParallelTasks
+  {
+  public:
+    ConvertTasks(const unsigned char* src, int src_pitch, unsigned char* dst, int dst_pitch, int rows, const RowConverter* converter):
+      mSrc(src), mDst(dst), mConverter(converter), mSrcPitch(src_pitch), mDstPitch(dst_pitch), mRows(rows) {}
+
+    int taskCount() const { return (mRows + ConvertBandRows - 1) / ConvertBandRows; }
+
+    virtual void runTask(int index)
+    {
+      int end = vl::min( (index+1)*ConvertBandRows, mRows );
+      for(int i=index*ConvertBandRows; i<end; ++i)
+        mConverter->convertRow( mSrc + (size_t)mSrcPitch*i, mDst + (size_t)mDstPitch*i );
+    }
+
+  protected:
+    const unsigned char* mSrc;
+    unsigned char* mDst;
+    const RowConverter* mConverter;
+    int mSrcPitch;
+    int mDstPitch;
+    int mRows;
+  };
+
+  void runConverter(const Image* src, Image* dst, const RowConverter& converter, int row_samples, int thread_count)
+  {
+    int rows = dst->height() ? dst->height() : 1;
+    if (dst->depth())
+      rows *= dst->depth();
+    else
+    if (dst->isCubemap())
+      rows *= 6;
+
+    if ((long long)rows * row_samples < ConvertParallelSamples)
+      thread_count = 1;
+
+    ConvertTasks tasks(src->pixels(), src->pitch(), dst->pixels(), dst->pitch(), rows, &converter);
+    Thread::runTasks(&tasks, tasks.taskCount(), thread_count);
+  }
+
+  //! Maps a value to 0..1 dividing it by the maximum value of its type, clamps it and maps it to the destination type.
+  template<typename S, typename D>
+  inline D convertSample(S val, double src_max, double dst_max)
+  {
+    double dval = val / src_max;
+    dval = dval < 0.0 ? 0.0 :
+           dval > 1.0 ? 1.0 :
+           dval;
+    return (D)(dval*dst_max);
+  }
+
+  template<typename S> struct TypeInfo {};
+  template<> struct TypeInfo<unsigned char>  { typedef unsigned char  Index; static double maxValue() { return 255.0; } };
+  template<> struct TypeInfo<GLbyte>         { typedef unsigned char  Index; static double maxValue() { return 127.0; } };
+  template<> struct TypeInfo<GLushort>       { typedef unsigned short Index; static double maxValue() { return 65535.0; } };
+  template<> struct TypeInfo<GLshort>        { typedef unsigned short Index; static double maxValue() { return 32767.0; } };
+  template<> struct TypeInfo<unsigned int>   { typedef unsigned int   Index; static double maxValue() { return 4294967295.0; } };
+  template<> struct TypeInfo<int>            { typedef unsigned int   Index; static double maxValue() { return 2147483647.0; } };
+  template<> struct TypeInfo<float>          { typedef unsigned int   Index; static double maxValue() { return 1.0; } };
+
+  /**
+   * Converts the type of the samples of a row. 8 and 16 bits sources are converted with a lookup table holding
+   * the result for every possible value, the other types use the same arithmetic of convertSample().
+   */
+  template<typename S, typename D>
+  class TypeConverter: public RowConverter
+  {
+  public:
+    TypeConverter(int count, bool use_lut): mCount(count)
+    {
+      if (use_lut && sizeof(S) <= 2)
+      {
+        mLUT.resize( sizeof(S) == 1 ? 0x100 : 0x10000 );
+        for(size_t i=0; i<mLUT.size(); ++i)
+        {
+          typename TypeInfo<S>::Index index = (typename TypeInfo<S>::Index)i;
+          S val;
+          memcpy(&val, &index, sizeof(S));
+          mLUT[i] = convertSample<S,D>(val, TypeInfo<S>::maxValue(), TypeInfo<D>::maxValue());
+        }
+      }
+    }
+
+    virtual void convertRow(const unsigned char* src_row, unsigned char* dst_row) const
+    {
+      const S* src = (const S*)src_row;
+      D* dst = (D*)dst_row;
+      if (!mLUT.empty())
+      {
+        const D* lut = &mLUT[0];
+        for(int i=0; i<mCount; ++i)
+          dst[i] = lut[ (typename TypeInfo<S>::Index)src[i] ];
+      }
+      else
+      {
+        const double src_max = TypeInfo<S>::maxValue();
+        const double dst_max = TypeInfo<D>::maxValue();
+        for(int i=0; i<mCount; ++i)
+          dst[i] = convertSample<S,D>(src[i], src_max, dst_max);
+      }
+    }
+
+  protected:
+    std::vector<D> mLUT;
+    int mCount;
+  };
+
+#if VL_IMAGE_SSE2
+  //! Loads 4 floats, clamps them to 0..1 in double precision, scales them by \p scale and truncates them, like convertSample().
+  inline __m128i convertFloatSSE2(const float* src, __m128d scale)
+  {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one  = _mm_set1_pd(1.0);
+    __m128 f = _mm_loadu_ps(src);
+    // the operand order of max/min keeps -0 and NaN like the scalar comparisons
+    __m128d lo = _mm_cvtps_pd(f);
+    __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+    lo = _mm_mul_pd( _mm_min_pd(one, _mm_max_pd(zero, lo)), scale );
+    hi = _mm_mul_pd( _mm_min_pd(one, _mm_max_pd(zero, hi)), scale );
+    return _mm_unpacklo_epi64( _mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi) );
+  }
+
+  template<>
+  void TypeConverter<float, unsigned char>::convertRow(const unsigned char* src_row, unsigned char* dst_row) const
+  {
+    const float* src = (const float*)src_row;
+    const __m128d scale = _mm_set1_pd(255.0);
+    int i=0;
+    for(; i+8<=mCount; i+=8)
+    {
+      __m128i a = convertFloatSSE2(src+i, scale);
+      __m128i b = convertFloatSSE2(src+i+4, scale);
+      __m128i px = _mm_packus_epi16( _mm_packs_epi32(a, b), _mm_setzero_si128() );
+      _mm_storel_epi64((__m128i*)(dst_row+i), px);
+    }
+    for(; i<mCount; ++i)
+      dst_row[i] = convertSample<float, unsigned char>(src[i], 1.0, 255.0);
+  }
+
+  template<>
+  void TypeConverter<float, GLushort>::convertRow(const unsigned char* src_row, unsigned char* dst_row) const
+  {
+    const float* src = (const float*)src_row;
+    GLushort* dst = (GLushort*)dst_row;
+    const __m128d scale = _mm_set1_pd(65535.0);
+    // there is no unsigned 32 -> 16 bits pack in SSE2: pack the values biased by -32768 and flip the sign bit
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+    int i=0;
+    for(; i+8<=mCount; i+=8)
+    {
+      __m128i a = _mm_sub_epi32( convertFloatSSE2(src+i, scale), bias32 );
+      __m128i b = _mm_sub_epi32( convertFloatSSE2(src+i+4, scale), bias32 );
+      _mm_storeu_si128( (__m128i*)(dst+i), _mm_xor_si128(_mm_packs_epi32(a, b), bias16) );
+    }
+    for(; i<mCount; ++i)
+      dst[i] = convertSample<float, GLushort>(src[i], 1.0, 65535.0);
+  }
+
+  template<>
+  void TypeConverter<float, float>::convertRow(const unsigned char* src_row, unsigned char* dst_row) const
+  {
+    const float* src = (const float*)src_row;
+    float* dst = (float*)dst_row;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one  = _mm_set1_ps(1.0f);
+    int i=0;
+    for(; i+4<=mCount; i+=4)
+      _mm_storeu_ps( dst+i, _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(src+i))) );
+    for(; i<mCount; ++i)
+      dst[i] = convertSample<float, float>(src[i], 1.0, 1.0);
+  }
+#endif
+
+  template<typename S>
+  void convertTypeTemplate(const Image* src, Image* dst, int components, int thread_count)
+  {
+    int count = src->width() * components;
+    // a table pays off only if the image is large enough
+    int rows = dst->requiredMemory() / dst->pitch();
+    bool use_lut = sizeof(S) == 1 || ( sizeof(S) == 2 && (long long)count * rows >= 4*0x10000 );
+    switch(dst->type())
+    {
+      case IT_UNSIGNED_BYTE:  runConverter(src, dst, TypeConverter<S, unsigned char>(count, use_lut), count, thread_count); break;
+      case IT_BYTE:           runConverter(src, dst, TypeConverter<S, GLbyte>       (count, use_lut), count, thread_count); break;
+      case IT_UNSIGNED_SHORT: runConverter(src, dst, TypeConverter<S, GLushort>     (count, use_lut), count, thread_count); break;
+      case IT_SHORT:          runConverter(src, dst, TypeConverter<S, GLshort>      (count, use_lut), count, thread_count); break;
+      case IT_UNSIGNED_INT:   runConverter(src, dst, TypeConverter<S, unsigned int> (count, use_lut), count, thread_count); break;
+      case IT_INT:            runConverter(src, dst, TypeConverter<S, int>          (count, use_lut), count, thread_count); break;
+      case IT_FLOAT:          runConverter(src, dst, TypeConverter<S, float>        (count, use_lut), count, thread_count); break;
+      default:
+        break;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+ref<Image> vl::Image::convertType(EImageType new_type, int thread_count) const
 {
   switch(type())
   {
@@ -1348,77 +1576,17 @@ ref<Image> vl::Image::convertType(EImageType new_type) const
       break;
   }
 
-  int line_count = img->height()?img->height():1;
-  if (img->depth())
-    line_count *= img->depth();
-  else
-  if (img->isCubemap())
-    line_count *= 6;
-
-  for(int i=0; i<line_count; ++i)
-  {
-    const void* srcLine = pixels()      + pitch()*i;
-    void* dstLine = img->pixels() + img->pitch()*i;
-
-    const unsigned char* srcUByte  = (const unsigned char*)srcLine;
-    const GLbyte*        srcSByte  = (const GLbyte*)srcLine;
-    const GLushort*      srcUShort = (const GLushort*)srcLine;
-    const GLshort*       srcSShort = (const GLshort*)srcLine;
-    const unsigned int*  srcUInt   = (const unsigned int*)srcLine;
-    const int*           srcSInt   = (const int*)srcLine;
-    const float*         srcFloat  = (const float*)srcLine;
-
-    unsigned char* dstUByte  = (unsigned char*)dstLine;
-    GLbyte*        dstSByte  = (GLbyte*)dstLine;
-    GLushort*      dstUShort = (GLushort*)dstLine;
-    GLshort*       dstSShort = (GLshort*)dstLine;
-    unsigned int*  dstUInt   = (unsigned int*)dstLine;
-    int*           dstSInt   = (int*)dstLine;
-    float*         dstFloat  = (float*)dstLine;
-
-    for(int j=0; j<img->width(); ++j)
-    {
-      for(int c=0; c<components; ++c)
-      {
-        double dval = 0;
-        long long qint = 0;
-
-        // convert dst format to double
-
-        switch(type())
-        {
-          case IT_UNSIGNED_BYTE:  qint = *srcUByte;  dval = qint/255.0; ++srcUByte; break;
-          case IT_BYTE:           qint = *srcSByte;  dval = qint/127.0; ++srcSByte; break;
-          case IT_UNSIGNED_SHORT: qint = *srcUShort; dval = qint/65535.0; ++srcUShort; break;
-          case IT_SHORT:          qint = *srcSShort; dval = qint/32767.0; ++srcSShort; break;
-          case IT_UNSIGNED_INT:   qint = *srcUInt;   dval = qint/4294967295.0; ++srcUInt; break;
-          case IT_INT:            qint = *srcSInt;   dval = qint/2147483647.0; ++srcSInt; break;
-          case IT_FLOAT:          dval = *srcFloat;  ++srcFloat; break;
-          default:
-            return NULL;
-        }
-
-        // clamp 0.0 >= dval >= 1.0
-        dval = dval < 0.0 ? 0.0 :
-               dval > 1.0 ? 1.0 :
-               dval;
-
-        // convert double to dst format
-
-        switch(img->type())
-        {
-          case IT_UNSIGNED_BYTE:  *dstUByte  = (unsigned char) (dval*255.0); ++dstUByte; break;
-          case IT_BYTE:           *dstSByte  = (GLbyte)  (dval*127.0); ++dstSByte; break;
-          case IT_UNSIGNED_SHORT: *dstUShort = (GLushort)(dval*65535.0); ++dstUShort; break;
-          case IT_SHORT:          *dstSShort = (GLshort) (dval*32767.0); ++dstSShort; break;
-          case IT_UNSIGNED_INT:   *dstUInt   = (unsigned int)  (dval*4294967295.0); ++dstUInt; break;
-          case IT_INT:            *dstSInt   = (int)   (dval*2147483647.0); ++dstSInt; break;
-          case IT_FLOAT:          *dstFloat  = (float)dval; ++dstFloat; break;
-          default:
-            return NULL;
-        }
-      }
-    }
+  switch(type())
+  {
+    case IT_UNSIGNED_BYTE:  convertTypeTemplate<unsigned char>(this, img.get(), components, thread_count); break;
+    case IT_BYTE:           convertTypeTemplate<GLbyte>       (this, img.get(), components, thread_count); break;
+    case IT_UNSIGNED_SHORT: convertTypeTemplate<GLushort>     (this, img.get(), components, thread_count); break;
+    case IT_SHORT:          convertTypeTemplate<GLshort>      (this, img.get(), components, thread_count); break;
+    case IT_UNSIGNED_INT:   convertTypeTemplate<unsigned int> (this, img.get(), components, thread_count); break;
+    case IT_INT:            convertTypeTemplate<int>          (this, img.get(), components, thread_count); break;
+    case IT_FLOAT:          convertTypeTemplate<float>        (this, img.get(), components, thread_count); break;
+    default:
+      return NULL;
   }
 
   return img;
@@ -1623,66 +1791,203 @@ namespace
     int r,g,b,a,l;
   };
 
-  template<typename T>
-  void convert(const T*src_px, T*dst_px, T max_value, const rgbal& srco, const rgbal& dsto)
+  //! Special values of FormatConverter::mMap.
+  enum { MapZero = -1, MapMax = -2, MapGray = -3 };
+
+  /**
+   * Computes for each destination component the source component it is copied from or one of MapZero, MapMax and MapGray.
+   * - Missing color components are set to zero, a missing alpha is set to the maximum value.
+   * - Luminance is computed from r, g and b if all present, otherwise it is copied from the only one available.
+   * - r, g and b are copied from the luminance if the source has no color.
+   */
+  void computeFormatMap(const rgbal& srco, const rgbal& dsto, int* map)
   {
     // set dst default values first
     if (dsto.r != -1)
-      dst_px[dsto.r] = 0;
+      map[dsto.r] = MapZero;
     if (dsto.g != -1)
-      dst_px[dsto.g] = 0;
+      map[dsto.g] = MapZero;
     if (dsto.b != -1)
-      dst_px[dsto.b] = 0;
+      map[dsto.b] = MapZero;
     if (dsto.a != -1)
-      dst_px[dsto.a] = max_value;
+      map[dsto.a] = MapMax;
     if (dsto.l != -1)
-      dst_px[dsto.l] = 0;
+      map[dsto.l] = MapZero;
 
     // try copy src -> dst
     if (dsto.r != -1 && srco.r != -1 )
-      dst_px[dsto.r] = src_px[srco.r];
+      map[dsto.r] = srco.r;
     if (dsto.g != -1 && srco.g != -1)
-      dst_px[dsto.g] = src_px[srco.g];
+      map[dsto.g] = srco.g;
     if (dsto.b != -1 && srco.b != -1)
-      dst_px[dsto.b] = src_px[srco.b];
+      map[dsto.b] = srco.b;
     if (dsto.a != -1 && srco.a != -1)
-      dst_px[dsto.a] = src_px[srco.a];
+      map[dsto.a] = srco.a;
     if (dsto.l != -1 && srco.l != -1)
-      dst_px[dsto.l] = src_px[srco.l];
+      map[dsto.l] = srco.l;
 
     // try rgb -> gray conversion
     if (dsto.l != -1 && srco.r != -1 && srco.g != -1 && srco.b != -1)
-    {
-      dvec3 col(src_px[srco.r], src_px[srco.g], src_px[srco.b]);
-      double gray = dot(col / dvec3(max_value,max_value,max_value), dvec3(0.299,0.587,0.114));
-      dst_px[dsto.l] = T(gray * max_value);
-    }
+      map[dsto.l] = MapGray;
     else
     // try r -> gray conversion
     if (dsto.l != -1 && srco.r != -1 && srco.g == -1 && srco.b == -1)
-      dst_px[dsto.l] = src_px[srco.r];
+      map[dsto.l] = srco.r;
     else
     // try g -> gray conversion
     if (dsto.l != -1 && srco.r == -1 && srco.g != -1 && srco.b == -1)
-      dst_px[dsto.l] = src_px[srco.g];
+      map[dsto.l] = srco.g;
     else
     // try b -> gray conversion
     if (dsto.l != -1 && srco.r == -1 && srco.g == -1 && srco.b != -1)
-      dst_px[dsto.l] = src_px[srco.b];
+      map[dsto.l] = srco.b;
     else
     // try gray -> r,g,b
     if (srco.l != -1)
     {
       if (dsto.r != -1)
-        dst_px[dsto.r] = src_px[srco.l];
+        map[dsto.r] = srco.l;
       if (dsto.g != -1)
-        dst_px[dsto.g] = src_px[srco.l];
+        map[dsto.g] = srco.l;
       if (dsto.b != -1)
-        dst_px[dsto.b] = src_px[srco.l];
+        map[dsto.b] = srco.l;
+    }
+  }
+
+  //! Converts a row of \p SC components pixels into \p DC components pixels following the map computed by computeFormatMap().
+  template<typename T, int SC, int DC>
+  class FormatConverter: public RowConverter
+  {
+  public:
+    FormatConverter(int width, const int* map, const rgbal& srco, T max_value): mSrco(srco), mWidth(width), mMaxValue(max_value), mGray(false)
+    {
+      // the pixel is extended with the constants: [ src components | 0 | max_value | gray ]
+      for(int c=0; c<DC; ++c)
+      {
+        mMap[c] = map[c] >= 0 ? map[c] : SC - 1 - map[c];
+        mGray |= map[c] == MapGray;
+      }
+    }
+
+    virtual void convertRow(const unsigned char* src_row, unsigned char* dst_row) const
+    {
+      const T* src_px = (const T*)src_row;
+      T* dst_px = (T*)dst_row;
+      T px[SC+3];
+      px[SC+0] = 0;
+      px[SC+1] = mMaxValue;
+      px[SC+2] = 0;
+      for(int x=0; x<mWidth; ++x, src_px+=SC, dst_px+=DC)
+      {
+        for(int c=0; c<SC; ++c)
+          px[c] = src_px[c];
+        if (mGray)
+        {
+          dvec3 col(src_px[mSrco.r], src_px[mSrco.g], src_px[mSrco.b]);
+          double gray = dot(col / dvec3(mMaxValue,mMaxValue,mMaxValue), dvec3(0.299,0.587,0.114));
+          px[SC+2] = T(gray * mMaxValue);
+        }
+        for(int c=0; c<DC; ++c)
+          dst_px[c] = px[mMap[c]];
+      }
+    }
+
+  protected:
+    rgbal mSrco;
+    int mMap[DC];
+    int mWidth;
+    T mMaxValue;
+    bool mGray;
+  };
+
+  //! Swaps the first and third byte of every 4 bytes pixel, i.e. RGBA <-> BGRA.
+  class SwapRBConverter: public RowConverter
+  {
+  public:
+    SwapRBConverter(int width): mWidth(width) {}
+
+    virtual void convertRow(const unsigned char* src, unsigned char* dst) const
+    {
+      int x=0;
+#if VL_IMAGE_SSE2
+      const __m128i ga = _mm_set1_epi32(0xFF00FF00);
+      const __m128i ch = _mm_set1_epi32(0x000000FF);
+      for(; x+4<=mWidth; x+=4)
+      {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src+x*4));
+        __m128i rb = _mm_or_si128( _mm_and_si128(_mm_srli_epi32(px, 16), ch), _mm_slli_epi32(_mm_and_si128(px, ch), 16) );
+        _mm_storeu_si128( (__m128i*)(dst+x*4), _mm_or_si128(_mm_and_si128(px, ga), rb) );
+      }
+#endif
+      for(; x<mWidth; ++x)
+      {
+        dst[x*4+0] = src[x*4+2];
+        dst[x*4+1] = src[x*4+1];
+        dst[x*4+2] = src[x*4+0];
+        dst[x*4+3] = src[x*4+3];
+      }
+    }
+
+  protected:
+    int mWidth;
+  };
+
+  //! Copies the rows unchanged.
+  class CopyConverter: public RowConverter
+  {
+  public:
+    CopyConverter(int bytes): mBytes(bytes) {}
+
+    virtual void convertRow(const unsigned char* src, unsigned char* dst) const { memcpy(dst, src, mBytes); }
+
+  protected:
+    int mBytes;
+  };
+
+  template<typename T, int SC>
+  void convertFormatTemplate(const Image* src, Image* dst, int dst_comp, const int* map, const rgbal& srco, T max_value, int thread_count)
+  {
+    int w = src->width();
+    switch(dst_comp)
+    {
+      case 1: runConverter(src, dst, FormatConverter<T,SC,1>(w, map, srco, max_value), w*SC, thread_count); break;
+      case 2: runConverter(src, dst, FormatConverter<T,SC,2>(w, map, srco, max_value), w*SC, thread_count); break;
+      case 3: runConverter(src, dst, FormatConverter<T,SC,3>(w, map, srco, max_value), w*SC, thread_count); break;
+      case 4: runConverter(src, dst, FormatConverter<T,SC,4>(w, map, srco, max_value), w*SC, thread_count); break;
+      default:
+        break;
+    }
+  }
+
+  template<typename T>
+  void convertFormatTemplate(const Image* src, Image* dst, int src_comp, int dst_comp, const int* map, const rgbal& srco, T max_value, int thread_count)
+  {
+    int w = src->width();
+    bool identity = src_comp == dst_comp;
+    for(int c=0; c<dst_comp; ++c)
+      identity &= map[c] == c;
+    if (identity)
+    {
+      runConverter(src, dst, CopyConverter(w*src_comp*sizeof(T)), w*src_comp, thread_count);
+      return;
+    }
+    if (sizeof(T) == 1 && src_comp == 4 && dst_comp == 4 && map[0] == 2 && map[1] == 1 && map[2] == 0 && map[3] == 3)
+    {
+      runConverter(src, dst, SwapRBConverter(w), w*4, thread_count);
+      return;
+    }
+    switch(src_comp)
+    {
+      case 1: convertFormatTemplate<T,1>(src, dst, dst_comp, map, srco, max_value, thread_count); break;
+      case 2: convertFormatTemplate<T,2>(src, dst, dst_comp, map, srco, max_value, thread_count); break;
+      case 3: convertFormatTemplate<T,3>(src, dst, dst_comp, map, srco, max_value, thread_count); break;
+      case 4: convertFormatTemplate<T,4>(src, dst, dst_comp, map, srco, max_value, thread_count); break;
+      default:
+        break;
     }
   }
 }
-ref<Image> vl::Image::convertFormat(EImageFormat new_format) const
+ref<Image> vl::Image::convertFormat(EImageFormat new_format, int thread_count) const
 {
   switch(type())
   {
@@ -1820,49 +2125,20 @@ ref<Image> vl::Image::convertFormat(EImageFormat new_format) const
       break;
   }
 
-  int line_count = img->height()?img->height():1;
-  if (img->depth())
-    line_count *= img->depth();
-  else
-  if (img->isCubemap())
-    line_count *= 6;
-
-  for(int i=0; i<line_count; ++i)
-  {
-    const void* srcLine = pixels()      + pitch()*i;
-    void* dstLine = img->pixels() + img->pitch()*i;
-
-    const unsigned char* srcUByte  = (const unsigned char*)srcLine;
-    const GLbyte*        srcSByte  = (const GLbyte*)srcLine;
-    const GLushort*      srcUShort = (const GLushort*)srcLine;
-    const GLshort*       srcSShort = (const GLshort*)srcLine;
-    const unsigned int*  srcUInt   = (const unsigned int*)srcLine;
-    const int*           srcSInt   = (const int*)srcLine;
-    const float*         srcFloat  = (const float*)srcLine;
-
-    unsigned char* dstUByte  = (unsigned char*)dstLine;
-    GLbyte*        dstSByte  = (GLbyte*)dstLine;
-    GLushort*      dstUShort = (GLushort*)dstLine;
-    GLshort*       dstSShort = (GLshort*)dstLine;
-    unsigned int*  dstUInt   = (unsigned int*)dstLine;
-    int*           dstSInt   = (int*)dstLine;
-    float*         dstFloat  = (float*)dstLine;
-
-    for(int j=0; j<img->width(); ++j)
-    {
-      switch(type())
-      {
-        case IT_UNSIGNED_BYTE:  convert<unsigned char> (srcUByte,  dstUByte,  255,         srco, dsto); srcUByte+=src_comp;  dstUByte+=dst_comp;  break;
-        case IT_BYTE:           convert<GLbyte>        (srcSByte,  dstSByte,  127,         srco, dsto); srcSByte+=src_comp;  dstSByte+=dst_comp;  break;
-        case IT_UNSIGNED_SHORT: convert<GLushort>      (srcUShort, dstUShort, 65535,       srco, dsto); srcUShort+=src_comp; dstUShort+=dst_comp; break;
-        case IT_SHORT:          convert<GLshort>       (srcSShort, dstSShort, 32767,       srco, dsto); srcSShort+=src_comp; dstSShort+=dst_comp; break;
-        case IT_UNSIGNED_INT:   convert<unsigned int>  (srcUInt,   dstUInt,   4294967295U, srco, dsto); srcUInt+=src_comp;   dstUInt+=dst_comp;   break;
-        case IT_INT:            convert<int>           (srcSInt,   dstSInt,   2147483647,  srco, dsto); srcSInt+=src_comp;   dstSInt+=dst_comp;   break;
-        case IT_FLOAT:          convert<float>         (srcFloat,  dstFloat,  1.0f,        srco, dsto); srcFloat+=src_comp;  dstFloat+=dst_comp;  break;
-        default:
-          return NULL;
-      }
-    }
+  int map[4] = { MapZero, MapZero, MapZero, MapZero };
+  computeFormatMap(srco, dsto, map);
+
+  switch(type())
+  {
+    case IT_UNSIGNED_BYTE:  convertFormatTemplate<unsigned char>(this, img.get(), src_comp, dst_comp, map, srco, 255,         thread_count); break;
+    case IT_BYTE:           convertFormatTemplate<GLbyte>       (this, img.get(), src_comp, dst_comp, map, srco, 127,         thread_count); break;
+    case IT_UNSIGNED_SHORT: convertFormatTemplate<GLushort>     (this, img.get(), src_comp, dst_comp, map, srco, 65535,       thread_count); break;
+    case IT_SHORT:          convertFormatTemplate<GLshort>      (this, img.get(), src_comp, dst_comp, map, srco, 32767,       thread_count); break;
+    case IT_UNSIGNED_INT:   convertFormatTemplate<unsigned int> (this, img.get(), src_comp, dst_comp, map, srco, 4294967295U, thread_count); break;
+    case IT_INT:            convertFormatTemplate<int>          (this, img.get(), src_comp, dst_comp, map, srco, 2147483647,  thread_count); break;
+    case IT_FLOAT:          convertFormatTemplate<float>        (this, img.get(), src_comp, dst_comp, map, srco, 1.0f,        thread_count); break;
+    default:
+      return NULL;
   }
 
   return img;
@@ -2210,3 +2486,604 @@ void Image::substituteColorGreenKey(unsigned int col0, unsigned int col1)
   }
 }
 //-----------------------------------------------------------------------------
+// Image::resample() & Image::generateMipmaps()
+//-----------------------------------------------------------------------------
+namespace
+{
+  //! Number of destination rows processed by a single task.
+  const int ResampleBandRows = 32;
+
+  //! Number of destination slices of a 3D image filtered along z at once.
+  const int ResampleBandSlices = 16;
+
+  inline float sinc(float x)
+  {
+    if (x == 0.0f)
+      return 1.0f;
+    x *= fPi;
+    return ::sin(x) / x;
+  }
+
+  //! Modified Bessel function of the first kind of order 0.
+  inline double bessel0(double x)
+  {
+    double sum = 1.0, term = 1.0;
+    double x2 = x*x/4.0;
+    for(int k=1; k<32 && term > sum*1e-12; ++k)
+    {
+      term *= x2 / (k*k);
+      sum += term;
+    }
+    return sum;
+  }
+
+  float resampleKernel(EImageResampleFilter filter, float x)
+  {
+    const float radius = 3.0f;
+    if (x <= -radius || x >= radius)
+      return 0;
+    if (filter == IRF_Lanczos)
+      return sinc(x) * sinc(x/radius);
+    else
+    {
+      const double alpha = 4.0;
+      double t = x/radius;
+      return sinc(x) * (float)(bessel0(alpha*::sqrt(1.0-t*t)) / bessel0(alpha));
+    }
+  }
+
+  inline float srgbToLinear(float c)
+  {
+    return c <= 0.04045f ? c / 12.92f : (float)::pow((c+0.055)/1.055, 2.4);
+  }
+
+  inline float linearToSRGB(float l)
+  {
+    return l <= 0.0031308f ? l * 12.92f : (float)(1.055*::pow((double)l, 1.0/2.4) - 0.055);
+  }
+
+  //! The source pixels and weights contributing to each destination pixel along one axis.
+  class ResampleAxis
+  {
+  public:
+    void compute(int src_size, int dst_size, EImageResampleFilter filter)
+    {
+      double scale = (double)dst_size / src_size;
+      // when minifying the kernel is stretched to cover the source pixels
+      double fscale = scale < 1.0 ? scale : 1.0;
+      double support = filter == IRF_Box ? 0.5/fscale : 3.0/fscale;
+      mTaps  = (int)::ceil(2.0*support) + 2;
+      mFirst.resize(dst_size);
+      mCount.resize(dst_size);
+      mWeights.assign(dst_size*mTaps, 0.0f);
+
+      for(int i=0; i<dst_size; ++i)
+      {
+        int j0, j1;
+        double center = (i+0.5) / scale;
+        if (filter == IRF_Box)
+        {
+          j0 = (int)::floor(center-support);
+          j1 = (int)::ceil(center+support) - 1;
+        }
+        else
+        {
+          center -= 0.5;
+          j0 = (int)::ceil(center-support);
+          j1 = (int)::floor(center+support);
+        }
+        // clamp to the borders and merge the weights of the clamped taps
+        int first = clamp(j0, 0, src_size-1);
+        int last  = clamp(j1, 0, src_size-1);
+        float* w = &mWeights[i*mTaps];
+        VL_CHECK(last-first < mTaps)
+        float sum = 0;
+        for(int j=j0; j<=j1; ++j)
+        {
+          float wj;
+          if (filter == IRF_Box)
+          {
+            // coverage of the source pixel [j, j+1) by the footprint of the destination pixel
+            double a = i / scale, b = (i+1) / scale;
+            wj = (float)(vl::min(b, j+1.0) - vl::max(a, (double)j));
+            if (wj < 0)
+              wj = 0;
+          }
+          else
+            wj = resampleKernel(filter, (float)((j-center)*fscale));
+          w[ clamp(j, 0, src_size-1) - first ] += wj;
+          sum += wj;
+        }
+        if (sum == 0)
+        {
+          w[0] = 1;
+          last = first;
+          sum = 1;
+        }
+        for(int k=0; k<=last-first; ++k)
+          w[k] /= sum;
+        mFirst[i] = first;
+        mCount[i] = last-first+1;
+      }
+    }
+
+    int first(int i) const { return mFirst[i]; }
+    int count(int i) const { return mCount[i]; }
+    const float* weights(int i) const { return &mWeights[i*mTaps]; }
+
+    //! The range of source pixels used by the destination pixels [begin, end).
+    void range(int begin, int end, int& src_begin, int& src_end) const
+    {
+      src_begin = mFirst[begin];
+      src_end   = mFirst[begin] + mCount[begin];
+      for(int i=begin+1; i<end; ++i)
+      {
+        src_begin = vl::min(src_begin, mFirst[i]);
+        src_end   = vl::max(src_end, mFirst[i] + mCount[i]);
+      }
+    }
+
+  protected:
+    std::vector<int> mFirst;
+    std::vector<int> mCount;
+    std::vector<float> mWeights;
+    int mTaps;
+  };
+
+  //! Filters a row of 4-float pixels along x.
+  void filterRowX(const float* src, const ResampleAxis& axis, int dst_w, float* dst)
+  {
+    for(int x=0; x<dst_w; ++x, dst+=4)
+    {
+      const float* w = axis.weights(x);
+      const float* s = src + axis.first(x)*4;
+      int n = axis.count(x);
+#if VL_IMAGE_SSE
+      __m128 acc = _mm_setzero_ps();
+      for(int k=0; k<n; ++k, s+=4)
+        acc = _mm_add_ps( acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(s)) );
+      _mm_storeu_ps(dst, acc);
+#else
+      float a0=0, a1=0, a2=0, a3=0;
+      for(int k=0; k<n; ++k, s+=4)
+      {
+        a0 += w[k]*s[0];
+        a1 += w[k]*s[1];
+        a2 += w[k]*s[2];
+        a3 += w[k]*s[3];
+      }
+      dst[0]=a0; dst[1]=a1; dst[2]=a2; dst[3]=a3;
+#endif
+    }
+  }
+
+  //! Computes the weighted sum of \p n rows of \p count floats.
+  void filterRows(const float* const* rows, const float* w, int n, int count, float* dst)
+  {
+    int i=0;
+#if VL_IMAGE_SSE
+    for(; i+8<=count; i+=8)
+    {
+      __m128 acc0 = _mm_setzero_ps();
+      __m128 acc1 = _mm_setzero_ps();
+      for(int k=0; k<n; ++k)
+      {
+        __m128 wk = _mm_set1_ps(w[k]);
+        acc0 = _mm_add_ps( acc0, _mm_mul_ps(wk, _mm_loadu_ps(rows[k]+i)) );
+        acc1 = _mm_add_ps( acc1, _mm_mul_ps(wk, _mm_loadu_ps(rows[k]+i+4)) );
+      }
+      _mm_storeu_ps(dst+i, acc0);
+      _mm_storeu_ps(dst+i+4, acc1);
+    }
+#endif
+    for(; i<count; ++i)
+    {
+      float acc = 0;
+      for(int k=0; k<n; ++k)
+        acc += w[k]*rows[k][i];
+      dst[i] = acc;
+    }
+  }
+
+  template<typename T, int C>
+  void decodeRowTemplate(const T* src, int width, float scale, float* dst)
+  {
+    for(int x=0; x<width; ++x, src+=C, dst+=4)
+    {
+      dst[0] = src[0]*scale;
+      dst[1] = C > 1 ? src[C > 1 ? 1 : 0]*scale : 0;
+      dst[2] = C > 2 ? src[C > 2 ? 2 : 0]*scale : 0;
+      dst[3] = C > 3 ? src[C > 3 ? 3 : 0]*scale : 0;
+    }
+  }
+
+  //! Converts a row of pixels to the 4-float per pixel working format.
+  template<typename T>
+  void decodeRow(const T* src, int width, int comps, float scale, float* dst)
+  {
+    switch(comps)
+    {
+      case 1: decodeRowTemplate<T,1>(src, width, scale, dst); break;
+      case 2: decodeRowTemplate<T,2>(src, width, scale, dst); break;
+      case 3: decodeRowTemplate<T,3>(src, width, scale, dst); break;
+      default: decodeRowTemplate<T,4>(src, width, scale, dst); break;
+    }
+  }
+
+  //! \p F is the type used for the rounding, double is needed by 32 bits integers.
+  template<typename T, typename F, int C>
+  void encodeRowTemplate(const float* src, int width, F max_val, F min_val, T* dst)
+  {
+    for(int x=0; x<width; ++x, src+=4, dst+=C)
+    {
+      for(int c=0; c<C; ++c)
+      {
+        F v = src[c];
+        v = (v < min_val ? min_val : (v > 1 ? 1 : v)) * max_val;
+        dst[c] = (T)(v < 0 ? v - (F)0.5 : v + (F)0.5);
+      }
+    }
+  }
+
+  //! Converts a row of pixels from the 4-float per pixel working format.
+  template<typename T, typename F>
+  void encodeRow(const float* src, int width, int comps, F max_val, F min_val, T* dst)
+  {
+    switch(comps)
+    {
+      case 1: encodeRowTemplate<T,F,1>(src, width, max_val, min_val, dst); break;
+      case 2: encodeRowTemplate<T,F,2>(src, width, max_val, min_val, dst); break;
+      case 3: encodeRowTemplate<T,F,3>(src, width, max_val, min_val, dst); break;
+      default: encodeRowTemplate<T,F,4>(src, width, max_val, min_val, dst); break;
+    }
+  }
+
+  //! Shared state of the tasks computing a resampled image.
+  class ResampleTasks: public ParallelTasks
+  {
+  public:
+    ResampleTasks(): mSrc(NULL), mDst(NULL), mVolume(NULL), mPlaneBegin(0), mVolumeBegin(0), mZPass(false) {}
+
+    // runs either the x/y pass of a band of rows of a plane or the z pass of a band of rows of a slice, 
+    // the planes are counted from mPlaneBegin
+    virtual void runTask(int index)
+    {
+      int bands = (mDstH + ResampleBandRows - 1) / ResampleBandRows;
+      int plane = mPlaneBegin + index / bands;
+      int y_begin = (index % bands) * ResampleBandRows;
+      int y_end = vl::min(y_begin + ResampleBandRows, mDstH);
+      std::vector<float> out(mDstW*4);
+      std::vector<const float*> rows;
+
+      if (mZPass)
+      {
+        rows.resize(mZ.count(plane));
+        for(int y=y_begin; y<y_end; ++y)
+        {
+          for(int k=0; k<(int)rows.size(); ++k)
+            rows[k] = mVolume + ( (size_t)(mZ.first(plane)+k-mVolumeBegin) * mDstH + y ) * mDstW * 4;
+          filterRows(&rows[0], mZ.weights(plane), (int)rows.size(), mDstW*4, &out[0]);
+          storeRow(&out[0], mDst + (size_t)mDstPitch * (plane*mDstH + y));
+        }
+        return;
+      }
+
+      int sy_begin = 0, sy_end = 0;
+      mY.range(y_begin, y_end, sy_begin, sy_end);
+      std::vector<float> row(mSrcW*4);
+      std::vector<float> hbuf((size_t)(sy_end-sy_begin)*mDstW*4);
+      for(int sy=sy_begin; sy<sy_end; ++sy)
+      {
+        loadRow(mSrc + (size_t)mSrcPitch * (plane*mSrcH + sy), &row[0]);
+        filterRowX(&row[0], mX, mDstW, &hbuf[(size_t)(sy-sy_begin)*mDstW*4]);
+      }
+
+      for(int y=y_begin; y<y_end; ++y)
+      {
+        rows.resize(mY.count(y));
+        for(int k=0; k<(int)rows.size(); ++k)
+          rows[k] = &hbuf[(size_t)(mY.first(y)+k-sy_begin)*mDstW*4];
+        if (mVolume)
+          filterRows(&rows[0], mY.weights(y), (int)rows.size(), mDstW*4, mVolume + ((size_t)(plane-mVolumeBegin)*mDstH + y)*mDstW*4);
+        else
+        {
+          filterRows(&rows[0], mY.weights(y), (int)rows.size(), mDstW*4, &out[0]);
+          storeRow(&out[0], mDst + (size_t)mDstPitch * (plane*mDstH + y));
+        }
+      }
+    }
+
+    void loadRow(const unsigned char* src, float* dst) const
+    {
+      if (!mSRGBDecode.empty())
+      {
+        // 8 bits sRGB: exact table lookup
+        for(int x=0; x<mSrcW; ++x, src+=mComps, dst+=4)
+        {
+          dst[0] = dst[1] = dst[2] = dst[3] = 0;
+          for(int c=0; c<mComps; ++c)
+            dst[c] = c < mColorComps ? mSRGBDecode[src[c]] : src[c]*(1.0f/0xFF);
+        }
+        return;
+      }
+
+      switch(mType)
+      {
+        case IT_UNSIGNED_BYTE:  decodeRow((const unsigned char*) src, mSrcW, mComps, 1.0f/0xFF, dst); break;
+        case IT_BYTE:           decodeRow((const GLbyte*)        src, mSrcW, mComps, 1.0f/0x7F, dst); break;
+        case IT_UNSIGNED_SHORT: decodeRow((const unsigned short*)src, mSrcW, mComps, 1.0f/0xFFFF, dst); break;
+        case IT_SHORT:          decodeRow((const short*)         src, mSrcW, mComps, 1.0f/0x7FFF, dst); break;
+        case IT_UNSIGNED_INT:   decodeRow((const unsigned int*)  src, mSrcW, mComps, 1.0f/0xFFFFFFFF, dst); break;
+        case IT_INT:            decodeRow((const int*)           src, mSrcW, mComps, 1.0f/0x7FFFFFFF, dst); break;
+        case IT_FLOAT:          decodeRow((const float*)         src, mSrcW, mComps, 1.0f, dst); break;
+        default:
+          VL_TRAP()
+      }
+      if (mSRGB)
+      {
+        for(int x=0; x<mSrcW; ++x, dst+=4)
+          for(int c=0; c<mColorComps; ++c)
+            dst[c] = srgbToLinear(dst[c]);
+      }
+    }
+
+    void storeRow(float* src, unsigned char* dst) const
+    {
+      if (mNormalMap)
+      {
+        // unsigned types map -1..1 to 0..1
+        bool biased = mType == IT_UNSIGNED_BYTE || mType == IT_UNSIGNED_SHORT || mType == IT_UNSIGNED_INT;
+        float* px = src;
+        for(int x=0; x<mDstW; ++x, px+=4)
+        {
+          fvec3 n(px[0], px[1], px[2]);
+          if (biased)
+            n = n*2.0f - fvec3(1,1,1);
+          float len = n.length();
+          if (len > 0)
+            n /= len;
+          if (biased)
+            n = n*0.5f + fvec3(0.5f,0.5f,0.5f);
+          px[0] = n.x(); px[1] = n.y(); px[2] = n.z();
+        }
+      }
+      else
+      if (mSRGB)
+      {
+        float* px = src;
+        if (!mSRGBEncode.empty())
+        {
+          const int last = (int)mSRGBEncode.size()-2;
+          for(int x=0; x<mDstW; ++x, px+=4)
+          {
+            for(int c=0; c<mColorComps; ++c)
+            {
+              float t = clamp(px[c], 0.0f, 1.0f) * last;
+              int i = (int)t;
+              px[c] = mSRGBEncode[i] + (mSRGBEncode[i+1]-mSRGBEncode[i])*(t-i);
+            }
+          }
+        }
+        else
+        {
+          for(int x=0; x<mDstW; ++x, px+=4)
+            for(int c=0; c<mColorComps; ++c)
+              px[c] = linearToSRGB(vl::max(px[c], 0.0f));
+        }
+      }
+
+      switch(mType)
+      {
+        case IT_UNSIGNED_BYTE:  encodeRow(src, mDstW, mComps, (float)0xFF,   0.0f, (unsigned char*) dst); break;
+        case IT_BYTE:           encodeRow(src, mDstW, mComps, (float)0x7F,  -1.0f, (GLbyte*)        dst); break;
+        case IT_UNSIGNED_SHORT: encodeRow(src, mDstW, mComps, (float)0xFFFF, 0.0f, (unsigned short*)dst); break;
+        case IT_SHORT:          encodeRow(src, mDstW, mComps, (float)0x7FFF,-1.0f, (short*)         dst); break;
+        case IT_UNSIGNED_INT:   encodeRow(src, mDstW, mComps, (double)0xFFFFFFFF, 0.0, (unsigned int*)dst); break;
+        case IT_INT:            encodeRow(src, mDstW, mComps, (double)0x7FFFFFFF,-1.0, (int*)       dst); break;
+        case IT_FLOAT:
+        {
+          float* px = (float*)dst;
+          for(int x=0; x<mDstW; ++x, src+=4, px+=mComps)
+            for(int c=0; c<mComps; ++c)
+              px[c] = src[c];
+          break;
+        }
+        default:
+          VL_TRAP()
+      }
+    }
+
+  public:
+    ResampleAxis mX, mY, mZ;
+    std::vector<float> mSRGBDecode;
+    std::vector<float> mSRGBEncode;
+    const unsigned char* mSrc;
+    unsigned char* mDst;
+    // the source slices [mVolumeBegin, ...) filtered along x and y
+    float* mVolume;
+    int mPlaneBegin;
+    int mVolumeBegin;
+    int mSrcW, mSrcH, mSrcPitch;
+    int mDstW, mDstH, mDstPitch;
+    int mComps, mColorComps;
+    EImageType mType;
+    bool mSRGB;
+    bool mNormalMap;
+    bool mZPass;
+  };
+}
+//-----------------------------------------------------------------------------
+/**
+ * The image is filtered separately along each axis with a precomputed table of weights, on a 4-float per pixel working 
+ * format. The destination rows are processed in bands distributed over \p thread_count threads, each band filters along x 
+ * only the source rows it needs. When SSE is available four components are filtered at once.
+ * 3D images are filtered along z in bands of slices: only the source slices needed by a band are kept filtered along x and y, 
+ * the ones shared with the next band are reused.
+ */
+ref<Image> Image::resample(int w, int h, int d, EImageResampleFilter filter, bool srgb, int thread_count) const
+{
+  int comps = 0, color_comps = 0;
+  switch(format())
+  {
+    case IF_RGB:   comps = 3; color_comps = 3; break;
+    case IF_RGBA:  comps = 4; color_comps = 3; break;
+    case IF_BGR:   comps = 3; color_comps = 3; break;
+    case IF_BGRA:  comps = 4; color_comps = 3; break;
+    case IF_RG:    comps = 2; color_comps = 2; break;
+    case IF_RED:   comps = 1; color_comps = 1; break;
+    case IF_GREEN: comps = 1; color_comps = 1; break;
+    case IF_BLUE:  comps = 1; color_comps = 1; break;
+    case IF_ALPHA: comps = 1; color_comps = 0; break;
+    case IF_LUMINANCE: comps = 1; color_comps = 1; break;
+    case IF_LUMINANCE_ALPHA: comps = 2; color_comps = 1; break;
+    case IF_DEPTH_COMPONENT: comps = 1; color_comps = 0; break;
+    default:
+      Log::error("Image::resample(): unsupported image format().\n");
+      return NULL;
+  }
+
+  switch(type())
+  {
+    case IT_UNSIGNED_BYTE:
+    case IT_BYTE:
+    case IT_UNSIGNED_SHORT:
+    case IT_SHORT:
+    case IT_UNSIGNED_INT:
+    case IT_INT:
+    case IT_FLOAT:
+      break;
+    default:
+      Log::error("Image::resample(): unsupported image type().\n");
+      return NULL;
+  }
+
+  EImageDimension dim = dimension();
+  bool ok = w > 0;
+  switch(dim)
+  {
+    case ID_1D: ok &= h == 0 && d == 0; break;
+    case ID_2D: 
+    case ID_Cubemap: ok &= h > 0 && d == 0; break;
+    case ID_3D: ok &= h > 0 && d > 0; break;
+    default: ok = false;
+  }
+  if (!ok || !pixels())
+  {
+    Log::error( Say("Image::resample(): invalid size %nx%nx%n.\n") << w << h << d );
+    return NULL;
+  }
+
+  ref<Image> img = new Image;
+  switch(dim)
+  {
+    case ID_1D: img->allocate1D(w, format(), type()); break;
+    case ID_2D: img->allocate2D(w, h, byteAlignment(), format(), type()); break;
+    case ID_3D: img->allocate3D(w, h, d, byteAlignment(), format(), type()); break;
+    default:    img->allocateCubemap(w, h, byteAlignment(), format(), type()); break;
+  }
+  img->setIsNormalMap(isNormalMap());
+  img->setHasAlpha(hasAlpha());
+  img->setObjectName(objectName().c_str());
+
+  ResampleTasks tasks;
+  tasks.mSrc = pixels();
+  tasks.mDst = img->pixels();
+  tasks.mSrcW = width();
+  tasks.mSrcH = height() ? height() : 1;
+  tasks.mSrcPitch = pitch();
+  tasks.mDstW = w;
+  tasks.mDstH = h ? h : 1;
+  tasks.mDstPitch = img->pitch();
+  tasks.mComps = comps;
+  tasks.mColorComps = color_comps;
+  tasks.mType = type();
+  tasks.mNormalMap = isNormalMap() && comps >= 3;
+  tasks.mSRGB = srgb && !tasks.mNormalMap && color_comps;
+  tasks.mX.compute(tasks.mSrcW, tasks.mDstW, filter);
+  tasks.mY.compute(tasks.mSrcH, tasks.mDstH, filter);
+
+  if (tasks.mSRGB && type() == IT_UNSIGNED_BYTE)
+  {
+    tasks.mSRGBDecode.resize(256);
+    for(int i=0; i<256; ++i)
+      tasks.mSRGBDecode[i] = srgbToLinear(i/255.0f);
+    // piecewise linear approximation, the error is well below half a step of 8 bits
+    tasks.mSRGBEncode.resize(4096+1);
+    for(int i=0; i<4096; ++i)
+      tasks.mSRGBEncode[i] = linearToSRGB(i/4095.0f);
+    tasks.mSRGBEncode[4096] = tasks.mSRGBEncode[4095];
+  }
+
+  int bands = (tasks.mDstH + ResampleBandRows - 1) / ResampleBandRows;
+  if (dim != ID_3D)
+  {
+    Thread::runTasks(&tasks, (dim == ID_Cubemap ? 6 : 1)*bands, thread_count);
+    return img;
+  }
+
+  tasks.mZ.compute(depth(), d, filter);
+
+  // the source slices needed by the largest band
+  int max_slices = 0;
+  for(int z_begin=0; z_begin<d; z_begin+=ResampleBandSlices)
+  {
+    int sz_begin = 0, sz_end = 0;
+    tasks.mZ.range(z_begin, vl::min(z_begin + ResampleBandSlices, d), sz_begin, sz_end);
+    max_slices = vl::max(max_slices, sz_end-sz_begin);
+  }
+  size_t slice_size = (size_t)tasks.mDstW*tasks.mDstH*4;
+  std::vector<float> volume(slice_size*max_slices);
+  tasks.mVolume = &volume[0];
+
+  int volume_end = 0;
+  for(int z_begin=0; z_begin<d; z_begin+=ResampleBandSlices)
+  {
+    int z_end = vl::min(z_begin + ResampleBandSlices, d);
+    int sz_begin = 0, sz_end = 0;
+    tasks.mZ.range(z_begin, z_end, sz_begin, sz_end);
+    // the source ranges only move forward, keep the slices shared with the previous band
+    VL_CHECK(sz_begin >= tasks.mVolumeBegin)
+    int kept = vl::max(0, vl::min(volume_end, sz_end) - sz_begin);
+    if (kept)
+      memmove(&volume[0], &volume[(sz_begin-tasks.mVolumeBegin)*slice_size], kept*slice_size*sizeof(float));
+    tasks.mVolumeBegin = sz_begin;
+    volume_end = sz_end;
+
+    // filter the missing source slices along x and y, then filter the band along z
+    tasks.mZPass = false;
+    tasks.mPlaneBegin = sz_begin + kept;
+    Thread::runTasks(&tasks, (sz_end-tasks.mPlaneBegin)*bands, thread_count);
+    tasks.mZPass = true;
+    tasks.mPlaneBegin = z_begin;
+    Thread::runTasks(&tasks, (z_end-z_begin)*bands, thread_count);
+  }
+
+  return img;
+}
+//-----------------------------------------------------------------------------
+bool Image::generateMipmaps(EImageResampleFilter filter, bool srgb, int thread_count)
+{
+  if (!pixels() || dimension() == ID_Error)
+  {
+    Log::error("Image::generateMipmaps(): invalid image.\n");
+    return false;
+  }
+
+  // build the chain aside so that the current mipmaps are left untouched on failure
+  std::vector< ref<Image> > mipmaps;
+  const Image* level = this;
+  while( level->width() > 1 || level->height() > 1 || level->depth() > 1 )
+  {
+    int w = vl::max(level->width()/2, 1);
+    int h = level->height() ? vl::max(level->height()/2, 1) : 0;
+    int d = level->depth()  ? vl::max(level->depth()/2, 1)  : 0;
+    ref<Image> mipmap = level->resample(w, h, d, filter, srgb, thread_count);
+    if (!mipmap)
+      return false;
+    mipmaps.push_back(mipmap);
+    level = mipmap.get();
+  }
+  mMipmaps.swap(mipmaps);
+  return true;
+}
+//-----------------------------------------------------------------------------
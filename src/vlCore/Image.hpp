@@ -229,8 +229,10 @@ namespace vl
      * - IF_LUMINANCE
      * - IF_LUMINANCE_ALPHA
      * - IF_DEPTH_COMPONENT
+     *
+     * Large images are converted in bands of rows distributed over \p thread_count threads, 0 means Thread::hardwareConcurrency().
     */
-    ref<Image> convertType(EImageType new_type) const;
+    ref<Image> convertType(EImageType new_type, int thread_count=0) const;
 
     /**
      * Converts the \p format() of an image.
@@ -255,8 +257,32 @@ namespace vl
      * - IF_ALPHA
      * - IF_LUMINANCE
      * - IF_LUMINANCE_ALPHA
+     *
+     * Large images are converted in bands of rows distributed over \p thread_count threads, 0 means Thread::hardwareConcurrency().
+     */
+    ref<Image> convertFormat(EImageFormat new_format, int thread_count=0) const;
+
+    /**
+     * Returns a copy of the image resized to \p width x \p height x \p depth pixels using the given \p filter.
+     *
+     * - For 1D images \p height and \p depth must be 0, for 2D images and cubemaps \p depth must be 0.
+     * - Cubemap faces are resampled independently, the pixels outside a face are clamped to its border.
+     * - If \p srgb is true the color components (not alpha) are converted to linear space before filtering and back to sRGB afterwards.
+     * - If isNormalMap() is true the RGB components are renormalized after filtering and \p srgb is ignored.
+     * - The work is split across \p thread_count threads, 0 means Thread::hardwareConcurrency().
+     *
+     * The image type() and format() must be among the ones supported by convertType(), IF_RG is also supported.
+     * Returns NULL if the image cannot be resampled. The mipmaps of the image are not copied.
+     */
+    ref<Image> resample(int width, int height, int depth=0, EImageResampleFilter filter=IRF_Lanczos, bool srgb=false, int thread_count=0) const;
+
+    /**
+     * Fills mipmaps() with the whole mipmap chain of the image, down to the 1x1 level, using the given \p filter.
+     * Each level is computed from the previous one using resample(), see its documentation for the meaning of the
+     * parameters. Supports 1D, 2D, 3D images and cubemaps. Returns false if the image cannot be resampled,
+     * in which case mipmaps() is left unchanged.
      */
-    ref<Image> convertFormat(EImageFormat new_format) const;
+    bool generateMipmaps(EImageResampleFilter filter=IRF_Box, bool srgb=false, int thread_count=0);
 
     //! Equalizes the image. Returns false if the image format() or type() is not supported. This function supports both 3D images and cubemaps.
     bool equalize();
@@ -34,6 +34,13 @@
 
 #include <memory.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define VL_IMAGETOOLS_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define VL_IMAGETOOLS_SSE2 0
+#endif
+
 namespace vl
 {
 //-----------------------------------------------------------------------------
@@ -48,34 +55,48 @@ namespace vl
     if(bytealign)
     {
       // compact the image
-
-      unsigned char *pxl1 = (unsigned char *)buf;
-      unsigned char *pxl2 = (unsigned char *)buf;
-      int count = 0;
-      for(int i=0; i<pitch*h; ++i, count++)
-      {
-        if (count==pitch)
-          count = 0;
-
-        *pxl1 = *pxl2;
-
-        if (count < w*3)
-          pxl1 ++;
-
-        pxl2 ++;
-      }
+      unsigned char* pxl = (unsigned char*)buf;
+      for(int y=1; y<h; ++y)
+        memmove(pxl + y*xbytes, pxl + y*pitch, xbytes);
     }
 
-    unsigned char * px32 = (unsigned char*)buf + w * h * 4 - 4;
-    unsigned char * px24 = (unsigned char*)buf + w * h * 3 - 3;
-    for(int i=0; i<w * h; ++i)
+    // expand from the last pixel backwards so that no pixel is overwritten before being read
+    unsigned char* pxl = (unsigned char*)buf;
+    int i = w * h;
+#if VL_IMAGETOOLS_SSE2
+    // the last pixels are done one by one so that the 4 pixels blocks are done with 16 bytes loads never reading past the buffer
+    for(int n4 = i & ~3; i > n4; )
     {
-      px32[0] = px24[0];
-      px32[1] = px24[1];
-      px32[2] = px24[2];
-      px32[3] = alpha;
-      px24 -= 3;
-      px32 -= 4;
+      --i;
+      // the first pixels overlap their own source
+      unsigned char r = pxl[i*3+0], g = pxl[i*3+1], b = pxl[i*3+2];
+      pxl[i*4+0] = r;
+      pxl[i*4+1] = g;
+      pxl[i*4+2] = b;
+      pxl[i*4+3] = alpha;
+    }
+    const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i a   = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+    while(i >= 4)
+    {
+      i -= 4;
+      // the load covers 4 pixels plus 4 bytes of the next one, which are discarded
+      __m128i v  = _mm_loadu_si128((const __m128i*)(pxl + i*3));
+      __m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+      __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+      __m128i p = _mm_unpacklo_epi64(p01, p23);
+      _mm_storeu_si128( (__m128i*)(pxl + i*4), _mm_or_si128(_mm_and_si128(p, rgb), a) );
+    }
+#endif
+    while(i > 0)
+    {
+      --i;
+      // the first pixels overlap their own source
+      unsigned char r = pxl[i*3+0], g = pxl[i*3+1], b = pxl[i*3+2];
+      pxl[i*4+0] = r;
+      pxl[i*4+1] = g;
+      pxl[i*4+2] = b;
+      pxl[i*4+3] = alpha;
     }
   }
 //-----------------------------------------------------------------------------
@@ -123,32 +144,27 @@ namespace vl
     if(bytealign)
     {
       // compact the image
+      unsigned char* pxl = (unsigned char*)buf;
+      for(int y=1; y<h; ++y)
+        memmove(pxl + y*xbytes, pxl + y*pitch, xbytes);
+    }
 
-      unsigned char *pxl1 = (unsigned char *)buf;
-      unsigned char *pxl2 = (unsigned char *)buf;
-      int count = 0;
-      for(int i=0; i<pitch*h; ++i, count++)
-      {
-        if (count==pitch)
-          count = 0;
-
-        *pxl1 = *pxl2;
-
-        if (count < w)
-          pxl1 ++;
-
-        pxl2 ++;
-      }
+    // The palette lookup is a gather which SSE2 cannot vectorize: expand the palette to RGBA once
+    // instead so that every pixel is converted with a single 32 bits copy.
+    unsigned char palette32[256*4];
+    for(int i=0; i<256; ++i)
+    {
+      palette32[i*4+0] = palette[i*3+0];
+      palette32[i*4+1] = palette[i*3+1];
+      palette32[i*4+2] = palette[i*3+2];
+      palette32[i*4+3] = alpha;
     }
 
     unsigned char* px32 = (unsigned char*)buf + w * h * 4 - 4;
     unsigned char* px8  = (unsigned char*)buf + w * h * 1 - 1;
     for(int i=0; i<w * h; ++i)
     {
-      px32[0] = palette[*px8*3+0];
-      px32[1] = palette[*px8*3+1];
-      px32[2] = palette[*px8*3+2];
-      px32[3] = alpha;
+      memcpy(px32, palette32 + *px8*4, 4);
       px8  -= 1;
       px32 -= 4;
     }
@@ -163,32 +179,17 @@ namespace vl
     if(bytealign)
     {
       // compact the image
-
-      unsigned char *pxl1 = (unsigned char *)buf;
-      unsigned char *pxl2 = (unsigned char *)buf;
-      int count = 0;
-      for(int i=0; i<pitch*h; ++i, count++)
-      {
-        if (count==pitch)
-          count = 0;
-
-        *pxl1 = *pxl2;
-
-        if (count < w)
-          pxl1 ++;
-
-        pxl2 ++;
-      }
+      unsigned char* pxl = (unsigned char*)buf;
+      for(int y=1; y<h; ++y)
+        memmove(pxl + y*xbytes, pxl + y*pitch, xbytes);
     }
 
+    // one 32 bits copy per pixel, the palette lookup cannot be vectorized with SSE2
     unsigned char * px32 = (unsigned char*)buf + w * h * 4 - 4;
     unsigned char * px8  = (unsigned char*)buf + w * h * 1 - 1;
     for(int i=0; i<w * h; ++i)
     {
-      px32[0] = palette[*px8*4+0];
-      px32[1] = palette[*px8*4+1];
-      px32[2] = palette[*px8*4+2];
-      px32[3] = palette[*px8*4+3];
+      memcpy(px32, palette + *px8*4, 4);
       px8  -= 1;
       px32 -= 4;
     }
@@ -198,7 +199,19 @@ namespace vl
   {
     unsigned char* p = (unsigned char*)buf;
     unsigned char dw[4];
-    for(int i=0; i<size; i+=4, p+=4)
+    int i=0;
+#if VL_IMAGETOOLS_SSE2
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    for(; i+16<=size; i+=16, p+=16)
+    {
+      __m128i v = _mm_loadu_si128((const __m128i*)p);
+      // swap the bytes of each 16 bits word, then the words
+      v = _mm_or_si128( _mm_and_si128(_mm_srli_epi16(v, 8), mask), _mm_andnot_si128(mask, _mm_slli_epi16(v, 8)) );
+      v = _mm_shufflelo_epi16( _mm_shufflehi_epi16(v, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1) );
+      _mm_storeu_si128((__m128i*)p, v);
+    }
+#endif
+    for(; i<size; i+=4, p+=4)
     {
       memcpy(dw, p, 4);
       p[0] = dw[3];
@@ -212,7 +225,18 @@ namespace vl
   {
     unsigned char* p = (unsigned char*)buf;
     unsigned char dw[4];
-    for(int i=0; i<bytecount; i+=4, p+=4)
+    int i=0;
+#if VL_IMAGETOOLS_SSE2
+    const __m128i ga = _mm_set1_epi32(0xFF00FF00);
+    const __m128i ch = _mm_set1_epi32(0x000000FF);
+    for(; i+16<=bytecount; i+=16, p+=16)
+    {
+      __m128i v  = _mm_loadu_si128((const __m128i*)p);
+      __m128i rb = _mm_or_si128( _mm_and_si128(_mm_srli_epi32(v, 16), ch), _mm_slli_epi32(_mm_and_si128(v, ch), 16) );
+      _mm_storeu_si128( (__m128i*)p, _mm_or_si128(_mm_and_si128(v, ga), rb) );
+    }
+#endif
+    for(; i<bytecount; i+=4, p+=4)
     {
       memcpy(dw, p, 4);
       p[0] = dw[2];
@@ -236,7 +260,17 @@ namespace vl
   inline void fillRGBA32_Alpha(void* buf, int bytecount, unsigned char alpha)
   {
     unsigned char* pxl = (unsigned char*)buf;
-    for(int i=0; i<bytecount; i+=4)
+    int i=0;
+#if VL_IMAGETOOLS_SSE2
+    const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i a   = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+    for(; i+16<=bytecount; i+=16)
+    {
+      __m128i v = _mm_loadu_si128((const __m128i*)(pxl+i));
+      _mm_storeu_si128( (__m128i*)(pxl+i), _mm_or_si128(_mm_and_si128(v, rgb), a) );
+    }
+#endif
+    for(; i<bytecount; i+=4)
     {
       pxl[i+3] = alpha;
     }
@@ -0,0 +1,274 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/InflateIndex.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <zlib.h>
+#include <algorithm>
+
+using namespace vl;
+
+namespace
+{
+  const char INDEX_MAGIC[] = { 'V', 'L', 'Z', 'I' };
+  const int INDEX_VERSION = 1;
+
+  struct CheckpointLess
+  {
+    bool operator()(long long offset, const InflateIndex::Checkpoint& cp) const { return offset < cp.mUncompressedOffset; }
+  };
+}
+//-----------------------------------------------------------------------------
+// InflateIndex
+//-----------------------------------------------------------------------------
+InflateIndex::InflateIndex(long long span)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mSpan = span;
+  mCompressedSize = -1;
+  mOutput = 0;
+  mWindowPos = 0;
+  mWindowFill = 0;
+  mComplete = false;
+}
+//-----------------------------------------------------------------------------
+void InflateIndex::clear()
+{
+  mCheckpoints.clear();
+  mComplete = false;
+  beginStream();
+}
+//-----------------------------------------------------------------------------
+const InflateIndex::Checkpoint* InflateIndex::findCheckpoint(long long uncompressed_offset) const
+{
+  std::vector<Checkpoint>::const_iterator it = std::upper_bound(mCheckpoints.begin(), mCheckpoints.end(), uncompressed_offset, CheckpointLess());
+  if (it == mCheckpoints.begin())
+    return NULL;
+  else
+    return &*(it-1);
+}
+//-----------------------------------------------------------------------------
+void InflateIndex::beginStream()
+{
+  mOutput = 0;
+  mWindowPos = 0;
+  mWindowFill = 0;
+}
+//-----------------------------------------------------------------------------
+bool InflateIndex::restore(const Checkpoint* cp, z_stream_s* strm, VirtualFile* source, long long base_offset)
+{
+  inflateEnd(strm);
+  memset(strm, 0, sizeof(z_stream_s));
+  if ( inflateInit2(strm, -15) != Z_OK )
+  {
+    Log::error("InflateIndex::restore(): inflateInit2 failed.\n");
+    return false;
+  }
+
+  // the first bits of the block might belong to the last byte of the previous one
+  if ( !source->seekSet(base_offset + cp->compressedOffset() - (cp->bits() ? 1 : 0)) )
+  {
+    Log::error("InflateIndex::restore(): could not seek the compressed stream.\n");
+    inflateEnd(strm);
+    memset(strm, 0, sizeof(z_stream_s));
+    return false;
+  }
+  if (cp->bits())
+  {
+    unsigned char byte = 0;
+    if ( source->read(&byte, 1) != 1 )
+    {
+      inflateEnd(strm);
+      memset(strm, 0, sizeof(z_stream_s));
+      return false;
+    }
+    inflatePrime(strm, cp->bits(), byte >> (8 - cp->bits()));
+  }
+  if ( !cp->window().empty() )
+    inflateSetDictionary(strm, &cp->window()[0], (uInt)cp->window().size());
+
+  // continue tracking from the checkpoint
+  mOutput = cp->uncompressedOffset();
+  mWindowFill = (int)cp->window().size();
+  mWindowPos = mWindowFill % WINDOW_SIZE;
+  if (mWindowFill)
+  {
+    mWindow.resize(WINDOW_SIZE);
+    memcpy(&mWindow[0], &cp->window()[0], mWindowFill);
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+void InflateIndex::update(const z_stream_s* strm, const unsigned char* out, unsigned int out_bytes, long long compressed_offset, bool stream_end)
+{
+  if (mComplete)
+    return;
+
+  // keep the last WINDOW_SIZE bytes of output in a circular buffer
+  if (out_bytes)
+  {
+    if (mWindow.empty())
+      mWindow.resize(WINDOW_SIZE);
+    if (out_bytes >= (unsigned)WINDOW_SIZE)
+    {
+      memcpy(&mWindow[0], out + out_bytes - WINDOW_SIZE, WINDOW_SIZE);
+      mWindowPos = 0;
+    }
+    else
+    {
+      int head = std::min((int)out_bytes, WINDOW_SIZE - mWindowPos);
+      memcpy(&mWindow[0] + mWindowPos, out, head);
+      memcpy(&mWindow[0], out + head, out_bytes - head);
+      mWindowPos = (mWindowPos + (int)out_bytes) % WINDOW_SIZE;
+    }
+    mWindowFill = std::min(mWindowFill + (long long)out_bytes, (long long)WINDOW_SIZE);
+    mOutput += out_bytes;
+  }
+
+  // at the end of the last block or past it
+  if ( stream_end || ((strm->data_type & 128) && (strm->data_type & 64)) )
+  {
+    mComplete = true;
+    return;
+  }
+
+  // at the end of a block which is not the last one
+  if ( (strm->data_type & 128) && !(strm->data_type & 64) )
+  {
+    long long last = mCheckpoints.empty() ? 0 : mCheckpoints.back().uncompressedOffset();
+    if ( mSpan > 0 && mOutput >= last + mSpan )
+    {
+      mCheckpoints.push_back(Checkpoint());
+      Checkpoint& cp = mCheckpoints.back();
+      cp.mUncompressedOffset = mOutput;
+      cp.mCompressedOffset = compressed_offset;
+      cp.mBits = strm->data_type & 7;
+      cp.mWindow.resize(mWindowFill);
+      // unroll the circular buffer
+      int start = (mWindowPos - mWindowFill + WINDOW_SIZE) % WINDOW_SIZE;
+      int head = std::min(mWindowFill, WINDOW_SIZE - start);
+      memcpy(&cp.mWindow[0], &mWindow[0] + start, head);
+      if (mWindowFill - head)
+        memcpy(&cp.mWindow[0] + head, &mWindow[0], mWindowFill - head);
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+bool InflateIndex::save(VirtualFile* file) const
+{
+  if ( file->write(INDEX_MAGIC, 4) != 4 )
+  {
+    Log::error( Say("InflateIndex::save(): could not write '%s'.\n") << file->path() );
+    return false;
+  }
+  file->writeSInt32(INDEX_VERSION);
+  file->writeSInt64(mSpan);
+  file->writeSInt64(mCompressedSize);
+  file->writeSInt32(mComplete ? 1 : 0);
+  file->writeSInt32((int)mCheckpoints.size());
+  std::vector<unsigned char> zwindow;
+  for(size_t i=0; i<mCheckpoints.size(); ++i)
+  {
+    const Checkpoint& cp = mCheckpoints[i];
+    uLongf zwindow_size = 0;
+    if ( !cp.window().empty() )
+    {
+      zwindow.resize(compressBound((uLong)cp.window().size()));
+      zwindow_size = (uLongf)zwindow.size();
+      if ( compress2(&zwindow[0], &zwindow_size, &cp.window()[0], (uLong)cp.window().size(), 1) != Z_OK )
+        zwindow_size = 0;
+    }
+    file->writeSInt64(cp.uncompressedOffset());
+    file->writeSInt64(cp.compressedOffset());
+    file->writeSInt32(cp.bits());
+    file->writeSInt32((int)cp.window().size());
+    file->writeSInt32((int)zwindow_size);
+    if ( zwindow_size && file->write(&zwindow[0], zwindow_size) != (long long)zwindow_size )
+    {
+      Log::error( Say("InflateIndex::save(): could not write '%s'.\n") << file->path() );
+      return false;
+    }
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool InflateIndex::load(VirtualFile* file)
+{
+  clear();
+
+  char magic[4] = { 0, 0, 0, 0 };
+  file->read(magic, 4);
+  if ( memcmp(magic, INDEX_MAGIC, 4) != 0 || file->readSInt32() != INDEX_VERSION )
+  {
+    Log::error( Say("InflateIndex::load(): '%s' is not a valid index file.\n") << file->path() );
+    return false;
+  }
+  mSpan = file->readSInt64();
+  mCompressedSize = file->readSInt64();
+  mComplete = file->readSInt32() != 0;
+  int count = file->readSInt32();
+  if (count < 0)
+  {
+    clear();
+    Log::error( Say("InflateIndex::load(): '%s' is corrupted.\n") << file->path() );
+    return false;
+  }
+  mCheckpoints.resize(count);
+  std::vector<unsigned char> zwindow;
+  for(int i=0; i<count; ++i)
+  {
+    Checkpoint& cp = mCheckpoints[i];
+    cp.mUncompressedOffset = file->readSInt64();
+    cp.mCompressedOffset = file->readSInt64();
+    cp.mBits = file->readSInt32();
+    int window_size = file->readSInt32();
+    int zwindow_size = file->readSInt32();
+    bool ok = cp.mBits >= 0 && cp.mBits < 8 && window_size >= 0 && window_size <= WINDOW_SIZE && zwindow_size >= 0 && 
+              (i == 0 || cp.mUncompressedOffset > mCheckpoints[i-1].mUncompressedOffset);
+    if (ok && window_size)
+    {
+      zwindow.resize(zwindow_size);
+      cp.mWindow.resize(window_size);
+      uLongf size = (uLongf)window_size;
+      ok = zwindow_size && file->read(&zwindow[0], zwindow_size) == zwindow_size && 
+           uncompress(&cp.mWindow[0], &size, &zwindow[0], (uLong)zwindow_size) == Z_OK && size == (uLongf)window_size;
+    }
+    if (!ok)
+    {
+      clear();
+      Log::error( Say("InflateIndex::load(): '%s' is corrupted.\n") << file->path() );
+      return false;
+    }
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
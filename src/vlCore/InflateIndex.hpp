@@ -0,0 +1,157 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef InflateIndex_INCLUDE_ONCE
+#define InflateIndex_INCLUDE_ONCE
+
+#include <vlCore/VirtualFile.hpp>
+#include <vector>
+struct z_stream_s;
+
+namespace vl
+{
+  /**
+   * An index of checkpoints used by ZippedFile and GZipCodec to seek quickly inside a deflate stream.
+   *
+   * A checkpoint is taken every span() uncompressed bytes at the boundary of a deflate block and stores
+   * the compressed and uncompressed offsets of the block together with the last 32K of uncompressed data,
+   * which is what is needed to restart the decompression from that point. The index is built incrementally
+   * the first time the stream is decompressed and can be saved to and loaded from a file to be reused later,
+   * for example beside the archive it refers to.
+   *
+   * The memory used by the index is about 32K every span() bytes of uncompressed data.
+   *
+   * \note An InflateIndex can be used by only one ZippedFile or GZipCodec at a time.
+   */
+  class VLCORE_EXPORT InflateIndex: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::InflateIndex, Object)
+
+  public:
+    //! Size of the deflate window.
+    static const int WINDOW_SIZE = 32*1024;
+
+    //! A restart point of an InflateIndex.
+    class Checkpoint
+    {
+    public:
+      Checkpoint(): mUncompressedOffset(0), mCompressedOffset(0), mBits(0) {}
+
+      //! Offset of the checkpoint in the uncompressed data.
+      long long uncompressedOffset() const { return mUncompressedOffset; }
+
+      //! Offset of the first byte of the compressed data following the checkpoint, relative to the beginning of the compressed data.
+      long long compressedOffset() const { return mCompressedOffset; }
+
+      //! Number of bits of the previous byte belonging to the deflate block starting at this checkpoint.
+      int bits() const { return mBits; }
+
+      //! The uncompressed data preceding the checkpoint, up to WINDOW_SIZE bytes.
+      const std::vector<unsigned char>& window() const { return mWindow; }
+
+    public:
+      long long mUncompressedOffset;
+      long long mCompressedOffset;
+      int mBits;
+      std::vector<unsigned char> mWindow;
+    };
+
+  public:
+    //! Constructor.
+    InflateIndex(long long span=4*1024*1024);
+
+    //! The minimum distance in bytes between two checkpoints in the uncompressed data.
+    void setSpan(long long span) { mSpan = span; }
+
+    //! The minimum distance in bytes between two checkpoints in the uncompressed data.
+    long long span() const { return mSpan; }
+
+    //! Size of the compressed data the index refers to, -1 if unknown. Used to validate an index loaded from a file.
+    void setCompressedSize(long long size) { mCompressedSize = size; }
+
+    //! Size of the compressed data the index refers to, -1 if unknown. Used to validate an index loaded from a file.
+    long long compressedSize() const { return mCompressedSize; }
+
+    //! Returns \p true if the whole stream has been decompressed once, i.e. no more checkpoints will be added.
+    bool isComplete() const { return mComplete; }
+
+    //! Removes all the checkpoints.
+    void clear();
+
+    int checkpointCount() const { return (int)mCheckpoints.size(); }
+
+    const Checkpoint& checkpoint(int i) const { return mCheckpoints[i]; }
+
+    //! Returns the last checkpoint whose uncompressedOffset() is less than or equal to \p uncompressed_offset or NULL if there is none.
+    const Checkpoint* findCheckpoint(long long uncompressed_offset) const;
+
+    //! Writes the index to \p file which must be already open.
+    bool save(VirtualFile* file) const;
+
+    //! Reads the index from \p file which must be already open.
+    bool load(VirtualFile* file);
+
+    /** @name Stream tracking
+     * Used by the stream decoders to build and use the index.
+     */
+    //@{
+
+    //! Starts tracking a stream from its beginning.
+    void beginStream();
+
+    /**
+     * Initializes \p strm as a raw inflate stream ready to decompress the data following \p cp
+     * and moves \p source to the compressed data to be read next. \p base_offset is the position
+     * in \p source of the beginning of the compressed data.
+     */
+    bool restore(const Checkpoint* cp, z_stream_s* strm, VirtualFile* source, long long base_offset);
+
+    /**
+     * To be called after every call to inflate(Z_BLOCK) with the data just decompressed, adds a checkpoint if needed.
+     * \p compressed_offset is the offset of \p strm->next_in relative to the beginning of the compressed data.
+     */
+    void update(const z_stream_s* strm, const unsigned char* out, unsigned int out_bytes, long long compressed_offset, bool stream_end);
+
+    //@}
+
+  protected:
+    std::vector<Checkpoint> mCheckpoints;
+    std::vector<unsigned char> mWindow;
+    long long mSpan;
+    long long mCompressedSize;
+    long long mOutput;
+    int mWindowPos;
+    int mWindowFill;
+    bool mComplete;
+  };
+}
+
+#endif
@@ -68,25 +68,44 @@ ref<ResourceDatabase> LoadWriterManager::loadResource(const String& path, bool q
     const String* mPath;
   } timer(&path);
 
-  ref<VirtualFile> file = locateFile(path);
+  ref<VirtualFile> file = locateResource(path);
 
   if (file)
-  {
-    if (path.endsWith(".gz") || path.endsWith(".GZ"))
-    {
-      ref<GZipCodec> gz = new GZipCodec;
-      gz->setStream(file.get());
-      // remove .gz suffix so that correct loader can be picked up
-      gz->setPath( file->path().left(-3) );
-      file = gz;
-    }
     return loadResource(file.get(), quick);
-  }
   else
     return NULL;
 }
 //-----------------------------------------------------------------------------
+ref<VirtualFile> LoadWriterManager::locateResource(const String& path) const
+{
+  ref<VirtualFile> file = locateFile(path);
+
+  if (file && (path.endsWith(".gz") || path.endsWith(".GZ")))
+  {
+    ref<GZipCodec> gz = new GZipCodec;
+    gz->setStream(file.get());
+    // remove .gz suffix so that correct loader can be picked up
+    gz->setPath( file->path().left(-3) );
+    file = gz;
+  }
+
+  return file;
+}
+//-----------------------------------------------------------------------------
 ref<ResourceDatabase> LoadWriterManager::loadResource(VirtualFile* file, bool quick) const 
+{
+  ref<ResourceDatabase> db = decodeResource(file, quick);
+  executeLoadCallbacks(db.get());
+  return db;
+}
+//-----------------------------------------------------------------------------
+void LoadWriterManager::executeLoadCallbacks(ResourceDatabase* db) const
+{
+  for(size_t i=0; db && i<loadCallbacks().size(); ++i)
+    loadCallbacks()[i].get_writable()->operator()(db);
+}
+//-----------------------------------------------------------------------------
+ref<ResourceDatabase> LoadWriterManager::decodeResource(VirtualFile* file, bool quick) const 
 {
   const ResourceLoadWriter* loadwriter = findLoader(file);
   if (loadwriter)
@@ -105,9 +124,6 @@ ref<ResourceDatabase> LoadWriterManager::loadResource(VirtualFile* file, bool qu
     }
     else
       db = loadwriter->loadResource(file);
-    // load callbacks
-    for(size_t i=0; db && i<loadCallbacks().size(); ++i)
-      loadCallbacks()[i].get_writable()->operator()(db.get());
     return db;
   }
   else
@@ -117,6 +133,211 @@ ref<ResourceDatabase> LoadWriterManager::loadResource(VirtualFile* file, bool qu
   }
 }
 //-----------------------------------------------------------------------------
+// Asynchronous loading
+//-----------------------------------------------------------------------------
+// A loader thread decodes the queued requests and terminates as soon as the queue is empty.
+// The requests are accessed only through raw pointers: their reference count and the one of their
+// VirtualFile are only touched by the thread that created them.
+class LoadWriterManager::LoaderThread: public Thread
+{
+public:
+  LoaderThread(LoadWriterManager* manager): mManager(manager), mFinished(false) {}
+
+  virtual void run()
+  {
+    for(;;)
+    {
+      mManager->mAsyncMutex.lock();
+      if (mManager->mQueue.empty())
+      {
+        mFinished = true;
+        --mManager->mRunningLoaders;
+        mManager->mAsyncMutex.unlock();
+        return;
+      }
+      ResourceLoadRequest* request = mManager->mQueue.front();
+      mManager->mQueue.pop_front();
+      request->mState = ResourceLoadRequest::Decoding;
+      mManager->mAsyncMutex.unlock();
+
+      mManager->decodeRequest(request);
+    }
+  }
+
+public:
+  LoadWriterManager* mManager;
+  bool mFinished; // guarded by the manager's mutex
+};
+//-----------------------------------------------------------------------------
+LoadWriterManager::~LoadWriterManager()
+{
+  waitLoadedResources();
+  for(size_t i=0; i<mLoaders.size(); ++i)
+    mLoaders[i]->wait();
+  // the requests still referenced by the user must not access the manager anymore
+  for(size_t i=0; i<mRequests.size(); ++i)
+    mRequests[i]->mManager = NULL;
+}
+//-----------------------------------------------------------------------------
+void LoadWriterManager::decodeRequest(ResourceLoadRequest* request) const
+{
+  // the temporary ref<> is released before the request is marked as decoded
+  request->mResource = decodeResource(request->mFile.get(), request->mQuick);
+  LoadWriterManager* self = const_cast<LoadWriterManager*>(this);
+  self->mAsyncMutex.lock();
+  request->mState = ResourceLoadRequest::Decoded;
+  self->mAsyncCondition.notifyAll();
+  self->mAsyncMutex.unlock();
+}
+//-----------------------------------------------------------------------------
+void LoadWriterManager::joinFinishedLoaders()
+{
+  std::vector< ref<Thread> > running;
+  for(size_t i=0; i<mLoaders.size(); ++i)
+  {
+    mAsyncMutex.lock();
+    bool finished = static_cast<LoaderThread*>(mLoaders[i].get())->mFinished;
+    mAsyncMutex.unlock();
+    if (finished)
+      mLoaders[i]->wait();
+    else
+      running.push_back(mLoaders[i]);
+  }
+  mLoaders.swap(running);
+}
+//-----------------------------------------------------------------------------
+ref<ResourceLoadRequest> LoadWriterManager::loadResourceAsync(const String& path, bool quick)
+{
+  ref<VirtualFile> file = locateResource(path);
+
+  if (file)
+    return loadResourceAsync(file.get(), quick);
+  else
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+ref<ResourceLoadRequest> LoadWriterManager::loadResourceAsync(VirtualFile* file, bool quick)
+{
+  joinFinishedLoaders();
+
+  ref<ResourceLoadRequest> request = new ResourceLoadRequest(this, file, quick);
+  mRequests.push_back(request);
+
+  int max_loaders = loaderThreadCount() > 0 ? loaderThreadCount() : Thread::hardwareConcurrency();
+
+  mAsyncMutex.lock();
+  mQueue.push_back(request.get());
+  bool start_loader = mRunningLoaders < max_loaders;
+  if (start_loader)
+    ++mRunningLoaders;
+  mAsyncMutex.unlock();
+
+  if (start_loader)
+  {
+    ref<LoaderThread> loader = new LoaderThread(this);
+    if (loader->start())
+      mLoaders.push_back(loader);
+    else
+    {
+      // the request will be decoded by ResourceLoadRequest::wait()
+      Log::warning("LoadWriterManager::loadResourceAsync(): could not start a loader thread.\n");
+      mAsyncMutex.lock();
+      --mRunningLoaders;
+      mAsyncMutex.unlock();
+    }
+  }
+
+  return request;
+}
+//-----------------------------------------------------------------------------
+int LoadWriterManager::finalizeLoadedResources(int max_count)
+{
+  joinFinishedLoaders();
+
+  int count = 0;
+  std::vector< ref<ResourceLoadRequest> > pending;
+  for(size_t i=0; i<mRequests.size(); ++i)
+  {
+    ResourceLoadRequest* request = mRequests[i].get();
+    if ( !request->isFinalized() && (count == max_count || !request->isReady()) )
+      pending.push_back(request);
+    else
+    if ( !request->isFinalized() )
+    {
+      request->finalize();
+      ++count;
+    }
+  }
+  mRequests.swap(pending);
+  return count;
+}
+//-----------------------------------------------------------------------------
+void LoadWriterManager::waitLoadedResources()
+{
+  for(size_t i=0; i<mRequests.size(); ++i)
+    mRequests[i]->wait();
+  joinFinishedLoaders();
+}
+//-----------------------------------------------------------------------------
+// ResourceLoadRequest
+//-----------------------------------------------------------------------------
+ResourceLoadRequest::ResourceLoadRequest(LoadWriterManager* manager, VirtualFile* file, bool quick)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mManager = manager;
+  mPath = file->path();
+  mFile = file;
+  mState = Queued;
+  mQuick = quick;
+  mFinalized = false;
+}
+//-----------------------------------------------------------------------------
+bool ResourceLoadRequest::isReady() const
+{
+  if (!mManager)
+    return true;
+  mManager->mAsyncMutex.lock();
+  bool ready = mState == Decoded;
+  mManager->mAsyncMutex.unlock();
+  return ready;
+}
+//-----------------------------------------------------------------------------
+void ResourceLoadRequest::wait()
+{
+  if (!mManager)
+    return;
+  mManager->mAsyncMutex.lock();
+  if (mState == Queued)
+  {
+    // decode it here rather than waiting for a loader thread
+    std::deque<ResourceLoadRequest*>::iterator it = std::find(mManager->mQueue.begin(), mManager->mQueue.end(), this);
+    VL_CHECK(it != mManager->mQueue.end())
+    mManager->mQueue.erase(it);
+    mState = Decoding;
+    mManager->mAsyncMutex.unlock();
+    mManager->decodeRequest(this);
+    return;
+  }
+  // a loader thread is decoding it
+  while(mState != Decoded)
+    mManager->mAsyncCondition.wait(&mManager->mAsyncMutex);
+  mManager->mAsyncMutex.unlock();
+}
+//-----------------------------------------------------------------------------
+ref<ResourceDatabase> ResourceLoadRequest::finalize()
+{
+  if (!mFinalized)
+  {
+    wait();
+    mFinalized = true;
+    if (mManager)
+      mManager->executeLoadCallbacks(mResource.get());
+    mManager = NULL;
+    mFile = NULL;
+  }
+  return mResource;
+}
+//-----------------------------------------------------------------------------
 bool LoadWriterManager::writeResource(const String& path, ResourceDatabase* resource) const
 {
   const ResourceLoadWriter* loadwriter = findWriter(path);
@@ -37,6 +37,8 @@
 #include <vlCore/VirtualFile.hpp>
 #include <vlCore/MemoryFile.hpp>
 #include <vlCore/VisualizationLibrary.hpp>
+#include <vlCore/Thread.hpp>
+#include <deque>
 
 namespace vl
 {
@@ -54,19 +56,81 @@ namespace vl
     virtual void operator()(ResourceDatabase* db) = 0;
   };
 
+  class LoadWriterManager;
+
+  /** 
+   * Handle to a resource being loaded by LoadWriterManager::loadResourceAsync().
+   *
+   * The resource is decoded by a loader thread, its LoadCallbacks are executed by finalize() on the thread calling it, 
+   * which is usually the one owning the OpenGL context. Requests not finalized explicitly are finalized by 
+   * LoadWriterManager::finalizeLoadedResources().
+   *
+   * A request can outlive its LoadWriterManager: the manager waits for the decoding of its requests when it is destroyed
+   * and detaches them, a detached request is ready and its finalize() returns the resource without executing any LoadCallback.
+   */
+  class VLCORE_EXPORT ResourceLoadRequest: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::ResourceLoadRequest, Object)
+
+    friend class LoadWriterManager;
+
+  public:
+    //! The path of the resource being loaded.
+    const String& path() const { return mPath; }
+
+    //! Returns \p true when the decoding of the resource has completed, successfully or not.
+    bool isReady() const;
+
+    //! Waits for the decoding of the resource to complete. If no loader thread has picked up the request yet the resource is decoded on the calling thread.
+    void wait();
+
+    //! Returns \p true if finalize() has been called.
+    bool isFinalized() const { return mFinalized; }
+
+    //! Waits for the decoding of the resource and executes the LoadCallbacks on the calling thread. Returns the loaded resource or NULL if the loading failed.
+    ref<ResourceDatabase> finalize();
+
+    //! The loaded resource, NULL if finalize() has not been called yet or if the loading failed.
+    ResourceDatabase* resource() { return mFinalized ? mResource.get() : NULL; }
+
+    //! The loaded resource, NULL if finalize() has not been called yet or if the loading failed.
+    const ResourceDatabase* resource() const { return mFinalized ? mResource.get() : NULL; }
+
+  protected:
+    ResourceLoadRequest(LoadWriterManager* manager, VirtualFile* file, bool quick);
+
+  protected:
+    typedef enum { Queued, Decoding, Decoded } EState;
+    LoadWriterManager* mManager; // NULL once finalized or detached by ~LoadWriterManager()
+    String mPath;
+    ref<VirtualFile> mFile;
+    ref<ResourceDatabase> mResource;
+    EState mState; // guarded by the manager's mutex
+    bool mQuick;
+    bool mFinalized;
+  };
+
   /** The LoadWriterManager class loads and writes resources using the registered ResourceLoadWriter objects.
   You can install a LoadCallback to operate on loaded data or you can install a WriteCallback to operate on the data to be written,
-  using the methods loadCallbacks() and writeCallbacks(). */
+  using the methods loadCallbacks() and writeCallbacks(). 
+  
+  Resources can also be loaded in background with loadResourceAsync(), see also ResourceLoadRequest. */
   class VLCORE_EXPORT LoadWriterManager: public Object
   {
     VL_INSTRUMENT_CLASS(vl::LoadWriterManager, Object)
 
+    friend class ResourceLoadRequest;
+    class LoaderThread;
+
   public:
-    LoadWriterManager()
+    LoadWriterManager(): mLoaderThreadCount(0), mRunningLoaders(0)
     { 
       VL_DEBUG_SET_OBJECT_NAME()
     }
 
+    //! Waits for the completion of the pending loadResourceAsync() requests.
+    ~LoadWriterManager();
+
     void registerLoadWriter(ResourceLoadWriter*);
 
     //! Returns the set of registered ResourceLoadWriter objects
@@ -118,6 +182,38 @@ namespace vl
     //! Loads the resource specified by the given file using the appropriate ResourceLoadWriter.
     ref<ResourceDatabase> loadResource(VirtualFile* file, bool quick=true) const;
 
+    /**
+     * Locates the resource specified by the given path on the calling thread and decodes it on a loader thread.
+     * Returns NULL if the file could not be located. See also ResourceLoadRequest and finalizeLoadedResources().
+     *
+     * \note The ResourceLoadWriter objects are used by several threads at the same time, the ones that share 
+     * reference counted objects among different loadings, for example through defVLXRegistry(), require 
+     * atomic reference counting (see VL_ATOMIC_REFERENCE_COUNT). Log messages are serialized only if a Log::logMutex() is installed.
+     */
+    ref<ResourceLoadRequest> loadResourceAsync(const String& path, bool quick=true);
+
+    //! Decodes the resource specified by the given file on a loader thread, see loadResourceAsync(const String&, bool).
+    ref<ResourceLoadRequest> loadResourceAsync(VirtualFile* file, bool quick=true);
+
+    /**
+     * Finalizes up to \p max_count (-1 means all) of the requests whose decoding has completed, in the order they were issued, 
+     * see ResourceLoadRequest::finalize(). Returns the number of requests finalized. Call this regularly from the thread owning 
+     * the OpenGL context, for example once per frame.
+     */
+    int finalizeLoadedResources(int max_count=-1);
+
+    //! Waits for the decoding of all the pending loadResourceAsync() requests, the calling thread takes part to the decoding.
+    void waitLoadedResources();
+
+    //! The number of loadResourceAsync() requests not yet finalized.
+    int pendingResourceCount() const { return (int)mRequests.size(); }
+
+    //! The maximum number of threads used by loadResourceAsync(), 0 means Thread::hardwareConcurrency().
+    void setLoaderThreadCount(int count) { mLoaderThreadCount = count; }
+
+    //! The maximum number of threads used by loadResourceAsync(), 0 means Thread::hardwareConcurrency().
+    int loaderThreadCount() const { return mLoaderThreadCount; }
+
     //! Writes the resource specified by the given file using the appropriate ResourceLoadWriter.
     bool writeResource(const String& path, ResourceDatabase* resource) const;
 
@@ -132,10 +228,30 @@ namespace vl
 
     std::vector< ref<WriteCallback> >& writeCallbacks() { return mWriteCallbacks; }
 
+  protected:
+    ref<VirtualFile> locateResource(const String& path) const;
+
+    ref<ResourceDatabase> decodeResource(VirtualFile* file, bool quick) const;
+
+    void executeLoadCallbacks(ResourceDatabase* db) const;
+
+    void decodeRequest(ResourceLoadRequest* request) const;
+
+    void joinFinishedLoaders();
+
   protected:
     std::vector< ref<ResourceLoadWriter> > mLoadWriters;
     std::vector< ref<LoadCallback> > mLoadCallbacks;
     std::vector< ref<WriteCallback> > mWriteCallbacks;
+
+    // asynchronous loading
+    std::vector< ref<ResourceLoadRequest> > mRequests;
+    std::deque<ResourceLoadRequest*> mQueue;
+    std::vector< ref<Thread> > mLoaders;
+    Mutex mAsyncMutex;
+    Condition mAsyncCondition; // signaled every time a request is decoded
+    int mLoaderThreadCount;
+    int mRunningLoaders;
   };
 
   //! Returs the default LoadWriterManager used by Visualization Library.
@@ -146,6 +262,9 @@ namespace vl
 
   //! Utility function, equivalent to defLoadWriterManager()->registerLoadWriter(rlw).
   inline void registerLoadWriter(ResourceLoadWriter* rlw) { defLoadWriterManager()->registerLoadWriter(rlw); }
+
+  //! Utility function, equivalent to defLoadWriterManager()->loadResourceAsync(path, quick).
+  inline ref<ResourceLoadRequest> loadResourceAsync(const String& path, bool quick=true) { return defLoadWriterManager()->loadResourceAsync(path, quick); }
 }
 
 #endif
@@ -34,6 +34,7 @@
 
 #include <vlCore/checks.hpp>
 #include <vlCore/IMutex.hpp>
+#include <vlCore/Atomic.hpp>
 #include <vlCore/TypeInfo.hpp>
 #include <string>
 
@@ -64,6 +65,7 @@ namespace vl
       mRefCountMutex = NULL;
       mReferenceCount = 0;
       mAutomaticDelete = true;
+      mAtomicRefCount = VL_ATOMIC_REFERENCE_COUNT != 0;
       // user data
       #if VL_OBJECT_USER_DATA
         mUserData = NULL;
@@ -74,12 +76,13 @@ namespace vl
       #endif
     }
 
-    //! Copy constructor: copies the name, ref count mutex and user data.
+    //! Copy constructor: copies the name, ref count mutex, atomic ref count mode and user data.
     Object(const Object& other)
     {
-      // copy the name, the ref count mutex and the user data.
+      // copy the name, the ref count mutex, the ref count mode and the user data.
       mObjectName = other.mObjectName;
       mRefCountMutex = other.mRefCountMutex;
+      mAtomicRefCount = other.mAtomicRefCount;
       #if VL_OBJECT_USER_DATA
         mUserData = other.mUserData;
       #endif
@@ -94,12 +97,13 @@ namespace vl
       #endif
     }
 
-    //! Copy operator: copies the object's name, ref count mutex and user data.
+    //! Copy operator: copies the object's name, ref count mutex, atomic ref count mode and user data.
     Object& operator=(const Object& other) 
     { 
-      // copy the name, the ref count mutex and the user data.
+      // copy the name, the ref count mutex, the ref count mode and the user data.
       mObjectName = other.mObjectName;
       mRefCountMutex = other.mRefCountMutex;
+      mAtomicRefCount = other.mAtomicRefCount;
       #if VL_OBJECT_USER_DATA
         mUserData = other.mUserData;
       #endif
@@ -125,6 +129,13 @@ namespace vl
     //! The mutex used to protect the reference counting of an Object across multiple threads.
     const IMutex* refCountMutex() const { return mRefCountMutex; }
 
+    //! If \p true the reference count is updated using lock-free atomic operations, making ref<> safe to use across threads without a refCountMutex().
+    //! The default value is defined by VL_ATOMIC_REFERENCE_COUNT. A refCountMutex(), if installed, has precedence over this setting.
+    void setAtomicRefCount(bool atomic) { mAtomicRefCount = atomic; }
+
+    //! If \p true the reference count is updated using lock-free atomic operations, making ref<> safe to use across threads without a refCountMutex().
+    bool atomicRefCount() const { return mAtomicRefCount; }
+
     //! Returns the number of references of an object.
     int referenceCount() const 
     { 
@@ -134,6 +145,12 @@ namespace vl
     //! Increments the reference count of an object.
     void incReference() const
     {
+      if (!refCountMutex() && mAtomicRefCount)
+      {
+        atomicIncrement( (volatile int&)mReferenceCount );
+        return;
+      }
+
       // Lock mutex
       if (refCountMutex())
         const_cast<IMutex*>(refCountMutex())->lock();
@@ -151,6 +168,14 @@ namespace vl
       // Save local copy in case of deletion.
       IMutex* mutex = mRefCountMutex;
 
+      if (!mutex && mAtomicRefCount)
+      {
+        VL_CHECK(mReferenceCount)
+        if (atomicDecrement( (volatile int&)mReferenceCount ) == 0 && automaticDelete())
+          delete this;
+        return;
+      }
+
       // Lock mutex.
       if (mutex)
         mutex->lock();
@@ -194,8 +219,15 @@ namespace vl
     std::string mObjectName;
 
     IMutex* mRefCountMutex;
+    // volatile only when the counter is atomic by default: it would otherwise slow down the plain increments and decrements,
+    // the per-object atomic mode accesses the counter through a volatile reference.
+#if VL_ATOMIC_REFERENCE_COUNT
+    mutable volatile int mReferenceCount;
+#else
     mutable int mReferenceCount;
+#endif
     bool mAutomaticDelete;
+    bool mAtomicRefCount;
 
   // debugging facilities
 
@@ -0,0 +1,263 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/Thread.hpp>
+#include <vlCore/ScopedMutex.hpp>
+#include <vector>
+
+#if !defined(VL_PLATFORM_WINDOWS)
+  #include <unistd.h> // sysconf()
+#endif
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+// Mutex
+//-----------------------------------------------------------------------------
+Mutex::Mutex()
+{
+  mLocked = false;
+  #if defined(VL_PLATFORM_WINDOWS)
+    InitializeCriticalSection(&mCriticalSection);
+  #else
+    pthread_mutex_init(&mMutex, NULL);
+  #endif
+}
+//-----------------------------------------------------------------------------
+Mutex::~Mutex()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    DeleteCriticalSection(&mCriticalSection);
+  #else
+    pthread_mutex_destroy(&mMutex);
+  #endif
+}
+//-----------------------------------------------------------------------------
+void Mutex::lock()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    EnterCriticalSection(&mCriticalSection);
+  #else
+    pthread_mutex_lock(&mMutex);
+  #endif
+  mLocked = true;
+}
+//-----------------------------------------------------------------------------
+void Mutex::unlock()
+{
+  mLocked = false;
+  #if defined(VL_PLATFORM_WINDOWS)
+    LeaveCriticalSection(&mCriticalSection);
+  #else
+    pthread_mutex_unlock(&mMutex);
+  #endif
+}
+//-----------------------------------------------------------------------------
+// Condition
+//-----------------------------------------------------------------------------
+Condition::Condition()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    InitializeConditionVariable(&mCondition);
+  #else
+    pthread_cond_init(&mCondition, NULL);
+  #endif
+}
+//-----------------------------------------------------------------------------
+Condition::~Condition()
+{
+  #if !defined(VL_PLATFORM_WINDOWS)
+    pthread_cond_destroy(&mCondition);
+  #endif
+}
+//-----------------------------------------------------------------------------
+void Condition::wait(Mutex* mutex)
+{
+  mutex->mLocked = false;
+  #if defined(VL_PLATFORM_WINDOWS)
+    SleepConditionVariableCS(&mCondition, &mutex->mCriticalSection, INFINITE);
+  #else
+    pthread_cond_wait(&mCondition, &mutex->mMutex);
+  #endif
+  mutex->mLocked = true;
+}
+//-----------------------------------------------------------------------------
+void Condition::notifyOne()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    WakeConditionVariable(&mCondition);
+  #else
+    pthread_cond_signal(&mCondition);
+  #endif
+}
+//-----------------------------------------------------------------------------
+void Condition::notifyAll()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    WakeAllConditionVariable(&mCondition);
+  #else
+    pthread_cond_broadcast(&mCondition);
+  #endif
+}
+//-----------------------------------------------------------------------------
+// Thread
+//-----------------------------------------------------------------------------
+Thread::Thread()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mStarted = false;
+  #if defined(VL_PLATFORM_WINDOWS)
+    mHandle = NULL;
+  #endif
+}
+//-----------------------------------------------------------------------------
+Thread::~Thread()
+{
+  // note: the derived class has already been destroyed at this point so
+  // derived classes should always wait() for the thread in their destructor.
+  wait();
+}
+//-----------------------------------------------------------------------------
+#if defined(VL_PLATFORM_WINDOWS)
+DWORD WINAPI Thread::threadEntry(LPVOID arg)
+{
+  reinterpret_cast<Thread*>(arg)->run();
+  return 0;
+}
+#else
+void* Thread::threadEntry(void* arg)
+{
+  reinterpret_cast<Thread*>(arg)->run();
+  return NULL;
+}
+#endif
+//-----------------------------------------------------------------------------
+bool Thread::start()
+{
+  if (mStarted)
+    return false;
+  #if defined(VL_PLATFORM_WINDOWS)
+    mHandle = CreateThread(NULL, 0, threadEntry, this, 0, NULL);
+    mStarted = mHandle != NULL;
+  #else
+    mStarted = pthread_create(&mHandle, NULL, threadEntry, this) == 0;
+  #endif
+  return mStarted;
+}
+//-----------------------------------------------------------------------------
+void Thread::wait()
+{
+  if (!mStarted)
+    return;
+  #if defined(VL_PLATFORM_WINDOWS)
+    WaitForSingleObject(mHandle, INFINITE);
+    CloseHandle(mHandle);
+    mHandle = NULL;
+  #else
+    pthread_join(mHandle, NULL);
+  #endif
+  mStarted = false;
+}
+//-----------------------------------------------------------------------------
+int Thread::hardwareConcurrency()
+{
+  int count = 1;
+  #if defined(VL_PLATFORM_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = (int)info.dwNumberOfProcessors;
+  #elif defined(_SC_NPROCESSORS_ONLN)
+    count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  #endif
+  return count < 1 ? 1 : count;
+}
+//-----------------------------------------------------------------------------
+namespace
+{
+  // Fetches task indices from a shared counter until all the tasks have been executed.
+  class TaskRunner: public Thread
+  {
+  public:
+    TaskRunner(ParallelTasks* tasks, int task_count, int* next_task, IMutex* mutex):
+      mTasks(tasks), mTaskCount(task_count), mNextTask(next_task), mMutex(mutex) {}
+
+    ~TaskRunner() { wait(); }
+
+    virtual void run()
+    {
+      for(;;)
+      {
+        int task = 0;
+        {
+          ScopedMutex lock(mMutex);
+          task = (*mNextTask)++;
+        }
+        if (task >= mTaskCount)
+          return;
+        mTasks->runTask(task);
+      }
+    }
+
+  private:
+    ParallelTasks* mTasks;
+    int mTaskCount;
+    int* mNextTask;
+    IMutex* mMutex;
+  };
+}
+//-----------------------------------------------------------------------------
+void Thread::runTasks(ParallelTasks* tasks, int task_count, int thread_count)
+{
+  if (thread_count <= 0)
+    thread_count = hardwareConcurrency();
+  if (thread_count > task_count)
+    thread_count = task_count;
+
+  if (thread_count <= 1)
+  {
+    for(int i=0; i<task_count; ++i)
+      tasks->runTask(i);
+    return;
+  }
+
+  Mutex mutex;
+  int next_task = 0;
+  // the calling thread acts as the last runner
+  std::vector< ref<TaskRunner> > runners;
+  for(int i=0; i<thread_count; ++i)
+    runners.push_back( new TaskRunner(tasks, task_count, &next_task, &mutex) );
+  for(int i=1; i<thread_count; ++i)
+    runners[i]->start();
+  runners[0]->run();
+  for(int i=1; i<thread_count; ++i)
+    runners[i]->wait();
+}
+//-----------------------------------------------------------------------------
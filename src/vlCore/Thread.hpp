@@ -0,0 +1,192 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef Thread_INCLUDE_ONCE
+#define Thread_INCLUDE_ONCE
+
+#include <vlCore/Object.hpp>
+
+#if !defined(VL_PLATFORM_WINDOWS)
+  #include <pthread.h>
+#endif
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // Mutex
+  //------------------------------------------------------------------------------
+  /**
+   * A native, non recursive IMutex implementation based on Win32 critical sections or pthread mutexes.
+   * \sa vl::ScopedMutex, vl::Thread
+  */
+  class VLCORE_EXPORT Mutex: public IMutex
+  {
+  public:
+    Mutex();
+
+    ~Mutex();
+
+    //! Locks the mutex.
+    virtual void lock();
+
+    //! Unlocks the mutex.
+    virtual void unlock();
+
+    //! Returns 1 if locked, 0 if non locked.
+    virtual int isLocked() const { return mLocked ? 1 : 0; }
+
+  private:
+    Mutex(const Mutex&): IMutex() {}
+    Mutex& operator=(const Mutex&) { return *this; }
+
+    friend class Condition;
+
+  private:
+  #if defined(VL_PLATFORM_WINDOWS)
+    CRITICAL_SECTION mCriticalSection;
+  #else
+    pthread_mutex_t mMutex;
+  #endif
+    volatile bool mLocked;
+  };
+  //------------------------------------------------------------------------------
+  // Condition
+  //------------------------------------------------------------------------------
+  /**
+   * A condition variable used together with a Mutex to wait for a condition signaled by another thread,
+   * based on Win32 condition variables (Windows Vista and later) or pthread condition variables.
+   *
+   * Like any condition variable it can wake up spuriously: always wait() in a loop that checks the condition
+   * while holding the mutex.
+   * \sa vl::Mutex, vl::Thread
+  */
+  class VLCORE_EXPORT Condition
+  {
+  public:
+    Condition();
+
+    ~Condition();
+
+    //! Unlocks \p mutex, which must be locked by the calling thread, waits to be notified and locks \p mutex again.
+    void wait(Mutex* mutex);
+
+    //! Wakes up one of the threads waiting on the condition.
+    void notifyOne();
+
+    //! Wakes up all the threads waiting on the condition.
+    void notifyAll();
+
+  private:
+    Condition(const Condition&) {}
+    Condition& operator=(const Condition&) { return *this; }
+
+  private:
+  #if defined(VL_PLATFORM_WINDOWS)
+    CONDITION_VARIABLE mCondition;
+  #else
+    pthread_cond_t mCondition;
+  #endif
+  };
+  //------------------------------------------------------------------------------
+  // ParallelTasks
+  //------------------------------------------------------------------------------
+  /**
+   * A set of independent tasks to be executed by Thread::runTasks().
+   * runTask() is called once for every task index, possibly from different threads at the same time.
+  */
+  class ParallelTasks
+  {
+  public:
+    virtual ~ParallelTasks() {}
+
+    //! Executes the task number \p index.
+    virtual void runTask(int index) = 0;
+  };
+  //------------------------------------------------------------------------------
+  // Thread
+  //------------------------------------------------------------------------------
+  /**
+   * A minimal platform-independent thread: reimplement run() and call start() and wait().
+   *
+   * \note Visualization Library's reference counting is not thread safe by default, 
+   * code running inside a Thread should not create or destroy ref<> objects pointing 
+   * to Objects shared with other threads unless they use atomic reference counting
+   * (see Object::setAtomicRefCount() and VL_ATOMIC_REFERENCE_COUNT) or have a refCountMutex() installed.
+   *
+   * \sa vl::Mutex, vl::Condition, vl::ParallelTasks
+  */
+  class VLCORE_EXPORT Thread: public Object
+  {
+    VL_INSTRUMENT_ABSTRACT_CLASS(vl::Thread, Object)
+
+  public:
+    Thread();
+
+    //! Waits for the thread to terminate.
+    virtual ~Thread();
+
+    //! Starts the thread, returns \p false if the thread could not be created or is already running.
+    bool start();
+
+    //! Waits for the thread to terminate. Returns immediately if the thread has not been started.
+    void wait();
+
+    //! Returns \p true if the thread has been started and has not been joined yet with wait().
+    bool isStarted() const { return mStarted; }
+
+    //! Returns the number of hardware threads available on the machine (at least 1).
+    static int hardwareConcurrency();
+
+    //! Executes \p tasks->runTask(i) for every \p i in [0, \p task_count) using up to \p thread_count threads.
+    //! The calling thread takes part to the execution and the function returns only when all the tasks have been completed.
+    //! If \p thread_count is 0 hardwareConcurrency() threads are used, if it's 1 all the tasks are executed sequentially on the calling thread.
+    static void runTasks(ParallelTasks* tasks, int task_count, int thread_count=0);
+
+  protected:
+    //! The function executed by the thread.
+    virtual void run() = 0;
+
+  private:
+    Thread(const Thread& other): Object(other) {}
+    Thread& operator=(const Thread&) { return *this; }
+
+  #if defined(VL_PLATFORM_WINDOWS)
+    static DWORD WINAPI threadEntry(LPVOID arg);
+    HANDLE mHandle;
+  #else
+    static void* threadEntry(void* arg);
+    pthread_t mHandle;
+  #endif
+    bool mStarted;
+  };
+}
+
+#endif
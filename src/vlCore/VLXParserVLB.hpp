@@ -34,18 +34,105 @@
 
 #include <vlCore/VLXParser.hpp>
 #include <vlCore/VLXBinaryDefs.hpp>
+#include <vlCore/MemoryFile.hpp>
+#include <algorithm>
 
 namespace vl
 {
-  /** Parses a VLT file translating it into a VLX hierarchy. */
+  /** Parses a VLB file translating it into a VLX hierarchy. 
+   * The file is read in large blocks, or directly from memory if it's a MemoryFile, and the arrays are decoded 
+   * directly into the VLXArray storage. */
   class VLXParserVLB: public VLXParser
   {
     VL_INSTRUMENT_CLASS(vl::VLXParserVLB, VLXParser)
 
   public:
+    //! Size of the blocks read from the input file.
+    static const int BlockSize = 128*1024;
+
     VLXParserVLB()
     {
       mVersion = 0;
+      mFlags = 0;
+      resetBuffer();
+    }
+
+    //! Starts reading from the current position of the input file.
+    void resetBuffer()
+    {
+      mPtr = mEnd = mBufferStart = NULL;
+      mBufferOffset = 0;
+      mBufferSize = 0;
+      if (inputFile())
+        mBufferOffset = inputFile()->position();
+
+      // read memory files in place
+      MemoryFile* memory_file = dynamic_cast<MemoryFile*>(inputFile());
+      if (memory_file && memory_file->buffer() && memory_file->size() > mBufferOffset)
+      {
+        mBufferStart = mPtr = memory_file->ptr() + mBufferOffset;
+        mEnd = memory_file->ptr() + memory_file->size();
+        mBufferSize = mEnd - mBufferStart;
+        mMapped = true;
+      }
+      else
+        mMapped = false;
+    }
+
+    //! Position in the input file of the next byte to be parsed.
+    long long position() const { return mBufferOffset + (mPtr - mBufferStart); }
+
+    //! Reads the next block of the input file, returns false at the end of the file.
+    bool fillBuffer()
+    {
+      VL_CHECK(mPtr == mEnd)
+      if (mMapped || !inputFile())
+        return false;
+      mBufferOffset += mBufferSize;
+      mBuffer.resize(BlockSize);
+      mBufferSize = inputFile()->read(&mBuffer[0], BlockSize);
+      if (mBufferSize <= 0)
+        mBufferSize = 0;
+      mBufferStart = mPtr = &mBuffer[0];
+      mEnd = mPtr + mBufferSize;
+      return mBufferSize != 0;
+    }
+
+    bool readByte(unsigned char& byte)
+    {
+      if (mPtr == mEnd && !fillBuffer())
+        return false;
+      byte = *mPtr++;
+      return true;
+    }
+
+    //! Reads \p byte_count bytes, large reads go directly from the file to \p buffer.
+    bool readBytes(void* buffer, long long byte_count)
+    {
+      unsigned char* out = (unsigned char*)buffer;
+      while(byte_count)
+      {
+        if (mPtr == mEnd)
+        {
+          if (!mMapped && byte_count >= BlockSize && inputFile())
+          {
+            mBufferOffset += mBufferSize;
+            long long n = inputFile()->read(out, byte_count);
+            mBufferOffset += n > 0 ? n : 0;
+            mBufferSize = 0;
+            mBufferStart = mPtr = mEnd = NULL;
+            return n == byte_count;
+          }
+          if (!fillBuffer())
+            return false;
+        }
+        long long n = mEnd - mPtr < byte_count ? mEnd - mPtr : byte_count;
+        memcpy(out, mPtr, (size_t)n);
+        mPtr += n;
+        out += n;
+        byte_count -= n;
+      }
+      return true;
     }
 
     bool parseHeader()
@@ -58,43 +145,94 @@ namespace vl
       unsigned char vlx_identifier[] = { 0xAB, 'V', 'L', 'X', 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
       unsigned char vlx[sizeof(vlx_identifier)];
       memset(vlx, 0, sizeof(vlx));
-      inputFile()->read(vlx, sizeof(vlx));
+      readBytes(vlx, sizeof(vlx));
       if ( memcmp(vlx, vlx_identifier, sizeof(vlx)) != 0 )
         return false;
 
-      if ( inputFile()->readUInt16(&mVersion,1) != 2 )
+      if ( !readBytes(&mVersion, 2) )
         return false;
+      swapLittleEndian(&mVersion, 2, 1);
 
       unsigned char ch = 0xFF;
-      for( ; inputFile()->readUInt8(&ch, 1) && ch ; ch = 0xFF )
+      for( ; readByte(ch) && ch ; ch = 0xFF )
         mEncoding.push_back(ch);
       if (ch)
         return false;
 
-      if ( inputFile()->readUInt32(&mFlags, 1) != 4 )
+      if ( !readBytes(&mFlags, 4) )
         return false;
+      swapLittleEndian(&mFlags, 4, 1);
 
       return true;
     }
 
-    bool readChunk(unsigned char& chunk) { return inputFile()->read(&chunk, 1) == 1; }
+    static bool isLittleEndianCPU()
+    {
+      unsigned short bet = 0x00FF;
+      return ((unsigned char*)&bet)[0] == 0xFF;
+    }
+
+    //! Converts \p count little endian values of \p size bytes to the CPU endianness.
+    static void swapLittleEndian(void* data, int size, long long count)
+    {
+      if (isLittleEndianCPU())
+        return;
+      unsigned char* bytes = (unsigned char*)data;
+      for(long long i=0; i<count; ++i, bytes+=size)
+        std::reverse(bytes, bytes+size);
+    }
+
+    bool readChunk(unsigned char& chunk) { return readByte(chunk); }
+
+    //! A 64 bits integer is encoded in at most 10 bytes: 6 bits in the first byte and 7 bits in each following byte.
+    static const int MaxIntegerBytes = 10;
+
+    //! Decodes the integer starting at \p ptr, which must be followed by at least MaxIntegerBytes bytes.
+    //! Returns the pointer past the integer or NULL if the encoding is longer than MaxIntegerBytes.
+    static const unsigned char* decodeInteger(const unsigned char* ptr, long long& n)
+    {
+      const unsigned char nxt_flag = 0x80;
+      const unsigned char neg_flag = 0x40;
+      unsigned char byte = *ptr++;
+      bool is_neg = (byte & neg_flag) != 0;
+      n = byte & 0x3F;
+      int shift = 6;
+      for(int i=1; byte & nxt_flag; ++i)
+      {
+        if (i == MaxIntegerBytes)
+          return NULL;
+        byte = *ptr++;
+        n |= (long long)(byte & 0x7F) << shift;
+        shift += 7;
+      }
+      if (is_neg)
+        n = -n;
+      return ptr;
+    }
 
     bool readInteger(long long& n)
     {
-#if 0
-      return inputFile()->read(&n, sizeof(n)) == sizeof(n);
-#else
+      // fast path: the whole integer is in the buffer
+      if (mEnd && mEnd - mPtr >= MaxIntegerBytes)
+      {
+        const unsigned char* ptr = decodeInteger(mPtr, n);
+        if (!ptr)
+          return false;
+        mPtr = ptr;
+        return true;
+      }
+
       const unsigned char nxt_flag = 0x80;
       const unsigned char neg_flag = 0x40;
       unsigned char byte = 0;
-      if ( inputFile()->read(&byte, 1) != 1 )
+      if ( !readByte(byte) )
         return false;
       bool is_neg = (byte & neg_flag) != 0;
       n = byte & 0x3F;
       int shift = 6;
-      while(byte & nxt_flag)
+      for(int i=1; byte & nxt_flag; ++i)
       {
-        if ( inputFile()->read(&byte, 1) != 1 )
+        if ( i == MaxIntegerBytes || !readByte(byte) )
           return false;
         n |= (long long)(byte & 0x7F) << shift;
         shift += 7;
@@ -102,31 +240,30 @@ namespace vl
       if (is_neg)
         n = -n;
       return true;
-#endif
     }
 
-    void decodeIntegers(const std::vector<unsigned char>& in, std::vector<long long>& out)
+    //! Decodes \p count integers from the input file into \p out.
+    bool decodeIntegers(long long* out, long long count)
     {
-      out.reserve(in.size());
-      const unsigned char nxt_flag = 0x80;
-      const unsigned char neg_flag = 0x40;
-      for( size_t i=0 ; i<in.size() ; )
+      for(long long i=0; i<count; )
       {
-        unsigned char byte = in[i++];
-        bool is_neg = (byte & neg_flag) != 0;
-        long long n = byte & 0x3F;
-        int shift = 6;
-        while(byte & nxt_flag)
+        // decode in place the integers that are entirely in the buffer
+        if (mEnd)
         {
-          byte = in[i++];
-          n |= (long long)(byte & 0x7F) << shift;
-          shift += 7;
+          const unsigned char* ptr = mPtr;
+          for( ; i<count && mEnd - ptr >= MaxIntegerBytes; ++i)
+          {
+            ptr = decodeInteger(ptr, out[i]);
+            if (!ptr)
+              return false;
+          }
+          mPtr = ptr;
         }
-        if (is_neg)
-          n = -n;
-        // --> output
-        out.push_back(n);
+        // the next integer might span two blocks
+        if (i < count && !readInteger(out[i++]))
+          return false;
       }
+      return true;
     }
 
     bool readString(std::string& str)
@@ -140,8 +277,7 @@ namespace vl
       if (len == 0)
         return true;
       str.resize((size_t)len);
-      bool ok = (size_t)inputFile()->read(&str[0], str.length()) == str.length();
-      return ok;
+      return readBytes(&str[0], str.length());
     }
 
     bool parse()
@@ -161,6 +297,7 @@ namespace vl
 
       inputFile()->close();
       inputFile()->open(OM_ReadOnly);
+      resetBuffer();
 
       // clear metadata
       mMetadata.clear();
@@ -198,7 +335,7 @@ namespace vl
 
           if (!parseStructure(st.get()))
           {
-            Log::error( Say("Error parsing binary file at offset %n.\n") << inputFile()->position() );
+            Log::error( Say("Error parsing binary file at offset %n.\n") << position() );
             return false;
           }
 
@@ -206,7 +343,7 @@ namespace vl
         }
         else
         {
-          Log::error( Say("Error parsing binary file at offset %n. Expected chunk structure.\n") << inputFile()->position() );
+          Log::error( Say("Error parsing binary file at offset %n. Expected chunk structure.\n") << position() );
           return false;
         }
       }
@@ -315,7 +452,7 @@ namespace vl
           if (!readInteger(count))
             return false;
 
-          // values
+          // values: decoded directly from the buffer
           VLXArrayInteger& arr = *val.getArrayInteger();
           if (count)
           {
@@ -325,10 +462,13 @@ namespace vl
             VL_CHECK(encode_count >= 0)
             if (encode_count)
             {
-              std::vector<unsigned char> encoded;
-              encoded.resize((size_t)encode_count);
-              inputFile()->readUInt8(&encoded[0], encode_count);
-              decodeIntegers(encoded, arr.value());
+              long long start = position();
+              arr.value().resize((size_t)count);
+              if (!decodeIntegers(&arr.value()[0], count))
+                return false;
+              VL_CHECK(position() - start == encode_count)
+              if (position() - start != encode_count)
+                return false;
             }
           }
           VL_CHECK((size_t)count == arr.value().size())
@@ -352,9 +492,10 @@ namespace vl
           if (count)
           {
 #if 1
-            long long c = inputFile()->readDouble( &arr.value()[0], count );
-            VL_CHECK(c == count * (int)sizeof(double))
-            return c == count * (int)sizeof(double);
+            bool ok = readBytes( &arr.value()[0], count * sizeof(double) );
+            swapLittleEndian( &arr.value()[0], sizeof(double), count );
+            VL_CHECK(ok)
+            return ok;
 #elif 0
             long long zsize = 0;
             readInteger(zsize);
@@ -387,14 +528,32 @@ namespace vl
           if (count)
           {
 #if 1
-            std::vector<float> floats;
-            floats.resize( (size_t)count );
-            long long c = inputFile()->readFloat( &floats[0], count );
-            // copy over floats to doubles
-            for(size_t i=0; i<floats.size(); ++i)
-              arr.value()[i] = floats[i];
-            VL_CHECK(c == count * (int)sizeof(float))
-            return c == count * (int)sizeof(float);
+            // convert the floats to doubles directly from the buffer
+            double* out = &arr.value()[0];
+            const bool swap = !isLittleEndianCPU();
+            for(long long i=0; i<count; )
+            {
+              float f = 0;
+              long long avail = (mEnd - mPtr) / sizeof(float);
+              if (avail == 0)
+              {
+                // the float spans two blocks
+                if (!readBytes(&f, sizeof(float)))
+                  return false;
+                swapLittleEndian(&f, sizeof(float), 1);
+                out[i++] = f;
+                continue;
+              }
+              long long end = i + avail < count ? i + avail : count;
+              for( ; i<end; ++i, mPtr+=sizeof(float))
+              {
+                memcpy(&f, mPtr, sizeof(float));
+                if (swap)
+                  swapLittleEndian(&f, sizeof(float), 1);
+                out[i] = f;
+              }
+            }
+            return true;
 #elif 0
             long long zsize = 0;
             readInteger(zsize);
@@ -440,10 +599,11 @@ namespace vl
       case VLB_ChunkRealDouble:
         {
           double d = 0;
-          if (inputFile()->readDouble(&d, 1) != sizeof(double))
+          if (!readBytes(&d, sizeof(double)))
             return false;
           else
           {
+            swapLittleEndian(&d, sizeof(double), 1);
             val.setReal(d);
             return true;
           }
@@ -479,7 +639,7 @@ namespace vl
       case VLB_ChunkBool:
         {
           unsigned char boolean = false;
-          if ( inputFile()->readUInt8(&boolean, 1) != 1 )
+          if ( !readByte(boolean) )
             return false;
           else
           {
@@ -503,6 +663,14 @@ namespace vl
   private:
     unsigned int mFlags;
     ref<VirtualFile> mInputFile;
+    // read buffer
+    std::vector<unsigned char> mBuffer;
+    const unsigned char* mBufferStart;
+    const unsigned char* mPtr;
+    const unsigned char* mEnd;
+    long long mBufferOffset;
+    long long mBufferSize;
+    bool mMapped;
   };
 }
 
@@ -35,6 +35,95 @@
 #include <set>
 
 using namespace vl;
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  // Decompression of a single zip entry into a MemoryFile.
+  // Everything is allocated on the calling thread: the tasks only touch their own ZippedFile,
+  // its own clone of the source zip file and the preallocated buffer. Their paths are copied
+  // by prepareJob() so that the tasks don't share any reference counted string with the directory.
+  struct ExtractJob
+  {
+    ExtractJob(): mDone(false), mOK(false) {}
+
+    ref<ZippedFile> mZippedFile;
+    ref<MemoryFile> mMemoryFile;
+    bool mDone;
+    bool mOK;
+  };
+  //-----------------------------------------------------------------------------
+  class ExtractTasks: public ParallelTasks
+  {
+  public:
+    ExtractTasks(std::vector<ExtractJob>& jobs, bool check_sum, Mutex* mutex=NULL, Condition* condition=NULL): mJobs(jobs), mMutex(mutex), mCondition(condition), mCheckSum(check_sum) {}
+
+    virtual void runTask(int index)
+    {
+      ExtractJob& job = mJobs[index];
+      bool ok = job.mZippedFile->extract((char*)job.mMemoryFile->ptr(), mCheckSum);
+      if (mMutex)
+        mMutex->lock();
+      job.mOK = ok;
+      job.mDone = true;
+      if (mCondition)
+        mCondition->notifyAll();
+      if (mMutex)
+        mMutex->unlock();
+    }
+
+  protected:
+    std::vector<ExtractJob>& mJobs;
+    Mutex* mMutex;
+    Condition* mCondition;
+    bool mCheckSum;
+  };
+  //-----------------------------------------------------------------------------
+  bool prepareJob(ExtractJob& job, const ZippedDirectory* dir, const String& name)
+  {
+    job.mZippedFile = dir->zippedFile(name);
+    if (!job.mZippedFile)
+    {
+      Log::error( Say("ZippedDirectory: file '%s' not found.\n") << name );
+      return false;
+    }
+    job.mZippedFile->setPath( job.mZippedFile->path().ptr() );
+    VirtualFile* source = job.mZippedFile->zippedFileInfo()->sourceZipFile();
+    if (source)
+      source->setPath( source->path().ptr() );
+    job.mMemoryFile = new MemoryFile;
+    job.mMemoryFile->setPath( job.mZippedFile->path() );
+    job.mMemoryFile->allocateBuffer( job.mZippedFile->size() );
+    return true;
+  }
+  //-----------------------------------------------------------------------------
+  // The jobs and the index are protected by the mutex of the ZippedDirectory, which is signaled 
+  // through its condition every time a job completes. The thread is referenced by the threads
+  // waiting for its files too, so its reference count is atomic.
+  class PrefetchThread: public Thread
+  {
+  public:
+    PrefetchThread(int thread_count, Mutex* mutex, Condition* condition): mMutex(mutex), mCondition(condition), mThreadCount(thread_count)
+    {
+      setAtomicRefCount(true);
+    }
+
+    ~PrefetchThread() { wait(); }
+
+    virtual void run()
+    {
+      ExtractTasks tasks(mJobs, true, mMutex, mCondition);
+      Thread::runTasks(&tasks, (int)mJobs.size(), mThreadCount+1);
+    }
+
+  public:
+    std::vector<ExtractJob> mJobs;
+    std::map<String, int> mJobIndex;
+    Mutex* mMutex;
+    Condition* mCondition;
+    int mThreadCount;
+  };
+}
 //-----------------------------------------------------------------------------
 ZippedDirectory::ZippedDirectory() {}
 //-----------------------------------------------------------------------------
@@ -53,6 +142,11 @@ ZippedDirectory::ZippedDirectory(VirtualFile* zip_file)
     setSourceZipFile(zip_file);
 }
 //-----------------------------------------------------------------------------
+ZippedDirectory::~ZippedDirectory()
+{
+  clearPrefetched();
+}
+//-----------------------------------------------------------------------------
 bool ZippedDirectory::setPath(const String& name)
 {
   String root = name;
@@ -107,6 +201,7 @@ void ZippedDirectory::setSourceZipFile(VirtualFile* file)
 //-----------------------------------------------------------------------------
 void ZippedDirectory::reset()
 {
+  clearPrefetched();
   mSourceZipFile = NULL;
   mFiles.clear();
 }
@@ -247,6 +342,9 @@ bool ZippedDirectory::init()
 //-----------------------------------------------------------------------------
 ref<VirtualFile> ZippedDirectory::file(const String& name) const
 {
+  ref<MemoryFile> mem_file = takePrefetched( translatePath(name) );
+  if (mem_file)
+    return mem_file;
   return zippedFile(name);
 }
 //-----------------------------------------------------------------------------
@@ -393,3 +491,124 @@ bool ZippedDirectory::isCorrupted()
   return false;
 }
 //-----------------------------------------------------------------------------
+bool ZippedDirectory::extractFiles(const std::vector<String>& names, std::vector< ref<MemoryFile> >& files, int thread_count, bool check_sum) const
+{
+  files.clear();
+  files.resize(names.size());
+
+  std::vector<ExtractJob> jobs;
+  std::vector<int> job_file;
+  jobs.reserve(names.size());
+  for(size_t i=0; i<names.size(); ++i)
+  {
+    ExtractJob job;
+    if (prepareJob(job, this, names[i]))
+    {
+      jobs.push_back(job);
+      job_file.push_back((int)i);
+    }
+  }
+
+  ExtractTasks tasks(jobs, check_sum);
+  Thread::runTasks(&tasks, (int)jobs.size(), thread_count);
+
+  bool ok = jobs.size() == names.size();
+  for(size_t i=0; i<jobs.size(); ++i)
+  {
+    if (jobs[i].mOK)
+      files[job_file[i]] = jobs[i].mMemoryFile;
+    else
+    {
+      Log::error( Say("ZippedDirectory::extractFiles(): could not extract '%s'.\n") << jobs[i].mZippedFile->path() );
+      ok = false;
+    }
+  }
+  return ok;
+}
+//-----------------------------------------------------------------------------
+void ZippedDirectory::prefetchFiles(const std::vector<String>& names, int thread_count)
+{
+  clearPrefetched();
+
+  ref<PrefetchThread> thread = new PrefetchThread(thread_count, &mPrefetchMutex, &mPrefetchCondition);
+  thread->mJobs.reserve(names.size());
+  for(size_t i=0; i<names.size(); ++i)
+  {
+    ExtractJob job;
+    if (prepareJob(job, this, names[i]) && thread->mJobIndex.find(job.mZippedFile->path()) == thread->mJobIndex.end())
+    {
+      thread->mJobIndex[job.mZippedFile->path()] = (int)thread->mJobs.size();
+      thread->mJobs.push_back(job);
+    }
+  }
+
+  if (thread->mJobs.empty())
+    return;
+
+  mPrefetchMutex.lock();
+  mPrefetchThread = thread;
+  mPrefetchMutex.unlock();
+  if (!thread->start())
+  {
+    // run synchronously
+    Log::warning("ZippedDirectory::prefetchFiles(): could not start the prefetch thread.\n");
+    thread->run();
+  }
+}
+//-----------------------------------------------------------------------------
+void ZippedDirectory::waitPrefetch()
+{
+  mPrefetchMutex.lock();
+  ref<Thread> thread = mPrefetchThread;
+  mPrefetchMutex.unlock();
+  if (thread)
+    thread->wait();
+}
+//-----------------------------------------------------------------------------
+void ZippedDirectory::clearPrefetched()
+{
+  mPrefetchMutex.lock();
+  ref<Thread> thread = mPrefetchThread;
+  mPrefetchThread = NULL;
+  mPrefetchMutex.unlock();
+  if (thread)
+    thread->wait();
+}
+//-----------------------------------------------------------------------------
+ref<MemoryFile> ZippedDirectory::takePrefetched(const String& path) const
+{
+  // note: 'thread' must be released after unlocking the mutex since the last reference joins the thread
+  ref<PrefetchThread> thread;
+  ref<MemoryFile> mem_file;
+  bool failed = false;
+
+  mPrefetchMutex.lock();
+  thread = static_cast<PrefetchThread*>(mPrefetchThread.get());
+  std::map<String, int>::iterator it;
+  if (thread && (it = thread->mJobIndex.find(path)) != thread->mJobIndex.end())
+  {
+    ExtractJob& job = thread->mJobs[it->second];
+    thread->mJobIndex.erase(it);
+    // the thread is released by the last of its files to be requested
+    if (thread->mJobIndex.empty())
+      mPrefetchThread = NULL;
+
+    // wait for the file to be extracted
+    while(!job.mDone)
+      mPrefetchCondition.wait(&mPrefetchMutex);
+
+    if (job.mOK)
+      mem_file = job.mMemoryFile;
+    else
+      failed = true;
+    // release the data as soon as it is handed out
+    job.mMemoryFile = NULL;
+    job.mZippedFile = NULL;
+  }
+  mPrefetchMutex.unlock();
+
+  if (failed)
+    Log::error( Say("ZippedDirectory: could not prefetch '%s'.\n") << path );
+  return mem_file;
+}
+//-----------------------------------------------------------------------------
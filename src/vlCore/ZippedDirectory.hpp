@@ -35,6 +35,8 @@
 #include <vlCore/VirtualDirectory.hpp>
 #include <vlCore/DiskFile.hpp>
 #include <vlCore/ZippedFile.hpp>
+#include <vlCore/MemoryFile.hpp>
+#include <vlCore/Thread.hpp>
 #include <algorithm>
 
 namespace vl
@@ -45,6 +47,10 @@ namespace vl
   /**
    * A VirtualDirectory capable of reading files from a .zip file.
    *
+   * Files are normally decompressed on demand by the ZippedFile returned by file(), on the calling thread.
+   * When many files are going to be needed at once use extractFiles() to decompress them concurrently
+   * into MemoryFiles or prefetchFiles() to decompress them in background while doing something else.
+   *
    * \sa
    * - VirtualDirectory
    * - DiskDirectory
@@ -66,6 +72,9 @@ namespace vl
 
     ZippedDirectory(VirtualFile* zip_file);
 
+    //! Waits for the completion of any pending prefetchFiles().
+    ~ZippedDirectory();
+
     bool setPath(const String& name);
 
     const VirtualFile* sourceZipFile() const;
@@ -77,6 +86,7 @@ namespace vl
     //! Sets the source zip file to NULL and disposes all the files contained in this directory.
     void reset();
 
+    //! Returns a ZippedFile reading \p name or, if \p name has been requested with prefetchFiles(), a MemoryFile containing its uncompressed data.
     ref<VirtualFile> file(const String& name) const;
 
     //! Accepts absolute and relative paths
@@ -98,12 +108,44 @@ namespace vl
 
   bool isCorrupted();
 
+    /**
+     * Decompresses the files \p names into \p files using up to \p thread_count threads (0 means Thread::hardwareConcurrency()).
+     * On return \p files[i] contains the data of \p names[i] or is NULL if the file does not exist or could not be decompressed.
+     * Returns \p true if all the files have been decompressed successfully.
+     * \note The source zip file is opened once per file, so it must be possible to open several clones of it at the same time.
+     */
+    bool extractFiles(const std::vector<String>& names, std::vector< ref<MemoryFile> >& files, int thread_count=0, bool check_sum=true) const;
+
+    /**
+     * Starts decompressing the files \p names in background, using up to \p thread_count threads besides the calling one.
+     * A subsequent file() on one of those names waits, if needed, for its data and returns it as a MemoryFile. 
+     * Every prefetched file is returned only once and is then released by the directory.
+     * Calling prefetchFiles() again waits for the previous prefetch to complete and discards the files not yet requested.
+     * \note The background threads never touch the reference counts of the objects shared with the directory, so without
+     * VL_ATOMIC_REFERENCE_COUNT the directory can still be used by the thread that owns it while the prefetch is running.
+     * The files returned by file() share their paths and source zip files with the directory, calling file() from several
+     * threads at once, for example from the loader threads of LoadWriterManager::loadResourceAsync(), requires 
+     * VL_ATOMIC_REFERENCE_COUNT. prefetchFiles(), waitPrefetch() and clearPrefetched() must not be called concurrently.
+     */
+    void prefetchFiles(const std::vector<String>& names, int thread_count=1);
+
+    //! Waits for the completion of the current prefetchFiles().
+    void waitPrefetch();
+
+    //! Waits for the completion of the current prefetchFiles() and releases the files not yet requested.
+    void clearPrefetched();
+
   protected:
     bool init();
 
+    ref<MemoryFile> takePrefetched(const String& path) const;
+
   protected:
     std::map< String, ref<ZippedFile> > mFiles;
     ref<VirtualFile> mSourceZipFile;
+    mutable ref<Thread> mPrefetchThread;
+    mutable Mutex mPrefetchMutex;
+    mutable Condition mPrefetchCondition;
   };
 
 }
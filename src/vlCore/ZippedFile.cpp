@@ -30,7 +30,6 @@
 /**************************************************************************************/
 
 #include <vlCore/ZippedFile.hpp>
-#include <vlCore/CRC32CheckSum.hpp>
 #include <vlCore/Log.hpp>
 #include <vlCore/Say.hpp>
 #include <zlib.h>
@@ -250,7 +249,8 @@ namespace
         switch (ret)
         {
         case Z_NEED_DICT:
-          ret = Z_DATA_ERROR;
+          inflateEnd(&strm);
+          return Z_DATA_ERROR;
         case Z_DATA_ERROR:
         case Z_MEM_ERROR:
           inflateEnd(&strm);
@@ -274,14 +274,13 @@ namespace
     return ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
   }
 //-----------------------------------------------------------------------------
-  inline int zdecompress(VirtualFile *source, char *dest, unsigned int bytes_to_read)
+  // inflates directly into \p dest which must be \p dest_size bytes
+  inline int zdecompress(VirtualFile *source, char *dest, unsigned int bytes_to_read, unsigned int dest_size)
   {
     const unsigned int CHUNK_SIZE = 128*1024;
     int ret;
-    unsigned have;
     z_stream strm;
     unsigned char in[CHUNK_SIZE];
-    unsigned char out[CHUNK_SIZE];
 
     strm.zalloc = Z_NULL;
     strm.zfree = Z_NULL;
@@ -293,6 +292,9 @@ namespace
     if (ret != Z_OK)
       return ret;
 
+    strm.next_out  = (Bytef*)dest;
+    strm.avail_out = dest_size;
+
     do
     {
       unsigned int byte_count = CHUNK_SIZE < bytes_to_read  ? CHUNK_SIZE : bytes_to_read;
@@ -303,30 +305,25 @@ namespace
         break;
       strm.next_in = in;
 
-      do
+      ret = inflate(&strm, Z_NO_FLUSH);
+      VL_CHECK(ret != Z_STREAM_ERROR);
+      switch (ret)
       {
-        strm.avail_out = CHUNK_SIZE;
-        strm.next_out = out;
-
-        ret = inflate(&strm, Z_NO_FLUSH);
-        VL_CHECK(ret != Z_STREAM_ERROR);
-        switch (ret)
-        {
-        case Z_NEED_DICT:
-          ret = Z_DATA_ERROR;
-        case Z_DATA_ERROR:
-        case Z_MEM_ERROR:
-          inflateEnd(&strm);
-          return ret;
-        }
-
-        have = CHUNK_SIZE - strm.avail_out;
-        memcpy(dest, out, have);
-        dest += have;
+      case Z_NEED_DICT:
+        inflateEnd(&strm);
+        return Z_DATA_ERROR;
+      case Z_DATA_ERROR:
+      case Z_MEM_ERROR:
+        inflateEnd(&strm);
+        return ret;
       }
-      while (strm.avail_out == 0);
 
-      VL_CHECK(strm.avail_in == 0);
+      // more data than expected
+      if (ret != Z_STREAM_END && strm.avail_out == 0 && strm.avail_in)
+      {
+        inflateEnd(&strm);
+        return Z_DATA_ERROR;
+      }
 
     } while (ret != Z_STREAM_END);
 
@@ -340,6 +337,7 @@ namespace
 ZippedFile::ZippedFile() 
 { 
   mReadBytes = -1; 
+  mCheckpointSpan = 4*1024*1024;
   mZStream = new z_stream_s;
   memset(mZStream, 0, sizeof(z_stream_s));
 }
@@ -355,7 +353,24 @@ const ZippedFileInfo* ZippedFile::zippedFileInfo() const { return mZippedFileInf
 //-----------------------------------------------------------------------------
 ZippedFileInfo* ZippedFile::zippedFileInfo() { return mZippedFileInfo.get(); }
 //-----------------------------------------------------------------------------
-void ZippedFile::setZippedFileInfo(ZippedFileInfo* info) { mZippedFileInfo = info; }
+void ZippedFile::setZippedFileInfo(ZippedFileInfo* info) { mZippedFileInfo = info; mCheckpointIndex = NULL; }
+//-----------------------------------------------------------------------------
+void ZippedFile::setCheckpointIndex(InflateIndex* index)
+{
+  if ( index && zippedFileInfo() && index->compressedSize() != -1 && index->compressedSize() != zippedFileInfo()->compressedSize() )
+  {
+    Log::error( Say("ZippedFile::setCheckpointIndex(): the index does not match the file '%s'.\n") << path() );
+    return;
+  }
+  mCheckpointIndex = index;
+  // restart the stream so that the index is tracked from the beginning
+  if (mCheckpointIndex && isOpen())
+  {
+    long long pos = position();
+    resetStream();
+    seekSet(pos);
+  }
+}
 //-----------------------------------------------------------------------------
 bool ZippedFile::exists() const
 {
@@ -431,6 +446,15 @@ bool ZippedFile::open(EOpenMode mode)
     return false;
   }
 
+  // build the checkpoint index while reading
+  if ( zippedFileInfo()->compressionMethod() == 8 && !mCheckpointIndex && checkpointSpan() > 0 && zippedFileInfo()->uncompressedSize() > checkpointSpan() )
+  {
+    mCheckpointIndex = new InflateIndex(checkpointSpan());
+    mCheckpointIndex->setCompressedSize(zippedFileInfo()->compressedSize());
+  }
+  if (mCheckpointIndex)
+    mCheckpointIndex->beginStream();
+
   mReadBytes = 0;
   mUncompressedBufferPtr = 0;
   mUncompressedBuffer.clear();
@@ -466,8 +490,54 @@ void ZippedFile::resetStream()
   open(OM_ReadOnly);
 }
 //-----------------------------------------------------------------------------
+bool ZippedFile::restoreCheckpoint(const InflateIndex::Checkpoint* cp)
+{
+  mUncompressedBufferPtr = 0;
+  mUncompressedBuffer.clear();
+  if ( !mCheckpointIndex->restore(cp, mZStream, zippedFileInfo()->sourceZipFile(), zippedFileInfo()->zippedFileOffset()) )
+  {
+    Log::error("ZippedFile::seekSet(): error restoring zip stream.\n");
+    close();
+    return false;
+  }
+  // mark the stream as initialized, see close()
+  mZStream->next_in  = mZipBufferIn;
+  mZStream->avail_in = 0;
+  mReadBytes = cp->uncompressedOffset();
+  return true;
+}
+//-----------------------------------------------------------------------------
 bool ZippedFile::seekSet_Implementation(long long pos)
 {
+  if ( isOpen() )
+  {
+    // stored files are seeked directly
+    if ( zippedFileInfo()->compressionMethod() == 0 )
+    {
+      if ( !zippedFileInfo()->sourceZipFile()->seekSet( zippedFileInfo()->zippedFileOffset() + pos ) )
+        return false;
+      mReadBytes = pos;
+      return true;
+    }
+
+    // seek inside the data already decompressed
+    long long buffer_start = mReadBytes - mUncompressedBufferPtr;
+    if ( pos >= buffer_start && pos < buffer_start + (long long)mUncompressedBuffer.size() )
+    {
+      mUncompressedBufferPtr = (int)(pos - buffer_start);
+      mReadBytes = pos;
+      return true;
+    }
+  }
+
+  // restart from the nearest checkpoint if it saves some decompression
+  const InflateIndex::Checkpoint* cp = mCheckpointIndex && isOpen() ? mCheckpointIndex->findCheckpoint(pos) : NULL;
+  if ( cp && (pos < position() || cp->uncompressedOffset() > position()) )
+  {
+    if ( !restoreCheckpoint(cp) )
+      return false;
+  }
+  else
   if (pos<position())
     resetStream();
 
@@ -597,15 +667,22 @@ bool ZippedFile::extract(char* destination, bool check_sum)
     case 8: // deflate 32K
     {
       if (zfile_info->mCompressionMethod == 8)
-        zdecompress( zip.get(), destination, zfile_info->mCompressedSize );
+      {
+        if ( zdecompress( zip.get(), destination, zfile_info->mCompressedSize, zfile_info->mUncompressedSize ) != Z_OK )
+        {
+          Log::error( Say("ZippedFile::extract(): error decompressing '%s'.\n") << path() );
+          zip->close();
+          return false;
+        }
+      }
       else
       if (zfile_info->mCompressionMethod == 0)
         zip->read( destination, zfile_info->mUncompressedSize );
 
       if (check_sum)
       {
-        CRC32CheckSum checksum;
-        unsigned int crc = checksum.compute( destination, (int)zfile_info->mUncompressedSize );
+        // zlib's crc32() is considerably faster than CRC32CheckSum
+        unsigned int crc = (unsigned int)::crc32( ::crc32(0L, Z_NULL, 0), (const Bytef*)destination, zfile_info->mUncompressedSize );
         // printf("crc = 0x%08x | 0x%08x -> %s\n", crc, zfile_info->mCRC32, zfile_info->mCRC32 == crc ? "MATCH" : "ERROR!");
         VL_CHECK( zfile_info->mCRC32 == crc );
         if ( zfile_info->mCRC32 != crc )
@@ -647,13 +724,17 @@ bool ZippedFile::fillUncompressedBuffer()
   if (mZStream->avail_in == 0)
     return false;
   mZStream->next_in = mZipBufferIn;
+  compressed_read_bytes += mZStream->avail_in;
+
+  // stop at every block boundary while the checkpoint index is being built
+  bool build_index = mCheckpointIndex && !mCheckpointIndex->isComplete();
 
   do
   {
     mZStream->avail_out = CHUNK_SIZE;
     mZStream->next_out  = mZipBufferOut;
 
-    ret = inflate(mZStream, Z_NO_FLUSH);
+    ret = inflate(mZStream, build_index ? Z_BLOCK : Z_NO_FLUSH);
     VL_CHECK(ret != Z_STREAM_ERROR);
     switch (ret)
     {
@@ -667,13 +748,19 @@ bool ZippedFile::fillUncompressedBuffer()
     }
 
     have = CHUNK_SIZE - mZStream->avail_out;
+    if (build_index)
+      mCheckpointIndex->update(mZStream, mZipBufferOut, have, compressed_read_bytes - mZStream->avail_in, ret == Z_STREAM_END);
     if (!have)
+    {
+      if (build_index && mZStream->avail_in && ret != Z_STREAM_END)
+        continue;
       break;
+    }
     int start = (int)mUncompressedBuffer.size();
     mUncompressedBuffer.resize(start + have);
     memcpy(&mUncompressedBuffer[0] + start, mZipBufferOut, have);
   }
-  while ( mZStream->avail_out == 0 );
+  while ( mZStream->avail_out == 0 || (build_index && mZStream->avail_in && ret != Z_STREAM_END) );
 
   return true;
 }
@@ -33,6 +33,7 @@
 #define ZippedFile_INCLUDE_ONCE
 
 #include <vlCore/VirtualFile.hpp>
+#include <vlCore/InflateIndex.hpp>
 struct z_stream_s;
 
 namespace vl
@@ -120,6 +121,12 @@ namespace vl
   /**
    * A VirtualFile used to read a file contained in a .zip archive.
    *
+   * Seeking inside a compressed file requires decompressing the data preceding the requested position.
+   * To make random access fast, while reading a file larger than checkpointSpan() a checkpoint
+   * is taken every checkpointSpan() bytes (see InflateIndex) and subsequent seeks restart the decompression
+   * from the nearest checkpoint. The index can be saved and reinstalled with setCheckpointIndex() to make
+   * random access fast from the first read.
+   *
    * \sa
    * - VirtualDirectory
    * - DiskDirectory
@@ -167,6 +174,8 @@ namespace vl
       close(); 
       super::operator=(other); 
       mZippedFileInfo = new ZippedFileInfo(*other.mZippedFileInfo); 
+      mCheckpointIndex = NULL;
+      mCheckpointSpan = other.mCheckpointSpan;
       if (mZippedFileInfo->sourceZipFile())
       {
         ref<VirtualFile> src_zip_copy = mZippedFileInfo->sourceZipFile()->clone();
@@ -179,6 +188,22 @@ namespace vl
 
     void resetStream();
 
+    //! The index used to seek quickly inside the compressed data, NULL if none has been built or installed yet.
+    InflateIndex* checkpointIndex() { return mCheckpointIndex.get(); }
+
+    //! The index used to seek quickly inside the compressed data, NULL if none has been built or installed yet.
+    const InflateIndex* checkpointIndex() const { return mCheckpointIndex.get(); }
+
+    //! Installs an index previously built for this file, for example loaded with InflateIndex::load(). 
+    //! An index built for data of a different compressed size is rejected.
+    void setCheckpointIndex(InflateIndex* index);
+
+    //! Distance in bytes between the checkpoints of an automatically built index. 0 disables the automatic index. Default is 4MB.
+    void setCheckpointSpan(long long span) { mCheckpointSpan = span; }
+
+    //! Distance in bytes between the checkpoints of an automatically built index. 0 disables the automatic index. Default is 4MB.
+    long long checkpointSpan() const { return mCheckpointSpan; }
+
   protected:
     virtual long long read_Implementation(void* buffer, long long bytes_to_read);
 
@@ -190,8 +215,12 @@ namespace vl
 
     virtual bool seekSet_Implementation(long long);
 
+    bool restoreCheckpoint(const InflateIndex::Checkpoint* cp);
+
   protected:
     ref<ZippedFileInfo> mZippedFileInfo;
+    ref<InflateIndex> mCheckpointIndex;
+    long long mCheckpointSpan;
     long long mReadBytes;
 
     z_stream_s* mZStream;
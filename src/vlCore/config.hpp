@@ -190,6 +190,18 @@
 #define VL_MAX_TIMERS 16
 
 
+/**
+ * Default reference counting mode of vl::Object.
+ *
+ * - 0 = reference counting is not thread safe unless an IMutex is installed with Object::setRefCountMutex()
+ * - 1 = reference counting uses lock-free atomic operations, ref<> can be safely copied across threads
+ *
+ * The mode can also be changed on a per-object basis using Object::setAtomicRefCount().
+ * \note Atomic operations are slower than plain increments/decrements but much quicker than locking a mutex.
+ */
+#define VL_ATOMIC_REFERENCE_COUNT 0
+
+
 /**
  * Enable String copy-on-write mode.
  *
@@ -948,6 +948,14 @@ namespace vl
     ID_Error
   } EImageDimension;
 
+  //! Filter used by Image::resample() and Image::generateMipmaps().
+  typedef enum
+  {
+    IRF_Box,     //!< Averages the source pixels covered by each destination pixel, the classic 2x2 mipmap filter.
+    IRF_Kaiser,  //!< Kaiser-windowed sinc with a radius of 3 pixels: sharp mipmaps with little ringing.
+    IRF_Lanczos  //!< Lanczos-windowed sinc with a radius of 3 pixels: the sharpest filter, best suited for resizing.
+  } EImageResampleFilter;
+
   typedef enum
   {
     ST_RenderStates = 1,
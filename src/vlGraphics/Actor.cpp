@@ -30,6 +30,7 @@
 /**************************************************************************************/
 
 #include <vlGraphics/Actor.hpp>
+#include <vlCore/Atomic.hpp>
 
 using namespace vl;
 
@@ -42,6 +43,13 @@ Actor::~Actor()
   deleteOcclusionQuery();
 }
 //-----------------------------------------------------------------------------
+int Actor::nextSerialNumber()
+{
+  // Actors can be created by several threads at once.
+  static volatile int serial_number = 0;
+  return atomicIncrement(serial_number);
+}
+//-----------------------------------------------------------------------------
 void Actor::setLODs(Renderable* lod0, Renderable* lod1, Renderable* lod2, Renderable* lod3, Renderable* lod4, Renderable* lod5)
 {
   if (lod0) { VL_CHECK(0<VL_MAX_ACTOR_LOD) setLod(0,lod0); }
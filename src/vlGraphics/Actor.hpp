@@ -142,7 +142,8 @@ namespace vl
     */
     Actor(Renderable* renderable = NULL, Effect* effect = NULL, Transform* transform = NULL, int block = 0, int rank = 0):
       mEffect(effect), mTransform(transform), mRenderBlock(block), mRenderRank(rank),
-      mTransformUpdateTick(-1), mBoundsUpdateTick(-1), mEnableMask(0xFFFFFFFF), mOcclusionQuery(0), mOcclusionQueryTick(0xFFFFFFFF), mIsOccludee(true)
+      mTransformUpdateTick(-1), mBoundsUpdateTick(-1), mEnableMask(0xFFFFFFFF), mOcclusionQuery(0), mOcclusionQueryTick(0xFFFFFFFF), mIsOccludee(true),
+      mSerialNumber(nextSerialNumber())
     {
       VL_DEBUG_SET_OBJECT_NAME()
       mActorEventCallbacks.setAutomaticDelete(false);
@@ -156,6 +157,10 @@ namespace vl
     //! Destructor.
     virtual ~Actor();
 
+    /** Number assigned to the Actor on creation and never assigned to another Actor, unlike the Actor's address
+      * which can be reused once the Actor is deleted. Useful to recognize an Actor across frames without keeping it alive. */
+    int serialNumber() const { return mSerialNumber; }
+
     /** Sets the Renderable object representing the LOD level specifed by \p lod_index. */
     void setLod(int lod_index, Renderable* renderable) 
     { 
@@ -464,6 +469,10 @@ namespace vl
     GLuint mOcclusionQuery;
     unsigned mOcclusionQueryTick;
     bool mIsOccludee;
+    int mSerialNumber;
+
+  private:
+    static int nextSerialNumber();
   };
   //---------------------------------------------------------------------------
   /** Defined as a simple subclass of Collection<Actor>, see Collection for more information. */
@@ -31,6 +31,8 @@
 
 #include <vlGraphics/ActorKdTree.hpp>
 #include <vlCore/Log.hpp>
+#include <vlCore/Thread.hpp>
+#include <vlCore/Atomic.hpp>
 #include <algorithm>
 
 using namespace vl;
@@ -64,8 +66,603 @@ namespace
     VL_CHECK(a2->lod(0))
     return a1->boundingBox().minCorner().z() < a2->boundingBox().minCorner().z();
   }
+
+  //-----------------------------------------------------------------------------
+  // SAH builder utilities
+  //-----------------------------------------------------------------------------
+  // Maximum number of candidate planes per axis + 1.
+  const int SAHBinCount = 32;
+  // Relative costs of visiting a node and of culling an Actor.
+  const real SAHTraversalCost = 1;
+  const real SAHActorCost = 1;
+
+  //! An Actor and its bounding box.
+  struct SAHItem
+  {
+    real mMin[3];
+    real mMax[3];
+    Actor* mActor;
+  };
+
+  //! Bounding box used while binning.
+  struct SAHBox
+  {
+    real mMin[3];
+    real mMax[3];
+
+    void setNull()
+    {
+      for(int i=0; i<3; ++i)
+      {
+        mMin[i] = +std::numeric_limits<real>::max();
+        mMax[i] = -std::numeric_limits<real>::max();
+      }
+    }
+
+    bool isNull() const { return mMin[0] > mMax[0]; }
+
+    void add(const real* min, const real* max)
+    {
+      for(int i=0; i<3; ++i)
+      {
+        mMin[i] = min[i] < mMin[i] ? min[i] : mMin[i];
+        mMax[i] = max[i] > mMax[i] ? max[i] : mMax[i];
+      }
+    }
+
+    real halfArea() const
+    {
+      if (isNull())
+        return 0;
+      real dx = mMax[0] - mMin[0];
+      real dy = mMax[1] - mMin[1];
+      real dz = mMax[2] - mMin[2];
+      return dx*dy + dy*dz + dz*dx;
+    }
+  };
+
+  //! Half of the surface area of an AABB, 0 for a null AABB.
+  inline real halfArea(const AABB& aabb)
+  {
+    if (aabb.isNull())
+      return 0;
+    real dx = aabb.width();
+    real dy = aabb.height();
+    real dz = aabb.depth();
+    return dx*dy + dy*dz + dz*dx;
+  }
+
+  //! Equivalent to Plane(d, axis normal).classify(aabb).
+  inline int classifyAxis(const SAHItem& item, int axis, real d)
+  {
+    real const NEPS = -0.0001f;
+    real const PEPS = +0.0001f;
+    bool left  = item.mMin[axis] - d < NEPS;
+    bool right = item.mMax[axis] - d > PEPS;
+    if (left && right)
+      return 0;
+    else
+    if (left)
+      return -1;
+    else
+    if (right)
+      return +1;
+    else
+      return 0;
+  }
 }
+//-----------------------------------------------------------------------------
+// ActorKdTree::SAHBuilder
+//-----------------------------------------------------------------------------
+//! Computes the tree layout on a flat array of SAHItem-s partitioned in place and then creates the ActorKdTree nodes.
+//! Subtrees smaller than the spawn size are queued as tasks and laid out in parallel once the upper part of the tree
+//! has been laid out. Since the layout does not touch any Object it can also be computed on a background thread.
+class ActorKdTree::SAHBuilder: public ParallelTasks
+{
+public:
+  //! A node of the layout. The items [mBegin, mEnd) are the ones contained in the node.
+  //! mChildN and mChildP are either the index of the child in the same node list, -1 if
+  //! there is no child or -2-task if the child is the root of the subtree laid out by a task.
+  struct Node
+  {
+    real mMin[3];
+    real mMax[3];
+    int mAxis;
+    real mD;
+    int mBegin;
+    int mEnd;
+    int mChildN;
+    int mChildP;
+  };
+
+  struct Task
+  {
+    int mBegin;
+    int mEnd;
+    int mDepth;
+  };
+
+  //! Sorts the tasks from the largest to the smallest.
+  struct TaskLess
+  {
+    TaskLess(const std::vector<Task>& tasks): mTasks(tasks) {}
+    bool operator()(int a, int b) const { return mTasks[a].mEnd - mTasks[a].mBegin > mTasks[b].mEnd - mTasks[b].mBegin; }
+    const std::vector<Task>& mTasks;
+  };
+
+  SAHBuilder(const ActorCollection& actors, int max_depth): mMaxDepth(max_depth), mSpawnSize(0)
+  {
+    mItems.resize(actors.size());
+    for(int i=0; i<(int)actors.size(); ++i)
+    {
+      VL_CHECK(actors[i]->lod(0))
+      const AABB& aabb = actors[i]->boundingBox();
+      for(int k=0; k<3; ++k)
+      {
+        mItems[i].mMin[k] = aabb.minCorner()[k];
+        mItems[i].mMax[k] = aabb.maxCorner()[k];
+      }
+      mItems[i].mActor = const_cast<Actor*>(actors[i].get());
+    }
+  }
+
+  //! Computes the layout of the tree using up to \p thread_count threads, 1 means only the calling thread.
+  void layout(int thread_count)
+  {
+    mNodes.clear();
+    mTasks.clear();
+    mTaskNodes.clear();
+
+    // queue the subtrees small enough to give each thread several tasks
+    mSpawnSize = thread_count > 1 ? std::max( (int)mItems.size() / (thread_count * 8), 1024 ) : 0;
+    if (!mItems.empty())
+      layout(mNodes, 0, (int)mItems.size(), 0);
+
+    if (!mTasks.empty())
+    {
+      // largest subtrees first
+      mTaskOrder.resize(mTasks.size());
+      for(int i=0; i<(int)mTaskOrder.size(); ++i)
+        mTaskOrder[i] = i;
+      std::sort( mTaskOrder.begin(), mTaskOrder.end(), TaskLess(mTasks) );
+      mTaskNodes.resize(mTasks.size());
+      mSpawnSize = 0;
+      Thread::runTasks( this, (int)mTasks.size(), thread_count );
+    }
+  }
+
+  //! Replaces the content of \p root with the ActorKdTree nodes described by the layout.
+  void createNodes(ActorKdTree* root) const
+  {
+    resetNode(root);
+    if (!mNodes.empty())
+      createNodes(root, mNodes, 0);
+  }
+
+  virtual void runTask(int index)
+  {
+    int task = mTaskOrder[index];
+    layout(mTaskNodes[task], mTasks[task].mBegin, mTasks[task].mEnd, mTasks[task].mDepth);
+  }
+
+protected:
+  static void resetNode(ActorKdTree* node)
+  {
+    node->mChildN = NULL;
+    node->mChildP = NULL;
+    node->actors()->clear();
+    node->mAABB.setNull();
+    node->mPlane = Plane();
+  }
+
+  void createNodes(ActorKdTree* node, const std::vector<Node>& nodes, int index) const
+  {
+    const Node& layout_node = nodes[index];
+    node->mAABB.setMinCorner(layout_node.mMin[0], layout_node.mMin[1], layout_node.mMin[2]);
+    node->mAABB.setMaxCorner(layout_node.mMax[0], layout_node.mMax[1], layout_node.mMax[2]);
+    if (layout_node.mAxis != -1)
+    {
+      vec3 normal(0,0,0);
+      normal[layout_node.mAxis] = 1;
+      node->mPlane = Plane(layout_node.mD, normal);
+    }
+    for(int i=layout_node.mBegin; i<layout_node.mEnd; ++i)
+      node->actors()->push_back(mItems[i].mActor);
+
+    if (layout_node.mChildN != -1)
+    {
+      node->setChildN(new ActorKdTree);
+      createChild(node->childN(), nodes, layout_node.mChildN);
+    }
+    if (layout_node.mChildP != -1)
+    {
+      node->setChildP(new ActorKdTree);
+      createChild(node->childP(), nodes, layout_node.mChildP);
+    }
+  }
+
+  void createChild(ActorKdTree* child, const std::vector<Node>& nodes, int index) const
+  {
+    if (index >= 0)
+      createNodes(child, nodes, index);
+    else
+      createNodes(child, mTaskNodes[-2-index], 0);
+  }
+
+  //! Lays out the subtree containing the items [begin, end) and returns the index of its root in \p nodes.
+  int layout(std::vector<Node>& nodes, int begin, int end, int depth)
+  {
+    VL_CHECK(begin < end)
+    const int index = (int)nodes.size();
+    nodes.push_back(Node());
+    Node node;
+
+    // node bounds
+
+    SAHBox bounds;
+    bounds.setNull();
+    for(int i=begin; i<end; ++i)
+      bounds.add(mItems[i].mMin, mItems[i].mMax);
+    for(int k=0; k<3; ++k)
+    {
+      node.mMin[k] = bounds.mMin[k];
+      node.mMax[k] = bounds.mMax[k];
+    }
+    node.mAxis   = -1;
+    node.mD      = 0;
+    node.mBegin  = begin;
+    node.mEnd    = end;
+    node.mChildN = -1;
+    node.mChildP = -1;
+
+    const int count = end - begin;
+    int axis = -1;
+    real d = 0;
+    if (count > 1 && depth < mMaxDepth)
+      findBestPlane(bounds, begin, end, axis, d);
+
+    if (axis != -1)
+    {
+      // partition the items in negative, straddling and positive ones
+
+      int n_end = begin;
+      int p_begin = end;
+      for(int i=begin; i<p_begin; )
+      {
+        int side = classifyAxis(mItems[i], axis, d);
+        if (side < 0)
+          std::swap(mItems[i++], mItems[n_end++]);
+        else
+        if (side > 0)
+          std::swap(mItems[i], mItems[--p_begin]);
+        else
+          ++i;
+      }
+
+      // the straddling items stay in the node
+      if (n_end != begin || p_begin != end)
+      {
+        node.mAxis  = axis;
+        node.mD     = d;
+        node.mBegin = n_end;
+        node.mEnd   = p_begin;
+        if (n_end > begin)
+          node.mChildN = layoutOrDefer(nodes, begin, n_end, depth+1);
+        if (p_begin < end)
+          node.mChildP = layoutOrDefer(nodes, p_begin, end, depth+1);
+      }
+    }
+
+    nodes[index] = node;
+    return index;
+  }
+
+  int layoutOrDefer(std::vector<Node>& nodes, int begin, int end, int depth)
+  {
+    if (mSpawnSize && end - begin <= mSpawnSize)
+    {
+      Task task;
+      task.mBegin = begin;
+      task.mEnd   = end;
+      task.mDepth = depth;
+      mTasks.push_back(task);
+      return -2 - ((int)mTasks.size() - 1);
+    }
+    else
+      return layout(nodes, begin, end, depth);
+  }
 
+  //! Returns in \p axis and \p d the plane with the lowest SAH cost or axis = -1 if no plane is better than making a leaf.
+  //! The area of a child is the one of the part of the node box on its side of the plane.
+  void findBestPlane(const SAHBox& bounds, int begin, int end, int& axis, real& d)
+  {
+    const int count = end - begin;
+    const real node_area = bounds.halfArea();
+    real best_cost = SAHActorCost * count;
+    axis = -1;
+    if (node_area <= 0)
+      return;
+
+    // small nodes don't need many candidate planes
+    const int bin_count = count + 2 < SAHBinCount ? count + 2 : SAHBinCount;
+
+    for(int k=0; k<3; ++k)
+    {
+      const real extent = bounds.mMax[k] - bounds.mMin[k];
+      if (extent <= 0)
+        continue;
+      const real scale = bin_count / extent;
+
+      // bin the items by the position of their min and max corners
+
+      int min_count[SAHBinCount];
+      int max_count[SAHBinCount];
+      for(int b=0; b<bin_count; ++b)
+        min_count[b] = max_count[b] = 0;
+      for(int i=begin; i<end; ++i)
+      {
+        const SAHItem& item = mItems[i];
+        int bmin = (int)((item.mMin[k] - bounds.mMin[k]) * scale);
+        int bmax = (int)((item.mMax[k] - bounds.mMin[k]) * scale);
+        ++min_count[bmin < bin_count ? bmin : bin_count-1];
+        ++max_count[bmax < bin_count ? bmax : bin_count-1];
+      }
+
+      // the items entirely below the plane b are the ones whose max corner is in a bin < b,
+      // the ones entirely above are the ones whose min corner is in a bin >= b
+
+      const int k1 = (k+1) % 3;
+      const int k2 = (k+2) % 3;
+      const real e1 = bounds.mMax[k1] - bounds.mMin[k1];
+      const real e2 = bounds.mMax[k2] - bounds.mMin[k2];
+      int n_count = 0;
+      int p_count = count;
+      for(int b=1; b<bin_count; ++b)
+      {
+        n_count += max_count[b-1];
+        p_count -= min_count[b-1];
+        if (n_count == 0 && p_count == 0)
+          continue;
+        const real n_extent = b / scale;
+        const real p_extent = extent - n_extent;
+        const real n_area = n_extent * (e1 + e2) + e1 * e2;
+        const real p_area = p_extent * (e1 + e2) + e1 * e2;
+        const int straddling = count - n_count - p_count;
+        const real cost = SAHTraversalCost + SAHActorCost * (straddling + (n_area * n_count + p_area * p_count) / node_area);
+        if (cost < best_cost)
+        {
+          best_cost = cost;
+          axis = k;
+          d = bounds.mMin[k] + n_extent;
+        }
+      }
+    }
+  }
+
+protected:
+  std::vector<SAHItem> mItems;
+  std::vector<Node> mNodes;
+  std::vector<Task> mTasks;
+  std::vector<int> mTaskOrder;
+  std::vector< std::vector<Node> > mTaskNodes;
+  int mMaxDepth;
+  int mSpawnSize;
+};
+
+//-----------------------------------------------------------------------------
+// ActorKdTree::RebuildThread
+//-----------------------------------------------------------------------------
+//! Computes the layout of a new tree on a background thread, see refitKdTree().
+class ActorKdTree::RebuildThread: public Thread
+{
+public:
+  //! The Actor[s] are kept alive by the thread until it's destroyed.
+  RebuildThread(const ActorCollection& actors, int max_depth): mActors(actors), mBuilder(actors, max_depth), mDone(0) {}
+
+  //! The layout refers to the Actor[s] and to the builder, which are destroyed with this object.
+  ~RebuildThread() { wait(); }
+
+  //! Computes the layout on the calling thread, used if the thread could not be started.
+  void layoutNow() { run(); }
+
+  //! Returns \p true when the layout has been computed.
+  bool done() { return atomicFetchAdd(mDone, 0) != 0; }
+
+  const SAHBuilder& builder() const { return mBuilder; }
+
+protected:
+  virtual void run()
+  {
+    mBuilder.layout(1);
+    atomicIncrement(mDone);
+  }
+
+protected:
+  ActorCollection mActors;
+  SAHBuilder mBuilder;
+  volatile int mDone;
+};
+//-----------------------------------------------------------------------------
+// ActorKdTree::RefitState
+//-----------------------------------------------------------------------------
+//! Flat view of a tree used by refitKdTree(). The nodes are stored in pre-order so that iterating them
+//! backwards visits the children before their parents.
+class ActorKdTree::RefitState
+{
+public:
+  RefitState(ActorKdTree* root, bool refit_all): mCost(0), mBuildCost(0)
+  {
+    addNode(root, -1);
+    if (refit_all)
+    {
+      for(int i=0; i<(int)mActors.size(); ++i)
+        mActors[i]->computeBounds();
+      mDirty.assign(mNodes.size(), 1);
+      updateNodes();
+    }
+    mBuildCost = normalizedCost();
+  }
+
+  //! Updates the Actor[s] whose transform or renderable bounds changed and their nodes, returns the number of moved Actor[s].
+  int refit()
+  {
+    int moved = 0;
+    for(int i=0; i<(int)mActors.size(); ++i)
+    {
+      Actor* actor = mActors[i];
+      long long transform_tick = actor->transform() ? actor->transform()->worldMatrixUpdateTick() : -1;
+      if (transform_tick != mTransformTicks[i] || actor->lod(0)->boundsDirty() || actor->lod(0)->boundsUpdateTick() != mBoundsTicks[i])
+      {
+        actor->computeBounds();
+        mTransformTicks[i] = transform_tick;
+        mBoundsTicks[i] = actor->lod(0)->boundsUpdateTick();
+        // flag the node and its ancestors
+        for(int node = mActorNodes[i]; node != -1 && !mDirty[node]; node = mParents[node])
+          mDirty[node] = 1;
+        ++moved;
+      }
+    }
+    if (moved)
+      updateNodes();
+    return moved;
+  }
+
+  int actorCount() const { return (int)mActors.size(); }
+
+  //! The SAH cost of the tree relative to the area of the root.
+  real normalizedCost() const
+  {
+    real root_area = halfArea(mNodes[0]->aabb());
+    return root_area > 0 ? mCost / root_area : 0;
+  }
+
+  float quality() const
+  {
+    return mBuildCost > 0 ? (float)(normalizedCost() / mBuildCost) : 1.0f;
+  }
+
+protected:
+  void addNode(ActorKdTree* node, int parent)
+  {
+    const int index = (int)mNodes.size();
+    mNodes.push_back(node);
+    mParents.push_back(parent);
+    mDirty.push_back(0);
+    mNodeCosts.push_back( nodeCost(node) );
+    mCost += mNodeCosts.back();
+    for(int i=0; i<node->actors()->size(); ++i)
+    {
+      Actor* actor = node->actors()->at(i);
+      VL_CHECK(actor->lod(0))
+      mActors.push_back(actor);
+      mActorNodes.push_back(index);
+      mTransformTicks.push_back(actor->transform() ? actor->transform()->worldMatrixUpdateTick() : -1);
+      mBoundsTicks.push_back(actor->lod(0)->boundsUpdateTick());
+    }
+    if (node->childN())
+      addNode(node->childN(), index);
+    if (node->childP())
+      addNode(node->childP(), index);
+  }
+
+  static real nodeCost(const ActorKdTree* node)
+  {
+    return halfArea(node->aabb()) * (SAHTraversalCost + SAHActorCost * node->actors()->size());
+  }
+
+  //! Recomputes the AABB of the flagged nodes, children first.
+  void updateNodes()
+  {
+    for(int i=(int)mNodes.size()-1; i>=0; --i)
+    {
+      if (!mDirty[i])
+        continue;
+      mDirty[i] = 0;
+      ActorKdTree* node = mNodes[i];
+      AABB aabb;
+      for(int j=0; j<node->actors()->size(); ++j)
+        aabb += node->actors()->at(j)->boundingBox();
+      if (node->childN())
+        aabb += node->childN()->aabb();
+      if (node->childP())
+        aabb += node->childP()->aabb();
+      node->mAABB = aabb;
+      mCost -= mNodeCosts[i];
+      mNodeCosts[i] = nodeCost(node);
+      mCost += mNodeCosts[i];
+    }
+  }
+
+public:
+  ref<RebuildThread> mRebuild;
+
+protected:
+  std::vector<ActorKdTree*> mNodes;
+  std::vector<int> mParents;
+  std::vector<char> mDirty;
+  std::vector<real> mNodeCosts;
+  std::vector<Actor*> mActors;
+  std::vector<int> mActorNodes;
+  std::vector<long long> mTransformTicks;
+  std::vector<long long> mBoundsTicks;
+  real mCost;
+  real mBuildCost;
+};
+
+//-----------------------------------------------------------------------------
+ActorKdTree::~ActorKdTree()
+{
+  resetRefit();
+}
+//-----------------------------------------------------------------------------
+void ActorKdTree::resetRefit()
+{
+  // waits for the background rebuild to terminate
+  delete mRefitState;
+  mRefitState = NULL;
+}
+//-----------------------------------------------------------------------------
+int ActorKdTree::refitKdTree()
+{
+  // use the result of the background rebuild
+  if (mRefitState && mRefitState->mRebuild && mRefitState->mRebuild->done())
+  {
+    ref<RebuildThread> rebuild = mRefitState->mRebuild;
+    resetRefit();
+    rebuild->wait();
+    rebuild->builder().createNodes(this);
+    // the Actor[s] may have moved during the rebuild
+    mRefitState = new RefitState(this, true);
+    return mRefitState->actorCount();
+  }
+
+  if (!mRefitState)
+    mRefitState = new RefitState(this, false);
+
+  int moved = mRefitState->refit();
+
+  // start a background rebuild if the tree degraded too much
+  if (moved && !mRefitState->mRebuild && mRefitRebuildThreshold > 1 && mRefitState->quality() > mRefitRebuildThreshold)
+  {
+    ActorCollection acts;
+    extractActors(acts);
+    mRefitState->mRebuild = new RebuildThread(acts, mBuildMaxDepth);
+    if (!mRefitState->mRebuild->start())
+      mRefitState->mRebuild->layoutNow();
+  }
+
+  return moved;
+}
+//-----------------------------------------------------------------------------
+float ActorKdTree::refitQuality() const
+{
+  return mRefitState ? mRefitState->quality() : 1.0f;
+}
+//-----------------------------------------------------------------------------
+bool ActorKdTree::isRebuilding() const
+{
+  return mRefitState && mRefitState->mRebuild;
+}
 //-----------------------------------------------------------------------------
 ref<ActorKdTree> ActorKdTree::kdtreeFromNonLeafyActors(int max_depth, float minimum_volume)
 {
@@ -104,6 +701,8 @@ void ActorKdTree::computeLocalAABB(const ActorCollection& acts)
 void ActorKdTree::buildKdTree(ActorCollection& acts, int max_depth, float minimum_volume)
 {
   int counter = 0;
+  resetRefit();
+  mBuildMaxDepth = max_depth;
   prepareActors(acts);
   compileTree_internal(acts, counter, max_depth, minimum_volume);
 }
@@ -115,6 +714,20 @@ void ActorKdTree::rebuildKdTree(int max_depth, float minimum_volume)
   buildKdTree(acts, max_depth, minimum_volume);
 }
 //-----------------------------------------------------------------------------
+void ActorKdTree::buildKdTreeSAH(ActorCollection& acts, int max_depth, int thread_count)
+{
+  resetRefit();
+  mBuildMaxDepth = max_depth;
+  prepareActors(acts);
+
+  if (thread_count <= 0)
+    thread_count = Thread::hardwareConcurrency();
+
+  SAHBuilder builder(acts, max_depth);
+  builder.layout(thread_count);
+  builder.createNodes(this);
+}
+//-----------------------------------------------------------------------------
 void ActorKdTree::compileTree_internal(ActorCollection& acts, int& counter, int max_depth, float minimum_volume)
 {
   mChildN = NULL;
@@ -269,6 +882,7 @@ bool ActorKdTree::findBestPlane(Plane& plane, int& counter, ActorCollection& act
 ActorKdTree* ActorKdTree::insertActor(Actor* actor)
 {
   VL_CHECK(actor->lod(0))
+  resetRefit();
   if (childN() == 0 && childP() == 0)
     actors()->push_back(actor);
   else
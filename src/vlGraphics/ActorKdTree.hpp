@@ -59,10 +59,11 @@ namespace vl
     VL_INSTRUMENT_CLASS(vl::ActorKdTree, ActorTreeAbstract)
 
   public:
-    ActorKdTree()
+    ActorKdTree(): mRefitRebuildThreshold(1.5f), mBuildMaxDepth(100), mRefitState(NULL)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
+    ~ActorKdTree();
     virtual int childrenCount() const;
     virtual ActorTreeAbstract* child(int i);
     virtual const ActorTreeAbstract* child(int i) const;
@@ -80,6 +81,49 @@ namespace vl
   //! \note This method calls prepareActors() before computing the KdTree.
   void rebuildKdTree(int max_depth=100, float minimum_volume=0);
 
+  /**
+   * Builds a ActorKdTree with the given list of Actor[s] choosing the splitting planes using a binned surface area heuristic (SAH).
+   * Unlike buildKdTree() the Actor[s] are not sorted at every node and the splitting planes minimize the expected number of
+   * nodes and Actor[s] tested during the culling, which usually produces trees that are faster to cull.
+   * The subtrees can be built in parallel: \p thread_count equal to 1 uses only the calling thread, 0 uses Thread::hardwareConcurrency() threads.
+   * The resulting tree does not depend on the number of threads used.
+   * \note This method calls prepareActors() before computing the KdTree.
+   */
+  void buildKdTreeSAH(ActorCollection& actors, int max_depth=100, int thread_count=1);
+
+  /**
+   * Updates bottom-up the bounding boxes of the nodes containing Actor[s] that moved, i.e. whose Transform::worldMatrixUpdateTick()
+   * or Renderable bounds changed since the previous refit, without changing the structure of the tree.
+   * Only the moved Actor[s] and their ancestor nodes are updated, which makes this method much cheaper than computeAABB() or a rebuild.
+   *
+   * The quality of the tree is measured with the surface area heuristic: when refitQuality() exceeds refitRebuildThreshold() the tree is
+   * rebuilt with buildKdTreeSAH() on a background thread, using the \p max_depth of the last buildKdTree() or buildKdTreeSAH(),
+   * meanwhile the refitted tree stays in use. The next refitKdTree() after
+   * the background build completed replaces the content of the tree with the new nodes and refits them.
+   *
+   * Call this method on the root node after the world matrices of the frame have been computed.
+   * \return The number of Actor[s] whose bounds changed, all the Actor[s] of the tree when the result of a background rebuild has been used.
+   * \note While a background rebuild is pending the Actor[s] must not be removed from the tree.
+   * \note The refit information is reset by buildKdTree(), buildKdTreeSAH() and insertActor(), after any other change to
+   * the structure of the tree, like eraseActor() or harvestNonLeafActors(), call resetRefit().
+   */
+  int refitKdTree();
+
+  //! Discards the refit information and any pending background rebuild, see refitKdTree().
+  void resetRefit();
+
+  //! Returns the current surface area heuristic cost of the tree divided by its cost when it was built, 1 when no refit has been done yet.
+  float refitQuality() const;
+
+  //! When refitQuality() exceeds this value refitKdTree() starts a background rebuild. A value <= 1 disables the rebuilds. Default is 1.5.
+  void setRefitRebuildThreshold(float threshold) { mRefitRebuildThreshold = threshold; }
+
+  //! When refitQuality() exceeds this value refitKdTree() starts a background rebuild. A value <= 1 disables the rebuilds. Default is 1.5.
+  float refitRebuildThreshold() const { return mRefitRebuildThreshold; }
+
+  //! Returns \p true if a background rebuild has been started by refitKdTree() and its result has not been used yet.
+  bool isRebuilding() const;
+
   //! Returns the splitting plane used to divide its two child nodes
   const Plane& plane() const { return mPlane; }
 
@@ -119,6 +163,14 @@ namespace vl
   void harvestNonLeafActors(ActorCollection& actors);
 
   private:
+    class SAHBuilder;
+    class RefitState;
+    class RebuildThread;
+
+    // no copy constructor and no assignment operator: the refit state refers to the nodes of this tree
+    ActorKdTree(const ActorKdTree& other): ActorTreeAbstract(other) {}
+    ActorKdTree& operator=(const ActorKdTree&) { return *this; }
+
     void setChildN(ActorKdTree* child) 
     { 
       VL_CHECK(child); 
@@ -149,6 +201,9 @@ namespace vl
     Plane mPlane;
     ref<ActorKdTree> mChildN;
     ref<ActorKdTree> mChildP;
+    float mRefitRebuildThreshold;
+    int mBuildMaxDepth;
+    RefitState* mRefitState;
   };
 
 }
@@ -67,11 +67,13 @@ namespace vl
       mBufferObject = new BufferObject;
       mBufferObjectDirty = true;
       mBufferObjectUsage = vl::BU_STATIC_DRAW;
+      mBufferChangedTick = 0;
     }
 
     //! Copies only the local data and not the BufferObject related fields
     ArrayAbstract(const ArrayAbstract& other): Object(other) 
     {
+      mBufferChangedTick = 0;
       operator=(other);
     }
     //! Copies only the local data and not the BufferObject related fields
@@ -79,6 +81,7 @@ namespace vl
     {
       bufferObject()->resize( other.bufferObject()->bytesUsed() );
       memcpy( ptr(), other.ptr(), bytesUsed() );
+      ++mBufferChangedTick;
     }
 
     virtual ref<ArrayAbstract> clone() const = 0;
@@ -134,7 +137,11 @@ namespace vl
     bool isBufferObjectDirty() const { return mBufferObjectDirty; }
 
     //! Wether the BufferObject should be updated or not using the local storage. Initially set to true.
-    void setBufferObjectDirty(bool dirty=true) { mBufferObjectDirty = dirty; }
+    void setBufferObjectDirty(bool dirty=true) { mBufferObjectDirty = dirty; if (dirty) ++mBufferChangedTick; }
+
+    //! Incremented every time the array is marked as changed via setBufferObjectDirty(true) or operator=().
+    //! Used by caches derived from the array's contents (see vl::TriangleBVH) to detect in-place edits.
+    long long bufferChangedTick() const { return mBufferChangedTick; }
 
     //! BU_STATIC_DRAW by default
     EBufferObjectUsage usage() const { return mBufferObjectUsage; }
@@ -154,6 +161,7 @@ namespace vl
     ref<BufferObject> mBufferObject;
     EBufferObjectUsage mBufferObjectUsage;
     bool mBufferObjectDirty;
+    long long mBufferChangedTick;
   };
 //-----------------------------------------------------------------------------
 // Array
@@ -233,7 +241,7 @@ namespace vl
 
     virtual ref<ArrayAbstract> clone() const
     {
-      ref<Array> arr = createArray()->as<Array>(); VL_CHECK(arr);
+      ref<Array> arr = createArray()->template as<Array>(); VL_CHECK(arr);
       if (size())
       {
         arr->resize(size());
@@ -0,0 +1,406 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/DepthSortCallback.hpp>
+#include <vlCore/Thread.hpp>
+#include <algorithm>
+#include <set>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+  #define VL_DEPTHSORT_SSE 1
+  #include <xmmintrin.h>
+#else
+  #define VL_DEPTHSORT_SSE 0
+#endif
+
+using namespace vl;
+
+namespace
+{
+  //! Maps a float to an unsigned integer with the same ordering.
+  inline u32 sortableFloat(float value)
+  {
+    u32 bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+  }
+
+  //! A primitive made of N indices of type T.
+  template<typename T, int N>
+  struct Primitive
+  {
+    T mIndex[N];
+  };
+
+  //! Computes the sort key of each primitive: the sum of the eye-space z of its vertices in the upper 32 bits, its index in the lower 32.
+  template<typename T, int N>
+  void computeKeys(const T* indices, size_t count, const float* eye_z, u32 flip, u64* keys)
+  {
+    for(size_t i=0; i<count; ++i, indices+=N)
+    {
+      float z = eye_z[indices[0]];
+      for(int j=1; j<N; ++j)
+        z += eye_z[indices[j]];
+      keys[i] = ((u64)(sortableFloat(z) ^ flip) << 32) | (u64)i;
+    }
+  }
+
+  //! Rewrites the primitives in the order specified by the lower 32 bits of \p keys.
+  template<typename T, int N>
+  void reorderPrimitives(T* indices, size_t count, const u64* keys, std::vector<unsigned char>& scratch)
+  {
+    typedef Primitive<T,N> PrimitiveType;
+    scratch.resize( count * sizeof(PrimitiveType) );
+    PrimitiveType* sorted = (PrimitiveType*)&scratch[0];
+    const PrimitiveType* prims = (const PrimitiveType*)indices;
+    for(size_t i=0; i<count; ++i)
+      sorted[i] = prims[ (u32)keys[i] ];
+    memcpy(indices, sorted, count * sizeof(PrimitiveType));
+  }
+
+  //! Marks the index buffer of \p polys as modified, the buffer object is switched to BU_DYNAMIC_DRAW usage the first time.
+  template<typename deT>
+  void updateIndexBuffer(deT* polys)
+  {
+    polys->indexBuffer()->setBufferObjectDirty(true);
+    if (Has_BufferObject && polys->indexBuffer()->bufferObject()->handle())
+    {
+      if (polys->indexBuffer()->bufferObject()->usage() != vl::BU_DYNAMIC_DRAW)
+      {
+        polys->indexBuffer()->bufferObject()->setBufferData(vl::BU_DYNAMIC_DRAW);
+        polys->indexBuffer()->setBufferObjectDirty(false);
+      }
+    }
+  }
+  //-----------------------------------------------------------------------------
+  // DepthSortTasks
+  //-----------------------------------------------------------------------------
+  struct DepthSortJob
+  {
+    DepthSortCallback* mCallback;
+    const Actor* mActor;
+    Geometry* mGeometry;
+  };
+
+  //! Sorts the Geometry of one Actor per task.
+  class DepthSortTasks: public ParallelTasks
+  {
+  public:
+    DepthSortTasks(const std::vector<DepthSortJob>& jobs, const Camera* camera): mJobs(jobs), mCamera(camera) {}
+
+    virtual void runTask(int index)
+    {
+      const DepthSortJob& job = mJobs[index];
+      job.mCallback->sortGeometry(job.mActor, mCamera, job.mGeometry);
+    }
+
+  protected:
+    const std::vector<DepthSortJob>& mJobs;
+    const Camera* mCamera;
+  };
+}
+//-----------------------------------------------------------------------------
+// DepthSortCallback
+//-----------------------------------------------------------------------------
+void DepthSortCallback::onActorRenderStarted(Actor* actor, real /*frame_clock*/, const Camera* cam, Renderable* renderable, const Shader*, int pass)
+{
+  // need to sort only for the first pass
+  if (pass > 0)
+    return;
+
+  // this works well with LOD
+  Geometry* geometry = cast<Geometry>(renderable);
+
+  if (!geometry)
+    return;
+
+  // does nothing if the primitives have already been sorted by sortActors()
+  sortGeometry(actor, cam, geometry);
+
+  // the buffer objects are updated here since sortGeometry() might have been called by another thread
+  if (!mBufferObjectsDirty)
+    return;
+  mBufferObjectsDirty = false;
+
+  geometry->setBufferObjectDirty(true);
+  geometry->setDisplayListDirty(true);
+
+  for(int idraw=0; idraw<geometry->drawCalls()->size(); ++idraw)
+  {
+    DrawCall* dc = geometry->drawCalls()->at(idraw);
+    if (dc->classType() == DrawElementsUInt::Type())
+      updateIndexBuffer(dc->as<DrawElementsUInt>());
+    else
+    if (dc->classType() == DrawElementsUShort::Type())
+      updateIndexBuffer(dc->as<DrawElementsUShort>());
+    else
+    if (dc->classType() == DrawElementsUByte::Type())
+      updateIndexBuffer(dc->as<DrawElementsUByte>());
+  }
+}
+//-----------------------------------------------------------------------------
+bool DepthSortCallback::sortGeometry(const Actor* actor, const Camera* cam, Geometry* geometry)
+{
+  const ArrayAbstract* verts = geometry->vertexArray() ? geometry->vertexArray() : geometry->vertexAttribArray(vl::VA_Position) ? geometry->vertexAttribArray(vl::VA_Position)->data() : NULL;
+
+  if (!verts)
+    return false;
+
+  mat4 m;
+  if (actor && actor->transform())
+    m = cam->viewMatrix() * actor->transform()->worldMatrix();
+  else
+    m = cam->viewMatrix();
+
+  // the order of the primitives depends only on the direction of the row of the matrix that computes the eye-space z:
+  // its length and the translation along the view direction add the same scale and offset to every z.
+  fvec3 dir( (float)m.e(2,0), (float)m.e(2,1), (float)m.e(2,2) );
+  float len = dir.length();
+  if (len == 0)
+    return false;
+  dir /= len;
+
+  if (geometry == mCacheGeometry)
+  {
+    if (mSortThreshold > 0 ? dot(dir, mCacheDirection) >= mSortThresholdCos : dir == mCacheDirection)
+      return false;
+  }
+  mCacheGeometry  = geometry;
+  mCacheDirection = dir;
+
+  computeEyeSpaceZ(verts, m);
+
+  for(int idraw=0; idraw<geometry->drawCalls()->size(); ++idraw)
+  {
+    DrawCall* dc = geometry->drawCalls()->at(idraw);
+    if (dc->classType() == DrawElementsUInt::Type())
+      sort<unsigned int, DrawElementsUInt>(dc->as<DrawElementsUInt>());
+    else
+    if (dc->classType() == DrawElementsUShort::Type())
+      sort<unsigned short, DrawElementsUShort>(dc->as<DrawElementsUShort>());
+    else
+    if (dc->classType() == DrawElementsUByte::Type())
+      sort<unsigned char, DrawElementsUByte>(dc->as<DrawElementsUByte>());
+  }
+
+  mBufferObjectsDirty = true;
+  return true;
+}
+//-----------------------------------------------------------------------------
+void DepthSortCallback::computeEyeSpaceZ(const ArrayAbstract* verts, const mat4& m)
+{
+  const float r0 = (float)m.e(2,0);
+  const float r1 = (float)m.e(2,1);
+  const float r2 = (float)m.e(2,2);
+  const float r3 = (float)m.e(2,3);
+
+  const size_t count = verts->size();
+  mEyeSpaceZ.resize( count );
+  if (!count)
+    return;
+  float* eye_z = &mEyeSpaceZ[0];
+
+  const ArrayFloat3* verts3f = cast_const<ArrayFloat3>(verts);
+  if (!verts3f)
+  {
+    for(size_t i=0; i<count; ++i)
+    {
+      vec3 v = verts->getAsVec3(i);
+      eye_z[i] = r0 * (float)v.x() + r1 * (float)v.y() + r2 * (float)v.z() + r3;
+    }
+    return;
+  }
+
+  const float* p = (const float*)verts3f->ptr();
+  size_t i = 0;
+#if VL_DEPTHSORT_SSE
+  const __m128 c0 = _mm_set1_ps(r0);
+  const __m128 c1 = _mm_set1_ps(r1);
+  const __m128 c2 = _mm_set1_ps(r2);
+  const __m128 c3 = _mm_set1_ps(r3);
+  for( ; i+4<=count; i+=4, p+=12)
+  {
+    // m0 = x0 y0 z0 x1, m1 = y1 z1 x2 y2, m2 = z2 x3 y3 z3
+    __m128 m0 = _mm_loadu_ps(p);
+    __m128 m1 = _mm_loadu_ps(p+4);
+    __m128 m2 = _mm_loadu_ps(p+8);
+
+    // transpose to x0 x1 x2 x3, y0 y1 y2 y3, z0 z1 z2 z3
+    __m128 t0 = _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(3,3,3,0));
+    __m128 t1 = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(1,1,2,2));
+    __m128 x  = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(2,0,1,0));
+    __m128 t2 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(3,0,1,1));
+    __m128 t3 = _mm_shuffle_ps(t2, m2, _MM_SHUFFLE(2,2,3,3));
+    __m128 y  = _mm_shuffle_ps(t2, t3, _MM_SHUFFLE(2,0,2,0));
+    __m128 t4 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1,1,2,2));
+    __m128 t5 = _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(3,3,0,0));
+    __m128 z  = _mm_shuffle_ps(t4, t5, _MM_SHUFFLE(2,0,2,0));
+
+    __m128 r = _mm_add_ps( _mm_add_ps( _mm_mul_ps(x, c0), _mm_mul_ps(y, c1) ), _mm_add_ps( _mm_mul_ps(z, c2), c3 ) );
+    _mm_storeu_ps(eye_z + i, r);
+  }
+#endif
+  for( ; i<count; ++i, p+=3)
+    eye_z[i] = (r0 * p[0] + r1 * p[1]) + (r2 * p[2] + r3);
+}
+//-----------------------------------------------------------------------------
+template<typename T, typename deT>
+void DepthSortCallback::sort(deT* polys)
+{
+  int prim_size = 0;
+  switch(polys->primitiveType())
+  {
+  case PT_QUADS:     prim_size = 4; break;
+  case PT_TRIANGLES: prim_size = 3; break;
+  case PT_LINES:     prim_size = 2; break;
+  case PT_POINTS:    prim_size = 1; break;
+  default:
+    return;
+  }
+
+  const size_t count = polys->indexBuffer()->size() / prim_size;
+  if (!count)
+    return;
+
+  // compute zetas
+  T* indices = (T*)polys->indexBuffer()->ptr();
+  const float* eye_z = &mEyeSpaceZ[0];
+  const u32 flip = sortMode() == SM_SortBackToFront ? 0 : 0xFFFFFFFFu;
+  mPrimitiveZ.resize( count );
+  switch(prim_size)
+  {
+  case 4: computeKeys<T,4>(indices, count, eye_z, flip, &mPrimitiveZ[0]); break;
+  case 3: computeKeys<T,3>(indices, count, eye_z, flip, &mPrimitiveZ[0]); break;
+  case 2: computeKeys<T,2>(indices, count, eye_z, flip, &mPrimitiveZ[0]); break;
+  case 1: computeKeys<T,1>(indices, count, eye_z, flip, &mPrimitiveZ[0]); break;
+  }
+
+  // sort based on mPrimitiveZ
+  sortPrimitiveZ(count);
+
+  // regenerate the sorted indices
+  switch(prim_size)
+  {
+  case 4: reorderPrimitives<T,4>(indices, count, &mPrimitiveZ[0], mSortedIndices); break;
+  case 3: reorderPrimitives<T,3>(indices, count, &mPrimitiveZ[0], mSortedIndices); break;
+  case 2: reorderPrimitives<T,2>(indices, count, &mPrimitiveZ[0], mSortedIndices); break;
+  case 1: reorderPrimitives<T,1>(indices, count, &mPrimitiveZ[0], mSortedIndices); break;
+  }
+}
+//-----------------------------------------------------------------------------
+void DepthSortCallback::sortPrimitiveZ(size_t count)
+{
+  if (count < 256)
+  {
+    // the primitive index in the lower bits makes the keys unique: same order as the radix sort
+    std::sort( mPrimitiveZ.begin(), mPrimitiveZ.begin() + count );
+    return;
+  }
+
+  // LSD radix sort of the upper 32 bits, 8 bits per pass: the histograms of all the passes are computed at once.
+  size_t histograms[4 * 256];
+  memset(histograms, 0, sizeof(histograms));
+  u64* src = &mPrimitiveZ[0];
+  for(size_t i=0; i<count; ++i)
+  {
+    u32 key = (u32)(src[i] >> 32);
+    ++histograms[0 * 256 + ( key        & 0xFF)];
+    ++histograms[1 * 256 + ((key >> 8)  & 0xFF)];
+    ++histograms[2 * 256 + ((key >> 16) & 0xFF)];
+    ++histograms[3 * 256 + ( key >> 24        )];
+  }
+
+  mPrimitiveZTemp.resize( count );
+  u64* dst = &mPrimitiveZTemp[0];
+  for(int pass=0; pass<4; ++pass)
+  {
+    size_t* histogram = &histograms[pass * 256];
+    const int shift = 32 + pass * 8;
+
+    // skip the passes in which all the keys have the same digit
+    if ( histogram[ (src[0] >> shift) & 0xFF ] == count )
+      continue;
+
+    size_t offset = 0;
+    for(int digit=0; digit<256; ++digit)
+    {
+      size_t digit_count = histogram[digit];
+      histogram[digit] = offset;
+      offset += digit_count;
+    }
+
+    for(size_t i=0; i<count; ++i)
+      dst[ histogram[ (src[i] >> shift) & 0xFF ]++ ] = src[i];
+
+    std::swap(src, dst);
+  }
+
+  if (src != &mPrimitiveZ[0])
+    mPrimitiveZ.swap(mPrimitiveZTemp);
+}
+//-----------------------------------------------------------------------------
+void DepthSortCallback::setSortThreshold(float degrees)
+{
+  mSortThreshold    = degrees;
+  mSortThresholdCos = (float)cos(degrees * dDEG_TO_RAD);
+}
+//-----------------------------------------------------------------------------
+void DepthSortCallback::sortActors(ActorCollection* actors, Camera* cam, int thread_count)
+{
+  // LODs are evaluated here since LODEvaluator-s are not required to be thread safe
+  std::vector<DepthSortJob> jobs;
+  std::set<const void*> used;
+  for(int i=0; i<actors->size(); ++i)
+  {
+    Actor* actor = actors->at(i);
+    if (!actor)
+      continue;
+    for(int j=0; j<actor->actorEventCallbacks()->size(); ++j)
+    {
+      DepthSortCallback* dsc = cast<DepthSortCallback>(actor->actorEventCallbacks()->at(j));
+      if (!dsc || !dsc->isEnabled())
+        continue;
+      Geometry* geometry = cast<Geometry>(actor->lod( actor->evaluateLOD(cam) ));
+      if (!geometry || used.count(dsc) || used.count(geometry))
+        continue;
+      used.insert(dsc);
+      used.insert(geometry);
+      DepthSortJob job = { dsc, actor, geometry };
+      jobs.push_back(job);
+    }
+  }
+  if (jobs.empty())
+    return;
+
+  DepthSortTasks tasks(jobs, cam);
+  Thread::runTasks(&tasks, (int)jobs.size(), thread_count);
+}
+//-----------------------------------------------------------------------------
@@ -57,6 +57,9 @@ namespace vl
    * - This callback works well with multipassing, the sorting is done only once.
    * - Using DrawElementsUShort or DrawElementsUByte might result in a quicker sorting compared to DrawElementsUInt.
    *   Is therefore advisable to use them whenever possible.
+   * - Only the eye-space z of the vertices is computed and the primitives are radix sorted: the sorting is performed again
+   *   only when the view direction in object space changes, see setSortThreshold() to reuse the previous order for small changes.
+   * - Use sortActors() to sort the primitives of all the transparent Actors on several threads before the rendering starts.
    *
    *
    * \remarks
@@ -71,70 +74,13 @@ namespace vl
    *
    * \sa \ref pagGuidePolygonDepthSorting
    */
-  class DepthSortCallback: public ActorEventCallback
+  class VLGRAPHICS_EXPORT DepthSortCallback: public ActorEventCallback
   {
     VL_INSTRUMENT_CLASS(vl::DepthSortCallback, ActorEventCallback)
 
-    template<typename T>
-    class Point
-    {
-    public:
-      T A;
-    };
-    template<typename T>
-    class Line
-    {
-    public:
-      T A,B;
-    };
-    template<typename T>
-    class Triangle
-    {
-    public:
-      T A,B,C;
-    };
-    template<typename T>
-    class Quad
-    {
-    public:
-      T A,B,C,D;
-    };
-    typedef Point<unsigned int>      PointUInt;
-    typedef Line<unsigned int>       LineUInt;
-    typedef Triangle<unsigned int>   TriangleUInt;
-    typedef Quad<unsigned int>       QuadUInt;
-
-    typedef Point<unsigned short>    PointUShort;
-    typedef Line<unsigned short>     LineUShort;
-    typedef Triangle<unsigned short> TriangleUShort;
-    typedef Quad<unsigned short>     QuadUShort;
-
-    typedef Point<unsigned char>     PointUByte;
-    typedef Line<unsigned char>      LineUByte;
-    typedef Triangle<unsigned char>  TriangleUByte;
-    typedef Quad<unsigned char>      QuadUByte;
-
-    class PrimitiveZ
-    {
-    public:
-      PrimitiveZ(int tri=0, float z=0.0f): mPrimitiveIndex(tri), mZ(z) {}
-      unsigned int mPrimitiveIndex;
-      float mZ;
-    };
-    class Sorter_Back_To_Front
-    {
-    public:
-      bool operator()(const PrimitiveZ& t1, const PrimitiveZ& t2) const { return t1.mZ < t2.mZ; }
-    };
-    class Sorter_Front_To_Back
-    {
-    public:
-      bool operator()(const PrimitiveZ& t1, const PrimitiveZ& t2) const { return t1.mZ > t2.mZ; }
-    };
-
   public:
     //! Constructor.
-    DepthSortCallback()
+    DepthSortCallback(): mSortThreshold(0), mSortThresholdCos(1), mCacheGeometry(NULL), mBufferObjectsDirty(false)
     {
       VL_DEBUG_SET_OBJECT_NAME()
       setSortMode(SM_SortBackToFront);
@@ -142,223 +88,63 @@ namespace vl
 
     void onActorDelete(Actor*) {}
 
-    //! Performs the actual sorting
-    virtual void onActorRenderStarted(Actor* actor, real /*frame_clock*/, const Camera* cam, Renderable* renderable, const Shader*, int pass)
-    {
-      // need to sort only for the first pass
-      if (pass > 0)
-        return;
-
-      vl::mat4 matrix = cam->viewMatrix();
-      if (actor && actor->transform())
-        matrix *= actor->transform()->worldMatrix();
-
-      if (matrix == mCacheMatrix)
-        return;
-      else
-        mCacheMatrix = matrix;
-
-      // this works well with LOD
-      Geometry* geometry = renderable->as<Geometry>();
-
-      if (!geometry)
-        return;
-
-      const ArrayAbstract* verts = geometry->vertexArray() ? geometry->vertexArray() : geometry->vertexAttribArray(vl::VA_Position) ? geometry->vertexAttribArray(vl::VA_Position)->data() : NULL;
-
-      if (!verts)
-        return;
-
-      // computes eye-space vertex positions
-      mat4 m;
-      if (actor->transform())
-        m = cam->viewMatrix() * actor->transform()->worldMatrix();
-      else
-        m = cam->viewMatrix();
-      mEyeSpaceVerts.resize( verts->size() );
-      // would be nice to optimize this with SEE2
-      for(size_t i=0; i<verts->size(); ++i)
-        mEyeSpaceVerts[i] = m * verts->getAsVec3(i);
-
-      geometry->setBufferObjectDirty(true);
-      geometry->setDisplayListDirty(true);
-
-      for(int idraw=0; idraw<geometry->drawCalls()->size(); ++idraw)
-      {
-        DrawCall* dc = geometry->drawCalls()->at(idraw);
-        if (dc->classType() == DrawElementsUInt::Type())
-          sort<unsigned int, DrawElementsUInt>(dc->as<DrawElementsUInt>(), mSortedPointsUInt, mSortedLinesUInt, mSortedTrianglesUInt, mSortedQuadsUInt);
-        else
-        if (dc->classType() == DrawElementsUShort::Type())
-          sort<unsigned short, DrawElementsUShort>(dc->as<DrawElementsUShort>(), mSortedPointsUShort, mSortedLinesUShort, mSortedTrianglesUShort, mSortedQuadsUShort);
-        else
-        if (dc->classType() == DrawElementsUByte::Type())
-          sort<unsigned char, DrawElementsUByte>(dc->as<DrawElementsUByte>(), mSortedPointsUByte, mSortedLinesUByte, mSortedTrianglesUByte, mSortedQuadsUByte);
-      }
-    }
-
-    template<typename T, typename deT>
-    void sort(deT* polys, std::vector<Point<T> >& sorted_points, std::vector<Line<T> >& sorted_lines, std::vector<Triangle<T> >& sorted_triangles, std::vector<Quad<T> >& sorted_quads)
-    {
-      if (polys->primitiveType() == PT_QUADS)
-      {
-        // compute zetas
-        mPrimitiveZ.resize( polys->indexBuffer()->size() / 4 );
-        if (mPrimitiveZ.empty())
-          return;
-
-        const typename deT::index_type* it  = polys->indexBuffer()->begin();
-        const typename deT::index_type* end = polys->indexBuffer()->end();
-        for(unsigned iz=0; it != end; it+=4, ++iz)
-        {
-          mPrimitiveZ[iz].mZ = (float)(mEyeSpaceVerts[it[0]].z() + mEyeSpaceVerts[it[1]].z() + mEyeSpaceVerts[it[2]].z() + mEyeSpaceVerts[it[3]].z());
-          mPrimitiveZ[iz].mPrimitiveIndex = iz;
-        }
-
-        // sort based on mPrimitiveZ
-        if (sortMode() == SM_SortBackToFront)
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
-        else
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
-
-        // regenerate the sorted indices
-        sorted_quads.resize( polys->indexBuffer()->size() / 4 );
-        Quad<T>* tris = (Quad<T>*)polys->indexBuffer()->ptr();
-        for(unsigned int i=0; i<mPrimitiveZ.size(); ++i)
-          sorted_quads[i] = tris[ mPrimitiveZ[i].mPrimitiveIndex ];
-        memcpy(&tris[0], &sorted_quads[0], sizeof(sorted_quads[0])*sorted_quads.size() );
-      }
-      else
-      if (polys->primitiveType() == PT_TRIANGLES)
-      {
-        // compute zetas
-        mPrimitiveZ.resize( polys->indexBuffer()->size() / 3 );
-        if (mPrimitiveZ.empty())
-          return;
-
-        const typename deT::index_type* it  = polys->indexBuffer()->begin();
-        const typename deT::index_type* end = polys->indexBuffer()->end();
-        for(unsigned iz=0; it != end; it+=3, ++iz)
-        {
-          mPrimitiveZ[iz].mZ = (float)(mEyeSpaceVerts[it[0]].z() + mEyeSpaceVerts[it[1]].z() + mEyeSpaceVerts[it[2]].z());
-          mPrimitiveZ[iz].mPrimitiveIndex = iz;
-        }
-
-        // sort based on mPrimitiveZ
-        if (sortMode() == SM_SortBackToFront)
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
-        else
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
-
-        // regenerate the sorted indices
-        sorted_triangles.resize( polys->indexBuffer()->size() / 3 );
-        Triangle<T>* tris = (Triangle<T>*)polys->indexBuffer()->ptr();
-        for(unsigned int i=0; i<mPrimitiveZ.size(); ++i)
-          sorted_triangles[i] = tris[ mPrimitiveZ[i].mPrimitiveIndex ];
-        memcpy(&tris[0], &sorted_triangles[0], sizeof(sorted_triangles[0])*sorted_triangles.size() );
-      }
-      else
-      if (polys->primitiveType() == PT_LINES)
-      {
-        // compute zetas
-        mPrimitiveZ.resize( polys->indexBuffer()->size() / 2 );
-        if (mPrimitiveZ.empty())
-          return;
-
-        const typename deT::index_type* it  = polys->indexBuffer()->begin();
-        const typename deT::index_type* end = polys->indexBuffer()->end();
-        for(unsigned iz=0; it != end; it+=2, ++iz)
-        {
-          mPrimitiveZ[iz].mZ = (float)(mEyeSpaceVerts[it[0]].z() + mEyeSpaceVerts[it[1]].z());
-          mPrimitiveZ[iz].mPrimitiveIndex = iz;
-        }
-
-        // sort based on mPrimitiveZ
-        if (sortMode() == SM_SortBackToFront)
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
-        else
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
-
-        // regenerate the sorted indices
-        sorted_lines.resize( polys->indexBuffer()->size() / 2 );
-        Line<T>* tris = (Line<T>*)polys->indexBuffer()->ptr();
-        for(unsigned int i=0; i<mPrimitiveZ.size(); ++i)
-          sorted_lines[i] = tris[ mPrimitiveZ[i].mPrimitiveIndex ];
-        memcpy(&tris[0], &sorted_lines[0], sizeof(sorted_lines[0])*sorted_lines.size() );
-      }
-      else
-      if (polys->primitiveType() == PT_POINTS)
-      {
-        // compute zetas
-        mPrimitiveZ.resize( polys->indexBuffer()->size() );
-        if (mPrimitiveZ.empty())
-          return;
-
-        const typename deT::index_type* it  = polys->indexBuffer()->begin();
-        const typename deT::index_type* end = polys->indexBuffer()->end();
-        for(unsigned iz=0; it != end; ++it, ++iz)
-        {
-          mPrimitiveZ[iz].mZ = (float)mEyeSpaceVerts[it[0]].z();
-          mPrimitiveZ[iz].mPrimitiveIndex = iz;
-        }
-
-        // sort based on mPrimitiveZ
-        if (sortMode() == SM_SortBackToFront)
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
-        else
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
+    //! Performs the actual sorting, if not already done by sortActors(), and updates the index buffer objects.
+    virtual void onActorRenderStarted(Actor* actor, real /*frame_clock*/, const Camera* cam, Renderable* renderable, const Shader*, int pass);
 
-        // regenerate the sorted indices
-        sorted_points.resize( polys->indexBuffer()->size() );
-        Point<T>* tris = (Point<T>*)polys->indexBuffer()->ptr();
-        for(unsigned int i=0; i<mPrimitiveZ.size(); ++i)
-          sorted_points[i] = tris[ mPrimitiveZ[i].mPrimitiveIndex ];
-        memcpy(&tris[0], &sorted_points[0], sizeof(sorted_points[0])*sorted_points.size() );
-      }
+    /**
+     * Sorts the primitives of \p geometry as seen by \p cam, does nothing if the cached order can be reused (see setSortThreshold()).
+     * This function does not issue any OpenGL command, the index buffer objects are updated at the next onActorRenderStarted(),
+     * and can be called from any thread as long as no other thread is accessing \p geometry or this callback.
+     * Returns \p true if the primitives have been sorted.
+     */
+    bool sortGeometry(const Actor* actor, const Camera* cam, Geometry* geometry);
 
-      if (Has_BufferObject)
-      {
-        if (polys->indexBuffer()->bufferObject()->handle())
-        {
-          if (polys->indexBuffer()->bufferObject()->usage() != vl::BU_DYNAMIC_DRAW)
-          {
-            polys->indexBuffer()->bufferObject()->setBufferData(vl::BU_DYNAMIC_DRAW);
-            polys->indexBuffer()->setBufferObjectDirty(false);
-          }
-          else
-            polys->indexBuffer()->setBufferObjectDirty(true);
-        }
-      }
-    }
+    /**
+     * Sorts ahead of rendering the Geometry of every Actor of \p actors that has a DepthSortCallback installed, using
+     * up to \p thread_count threads (0 means Thread::hardwareConcurrency()). The LOD of each Actor is evaluated
+     * on the calling thread using \p cam. A Geometry or a DepthSortCallback shared among several Actors is sorted only once,
+     * for the first Actor that uses it: the other Actors will sort it again during the rendering as usual.
+     * Call this function before rendering, for example from a RenderEventCallback::onRenderingStarted(), with the same camera used for the rendering.
+     */
+    static void sortActors(ActorCollection* actors, Camera* cam, int thread_count=0);
 
     ESortMode sortMode() const { return mSortMode; }
     void setSortMode(ESortMode sort_mode) { mSortMode = sort_mode; }
 
+    /**
+     * The primitives are sorted again only when the view direction, expressed in object space, changes by more than
+     * \p degrees from the one used for the last sorting. Default is 0, i.e. the primitives are sorted every time the
+     * view direction changes. Note that translations along the view direction never require a new sorting.
+     */
+    void setSortThreshold(float degrees);
+
+    //! See setSortThreshold().
+    float sortThreshold() const { return mSortThreshold; }
+
     /**
      * Forces sorting at the next rendering.
      */
-    void invalidateCache() { mCacheMatrix = vl::mat4(); }
+    void invalidateCache() { mCacheGeometry = NULL; mCacheDirection = fvec3(); }
 
   protected:
-    std::vector<vec3> mEyeSpaceVerts;
-    std::vector<PrimitiveZ> mPrimitiveZ;
-
-    std::vector<PointUInt> mSortedPointsUInt;
-    std::vector<LineUInt> mSortedLinesUInt;
-    std::vector<TriangleUInt> mSortedTrianglesUInt;
-    std::vector<QuadUInt> mSortedQuadsUInt;
+    template<typename T, typename deT>
+    void sort(deT* polys);
 
-    std::vector<PointUShort> mSortedPointsUShort;
-    std::vector<LineUShort> mSortedLinesUShort;
-    std::vector<TriangleUShort> mSortedTrianglesUShort;
-    std::vector<QuadUShort> mSortedQuadsUShort;
+    void computeEyeSpaceZ(const ArrayAbstract* verts, const mat4& m);
 
-    std::vector<PointUByte> mSortedPointsUByte;
-    std::vector<LineUByte> mSortedLinesUByte;
-    std::vector<TriangleUByte> mSortedTrianglesUByte;
-    std::vector<QuadUByte> mSortedQuadsUByte;
+    void sortPrimitiveZ(size_t count);
 
-    vl::mat4 mCacheMatrix;
+  protected:
+    std::vector<float> mEyeSpaceZ;
+    std::vector<u64> mPrimitiveZ;
+    std::vector<u64> mPrimitiveZTemp;
+    std::vector<unsigned char> mSortedIndices;
+
+    fvec3 mCacheDirection;
+    float mSortThreshold;
+    float mSortThresholdCos;
+    const Geometry* mCacheGeometry;
+    bool mBufferObjectsDirty;
 
     ESortMode mSortMode;
   };
@@ -31,31 +31,38 @@
 
 #include <vlGraphics/DoubleVertexRemover.hpp>
 #include <vlCore/Time.hpp>
+#include <vlCore/Thread.hpp>
+#include <algorithm>
 
 using namespace vl;
 
 namespace
 {
+  void collectAttribs(const Geometry* geom, std::vector< const ArrayAbstract* >& attribs)
+  {
+    if (geom->vertexArray())
+      attribs.push_back(geom->vertexArray());
+    if (geom->normalArray())
+      attribs.push_back(geom->normalArray());
+    if (geom->colorArray())
+      attribs.push_back(geom->colorArray());
+    if (geom->secondaryColorArray())
+      attribs.push_back(geom->secondaryColorArray());
+    if (geom->fogCoordArray())
+      attribs.push_back(geom->fogCoordArray());
+    for(int i=0; i<VL_MAX_TEXTURE_UNITS; ++i)
+      if (geom->texCoordArray(i))
+        attribs.push_back(geom->texCoordArray(i));
+    for(int i=0; i<geom->vertexAttribArrays()->size(); ++i)
+      attribs.push_back(geom->vertexAttribArrays()->at(i)->data());
+  }
+
   class LessCompare
   {
   public:
     LessCompare(const Geometry* geom)
     {
-      if (geom->vertexArray())
-        mAttribs.push_back(geom->vertexArray());
-      if (geom->normalArray())
-        mAttribs.push_back(geom->normalArray());
-      if (geom->colorArray())
-        mAttribs.push_back(geom->colorArray());
-      if (geom->secondaryColorArray())
-        mAttribs.push_back(geom->secondaryColorArray());
-      if (geom->fogCoordArray())
-        mAttribs.push_back(geom->fogCoordArray());
-      for(int i=0; i<VL_MAX_TEXTURE_UNITS; ++i)
-        if (geom->texCoordArray(i))
-          mAttribs.push_back(geom->texCoordArray(i));
-      for(int i=0; i<geom->vertexAttribArrays()->size(); ++i)
-        mAttribs.push_back(geom->vertexAttribArrays()->at(i)->data());
+      collectAttribs(geom, mAttribs);
     }
 
     bool operator()(u32 a, u32 b) const 
@@ -78,21 +85,7 @@ namespace
   public:
     EqualsCompare(const Geometry* geom)
     {
-      if (geom->vertexArray())
-        mAttribs.push_back(geom->vertexArray());
-      if (geom->normalArray())
-        mAttribs.push_back(geom->normalArray());
-      if (geom->colorArray())
-        mAttribs.push_back(geom->colorArray());
-      if (geom->secondaryColorArray())
-        mAttribs.push_back(geom->secondaryColorArray());
-      if (geom->fogCoordArray())
-        mAttribs.push_back(geom->fogCoordArray());
-      for(int i=0; i<VL_MAX_TEXTURE_UNITS; ++i)
-        if (geom->texCoordArray(i))
-          mAttribs.push_back(geom->texCoordArray(i));
-      for(int i=0; i<geom->vertexAttribArrays()->size(); ++i)
-        mAttribs.push_back(geom->vertexAttribArrays()->at(i)->data());
+      collectAttribs(geom, mAttribs);
     }
 
     bool operator()(u32 a, u32 b) const 
@@ -108,6 +101,123 @@ namespace
   protected:
     std::vector< const ArrayAbstract* > mAttribs;
   };
+
+  // the hash tables are partitioned using the top bits of the hash
+  const int VertexHashPartitionBits = 6;
+  const int VertexHashPartitions    = 1 << VertexHashPartitionBits;
+  const u32 VertexHashEmpty         = 0xFFFFFFFF;
+
+  inline u32 hashKey(const unsigned char* key, size_t size)
+  {
+    u32 h = 0x811C9DC5;
+    size_t i = 0;
+    for( ; i+4<=size; i+=4)
+    {
+      u32 w;
+      memcpy(&w, key+i, 4);
+      h = (h ^ w) * 0x9E3779B1;
+      h ^= h >> 15;
+    }
+    for( ; i<size; ++i)
+      h = (h ^ key[i]) * 0x01000193;
+    // final avalanche
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+  }
+
+  // packs the attributes of each vertex in a byte key and computes its hash
+  class VertexKeyTasks: public ParallelTasks
+  {
+  public:
+    VertexKeyTasks(const std::vector< const ArrayAbstract* >& attribs, const std::vector<size_t>& attrib_sizes, u32 vert_count, int task_count, size_t key_size, std::vector<unsigned char>& keys, std::vector<u32>& hashes)
+      : mAttribs(attribs), mAttribSizes(attrib_sizes), mVertCount(vert_count), mTaskCount(task_count), mKeySize(key_size), mKeys(keys), mHashes(hashes) {}
+
+    virtual void runTask(int index)
+    {
+      u32 begin = (u32)((unsigned long long)mVertCount * index / mTaskCount);
+      u32 end   = (u32)((unsigned long long)mVertCount * (index+1) / mTaskCount);
+      for(u32 v=begin; v<end; ++v)
+      {
+        unsigned char* key = &mKeys[0] + (size_t)v * mKeySize;
+        unsigned char* ptr = key;
+        for(unsigned i=0; i<mAttribs.size(); ++i)
+        {
+          size_t size = mAttribSizes[i];
+          memcpy(ptr, mAttribs[i]->ptr() + v * size, size);
+          ptr += size;
+        }
+        mHashes[v] = hashKey(key, mKeySize);
+      }
+    }
+
+  private:
+    const std::vector< const ArrayAbstract* >& mAttribs;
+    const std::vector<size_t>& mAttribSizes;
+    u32 mVertCount;
+    int mTaskCount;
+    size_t mKeySize;
+    std::vector<unsigned char>& mKeys;
+    std::vector<u32>& mHashes;
+  };
+
+  // dedups the vertices of a partition with an open addressing hash table, the vertices are visited
+  // in increasing order so that each one is mapped to its first occurrence.
+  class VertexHashTasks: public ParallelTasks
+  {
+  public:
+    VertexHashTasks(const std::vector<u32>& order, const std::vector<u32>& offsets, size_t key_size, const std::vector<unsigned char>& keys, const std::vector<u32>& hashes, std::vector<u32>& first)
+      : mOrder(order), mOffsets(offsets), mKeySize(key_size), mKeys(keys), mHashes(hashes), mFirst(first) {}
+
+    virtual void runTask(int index)
+    {
+      const u32 begin = mOffsets[index];
+      const u32 end   = mOffsets[index+1];
+      if (begin == end)
+        return;
+
+      u32 table_size = 16;
+      while(table_size < (end - begin) * 2)
+        table_size <<= 1;
+      const u32 mask = table_size - 1;
+      std::vector<u32> table(table_size, VertexHashEmpty);
+
+      const unsigned char* keys = &mKeys[0];
+      for(u32 i=begin; i<end; ++i)
+      {
+        const u32 v = mOrder[i];
+        const u32 h = mHashes[v];
+        u32 slot = h & mask;
+        for(;;)
+        {
+          const u32 u = table[slot];
+          if (u == VertexHashEmpty)
+          {
+            table[slot] = v;
+            mFirst[v] = v;
+            break;
+          }
+          if (mHashes[u] == h && memcmp(keys + (size_t)u * mKeySize, keys + (size_t)v * mKeySize, mKeySize) == 0)
+          {
+            mFirst[v] = u;
+            break;
+          }
+          slot = (slot + 1) & mask;
+        }
+      }
+    }
+
+  private:
+    const std::vector<u32>& mOrder;
+    const std::vector<u32>& mOffsets;
+    size_t mKeySize;
+    const std::vector<unsigned char>& mKeys;
+    const std::vector<u32>& mHashes;
+    std::vector<u32>& mFirst;
+  };
 }
 
 //-----------------------------------------------------------------------------
@@ -243,6 +353,38 @@ void DoubleVertexRemover::removeDoubles(Geometry* geom)
   if (!vert_count)
     return;
 
+  if (useHashing())
+    mapVerticesHashing(geom, vert_count);
+  else
+    mapVerticesSorting(geom, vert_count);
+
+  // regenerate vertices
+
+  geom->regenerateVertices(mMapNewToOld);
+
+  // regenerate DrawCall
+
+  std::vector< ref<DrawCall> > draw_cmd;
+  for(int idraw=0; idraw<geom->drawCalls()->size(); ++idraw)
+    draw_cmd.push_back( geom->drawCalls()->at(idraw) );
+  geom->drawCalls()->clear();
+
+  for(u32 idraw=0; idraw<draw_cmd.size(); ++idraw)
+  {
+    ref<DrawElementsUInt> de = new DrawElementsUInt( draw_cmd[idraw]->primitiveType() );
+    geom->drawCalls()->push_back(de.get());
+    const u32 idx_count = draw_cmd[idraw]->countIndices();
+    de->indexBuffer()->resize(idx_count);
+    u32 i=0;
+    for(IndexIterator it = draw_cmd[idraw]->indexIterator(); it.hasNext(); it.next(), ++i)
+      de->indexBuffer()->at(i) = mMapOldToNew[it.index()];
+  }
+
+  Log::debug( Say("DoubleVertexRemover : time=%.2ns, verts=%n/%n, saved=%n, ratio=%.2n\n") << timer.elapsed() << mMapNewToOld.size() << vert_count << vert_count - (u32)mMapNewToOld.size() << (float)mMapNewToOld.size()/vert_count );
+}
+//-----------------------------------------------------------------------------
+void DoubleVertexRemover::mapVerticesSorting(const Geometry* geom, u32 vert_count)
+{
   std::vector<u32> verti;
   verti.resize(vert_count);
   mMapOldToNew.resize(vert_count);
@@ -268,33 +410,64 @@ void DoubleVertexRemover::removeDoubles(Geometry* geom)
     }
   }
   for(unsigned j=unique_vert_idx; j<verti.size(); ++j)
-  {
     mMapOldToNew[verti[j]] = (u32)mMapNewToOld.size();
-    mMapNewToOld.push_back(verti[unique_vert_idx]);
+  mMapNewToOld.push_back(verti[unique_vert_idx]);
+}
+//-----------------------------------------------------------------------------
+void DoubleVertexRemover::mapVerticesHashing(const Geometry* geom, u32 vert_count)
+{
+  std::vector< const ArrayAbstract* > attribs;
+  collectAttribs(geom, attribs);
+
+  // bytes per vertex of each attribute
+  std::vector<size_t> attrib_sizes(attribs.size());
+  size_t key_size = 0;
+  for(unsigned i=0; i<attribs.size(); ++i)
+  {
+    VL_CHECK(attribs[i]->size() >= vert_count)
+    attrib_sizes[i] = attribs[i]->size() ? attribs[i]->bytesUsed() / attribs[i]->size() : 0;
+    key_size += attrib_sizes[i];
   }
 
-  // regenerate vertices
+  // pack the keys and compute their hash
 
-  geom->regenerateVertices(mMapNewToOld);
+  std::vector<unsigned char> keys(key_size * vert_count);
+  std::vector<u32> hashes(vert_count);
+  const int key_task_count = (int)std::min((u32)VertexHashPartitions, vert_count);
+  VertexKeyTasks key_tasks(attribs, attrib_sizes, vert_count, key_task_count, key_size, keys, hashes);
+  Thread::runTasks(&key_tasks, key_task_count, threadCount());
 
-  // regenerate DrawCall
+  // group the vertices by partition keeping them in increasing order
 
-  std::vector< ref<DrawCall> > draw_cmd;
-  for(int idraw=0; idraw<geom->drawCalls()->size(); ++idraw)
-    draw_cmd.push_back( geom->drawCalls()->at(idraw) );
-  geom->drawCalls()->clear();
+  std::vector<u32> offsets(VertexHashPartitions+1, 0);
+  for(u32 v=0; v<vert_count; ++v)
+    ++offsets[ (hashes[v] >> (32 - VertexHashPartitionBits)) + 1 ];
+  for(int i=0; i<VertexHashPartitions; ++i)
+    offsets[i+1] += offsets[i];
+  std::vector<u32> order(vert_count);
+  std::vector<u32> cursor(offsets.begin(), offsets.end()-1);
+  for(u32 v=0; v<vert_count; ++v)
+    order[ cursor[hashes[v] >> (32 - VertexHashPartitionBits)]++ ] = v;
 
-  for(u32 idraw=0; idraw<draw_cmd.size(); ++idraw)
+  // find the first occurrence of each vertex
+
+  std::vector<u32> first(vert_count);
+  VertexHashTasks hash_tasks(order, offsets, key_size, keys, hashes, first);
+  Thread::runTasks(&hash_tasks, VertexHashPartitions, threadCount());
+
+  // number the unique vertices in order of first occurrence
+
+  mMapOldToNew.resize(vert_count);
+  mMapNewToOld.reserve(vert_count);
+  for(u32 v=0; v<vert_count; ++v)
   {
-    ref<DrawElementsUInt> de = new DrawElementsUInt( draw_cmd[idraw]->primitiveType() );
-    geom->drawCalls()->push_back(de.get());
-    const u32 idx_count = draw_cmd[idraw]->countIndices();
-    de->indexBuffer()->resize(idx_count);
-    u32 i=0;
-    for(IndexIterator it = draw_cmd[idraw]->indexIterator(); it.hasNext(); it.next(), ++i)
-      de->indexBuffer()->at(i) = mMapOldToNew[it.index()];
+    if (first[v] == v)
+    {
+      mMapOldToNew[v] = (u32)mMapNewToOld.size();
+      mMapNewToOld.push_back(v);
+    }
+    else
+      mMapOldToNew[v] = mMapOldToNew[first[v]];
   }
-
-  Log::debug( Say("DoubleVertexRemover : time=%.2ns, verts=%n/%n, saved=%n, ratio=%.2n\n") << timer.elapsed() << mMapNewToOld.size() << verti.size() << verti.size() - mMapNewToOld.size() << (float)mMapNewToOld.size()/verti.size() );
 }
 //-----------------------------------------------------------------------------
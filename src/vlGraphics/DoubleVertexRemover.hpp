@@ -60,19 +60,41 @@ namespace vl
   //-----------------------------------------------------------------------------
   //! Removes from a Geometry the vertices with the same attributes. 
   //! As a result also all the DrawArrays prensent in the Geometry are substituted with DrawElements.
+  //!
+  //! By default the vertices are sorted using the ArrayAbstract::compare() function of each attribute.
+  //! When hashing is enabled (see setUseHashing()) the attributes of each vertex are instead packed in a byte key and 
+  //! the duplicates are found using open addressing hash tables, one for each partition of the key space, filled in parallel.
+  //! In this mode two vertices are equal only if their attributes are bitwise identical (for example 0.0 and -0.0 are considered different),
+  //! the new vertices keep the order of their first occurrence and mapNewToOld() always refers to the first occurrence, regardless of the thread count.
   class VLGRAPHICS_EXPORT DoubleVertexRemover: public VertexMapper
   {
     VL_INSTRUMENT_CLASS(vl::DoubleVertexRemover, VertexMapper)
 
   public:
-    DoubleVertexRemover() {}
+    DoubleVertexRemover(): mUseHashing(false), mThreadCount(0) {}
     void removeDoubles(Geometry* geom);
     const std::vector<u32>& mapNewToOld() const { return mMapNewToOld; }
     const std::vector<u32>& mapOldToNew() const { return mMapOldToNew; }
 
+    //! If true the duplicated vertices are found by hashing instead of sorting. Disabled by default.
+    void setUseHashing(bool use_hashing) { mUseHashing = use_hashing; }
+    //! If true the duplicated vertices are found by hashing instead of sorting. Disabled by default.
+    bool useHashing() const { return mUseHashing; }
+
+    //! The number of threads used when hashing is enabled, 0 (default) means one thread per core.
+    void setThreadCount(int count) { mThreadCount = count; }
+    //! The number of threads used when hashing is enabled, 0 (default) means one thread per core.
+    int threadCount() const { return mThreadCount; }
+
+  protected:
+    void mapVerticesSorting(const Geometry* geom, u32 vert_count);
+    void mapVerticesHashing(const Geometry* geom, u32 vert_count);
+
   protected:
     std::vector<u32> mMapNewToOld;
     std::vector<u32> mMapOldToNew;
+    bool mUseHashing;
+    int mThreadCount;
   };
 }
 
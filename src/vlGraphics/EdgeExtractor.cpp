@@ -36,18 +36,240 @@
 #include <vlCore/Log.hpp>
 #include <vlGraphics/Array.hpp>
 #include <vlGraphics/Geometry.hpp>
+#include <vlCore/Thread.hpp>
+#include <algorithm>
+#include <cstring>
 
 using namespace vl;
 
+namespace
+{
+  //! Maps a float to an unsigned int with the same ordering, -0.0 and 0.0 are mapped to the same value since they compare equal.
+  inline u32 sortableBits(float f)
+  {
+    f += 0.0f;
+    u32 u;
+    memcpy(&u, &f, sizeof(u));
+    return (u & 0x80000000) ? ~u : u | 0x80000000;
+  }
+
+  //! A distinct vertex position.
+  struct PositionKey
+  {
+    u32 mKey[3];
+    u32 mId;
+
+    //! Same ordering as fvec3::operator<().
+    bool operator<(const PositionKey& other) const
+    {
+      if (mKey[0] != other.mKey[0])
+        return mKey[0] < other.mKey[0];
+      else
+      if (mKey[1] != other.mKey[1])
+        return mKey[1] < other.mKey[1];
+      else
+        return mKey[2] < other.mKey[2];
+    }
+  };
+
+  //! Assigns to each vertex the rank of its position among the distinct positions, 
+  //! vertices with the same position get the same rank. Returns the number of distinct positions.
+  u32 rankPositions(const std::vector<fvec3>& pos, std::vector<u32>& rank)
+  {
+    // weld the positions with a hash table
+    std::vector<PositionKey> unique;
+    std::vector<u32> hashes;
+    std::vector<int> slots(1024, -1);
+    u32 mask = (u32)slots.size() - 1;
+    rank.resize(pos.size());
+    for(size_t i=0; i<pos.size(); ++i)
+    {
+      if (unique.size() * 2 >= slots.size())
+      {
+        slots.assign(slots.size() * 2, -1);
+        mask = (u32)slots.size() - 1;
+        for(size_t j=0; j<unique.size(); ++j)
+        {
+          u32 slot = hashes[j] & mask;
+          while(slots[slot] != -1)
+            slot = (slot + 1) & mask;
+          slots[slot] = (int)j;
+        }
+      }
+
+      PositionKey key;
+      key.mKey[0] = sortableBits(pos[i].x());
+      key.mKey[1] = sortableBits(pos[i].y());
+      key.mKey[2] = sortableBits(pos[i].z());
+      u32 h = key.mKey[0] * 0x9E3779B1 ^ key.mKey[1] * 0x85EBCA6B ^ key.mKey[2] * 0xC2B2AE35;
+      h ^= h >> 15;
+      u32 slot = h & mask;
+      for(;;)
+      {
+        int idx = slots[slot];
+        if (idx == -1)
+        {
+          key.mId = (u32)unique.size();
+          slots[slot] = (int)key.mId;
+          unique.push_back(key);
+          hashes.push_back(h);
+          break;
+        }
+        if (memcmp(unique[idx].mKey, key.mKey, sizeof(key.mKey)) == 0)
+        {
+          key.mId = (u32)idx;
+          break;
+        }
+        slot = (slot + 1) & mask;
+      }
+      rank[i] = key.mId;
+    }
+    std::vector<int>().swap(slots);
+    std::vector<u32>().swap(hashes);
+
+    // sort the distinct positions and map the weld ids to ranks
+    std::sort(unique.begin(), unique.end());
+    std::vector<u32> id_to_rank(unique.size());
+    for(size_t i=0; i<unique.size(); ++i)
+      id_to_rank[unique[i].mId] = (u32)i;
+    for(size_t i=0; i<rank.size(); ++i)
+      rank[i] = id_to_rank[rank[i]];
+    return (u32)unique.size();
+  }
+
+  //! A non degenerate triangle with its normal.
+  struct CompactTriangle
+  {
+    u32 mIndex[3];
+    float mNormal[3];
+  };
+
+  //! One occurrence of an edge, the vertices are identified by the rank of their position.
+  struct HalfEdge
+  {
+    u32 mRank1, mRank2;
+    u32 mVertex1, mVertex2;
+    float mNormal[3];
+  };
+
+  //! An edge with its normals, equivalent to EdgeExtractor::Edge.
+  struct EdgeRecord
+  {
+    u32 mRank1, mRank2;
+    u32 mVertex1, mVertex2;
+    float mNormal1[3];
+    float mNormal2[3];
+
+    bool operator<(const EdgeRecord& other) const 
+    { 
+      return mRank1 != other.mRank1 ? mRank1 < other.mRank1 : mRank2 < other.mRank2; 
+    }
+  };
+
+  inline u32 hashRanks(u32 r1, u32 r2)
+  {
+    u32 h = r1 * 0x9E3779B1 ^ r2 * 0x85EBCA6B;
+    return h ^ (h >> 15);
+  }
+
+  //-----------------------------------------------------------------------------
+  // EdgeTable
+  //-----------------------------------------------------------------------------
+  //! Open addressing hash table of edges keyed on the position ranks of their two vertices.
+  //! Works on one partition of the half-edges at a time so that the table stays in cache.
+  class EdgeTable
+  {
+  public:
+    //! Merges the given half-edges, in order, into \p records with the same semantics of EdgeExtractor::addEdge().
+    //! \returns the number of edges shared by more than two triangles.
+    int merge(const HalfEdge* half_edges, size_t count, std::vector<EdgeRecord>& records)
+    {
+      u32 size = 16;
+      while(size < count * 2)
+        size <<= 1;
+      const u32 mask = size - 1;
+      mSlots.assign(size, -1);
+
+      int non_manifold = 0;
+      records.clear();
+      for(size_t i=0; i<count; ++i)
+      {
+        const HalfEdge& he = half_edges[i];
+        u32 slot = hashRanks(he.mRank1, he.mRank2) & mask;
+        for(;;)
+        {
+          int idx = mSlots[slot];
+          if (idx == -1)
+          {
+            mSlots[slot] = (int)records.size();
+            records.push_back(EdgeRecord());
+            EdgeRecord& rec = records.back();
+            rec.mRank1   = he.mRank1;
+            rec.mRank2   = he.mRank2;
+            rec.mVertex1 = he.mVertex1;
+            rec.mVertex2 = he.mVertex2;
+            memcpy(rec.mNormal1, he.mNormal, sizeof(rec.mNormal1));
+            memset(rec.mNormal2, 0, sizeof(rec.mNormal2));
+            break;
+          }
+          EdgeRecord& rec = records[idx];
+          if (rec.mRank1 == he.mRank1 && rec.mRank2 == he.mRank2)
+          {
+            if (rec.mNormal2[0] || rec.mNormal2[1] || rec.mNormal2[2])
+              ++non_manifold;
+            // the edge takes the vertices of the last occurrence like std::set<Edge> would do
+            rec.mVertex1 = he.mVertex1;
+            rec.mVertex2 = he.mVertex2;
+            memcpy(rec.mNormal2, he.mNormal, sizeof(rec.mNormal2));
+            break;
+          }
+          slot = (slot + 1) & mask;
+        }
+      }
+      return non_manifold;
+    }
+
+  protected:
+    std::vector<int> mSlots;
+  };
+}
+//-----------------------------------------------------------------------------
+// EdgeExtractor::EdgeTasks
+//-----------------------------------------------------------------------------
+//! Extracts the edges of one Geometry per task, the outcome of each task is logged by the calling thread after the join.
+class EdgeExtractor::EdgeTasks: public ParallelTasks
+{
+public:
+  EdgeTasks(const EdgeExtractor* extractor, const std::vector<const Geometry*>& geoms, std::vector< std::vector<EdgeExtractor::Edge> >& edges)
+    : mExtractor(extractor), mGeoms(geoms), mEdges(edges), mHasVertices(geoms.size(), 0), mNonManifold(geoms.size(), 0) {}
+
+  virtual void runTask(int index)
+  {
+    mHasVertices[index] = mExtractor->collectEdges(mGeoms[index], mEdges[index], mNonManifold[index]);
+  }
+
+  void logResults() const
+  {
+    for(size_t i=0; i<mGeoms.size(); ++i)
+      mExtractor->logExtraction(mHasVertices[i] != 0, mNonManifold[i]);
+  }
+
+protected:
+  const EdgeExtractor* mExtractor;
+  const std::vector<const Geometry*>& mGeoms;
+  std::vector< std::vector<EdgeExtractor::Edge> >& mEdges;
+  std::vector<char> mHasVertices;
+  std::vector<int> mNonManifold;
+};
 //-----------------------------------------------------------------------------
-void EdgeExtractor::addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtractor::Edge& e, const fvec3& n)
+void EdgeExtractor::addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtractor::Edge& e, const fvec3& n, int& non_manifold) const
 {
   std::set<EdgeExtractor::Edge>::iterator it = edges.find(e);
   if (it != edges.end())
   {
     VL_CHECK(!it->normal1().isNull())
-    if (mWarnNonManifold && !it->normal2().isNull())
-      vl::Log::error("EdgeExtractor: non-manifold mesh detected!\n");
+    if (!it->normal2().isNull())
+      ++non_manifold;
       EdgeExtractor::Edge edge = e;
       edge.setNormal1(it->normal1());
       edge.setNormal2(n);
@@ -66,23 +288,51 @@ void EdgeExtractor::addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtr
 //! Extracts the edges from the given Geometry and appends them to edges().
 void EdgeExtractor::extractEdges(Geometry* geom)
 {
-  ArrayAbstract* verts = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
-
-  // mic fixme:
-  // here the bottle-neck seems to be the continuous allocation/deallocation and insertion/search time,
-  // maybe a memory-pool-managed hash table would help?
-  if (!verts)
-  {
+  std::vector<Edge> edges;
+  extractEdges(geom, edges);
+  mEdges.insert(mEdges.end(), edges.begin(), edges.end());
+}
+//-----------------------------------------------------------------------------
+void EdgeExtractor::extractEdges(const Geometry* geom, std::vector<Edge>& edges) const
+{
+  int non_manifold = 0;
+  bool has_vertices = collectEdges(geom, edges, non_manifold);
+  logExtraction(has_vertices, non_manifold);
+}
+//-----------------------------------------------------------------------------
+bool EdgeExtractor::collectEdges(const Geometry* geom, std::vector<Edge>& edges, int& non_manifold) const
+{
+  non_manifold = 0;
+  if (useHashing())
+    return extractEdgesHashing(geom, edges, non_manifold);
+  else
+    return extractEdgesSorting(geom, edges, non_manifold);
+}
+//-----------------------------------------------------------------------------
+void EdgeExtractor::logExtraction(bool has_vertices, int non_manifold) const
+{
+  if (!has_vertices)
     vl::Log::error("EdgeExtractor::extractEdges(geom): 'geom' must have a vertex array of type ArrayFloat3.\n");
-    return;
+  if (mWarnNonManifold)
+  {
+    for(int i=0; i<non_manifold; ++i)
+      vl::Log::error("EdgeExtractor: non-manifold mesh detected!\n");
   }
+}
+//-----------------------------------------------------------------------------
+bool EdgeExtractor::extractEdgesSorting(const Geometry* geom, std::vector<Edge>& out, int& non_manifold) const
+{
+  const ArrayAbstract* verts = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
+
+  if (!verts)
+    return false;
 
   std::set<Edge> edges;
 
   // iterate all primitives
   for(int iprim=0; iprim<geom->drawCalls()->size(); ++iprim)
   {
-    DrawCall* prim = geom->drawCalls()->at(iprim);
+    const DrawCall* prim = geom->drawCalls()->at(iprim);
     // iterate triangles (if present)
     for(TriangleIterator trit = prim->triangleIterator(); trit.hasNext(); trit.next())
     {
@@ -98,15 +348,137 @@ void EdgeExtractor::extractEdges(Geometry* geom)
       fvec3 n = cross(v1,v2).normalize();
       if (n.isNull())
         continue;
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(a), (fvec3)verts->getAsVec3(b) ), n );
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(b), (fvec3)verts->getAsVec3(c) ), n );
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(c), (fvec3)verts->getAsVec3(a) ), n );
+      addEdge(edges, Edge( (fvec3)verts->getAsVec3(a), (fvec3)verts->getAsVec3(b) ), n, non_manifold );
+      addEdge(edges, Edge( (fvec3)verts->getAsVec3(b), (fvec3)verts->getAsVec3(c) ), n, non_manifold );
+      addEdge(edges, Edge( (fvec3)verts->getAsVec3(c), (fvec3)verts->getAsVec3(a) ), n, non_manifold );
     }
   }
 
-  for(std::set<Edge>::iterator it = edges.begin(); it != edges.end(); ++it)
+  out.assign(edges.begin(), edges.end());
+  classifyEdges(out);
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool EdgeExtractor::extractEdgesHashing(const Geometry* geom, std::vector<Edge>& out, int& non_manifold) const
+{
+  const ArrayAbstract* verts = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
+
+  if (!verts)
+    return false;
+
+  out.clear();
+
+  // rank the vertices by position: vertices with the same position get the same rank 
+  // and the rank order is the order in which std::set<Edge> sorts the edges.
+  std::vector<fvec3> pos(verts->size());
+  const ArrayFloat3* fverts = verts->as<ArrayFloat3>();
+  if (fverts && !pos.empty())
+    memcpy(&pos[0], fverts->begin(), pos.size() * sizeof(fvec3));
+  else
   {
-    Edge e = *it;
+    for(size_t i=0; i<pos.size(); ++i)
+      pos[i] = (fvec3)verts->getAsVec3(i);
+  }
+  std::vector<u32> rank;
+  const u32 rank_count = rankPositions(pos, rank);
+
+  // collect the triangles
+  std::vector<CompactTriangle> triangles;
+  for(int iprim=0; iprim<geom->drawCalls()->size(); ++iprim)
+  {
+    const DrawCall* prim = geom->drawCalls()->at(iprim);
+    for(TriangleIterator trit = prim->triangleIterator(); trit.hasNext(); trit.next())
+    {
+      CompactTriangle tri;
+      tri.mIndex[0] = (u32)trit.a();
+      tri.mIndex[1] = (u32)trit.b();
+      tri.mIndex[2] = (u32)trit.c();
+      if (tri.mIndex[0] == tri.mIndex[1] || tri.mIndex[1] == tri.mIndex[2] || tri.mIndex[2] == tri.mIndex[0])
+        continue;
+      // compute normal
+      fvec3 n = cross(pos[tri.mIndex[1]]-pos[tri.mIndex[0]], pos[tri.mIndex[2]]-pos[tri.mIndex[0]]).normalize();
+      if (n.isNull())
+        continue;
+      tri.mNormal[0] = n.x();
+      tri.mNormal[1] = n.y();
+      tri.mNormal[2] = n.z();
+      triangles.push_back(tri);
+    }
+  }
+
+  // partition the half-edges by their first rank, preserving their order, so that 
+  // the partitions are already sorted relative to each other and each one fits in cache
+  const size_t half_edge_count = triangles.size() * 3;
+  int partition_count = 1;
+  while(partition_count < 256 && half_edge_count / partition_count > 16*1024)
+    partition_count *= 2;
+  std::vector<size_t> offsets(partition_count+1, 0);
+  for(size_t i=0; i<triangles.size(); ++i)
+  {
+    for(int k=0; k<3; ++k)
+    {
+      u32 ra = rank[triangles[i].mIndex[k]];
+      u32 rb = rank[triangles[i].mIndex[(k+1)%3]];
+      ++offsets[ (u64)(ra < rb ? ra : rb) * partition_count / rank_count + 1 ];
+    }
+  }
+  for(int i=0; i<partition_count; ++i)
+    offsets[i+1] += offsets[i];
+  std::vector<HalfEdge> half_edges(half_edge_count);
+  std::vector<size_t> cursor(offsets.begin(), offsets.end()-1);
+  for(size_t i=0; i<triangles.size(); ++i)
+  {
+    const CompactTriangle& tri = triangles[i];
+    for(int k=0; k<3; ++k)
+    {
+      u32 a = tri.mIndex[k];
+      u32 b = tri.mIndex[(k+1)%3];
+      // a null normal implies rank[a] != rank[b]
+      if (rank[b] < rank[a])
+        std::swap(a, b);
+      HalfEdge& he = half_edges[ cursor[ (u64)rank[a] * partition_count / rank_count ]++ ];
+      he.mRank1   = rank[a];
+      he.mRank2   = rank[b];
+      he.mVertex1 = a;
+      he.mVertex2 = b;
+      memcpy(he.mNormal, tri.mNormal, sizeof(he.mNormal));
+    }
+  }
+  std::vector<CompactTriangle>().swap(triangles);
+
+  // in a closed manifold mesh every edge is shared by two triangles
+  out.reserve(half_edge_count / 2);
+
+  EdgeTable table;
+  std::vector<EdgeRecord> records;
+  for(int p=0; p<partition_count; ++p)
+  {
+    if (offsets[p] == offsets[p+1])
+      continue;
+    non_manifold += table.merge(&half_edges[offsets[p]], offsets[p+1] - offsets[p], records);
+    std::sort(records.begin(), records.end());
+    size_t start = out.size();
+    out.resize(start + records.size());
+    for(size_t i=0; i<records.size(); ++i)
+    {
+      const EdgeRecord& rec = records[i];
+      Edge& e = out[start+i];
+      e.setVertex1( pos[rec.mVertex1] );
+      e.setVertex2( pos[rec.mVertex2] );
+      e.setNormal1( fvec3(rec.mNormal1[0], rec.mNormal1[1], rec.mNormal1[2]) );
+      e.setNormal2( fvec3(rec.mNormal2[0], rec.mNormal2[1], rec.mNormal2[2]) );
+    }
+  }
+
+  classifyEdges(out);
+  return true;
+}
+//-----------------------------------------------------------------------------
+void EdgeExtractor::classifyEdges(std::vector<Edge>& edges) const
+{
+  for(size_t i=0; i<edges.size(); ++i)
+  {
+    Edge& e = edges[i];
     // boundary edge
     if (e.normal2().isNull())
       e.setIsCrease(true);
@@ -120,7 +492,6 @@ void EdgeExtractor::extractEdges(Geometry* geom)
       if( a1 > creaseAngle() )
         e.setIsCrease(true);
     }
-    mEdges.push_back(e);
   }
 }
 //-----------------------------------------------------------------------------
@@ -170,12 +541,39 @@ bool EdgeExtractor::extractEdges(Actor* actor)
 //-----------------------------------------------------------------------------
 void EdgeExtractor::extractEdges(ActorCollection* actors)
 {
+  if (!useHashing() || threadCount() == 1)
+  {
+    for(int i=0; i<actors->size(); ++i)
+    {
+      Geometry* geom = cast<Geometry>(actors->at(i)->lod(0));
+      if (geom)
+        extractEdges(geom);
+    }
+    return;
+  }
+
+  std::vector<const Geometry*> geoms;
   for(int i=0; i<actors->size(); ++i)
   {
     Geometry* geom = cast<Geometry>(actors->at(i)->lod(0));
     if (geom)
-      extractEdges(geom);
+      geoms.push_back(geom);
   }
+  if (geoms.empty())
+    return;
+
+  // one task per Geometry, the results are appended in the same order as the serial version
+  std::vector< std::vector<Edge> > edges(geoms.size());
+  EdgeTasks tasks(this, geoms, edges);
+  Thread::runTasks(&tasks, (int)geoms.size(), threadCount());
+  tasks.logResults();
+
+  size_t count = mEdges.size();
+  for(size_t i=0; i<edges.size(); ++i)
+    count += edges[i].size();
+  mEdges.reserve(count);
+  for(size_t i=0; i<edges.size(); ++i)
+    mEdges.insert(mEdges.end(), edges[i].begin(), edges[i].end());
 }
 //-----------------------------------------------------------------------------
 void EdgeExtractor::extractEdges(SceneManager* scene_manager)
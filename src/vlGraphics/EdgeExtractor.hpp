@@ -65,6 +65,12 @@ namespace vl
   - Assign a new EdgeUpdateCallback to the previously created Actor, using the Actor::renderEventCallbacks() method.
   - Initialize the previously created EdgeUpdateCallback edges with the edges extracted by the EdgeExtractor, 
     that is, assign EdgeExtractor::edges() to EdgeUpdateCallback::edges().
+
+  \par Performance
+  By default the edges of a Geometry are collected in a std::set. When hashing is enabled (see setUseHashing()) the vertices
+  with the same position are welded and ranked, and the edges are collected in flat open addressing hash tables keyed on the
+  pair of vertex ranks, one partition of the ranks at a time. In this mode extractEdges(ActorCollection*) also processes the 
+  Geometry objects in parallel using threadCount() threads. Both modes generate the same edges in the same order.
  
   \sa 
   - \ref pagGuideEdgeRendering "Edge Enhancement and Wireframe Rendering Tutorial"
@@ -133,12 +139,15 @@ namespace vl
     };
 
   public:
-    EdgeExtractor(): mCreaseAngle(45.0f), mWarnNonManifold(false)
+    EdgeExtractor(): mCreaseAngle(45.0f), mWarnNonManifold(false), mUseHashing(false), mThreadCount(0)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
 
     void extractEdges(Geometry* geom);
+    //! Extracts the edges of the given Geometry into \p edges without modifying edges(), can be called from multiple threads at the same time.
+    //! Errors and non-manifold warnings are logged by the calling thread.
+    void extractEdges(const Geometry* geom, std::vector<Edge>& edges) const;
     bool extractEdges(Actor* actor);
     void extractEdges(ActorCollection* actors);
     void extractEdges(SceneManager* scenemanager);
@@ -159,13 +168,34 @@ namespace vl
     bool warnNonManifold() const { return mWarnNonManifold; }
     void setWarnNonManifold(bool warn_on) { mWarnNonManifold = warn_on; }
 
+    //! If true the edges are collected in a hash table instead of a std::set and multiple Geometry objects are processed in parallel. Disabled by default.
+    void setUseHashing(bool use_hashing) { mUseHashing = use_hashing; }
+    //! If true the edges are collected in a hash table instead of a std::set and multiple Geometry objects are processed in parallel. Disabled by default.
+    bool useHashing() const { return mUseHashing; }
+
+    //! How many Geometry objects extractEdges(ActorCollection*) processes at the same time in hashing mode, one per thread.
+    //! 0 (default) uses Thread::hardwareConcurrency() threads, 1 processes the Geometry objects one after the other.
+    void setThreadCount(int count) { mThreadCount = count; }
+    //! How many Geometry objects extractEdges(ActorCollection*) processes at the same time in hashing mode, see setThreadCount().
+    int threadCount() const { return mThreadCount; }
+
   protected:
-    void addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtractor::Edge& e, const fvec3& n);
+    class EdgeTasks;
+    void addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtractor::Edge& e, const fvec3& n, int& non_manifold) const;
+    //! Extracts the edges of \p geom without logging. Returns false if \p geom has no vertex array.
+    bool collectEdges(const Geometry* geom, std::vector<Edge>& edges, int& non_manifold) const;
+    bool extractEdgesSorting(const Geometry* geom, std::vector<Edge>& edges, int& non_manifold) const;
+    bool extractEdgesHashing(const Geometry* geom, std::vector<Edge>& edges, int& non_manifold) const;
+    void classifyEdges(std::vector<Edge>& edges) const;
+    //! Logs the outcome of collectEdges().
+    void logExtraction(bool has_vertices, int non_manifold) const;
 
   protected:
     std::vector<Edge> mEdges;
     float mCreaseAngle;
     bool mWarnNonManifold;
+    bool mUseHashing;
+    int mThreadCount;
   };
 }
 
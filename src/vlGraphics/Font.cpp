@@ -35,7 +35,6 @@
 #include <vlCore/Log.hpp>
 #include <vlCore/Say.hpp>
 #include <vlCore/FileSystem.hpp>
-#include <vlCore/Image.hpp>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -66,15 +65,25 @@ const char* get_ft_error_message(int error)
   return ft_errors[i].err_msg;
 }
 
-//-----------------------------------------------------------------------------
-// Glyph
-//-----------------------------------------------------------------------------
-Glyph::~Glyph()
+namespace
 {
-  if (mTextureHandle)
+  //! Sets the filtering of the currently bound texture.
+  void setGlyphTextureParameters(bool smooth)
   {
-    glDeleteTextures(1, &mTextureHandle);
-    mTextureHandle = 0;
+    if (smooth)
+    {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+    }
+    else
+    {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+    }
   }
 }
 //-----------------------------------------------------------------------------
@@ -88,6 +97,11 @@ Font::Font(FontManager* fm)
   mFT_Face = NULL;
   mSmooth  = false;
   mFreeTypeLoadForceAutoHint = true;
+  mAtlasSize      = 0;
+  mAtlasPenX      = 0;
+  mAtlasPenY      = 0;
+  mAtlasRowHeight = 0;
+  mGlyphsVersion  = 0;
   setSize(14);
 }
 //-----------------------------------------------------------------------------
@@ -99,12 +113,18 @@ Font::Font(FontManager* fm, const String& font_file, int size)
   mFT_Face = NULL;
   mSmooth  = false;
   mFreeTypeLoadForceAutoHint = true;
+  mAtlasSize      = 0;
+  mAtlasPenX      = 0;
+  mAtlasPenY      = 0;
+  mAtlasRowHeight = 0;
+  mGlyphsVersion  = 0;
   loadFont(font_file);
   setSize(size);
 }
 //-----------------------------------------------------------------------------
 Font::~Font()
 {
+  releaseGlyphs();
   releaseFreeTypeData();
 }
 //-----------------------------------------------------------------------------
@@ -131,7 +151,7 @@ void Font::setSize(int size)
   {
     mSize = size;
     // removes all the cached glyphs
-    mGlyphMap.clear();
+    releaseGlyphs();
   }
 }
 //-----------------------------------------------------------------------------
@@ -142,7 +162,7 @@ void Font::loadFont(const String& path)
 
   mFilePath = path;
   // removes all the cached glyphs
-  mGlyphMap.clear();
+  releaseGlyphs();
 
   // remove FreeType font face object
   if (mFT_Face)
@@ -180,9 +200,116 @@ void Font::loadFont(const String& path)
   }
 }
 //-----------------------------------------------------------------------------
-Glyph* Font::glyph(int character)
+void Font::releaseGlyphs()
+{
+  for(int i=0; i<256; ++i)
+    mGlyphTable[i].clear();
+  mGlyphMap.clear();
+
+  if (!mAtlasTextures.empty())
+  {
+    glDeleteTextures( (GLsizei)mAtlasTextures.size(), &mAtlasTextures[0] );
+    mAtlasTextures.clear();
+  }
+  mAtlasSize      = 0;
+  mAtlasPenX      = 0;
+  mAtlasPenY      = 0;
+  mAtlasRowHeight = 0;
+  ++mGlyphsVersion;
+}
+//-----------------------------------------------------------------------------
+ref<Glyph>& Font::glyphSlot(int character)
 {
-  ref<Glyph>& glyph = mGlyphMap[character];
+  if (character >= 0 && character < 0x10000)
+  {
+    std::vector< ref<Glyph> >& page = mGlyphTable[character >> 8];
+    if (page.empty())
+      page.resize(256);
+    return page[character & 0xFF];
+  }
+  else
+    return mGlyphMap[character];
+}
+//-----------------------------------------------------------------------------
+bool Font::packGlyph(Glyph* glyph, int cell_w, int cell_h, int& x, int& y)
+{
+  // start a new row
+  if (mAtlasTextures.empty() || mAtlasPenX + cell_w > mAtlasSize)
+  {
+    mAtlasPenX = 0;
+    mAtlasPenY += mAtlasRowHeight;
+    mAtlasRowHeight = 0;
+  }
+
+  // start a new atlas texture
+  if (mAtlasTextures.empty() || mAtlasPenY + cell_h > mAtlasSize || cell_w > mAtlasSize)
+  {
+    int max_tex_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_tex_size);
+    if (max_tex_size <= 0)
+      max_tex_size = 1024;
+
+    int size = 512;
+    while( (size < cell_w || size < cell_h) && size < max_tex_size )
+      size *= 2;
+    if (size > max_tex_size)
+      size = max_tex_size;
+    if (cell_w > size || cell_h > size)
+    {
+      Log::error( Say("Font::glyph() error (%s): glyph too big for the atlas texture.\n") << filePath() );
+      return false;
+    }
+
+    // init to all transparent white
+    std::vector<unsigned char> pixels(size * size * 4);
+    for(size_t i=0; i<pixels.size(); i+=4)
+    {
+      pixels[i+0] = 0xFF;
+      pixels[i+1] = 0xFF;
+      pixels[i+2] = 0xFF;
+      pixels[i+3] = 0x0;
+    }
+
+    unsigned int texhdl = 0;
+    glGenTextures( 1, &texhdl );
+    VL_glActiveTexture(GL_TEXTURE0);
+    glBindTexture( GL_TEXTURE_2D, texhdl );
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0] ); VL_CHECK_OGL();
+    setGlyphTextureParameters( smooth() );
+
+    // sets anisotropy to the maximum supported
+    if (Has_GL_EXT_texture_filter_anisotropic)
+    {
+      float max_anisotropy;
+      glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropy);
+    }
+    VL_CHECK_OGL();
+
+    mAtlasTextures.push_back(texhdl);
+    mAtlasSize      = size;
+    mAtlasPenX      = 0;
+    mAtlasPenY      = 0;
+    mAtlasRowHeight = 0;
+  }
+
+  x = mAtlasPenX;
+  y = mAtlasPenY;
+  mAtlasPenX += cell_w;
+  mAtlasRowHeight = cell_h > mAtlasRowHeight ? cell_h : mAtlasRowHeight;
+
+  glyph->setTextureHandle( mAtlasTextures.back() );
+  glyph->setS0( x / (float)mAtlasSize );
+  glyph->setS1( (x + cell_w) / (float)mAtlasSize );
+  // t0 is the top of the glyph, t1 the bottom
+  glyph->setT0( (y + cell_h) / (float)mAtlasSize );
+  glyph->setT1( y / (float)mAtlasSize );
+  return true;
+}
+//-----------------------------------------------------------------------------
+Glyph* Font::createGlyph(int character)
+{
+  ref<Glyph>& glyph = glyphSlot(character);
 
   if (glyph.get() == NULL)
   {
@@ -331,116 +458,50 @@ Glyph* Font::glyph(int character)
       VL_CHECK( mFT_Face->glyph->bitmap.palette_mode == 0 )
       VL_CHECK( mFT_Face->glyph->bitmap.pitch > 0 )
 
-      unsigned int texhdl;
-      glGenTextures( 1, &texhdl );
-      glyph->setTextureHandle(texhdl);
-      VL_glActiveTexture(GL_TEXTURE0);
-      glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
-
-      int texsize[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 0 };
-      int max_tex_size = 0;
-      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_tex_size);
-
-      int w=0, h=0, margin = 1;
-
-      for(int i=0; texsize[i]; ++i)
+      // the glyph is stored in the atlas leaving a 1px transparent margin around it
+      int margin = 1;
+      int cell_w = glyph->width()  + margin*2;
+      int cell_h = glyph->height() + margin*2;
+      int cell_x = 0, cell_y = 0;
+      if ( packGlyph(glyph.get(), cell_w, cell_h, cell_x, cell_y) )
       {
-        if ( (texsize[i] >= glyph->width() + margin*2 && texsize[i] >= glyph->height() + margin*2) || texsize[i+1] > max_tex_size )
+        std::vector<unsigned char> cell(cell_w * cell_h * 4);
+
+        // init to all transparent white
+        for(size_t i=0; i<cell.size(); i+=4)
         {
-          w = texsize[i];
-          h = texsize[i];
-          break;
+          cell[i+0] = 0xFF;
+          cell[i+1] = 0xFF;
+          cell[i+2] = 0xFF;
+          cell[i+3] = 0x0;
         }
-      }
-      VL_CHECK(w)
-      VL_CHECK(h)
-
-#if(1)
-      // tex coords DO include the border
-      glyph->setS0( 0 );
-      glyph->setT0( 1 );
-      glyph->setS1((margin*2 + glyph->width() ) /(float)(w-1) );
-      glyph->setT1( 1 -(margin*2 + glyph->height() ) /(float)(h-1) );
-
-      // tex coords DO NOT include the border
-      //glyph->setS0((float)margin /(float)(w-1));
-      //glyph->setT0( 1 -(float)margin /(float)(h-1));
-      //glyph->setS1(((float)margin + glyph->width() ) /(float)(w-1));
-      //glyph->setT1( 1 -((float)margin + glyph->height() ) /(float)(h-1));
-#else
-      glyph->setS0((float)margin /(float)w);
-      glyph->setT0( 1 -(float)margin /(float)h);
-      glyph->setS1(((float)margin + glyph->width() ) /(float)w);
-      glyph->setT1( 1 -((float)margin + glyph->height() ) /(float)h);
-#endif
-
-      ref<Image> img = new Image;
-      img->allocate2D(w, h, 1, IF_RGBA, IT_UNSIGNED_BYTE);
-
-      // init to all transparent white
-      for(unsigned char *px = img->pixels(), *end = px + img->requiredMemory(); px<end; px+=4)
-      {
-        px[0] = 0xFF;
-        px[1] = 0xFF;
-        px[2] = 0xFF;
-        px[3] = 0x0;
-      }
-
-      // maps the glyph on the texture leaving a 1px margin
 
-      for(int y=0; y<glyph->height(); y++)
-      {
-        for(int x=0; x<glyph->width(); x++)
+        // the first row of the texture is the bottom of the glyph
+        for(int y=0; y<glyph->height(); y++)
         {
-          int offset_1 = (x+margin) * 4 + (w-1-y-margin) * img->pitch();
-          int offset_2 = 0;
-          if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
-            offset_2 = x / 8 + y * ::abs(mFT_Face->glyph->bitmap.pitch);
-          else
-            offset_2 = x + y * mFT_Face->glyph->bitmap.pitch;
-
-#if (1)
-          if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
-            img->pixels()[ offset_1+3 ] = (mFT_Face->glyph->bitmap.buffer[ offset_2 ] >> (7-x%8)) & 0x1 ? 0xFF : 0x0;
-          else
-            img->pixels()[ offset_1+3 ] = mFT_Face->glyph->bitmap.buffer[ offset_2 ];
-#else
-          // debug code
-          img->pixels()[ offset_1+0 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+1 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+2 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+3 ] = 0xFF; // face->glyph->bitmap.buffer[ offset_2 ];
-#endif
+          for(int x=0; x<glyph->width(); x++)
+          {
+            int offset_1 = (x+margin) * 4 + (cell_h-1-y-margin) * cell_w * 4;
+            int offset_2 = 0;
+            if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+              offset_2 = x / 8 + y * ::abs(mFT_Face->glyph->bitmap.pitch);
+            else
+              offset_2 = x + y * mFT_Face->glyph->bitmap.pitch;
+
+            if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+              cell[ offset_1+3 ] = (mFT_Face->glyph->bitmap.buffer[ offset_2 ] >> (7-x%8)) & 0x1 ? 0xFF : 0x0;
+            else
+              cell[ offset_1+3 ] = mFT_Face->glyph->bitmap.buffer[ offset_2 ];
+          }
         }
-      }
-
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img->width(), img->height(), 0, img->format(), img->type(), img->pixels() ); VL_CHECK_OGL();
 
-      if ( smooth() )
-      {
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+        VL_glActiveTexture(GL_TEXTURE0);
+        glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
+        glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+        glTexSubImage2D( GL_TEXTURE_2D, 0, cell_x, cell_y, cell_w, cell_h, GL_RGBA, GL_UNSIGNED_BYTE, &cell[0] );
+        VL_CHECK_OGL();
+        glBindTexture( GL_TEXTURE_2D, 0 );
       }
-      else
-      {
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-      }
-
-      // sets anisotropy to the maximum supported
-      if (Has_GL_EXT_texture_filter_anisotropic)
-      {
-        float max_anisotropy;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropy);
-      }
-
-      VL_CHECK_OGL();
-      glBindTexture( GL_TEXTURE_2D, 0 );
     }
 
     glyph->setAdvance( fvec2( (float)mFT_Face->glyph->advance.x / 64.0f, (float)mFT_Face->glyph->advance.y / 64.0f ) );
@@ -452,28 +513,10 @@ Glyph* Font::glyph(int character)
 void Font::setSmooth(bool smooth)
 {
   mSmooth = smooth;
-  std::map<int, ref<Glyph> >::iterator it = mGlyphMap.begin();
-  for(; it != mGlyphMap.end(); ++it )
+  for(size_t i=0; i<mAtlasTextures.size(); ++i)
   {
-    const ref<Glyph>& glyph = it->second;
-    if (glyph->textureHandle() == 0)
-      continue;
-
-    glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
-    if (smooth)
-    {
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-    }
-    else
-    {
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-    }
+    glBindTexture( GL_TEXTURE_2D, mAtlasTextures[i] );
+    setGlyphTextureParameters(smooth);
   }
   glBindTexture( GL_TEXTURE_2D, 0 );
 }
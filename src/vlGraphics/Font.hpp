@@ -51,6 +51,8 @@ namespace vl
   //-----------------------------------------------------------------------------
   /**
    * The Glyph associated to a character of a given Font.
+   * The bitmap of the glyph is stored in one of the atlas textures of its Font: textureHandle() is shared among
+   * all the glyphs packed in the same atlas and is owned by the Font.
   */
   class Glyph: public Object
   {
@@ -66,8 +68,6 @@ namespace vl
   public:
     Glyph(): mFont(NULL), mS0(0), mT0(0), mS1(0), mT1(0), mGlyphIndex(0), mTextureHandle(0), mWidth(0), mHeight(0), mLeft(0), mTop(0) {}
 
-    ~Glyph();
-
     unsigned int textureHandle() const { return mTextureHandle; }
     void setTextureHandle(unsigned int handle) { mTextureHandle = handle; }
 
@@ -123,6 +123,10 @@ namespace vl
   //-----------------------------------------------------------------------------
   /**
    * A font to be used with a Text renderable.
+   *
+   * The glyphs are rasterized on demand and packed in rows into a few shared atlas textures, so that a whole string
+   * can usually be rendered binding a single texture. The glyphs of the Basic Multilingual Plane are looked up
+   * through a two-level table, the other characters through a std::map.
   */
   class VLGRAPHICS_EXPORT Font: public Object
   {
@@ -170,7 +174,16 @@ namespace vl
     void setSize(int size);
 
     //! Returns (and eventually creates) the Glyph* associated to the given character.
-    Glyph* glyph(int character);
+    Glyph* glyph(int character)
+    {
+      if (character >= 0 && character < 0x10000)
+      {
+        std::vector< ref<Glyph> >& page = mGlyphTable[character >> 8];
+        if (!page.empty() && page[character & 0xFF])
+          return page[character & 0xFF].get();
+      }
+      return createGlyph(character);
+    }
     
     //! Whether the font rendering should use linear filtering or not.
     void setSmooth(bool smooth);
@@ -198,10 +211,30 @@ namespace vl
     //! There isn't a "best" option for all the fonts, the results can be better or worse depending on the particular font loaded.
     void setFreeTypLoadForceAutoHint(bool enable) { mFreeTypeLoadForceAutoHint = enable; }
 
+    //! The atlas textures currently used by the glyphs of this font.
+    const std::vector<unsigned int>& atlasTextures() const { return mAtlasTextures; }
+
+    //! Incremented every time the cached glyphs are discarded, for example by setSize() and loadFont().
+    //! Objects caching glyph metrics or texture coordinates can use it to know when to regenerate them.
+    int glyphsVersion() const { return mGlyphsVersion; }
+
+  protected:
+    Glyph* createGlyph(int character);
+    ref<Glyph>& glyphSlot(int character);
+    bool packGlyph(Glyph* glyph, int cell_w, int cell_h, int& x, int& y);
+    void releaseGlyphs();
+
   protected:
     FontManager* mFontManager;
     String mFilePath;
+    std::vector< ref<Glyph> > mGlyphTable[256];
     std::map< int, ref<Glyph> > mGlyphMap;
+    std::vector<unsigned int> mAtlasTextures;
+    int mAtlasSize;
+    int mAtlasPenX;
+    int mAtlasPenY;
+    int mAtlasRowHeight;
+    int mGlyphsVersion;
     FT_Face mFT_Face;
     std::vector<char> mMemoryFile;
     int mSize;
@@ -35,6 +35,7 @@
 #include <vlCore/VirtualFile.hpp>
 #include <vlCore/Log.hpp>
 #include <vlCore/Say.hpp>
+#include <vlCore/Atomic.hpp>
 
 using namespace vl;
 
@@ -243,11 +244,19 @@ void GLSLShader::deleteShader()
 //------------------------------------------------------------------------------
 // GLSLProgram
 //------------------------------------------------------------------------------
+namespace
+{
+  // Uniform::mLocationCache entries are valid only while the program's id matches: every (re)link gets a new, never reused, id.
+  volatile int gUniformCacheId = 0;
+}
+//-----------------------------------------------------------------------------
 GLSLProgram::GLSLProgram()
 {
   VL_DEBUG_SET_OBJECT_NAME()
   mScheduleLink = true;
   mHandle = 0;
+  mUniformCacheId = atomicIncrement(gUniformCacheId);
+  mUniformDeltaBinding = true;
   mGeometryVerticesOut = 0;
   mGeometryInputType   = GIT_TRIANGLES;
   mGeometryOutputType  = GOT_TRIANGLE_STRIP;
@@ -281,6 +290,8 @@ GLSLProgram& GLSLProgram::operator=(const GLSLProgram& other)
   mFragDataLocation = other.mFragDataLocation;
   mActiveUniforms.clear();
   mActiveAttribs.clear();
+  mUniformCacheId = atomicIncrement(gUniformCacheId);
+  mUniformDeltaBinding = other.mUniformDeltaBinding;
   mAutoAttribLocation = other.mAutoAttribLocation;
   if (other.mUniformSet)
   {
@@ -537,6 +548,7 @@ void GLSLProgram::postLink()
   // populate uniform binding map
 
   mActiveUniforms.clear();
+  mUniformCacheId = atomicIncrement(gUniformCacheId);
 
   int uniform_len = 0;
   glGetProgramiv(handle(), GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniform_len); VL_CHECK_OGL();
@@ -705,7 +717,7 @@ void GLSLProgram::apply(int /*index*/, const Camera*, OpenGLContext*) const
   }
 }
 //-----------------------------------------------------------------------------
-bool GLSLProgram::applyUniformSet(const UniformSet* uniforms) const
+bool GLSLProgram::applyUniformSet(const UniformSet* uniforms, int* issued, int* skipped) const
 {
   VL_CHECK_OGL();
   VL_CHECK( Has_GLSL )
@@ -731,12 +743,23 @@ bool GLSLProgram::applyUniformSet(const UniformSet* uniforms) const
   {
     const Uniform* uniform = uniforms->uniforms()[i].get();
 
-    #if 1
-      const UniformInfo* uinfo = activeUniformInfo(uniform->name().c_str());
-      int location = uinfo ? uinfo->Location : -1;
-    #else
-      int location = glGetUniformLocation(handle(), uniform->name().c_str());
-    #endif
+    // resolve the location once per uniform and link
+    int slot = 0;
+    while(slot < Uniform::LocationCacheSize && uniform->mLocationCache[slot].ProgramId != mUniformCacheId)
+      ++slot;
+    const UniformInfo* uinfo = NULL;
+    if (slot < Uniform::LocationCacheSize)
+      uinfo = uniform->mLocationCache[slot].Info;
+    else
+    {
+      uinfo = activeUniformInfo(uniform->name().c_str());
+      // round robin replacement
+      Uniform::LocationCacheEntry& entry = uniform->mLocationCache[uniform->mLocationCacheNext];
+      uniform->mLocationCacheNext = (uniform->mLocationCacheNext + 1) % Uniform::LocationCacheSize;
+      entry.ProgramId = mUniformCacheId;
+      entry.Info = uinfo;
+    }
+    int location = uinfo ? uinfo->Location : -1;
 
     if (location == -1)
     {
@@ -751,8 +774,18 @@ bool GLSLProgram::applyUniformSet(const UniformSet* uniforms) const
       continue;
     }
 
+    // delta binding: skip the uniform if the program already holds its current value
+    if (mUniformDeltaBinding && !uniform->mRawDataAccess && uinfo->Stamp == uniform->stamp())
+    {
+      if (skipped)
+        ++*skipped;
+      continue;
+    }
+    uinfo->Stamp = uniform->stamp();
+    if (issued)
+      ++*issued;
+
     // finally transmits the uniform
-    // note: we don't perform delta binding per-uniform variable at the moment!
 
     VL_CHECK_OGL();
     switch(uniform->mType)
@@ -803,11 +836,13 @@ bool GLSLProgram::applyUniformSet(const UniformSet* uniforms) const
         // Probably you added a uniform to a Shader or Actor but you forgot to assign a valueto it.
         vl::Log::bug( vl::Say("GLSLProgram::applyUniformSet(): uniform '%s' does not contain any data! Did you forget to assign a value to it?\n") << uniform->name() );
         VL_TRAP();
+        uinfo->Stamp = 0;
         break;
 
       default:
         vl::Log::bug( vl::Say("GLSLProgram::applyUniformSet(): wrong uniform type for '%s'!\n") << uniform->name() );
         VL_TRAP();
+        uinfo->Stamp = 0;
         break;
     }
   }
@@ -816,6 +851,12 @@ bool GLSLProgram::applyUniformSet(const UniformSet* uniforms) const
   return true;
 }
 //-----------------------------------------------------------------------------
+void GLSLProgram::invalidateUniformCache() const
+{
+  for(std::map<std::string, ref<UniformInfo> >::const_iterator it = mActiveUniforms.begin(); it != mActiveUniforms.end(); ++it)
+    it->second->Stamp = 0;
+}
+//-----------------------------------------------------------------------------
 void GLSLProgram::bindFragDataLocation(int color_number, const char* name)
 {
   scheduleRelinking();
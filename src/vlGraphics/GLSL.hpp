@@ -48,12 +48,13 @@ namespace vl
   struct UniformInfo: public Object
   {
     UniformInfo(const char* name, EUniformType type, int size, int location)
-    :Name(name), Type(type), Size(size), Location(location) {}
+    :Name(name), Type(type), Size(size), Location(location), Stamp(0) {}
 
     std::string Name;  //!< The name of the uniform.
     EUniformType Type; //!< The type of the uniform (float, vec4, mat2x3, sampler2D etc.)
     int Size;          //!< The size of the uniform: 1 for non-arrays, >= 1 for arrays.
     int Location;      //!< Location of the uniform as retuned by glGetUniformLocation().
+    mutable int Stamp; //!< Uniform::stamp() of the value last transmitted by GLSLProgram::applyUniformSet(), 0 if unknown.
   };
 
   //------------------------------------------------------------------------------
@@ -243,6 +244,11 @@ namespace vl
    * \remarks
    * A Uniform must be setup using <i>one and only one</i> of the 5 previously mentioned methods.
    *
+   * \par Delta Binding
+   * applyUniformSet() caches the location of each Uniform and skips the glUniform* call if the program already holds
+   * the Uniform's current value, see Uniform::stamp(). If you update with glUniform* a uniform that is also set through
+   * a UniformSet call invalidateUniformCache(), or disable the feature with setUniformDeltaBinding().
+   *
    * \par Attribute Location Bindings
    * In order to explicity specify which attribute index should be bound to which attribute name you can do one of the following.
    * -# call glBindAttribLocation() with the appropriate GLSLProgram::handle(). This is the most low level way of doing it.
@@ -490,8 +496,19 @@ namespace vl
     /**
      * Applies a set of uniforms to the currently bound GLSL program.
      * This function expects the GLSLProgram to be already bound, see useProgram().
+     * If \p issued and \p skipped are not NULL they are incremented by the number of glUniform* calls performed
+     * and by the number of uniforms skipped because the program already held their value.
     */
-    bool applyUniformSet(const UniformSet* uniforms) const;
+    bool applyUniformSet(const UniformSet* uniforms, int* issued=NULL, int* skipped=NULL) const;
+
+    //! Forgets which uniform values have been transmitted to the program so that the next applyUniformSet() transmits them all.
+    void invalidateUniformCache() const;
+
+    //! If enabled (default) applyUniformSet() skips the uniforms whose value has not changed since the last time they were transmitted.
+    void setUniformDeltaBinding(bool enable) { mUniformDeltaBinding = enable; }
+
+    //! If enabled (default) applyUniformSet() skips the uniforms whose value has not changed since the last time they were transmitted.
+    bool uniformDeltaBinding() const { return mUniformDeltaBinding; }
 
     /**
     * Returns the binding index of the given uniform.
@@ -632,6 +649,8 @@ namespace vl
     ref<UniformSet> mUniformSet;
     unsigned int mHandle;
     bool mScheduleLink;
+    int mUniformCacheId;
+    bool mUniformDeltaBinding;
 
     // glProgramParameter
     int mGeometryVerticesOut;
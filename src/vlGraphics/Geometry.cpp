@@ -129,6 +129,8 @@ Geometry& Geometry::deepCopyFrom(const Geometry& other)
     mVertexAttribArrays[i]->setData( other.mVertexAttribArrays[i]->data() ? other.mVertexAttribArrays[i]->data()->clone().get() : NULL );
   }
 
+  mTriangleBVH = NULL;
+
   // primitives
   mDrawCalls.clear();
   for(int i=0; i<other.mDrawCalls.size(); ++i)
@@ -158,6 +160,7 @@ Geometry& Geometry::shallowCopyFrom(const Geometry& other)
   mTexCoordArrays = other.mTexCoordArrays;
   mVertexAttribArrays = other.mVertexAttribArrays;
   mDrawCalls = other.mDrawCalls;
+  mTriangleBVH = NULL;
 
   return *this;
 }
@@ -171,6 +174,20 @@ void Geometry::setVertexArray(ArrayAbstract* data)
   mVertexArray = data;
 }
 //-----------------------------------------------------------------------------
+TriangleBVH* Geometry::triangleBVH()
+{
+  // recompute the bounds so that TriangleBVH::isUpToDate() can compare the bounds-update-tick
+  if (boundsDirty())
+    computeBounds();
+  // a failed build is kept as well so that it is not retried until the Geometry changes
+  if (!mTriangleBVH || !mTriangleBVH->isUpToDate(this))
+  {
+    mTriangleBVH = new TriangleBVH;
+    mTriangleBVH->build(this);
+  }
+  return mTriangleBVH->nodeCount() ? mTriangleBVH.get() : NULL;
+}
+//-----------------------------------------------------------------------------
 void Geometry::setNormalArray(ArrayAbstract* data)
 {
   // if one of this checks fail read the OpenGL Programmers Guide or the Reference Manual 
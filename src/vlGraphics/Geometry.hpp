@@ -45,6 +45,7 @@
 #include <vlGraphics/DrawArrays.hpp>
 #include <vlCore/Collection.hpp>
 #include <vlGraphics/VertexAttribInfo.hpp>
+#include <vlGraphics/TriangleBVH.hpp>
 
 namespace vl
 {
@@ -143,6 +144,16 @@ namespace vl
     /** Deletes all the vertex buffer objects of both vertex arrays and draw calls. */
     virtual void deleteBufferObject();
 
+    /** Returns the TriangleBVH used by RayIntersector, building it if missing or out of date, see TriangleBVH::isUpToDate().
+     * Returns NULL if the Geometry has no vertex positions or no triangles.
+     * \note In-place changes to the vertex positions are detected through ArrayAbstract::bufferChangedTick(), ie. call
+     * setBufferObjectDirty() on the array after them as you would do anyway to update its BufferObject. In-place changes
+     * to the indices of a DrawCall are not tracked, call discardTriangleBVH() after them. */
+    TriangleBVH* triangleBVH();
+
+    /** Releases the cached TriangleBVH, it will be rebuilt by the next triangleBVH() call. */
+    void discardTriangleBVH() { mTriangleBVH = NULL; }
+
     // ------------------------------------------------------------------------
     // Geometry Tools
     // ------------------------------------------------------------------------
@@ -351,6 +362,8 @@ namespace vl
     Collection<TextureArray> mTexCoordArrays;
     // generic vertex attributes
     Collection<VertexAttribInfo> mVertexAttribArrays;
+    // ray intersection acceleration structure
+    ref<TriangleBVH> mTriangleBVH;
   };
   //------------------------------------------------------------------------------
 }
@@ -35,6 +35,7 @@
 #include <vlGraphics/Geometry.hpp>
 #include <vlGraphics/TriangleStripGenerator.hpp>
 #include <vlGraphics/DoubleVertexRemover.hpp>
+#include <vlGraphics/VertexCacheOptimizer.hpp>
 #include <vlCore/LoadWriterManager.hpp>
 
 namespace vl
@@ -57,6 +58,7 @@ namespace vl
       mDiscardOriginalNormals = false;
       mRemoveDoubles          = false;
       mSortVertices           = false;
+      mOptimizeVertexCache    = false;
       mStripfy                = false;
       mConvertToDrawArrays    = false;
     }
@@ -79,6 +81,9 @@ namespace vl
         if (removeDoubles())
           DoubleVertexRemover().removeDoubles(geom[i].get());
 
+        if (optimizeVertexCache())
+          VertexCacheOptimizer().optimize(geom[i].get());
+
         if (sortVertices())
           geom[i]->sortVertices();
 
@@ -119,6 +124,11 @@ namespace vl
     //! Sorts the mesh's vertices for better performances
     bool sortVertices() const { return mSortVertices; }
 
+    //! Reorders the triangles and vertices for vertex cache reuse using VertexCacheOptimizer, an alternative to setStripfy()
+    void setOptimizeVertexCache(bool on) { mOptimizeVertexCache = on; }
+    //! Reorders the triangles and vertices for vertex cache reuse using VertexCacheOptimizer, an alternative to setStripfy()
+    bool optimizeVertexCache() const { return mOptimizeVertexCache; }
+
     //! Convert mesh into a set of triangle strips if possible
     void setStripfy(bool on) { mStripfy = on; }
     //! Convert mesh into a set of triangle strips if possible
@@ -159,6 +169,7 @@ namespace vl
     bool mComputeNormals;
     bool mRemoveDoubles;
     bool mSortVertices;
+    bool mOptimizeVertexCache;
     bool mStripfy;
     bool mConvertToDrawArrays;
     bool mUseDisplayLists;
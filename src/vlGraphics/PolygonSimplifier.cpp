@@ -67,6 +67,444 @@ namespace
   };
 }
 //-----------------------------------------------------------------------------
+namespace
+{
+  typedef PolygonSimplifier::QErr QErr;
+
+  // Indexed binary min-heap of vertex collapse costs, ties are broken by vertex index.
+  class CollapseHeap
+  {
+  public:
+    void init(int vert_count)
+    {
+      mHeap.clear();
+      mHeap.reserve(vert_count);
+      mPos.assign(vert_count, -1);
+      mCost.assign(vert_count, 0.0f);
+    }
+
+    int size() const { return (int)mHeap.size(); }
+
+    int top() const { return mHeap[0]; }
+
+    bool contains(int v) const { return mPos[v] >= 0; }
+
+    //! Inserts \p v or updates its cost if already present.
+    void push(int v, float cost)
+    {
+      if (contains(v))
+      {
+        float old_cost = mCost[v];
+        mCost[v] = cost;
+        if (cost < old_cost)
+          siftUp(mPos[v]);
+        else
+          siftDown(mPos[v]);
+      }
+      else
+      {
+        mCost[v] = cost;
+        mPos[v] = (int)mHeap.size();
+        mHeap.push_back(v);
+        siftUp(mPos[v]);
+      }
+    }
+
+    void remove(int v)
+    {
+      int i = mPos[v];
+      if (i < 0)
+        return;
+      mPos[v] = -1;
+      int last = mHeap.back();
+      mHeap.pop_back();
+      if (last != v)
+      {
+        mHeap[i] = last;
+        mPos[last] = i;
+        siftUp(i);
+        siftDown(mPos[last]);
+      }
+    }
+
+  private:
+    bool less(int a, int b) const { return mCost[a] < mCost[b] || (mCost[a] == mCost[b] && a < b); }
+
+    void siftUp(int i)
+    {
+      int v = mHeap[i];
+      while(i > 0)
+      {
+        int parent = (i - 1) / 2;
+        if (!less(v, mHeap[parent]))
+          break;
+        mHeap[i] = mHeap[parent];
+        mPos[mHeap[i]] = i;
+        i = parent;
+      }
+      mHeap[i] = v;
+      mPos[v] = i;
+    }
+
+    void siftDown(int i)
+    {
+      int v = mHeap[i];
+      int count = (int)mHeap.size();
+      for(;;)
+      {
+        int child = 2*i + 1;
+        if (child >= count)
+          break;
+        if (child + 1 < count && less(mHeap[child+1], mHeap[child]))
+          ++child;
+        if (!less(mHeap[child], v))
+          break;
+        mHeap[i] = mHeap[child];
+        mPos[mHeap[i]] = i;
+        i = child;
+      }
+      mHeap[i] = v;
+      mPos[v] = i;
+    }
+
+  private:
+    std::vector<int> mHeap;
+    std::vector<int> mPos;
+    std::vector<float> mCost;
+  };
+
+  // The mesh used by PolygonSimplifier::simplifyCompact(): flat per-vertex and per-triangle arrays and
+  // vertex/triangle incidence lists stored in a single pool, each list having its own slack.
+  class CompactMesh
+  {
+  public:
+    CompactMesh(): mMarkStamp(0) {}
+
+    void setup(const std::vector<fvec3>& in_verts, const std::vector<int>& in_tris)
+    {
+      const int vert_count = (int)in_verts.size();
+      const int tri_count  = (int)in_tris.size() / 3;
+
+      mPositions   = in_verts;
+      mTris.assign(in_tris.begin(), in_tris.begin() + tri_count*3);
+      mNormals.resize(tri_count);
+      mTriRemoved.assign(tri_count, 0);
+      mVertRemoved.assign(vert_count, 0);
+      mProtected.assign(vert_count, 0);
+      mQErr.assign(vert_count, QErr());
+      mCollapseVertex.assign(vert_count, -1);
+      mCollapseCost.assign(vert_count, 1.0e+38f);
+      mCollapsePosition.resize(vert_count);
+      mMark.assign(vert_count, 0);
+      mEdgeCount.resize(vert_count);
+      mBorderTri.resize(vert_count);
+
+      // incidence lists, laid out like a CSR
+      mIncBegin.assign(vert_count, 0);
+      mIncCount.assign(vert_count, 0);
+      mIncCapacity.assign(vert_count, 0);
+      for(int i=0; i<tri_count*3; ++i)
+        ++mIncCapacity[ mTris[i] ];
+      int offset = 0;
+      for(int v=0; v<vert_count; ++v)
+      {
+        mIncBegin[v] = offset;
+        offset += mIncCapacity[v];
+      }
+      mIncPool.resize(offset);
+      mIncPool.reserve(offset + offset / 2);
+      for(int t=0; t<tri_count; ++t)
+        for(int i=0; i<3; ++i)
+        {
+          int v = mTris[t*3+i];
+          mIncPool[ mIncBegin[v] + mIncCount[v]++ ] = t;
+        }
+
+      // normals and quadrics
+      for(int t=0; t<tri_count; ++t)
+      {
+        computeNormal(t);
+        const fvec3& a = mPositions[mTris[t*3+0]];
+        dvec3 n = (dvec3)mNormals[t];
+        double d = -dot((dvec3)a, n);
+        float area = cross(mPositions[mTris[t*3+1]] - a, mPositions[mTris[t*3+2]] - a).length() * 0.5f;
+        QErr qerr(n, d, area * (1.0 / 3.0));
+        mQErr[mTris[t*3+0]] += qerr;
+        mQErr[mTris[t*3+1]] += qerr;
+        mQErr[mTris[t*3+2]] += qerr;
+      }
+
+      // vertices without triangles are not part of the mesh
+      for(int v=0; v<vert_count; ++v)
+        mVertRemoved[v] = mIncCount[v] == 0;
+    }
+
+    void computeNormal(int t)
+    {
+      const fvec3& a = mPositions[mTris[t*3+0]];
+      mNormals[t] = cross(mPositions[mTris[t*3+1]] - a, mPositions[mTris[t*3+2]] - a);
+      mNormals[t].normalize();
+    }
+
+    // adds to the quadric of the vertex the penalty of its border edges, see PolygonSimplifier::Vertex::computeEdgePenalty()
+    void computeEdgePenalty(int v)
+    {
+      ++mMarkStamp;
+      mRing.clear();
+      for(int i=0; i<mIncCount[v]; ++i)
+      {
+        int t = mIncPool[mIncBegin[v] + i];
+        for(int j=0; j<3; ++j)
+        {
+          int w = mTris[t*3+j];
+          if (w == v)
+            continue;
+          if (mMark[w] != mMarkStamp)
+          {
+            mMark[w] = mMarkStamp;
+            mEdgeCount[w] = 0;
+            mRing.push_back(w);
+          }
+          ++mEdgeCount[w];
+          mBorderTri[w] = t;
+        }
+      }
+      for(size_t i=0; i<mRing.size(); ++i)
+      {
+        int w = mRing[i];
+        if (mEdgeCount[w] == 1)
+        {
+          fvec3 edge = mPositions[v] - mPositions[w];
+          dvec3 n = (dvec3)cross(mNormals[mBorderTri[w]], edge);
+          n.normalize();
+          double d = -dot(n, (dvec3)mPositions[v]);
+          mQErr[v] += QErr(n, d, dot(edge, edge) * 1.0);
+        }
+      }
+    }
+
+    // collects in "ring" the vertices sharing a triangle with "a" or "b", except "a"
+    void gatherRing(int a, int b, std::vector<int>& ring)
+    {
+      ++mMarkStamp;
+      ring.clear();
+      mMark[a] = mMarkStamp;
+      const int verts[] = { a, b };
+      for(int k=0; k<2; ++k)
+      {
+        int v = verts[k];
+        if (v < 0)
+          continue;
+        for(int i=0; i<mIncCount[v]; ++i)
+        {
+          int t = mIncPool[mIncBegin[v] + i];
+          for(int j=0; j<3; ++j)
+          {
+            int w = mTris[t*3+j];
+            if (mMark[w] != mMarkStamp)
+            {
+              mMark[w] = mMarkStamp;
+              ring.push_back(w);
+            }
+          }
+        }
+      }
+    }
+
+    // returns true if moving "v" to "solution" flips one of its triangles not shared with "u"
+    bool folds(int v, int u, const dvec3& solution) const
+    {
+      for(int i=0; i<mIncCount[v]; ++i)
+      {
+        int t = mIncPool[mIncBegin[v] + i];
+        const int* tri = &mTris[t*3];
+        if (tri[0] == u || tri[1] == u || tri[2] == u)
+          continue;
+        int e0, e1;
+        if (tri[0] == v)      { e0 = tri[1]; e1 = tri[2]; }
+        else if (tri[1] == v) { e0 = tri[0]; e1 = tri[2]; }
+        else                  { e0 = tri[0]; e1 = tri[1]; }
+        fvec3 edge = mPositions[e1] - mPositions[e0];
+        fvec3 n = cross(edge, mNormals[t]);
+        n.normalize();
+        float d1 = dot(mPositions[v] - mPositions[e0], n);
+        float d2 = dot((fvec3)solution - mPositions[e0], n);
+        if (d1 * d2 < 0)
+          return true;
+      }
+      return false;
+    }
+
+    // same cost function as PolygonSimplifier::computeCollapseInfo()
+    void computeCollapseInfo(int v, bool quick)
+    {
+      mCollapseCost[v] = 1.0e+38f;
+      mCollapseVertex[v] = -1;
+      gatherRing(v, -1, mRing);
+      for(size_t iadj=0; iadj<mRing.size(); ++iadj)
+      {
+        int u = mRing[iadj];
+        QErr qe = mQErr[v];
+        qe += mQErr[u];
+        double cost = 0.0;
+        dvec3 solution;
+        if (quick)
+        {
+          solution = ((dvec3)mPositions[v] + (dvec3)mPositions[u]) * 0.5;
+          cost = qe.evaluate( solution );
+        }
+        else
+        {
+          if ( qe.analyticSolution(solution) )
+            cost = qe.evaluate(solution);
+          else
+          {
+            dvec3 a = (dvec3)mPositions[v];
+            dvec3 b = (dvec3)mPositions[u];
+            dvec3 c = (a+b) * 0.5;
+            double ae = qe.evaluate(a);
+            double be = qe.evaluate(b);
+            double ce = qe.evaluate(c);
+            if (ae < be && ae < ce)
+            {
+              solution = a;
+              cost = ae;
+            }
+            else
+            if (be < ae && be < ce)
+            {
+              solution = b;
+              cost = be;
+            }
+            else
+            {
+              solution = c;
+              cost = ce;
+            }
+          }
+
+          // non acceptable solution, assign very high cost
+          if ( folds(v, u, solution) || folds(u, v, solution) )
+            cost = 1.0e+37f;
+        }
+
+        // to correctly simplify planar and cylindrical regions
+        cost += ((dvec3)mPositions[v] - solution).length() * 1.0e-12;
+
+        VL_CHECK( cost == cost )
+        if ( cost < mCollapseCost[v] )
+        {
+          mCollapseCost[v]     = (float)cost;
+          mCollapseVertex[v]   = u;
+          mCollapsePosition[v] = (fvec3)solution;
+        }
+      }
+    }
+
+    void addIncidentTriangle(int v, int t)
+    {
+      if (mIncCount[v] == mIncCapacity[v])
+      {
+        // relocate the list at the end of the pool with some slack
+        int capacity = std::max(8, mIncCapacity[v] * 2);
+        int begin = (int)mIncPool.size();
+        mIncPool.resize(begin + capacity);
+        std::copy(mIncPool.begin() + mIncBegin[v], mIncPool.begin() + mIncBegin[v] + mIncCount[v], mIncPool.begin() + begin);
+        mIncBegin[v] = begin;
+        mIncCapacity[v] = capacity;
+      }
+      mIncPool[ mIncBegin[v] + mIncCount[v]++ ] = t;
+    }
+
+    void discardRemovedTriangles(int v)
+    {
+      int* inc = &mIncPool[mIncBegin[v]];
+      int count = 0;
+      for(int i=0; i<mIncCount[v]; ++i)
+        if (!mTriRemoved[inc[i]])
+          inc[count++] = inc[i];
+      mIncCount[v] = count;
+      // vertices without triangles are removed
+      if (!count)
+        mVertRemoved[v] = 1;
+    }
+
+    // collapses "v" on its collapse vertex, "ring" must contain the vertices around "v"
+    void collapse(int v, const std::vector<int>& ring, bool quick)
+    {
+      const int u = mCollapseVertex[v];
+      // no adjacent vertex to collapse on
+      if (u < 0)
+        return;
+      VL_CHECK( !mVertRemoved[u] )
+
+      mVertRemoved[v] = 1;
+      mPositions[u] = mCollapsePosition[v];
+      mQErr[u] += mQErr[v];
+
+      for(int i=0; i<mIncCount[v]; ++i)
+      {
+        int t = mIncPool[mIncBegin[v] + i];
+        int* tri = &mTris[t*3];
+        if (tri[0] == u || tri[1] == u || tri[2] == u)
+          mTriRemoved[t] = 1;
+        else
+        {
+          for(int j=0; j<3; ++j)
+            if (tri[j] == v)
+              tri[j] = u;
+          addIncidentTriangle(u, t);
+        }
+      }
+      mIncCount[v] = 0;
+
+      for(size_t i=0; i<ring.size(); ++i)
+        if (!mVertRemoved[ring[i]])
+          discardRemovedTriangles(ring[i]);
+
+      // update the normals, used to compute anti-folding
+      if (!quick && !mVertRemoved[u])
+        for(int i=0; i<mIncCount[u]; ++i)
+          computeNormal(mIncPool[mIncBegin[u] + i]);
+    }
+
+  public:
+    std::vector<fvec3> mPositions;
+    std::vector<QErr> mQErr;
+    std::vector<int> mTris;
+    std::vector<fvec3> mNormals;
+    std::vector<unsigned char> mTriRemoved;
+    std::vector<unsigned char> mVertRemoved;
+    std::vector<unsigned char> mProtected;
+    // vertex/triangle incidence
+    std::vector<int> mIncBegin;
+    std::vector<int> mIncCount;
+    std::vector<int> mIncCapacity;
+    std::vector<int> mIncPool;
+    // collapse info
+    std::vector<int> mCollapseVertex;
+    std::vector<float> mCollapseCost;
+    std::vector<fvec3> mCollapsePosition;
+    // scratch data
+    std::vector<int> mMark;
+    std::vector<int> mEdgeCount;
+    std::vector<int> mBorderTri;
+    std::vector<int> mRing;
+    int mMarkStamp;
+  };
+
+  ref<Geometry> createOutputGeometry(const Geometry* input, ArrayFloat3* verts, DrawElementsUInt* de)
+  {
+    ref<Geometry> geom = new Geometry;
+    if (input && !input->vertexArray() && input->vertexAttribArray(vl::VA_Position))
+      geom->setVertexAttribArray( vl::VA_Position, verts );
+    else
+      geom->setVertexArray( verts );
+    geom->drawCalls()->push_back( de );
+    return geom;
+  }
+}
+//-----------------------------------------------------------------------------
 void PolygonSimplifier::simplify()
 {
   if (!mInput)
@@ -154,6 +592,12 @@ void PolygonSimplifier::simplify(const std::vector<fvec3>& in_verts, const std::
   std::sort(mTargets.begin(), mTargets.end());
   std::reverse(mTargets.begin(), mTargets.end());
 
+  if (compactMode())
+  {
+    simplifyCompact(in_verts, in_tris);
+    return;
+  }
+
   mSimplifiedVertices.clear();
   mSimplifiedTriangles.clear();
   mProtectedVerts.clear();
@@ -401,12 +845,7 @@ void PolygonSimplifier::outputSimplifiedGeometry()
   VL_CHECK(ptr == de->indexBuffer()->end());
 
   // output geometry
-  mOutput.push_back( new Geometry );
-  if (mInput->vertexArray())
-    mOutput.back()->setVertexArray( arr_f3.get() );
-  else
-    mOutput.back()->setVertexAttribArray( vl::VA_Position, arr_f3.get() );
-  mOutput.back()->drawCalls()->push_back( de.get() );
+  mOutput.push_back( createOutputGeometry(mInput.get(), arr_f3.get(), de.get()) );
 }
 //-----------------------------------------------------------------------------
 void PolygonSimplifier::clearTrianglesAndVertices()
@@ -418,3 +857,132 @@ void PolygonSimplifier::clearTrianglesAndVertices()
   mVertexLump.clear();
 }
 //-----------------------------------------------------------------------------
+void PolygonSimplifier::simplifyCompact(const std::vector<fvec3>& in_verts, const std::vector<int>& in_tris)
+{
+  Time timer;
+  timer.start();
+
+  mSimplifiedVertices.clear();
+  mSimplifiedTriangles.clear();
+  mTriangleLump.clear();
+  mVertexLump.clear();
+
+  const int polys_before = (int)in_tris.size() / 3;
+  const int verts_before = (int)in_verts.size();
+
+  CompactMesh mesh;
+  mesh.setup(in_verts, in_tris);
+
+  for(int i=0; i<(int)mProtectedVerts.size(); ++i)
+  {
+    VL_CHECK(mProtectedVerts[i] < verts_before)
+    if (mProtectedVerts[i] >= 0 && mProtectedVerts[i] < verts_before)
+      mesh.mProtected[ mProtectedVerts[i] ] = 1;
+  }
+
+  // compute the edge penalties first so that the collapse info sees the final quadrics
+  for(int v=0; v<verts_before; ++v)
+    if (!mesh.mVertRemoved[v])
+      mesh.computeEdgePenalty(v);
+
+  CollapseHeap heap;
+  heap.init(verts_before);
+  for(int v=0; v<verts_before; ++v)
+  {
+    if (!mesh.mVertRemoved[v] && !mesh.mProtected[v])
+    {
+      mesh.computeCollapseInfo(v, quick());
+      heap.push(v, mesh.mCollapseCost[v]);
+    }
+  }
+
+  if (verbose())
+    Log::print(Say("database setup = %.3n\n") << timer.elapsed() );
+
+  std::vector<int> ring;
+  std::vector<int> simplified_index(verts_before);
+  for(size_t itarget=0; itarget<mTargets.size(); ++itarget)
+  {
+    const int target_vertex_count = mTargets[itarget];
+
+    if (target_vertex_count < 3)
+    {
+      Log::print(Say("Invalid target_vertex_count = %n\n") << target_vertex_count);
+      return;
+    }
+
+    timer.start(1);
+
+    while( heap.size() > target_vertex_count )
+    {
+      int v = heap.top();
+      // vertices without adjacent vertices have the highest cost: none of the remaining ones can be collapsed
+      if ( mesh.mCollapseVertex[v] < 0 )
+        break;
+      heap.remove(v);
+
+      // the vertices around v and its collapse vertex need their collapse info updated
+      mesh.gatherRing(v, mesh.mCollapseVertex[v], ring);
+
+      mesh.collapse(v, ring, quick());
+
+      for(size_t i=0; i<ring.size(); ++i)
+      {
+        int w = ring[i];
+        if (mesh.mVertRemoved[w])
+          heap.remove(w);
+        else
+        if (!mesh.mProtected[w])
+        {
+          mesh.computeCollapseInfo(w, quick());
+          heap.push(w, mesh.mCollapseCost[w]);
+        }
+      }
+    }
+
+    if (verbose())
+      Log::print(Say("simplification = %.3ns (%.3ns)\n") << timer.elapsed() << timer.elapsed(1) );
+
+    // regenerate vertex buffer & generate indices for index buffer
+    int vert_count = 0;
+    for(int v=0; v<verts_before; ++v)
+      simplified_index[v] = mesh.mVertRemoved[v] ? -1 : vert_count++;
+    ref<ArrayFloat3> arr_f3 = new ArrayFloat3;
+    arr_f3->resize(vert_count);
+    for(int v=0; v<verts_before; ++v)
+      if (simplified_index[v] >= 0)
+        arr_f3->at(simplified_index[v]) = mesh.mPositions[v];
+
+    size_t index_count = 0;
+    for(int t=0; t<polys_before; ++t)
+      index_count += mesh.mTriRemoved[t] ? 0 : 3;
+    ref<DrawElementsUInt> de = new DrawElementsUInt(PT_TRIANGLES);
+    de->indexBuffer()->resize(index_count);
+    DrawElementsUInt::index_type* ptr = de->indexBuffer()->begin();
+    for(int t=0; t<polys_before; ++t)
+    {
+      if (!mesh.mTriRemoved[t])
+      {
+        for(int j=0; j<3; ++j)
+        {
+          VL_CHECK( simplified_index[mesh.mTris[t*3+j]] >= 0 )
+          ptr[j] = simplified_index[mesh.mTris[t*3+j]];
+        }
+        ptr += 3;
+      }
+    }
+    VL_CHECK(ptr == de->indexBuffer()->end());
+
+    mOutput.push_back( createOutputGeometry(mInput.get(), arr_f3.get(), de.get()) );
+  }
+
+  if (verbose() && !output().empty())
+  {
+    float elapsed = (float)timer.elapsed();
+    int polys_after = output().back()->drawCalls()->at(0)->countTriangles();
+    int verts_after = output().back()->vertexArray() ? (int)output().back()->vertexArray()->size() : (int)output().back()->vertexAttribArray(VA_Position)->data()->size();
+    Log::print(Say("POLYS: %n -> %n, %.2n%%, %.1nT/s\n") << polys_before << polys_after << 100.0f*verts_after/verts_before << (polys_before - polys_after)/elapsed );
+    Log::print(Say("VERTS: %n -> %n, %.2n%%, %.1nV/s\n") << verts_before << verts_after << 100.0f*verts_after/verts_before << (verts_before - verts_after)/elapsed );
+  }
+}
+//-----------------------------------------------------------------------------
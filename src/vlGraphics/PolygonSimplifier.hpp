@@ -48,6 +48,12 @@ namespace vl
   /**
    * The PolygonSimplifier class reduces the amount of polygons present in a Geometry using a quadric error metric.
    * The algorithm simplifies only the position array of the Geometry all the other vertex attributes will be discarded.
+   *
+   * When compactMode() is enabled the simplification is performed on flat arrays: vertex positions and quadrics, a triangle index
+   * array and the vertex/triangle incidence lists stored in a single pool. The vertices are kept in an indexed min-heap 
+   * ordered by collapse cost, so only the vertices around a collapse are re-queued and nothing is allocated per vertex.
+   * In this mode the Vertex and Triangle objects returned by simplifiedVertices() and simplifiedTriangles() are not generated.
+   * All the LODs specified by targets() are generated in one pass in both modes.
   */
   class VLGRAPHICS_EXPORT PolygonSimplifier: public Object
   {
@@ -318,7 +324,7 @@ namespace vl
     };
 
   public:
-    PolygonSimplifier(): mRemoveDoubles(false), mVerbose(true), mQuick(true) {}
+    PolygonSimplifier(): mRemoveDoubles(false), mVerbose(true), mQuick(true), mCompactMode(false) {}
 
     void simplify();
     void simplify(const std::vector<fvec3>& in_verts, const std::vector<int>& in_tris);
@@ -352,8 +358,14 @@ namespace vl
     bool quick() const { return mQuick; }
     void setQuick(bool quick) { mQuick = quick; }
 
+    //! If true the simplification uses compact arrays and an indexed heap instead of the Vertex and Triangle objects. Disabled by default.
+    bool compactMode() const { return mCompactMode; }
+    //! If true the simplification uses compact arrays and an indexed heap instead of the Vertex and Triangle objects. Disabled by default.
+    void setCompactMode(bool compact) { mCompactMode = compact; }
+
   protected:
     void outputSimplifiedGeometry();
+    void simplifyCompact(const std::vector<fvec3>& in_verts, const std::vector<int>& in_tris);
     inline void collapse(Vertex* v);
     inline void computeCollapseInfo(Vertex* v);
 
@@ -367,6 +379,7 @@ namespace vl
     bool mRemoveDoubles;
     bool mVerbose;
     bool mQuick;
+    bool mCompactMode;
 
   private:
     std::vector<Triangle> mTriangleLump;
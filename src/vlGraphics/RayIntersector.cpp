@@ -31,6 +31,7 @@
 
 #include <vlGraphics/RayIntersector.hpp>
 #include <vlGraphics/SceneManager.hpp>
+#include <limits>
 
 using namespace vl;
 
@@ -66,6 +67,15 @@ void RayIntersector::intersect(Actor* act)
 //-----------------------------------------------------------------------------
 void RayIntersector::intersectGeometry(Actor* act, Geometry* geom)
 {
+  if (useTriangleBVH())
+  {
+    TriangleBVH* bvh = geom->triangleBVH();
+    if (bvh)
+      intersectTriangleBVH(act, geom, bvh);
+    return;
+  }
+
+  size_t first = mIntersections.size();
   ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
   if (posarr)
   {
@@ -92,6 +102,55 @@ void RayIntersector::intersectGeometry(Actor* act, Geometry* geom)
       }
     }
   }
+
+  // keep only the closest intersection of this Geometry
+  if (closestHitOnly() && mIntersections.size() > first)
+  {
+    size_t closest = first;
+    for(size_t i=first+1; i<mIntersections.size(); ++i)
+      if (mIntersections[i]->distance() < mIntersections[closest]->distance())
+        closest = i;
+    mIntersections[first] = mIntersections[closest];
+    mIntersections.resize(first+1);
+  }
+}
+//-----------------------------------------------------------------------------
+void RayIntersector::intersectTriangleBVH(Actor* act, Geometry* geom, TriangleBVH* bvh)
+{
+  // the BVH is in object space: transform the ray instead of the triangles, 
+  // the ray parameter t is preserved so the distances are the same as in world space.
+  fvec3 orig = (fvec3)ray().origin();
+  fvec3 dir  = (fvec3)ray().direction();
+  if (act->transform())
+  {
+    mat4 inverse = act->transform()->worldMatrix().getInverse();
+    orig = (fvec3)(inverse * ray().origin());
+    dir  = (fvec3)(inverse * vec4(ray().direction(), 0)).xyz();
+  }
+
+  std::vector<TriangleBVH::Hit> hits;
+  if (closestHitOnly())
+  {
+    TriangleBVH::Hit hit;
+    if (bvh->intersectClosest(orig, dir, std::numeric_limits<float>::max(), hit))
+      hits.push_back(hit);
+  }
+  else
+    bvh->intersectAll(orig, dir, std::numeric_limits<float>::max(), hits);
+
+  for(size_t i=0; i<hits.size(); ++i)
+  {
+    const int* tri = bvh->triangleIndices(hits[i].triangle);
+    ref<RayIntersectionGeometry> record = new vl::RayIntersectionGeometry;
+    record->setIntersectionPoint( ray().origin() + ray().direction() * (real)hits[i].t );
+    record->setTriangleIndex( bvh->triangleDrawCallIndex(hits[i].triangle) );
+    record->setTriangle( tri[0], tri[1], tri[2] );
+    record->setActor(act);
+    record->setGeometry(geom);
+    record->setPrimitives( bvh->triangleDrawCall(hits[i].triangle) );
+    record->setDistance( hits[i].t );
+    mIntersections.push_back(record);
+  }
 }
 //-----------------------------------------------------------------------------
 template<class T>
@@ -129,13 +129,17 @@ namespace vl
   // RayIntersector
   //-----------------------------------------------------------------------------
   /** The RayIntersector class is used to detect the intersection points between a Ray and a set of Actor[s]
+   *
+   * By default the triangles of each Geometry are tested through the TriangleBVH returned by Geometry::triangleBVH(),
+   * which is built the first time a Geometry is intersected and then kept cached. For a one-shot test on a Geometry that
+   * changes every frame you may want to disable it with setUseTriangleBVH(false) to avoid the construction cost.
    */
   class VLGRAPHICS_EXPORT RayIntersector: public Object
   {
     VL_INSTRUMENT_CLASS(vl::RayIntersector, Object)
 
   public:
-    RayIntersector()
+    RayIntersector(): mUseTriangleBVH(true), mClosestHitOnly(false)
     {
       VL_DEBUG_SET_OBJECT_NAME()
       mActors = new ActorCollection;
@@ -159,6 +163,17 @@ namespace vl
     //! The intersection points detected by the last intersect() call sorted according to their distance (the first one is the closest).
     const std::vector< ref<RayIntersection> >& intersections() const { return mIntersections; }
 
+    //! Whether the triangles are tested through the cached Geometry::triangleBVH() or one by one, true by default.
+    void setUseTriangleBVH(bool use) { mUseTriangleBVH = use; }
+    //! Whether the triangles are tested through the cached Geometry::triangleBVH() or one by one, true by default.
+    bool useTriangleBVH() const { return mUseTriangleBVH; }
+
+    //! If true only the closest intersection of each Geometry is reported instead of all of them, false by default.
+    //! This is all you need for picking and is much faster when the ray crosses many triangles.
+    void setClosestHitOnly(bool closest) { mClosestHitOnly = closest; }
+    //! If true only the closest intersection of each Geometry is reported instead of all of them, false by default.
+    bool closestHitOnly() const { return mClosestHitOnly; }
+
     /** Executes the intersection test.
      * \note Before calling this function the transforms and the bounding volumes of the Actor[s] to be intersected must be updated, in this order.
      * \note All the intersections are mande on the Actor's LOD level #0.
@@ -181,6 +196,7 @@ namespace vl
 
     void intersect(Actor* act);
     void intersectGeometry(Actor* act, Geometry* geom);
+    void intersectTriangleBVH(Actor* act, Geometry* geom, TriangleBVH* bvh);
 
     // T should be either fvec3-4 or dvec3-4
     template<class T>
@@ -191,6 +207,8 @@ namespace vl
     std::vector< ref<RayIntersection> > mIntersections;
     ref<ActorCollection> mActors;
     Ray mRay;
+    bool mUseTriangleBVH;
+    bool mClosestHitOnly;
   };
 }
 
@@ -0,0 +1,324 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/RenderQueue.hpp>
+#include <algorithm>
+
+using namespace vl;
+
+namespace
+{
+  class SortItemLess
+  {
+  public:
+    template<class T>
+    bool operator()(const T& a, const T& b) const { return a.mKey < b.mKey; }
+  };
+
+  //! Compares the SortItem-s using the RenderQueueSorter, used when the sort keys are not available.
+  class SortItemTokenLess
+  {
+  public:
+    SortItemTokenLess(const RenderQueueSorter* sorter, RenderToken* const* tokens): mSorter(sorter), mTokens(tokens) {}
+    template<class T>
+    bool operator()(const T& a, const T& b) const { return mSorter->operator()(mTokens[a.mIndex], mTokens[b.mIndex]); }
+  protected:
+    const RenderQueueSorter* mSorter;
+    RenderToken* const* mTokens;
+  };
+
+  //! How many Actors of the previous frame sortCoherent() looks ahead to find the Actors that left the queue.
+  const int CoherenceLookAhead = 16;
+}
+//------------------------------------------------------------------------------
+void RenderQueue::computeCameraDistances(RenderQueueSorter* sorter, Camera* camera)
+{
+  if (sorter->mightNeedZCameraDistance())
+  {
+    for(int i=0; i<size(); ++i)
+    {
+      RenderToken* tok = at(i);
+      vec3 center = tok->mRenderable->boundingBox().isNull() ? vec3(0,0,0) : tok->mRenderable->boundingBox().center();
+      if ( sorter->confirmZCameraDistanceNeed(tok) )
+      {
+        if (tok->mActor->transform())
+          // tok->mCameraDistance = ( camera->viewMatrix() * (tok->mActor->transform()->worldMatrix() * center) ).lengthSquared();
+          tok->mCameraDistance = -( camera->viewMatrix() * (tok->mActor->transform()->worldMatrix() * center) ).z();
+        else
+          // tok->mCameraDistance = ( camera->viewMatrix() * /* I* */ center ).lengthSquared();
+          tok->mCameraDistance = -( camera->viewMatrix() * /* I* */ center ).z();
+      }
+      else
+        tok->mCameraDistance = 0;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+bool RenderQueue::computeSortKeys(RenderQueueSorter* sorter)
+{
+  if (size() <= 1 || !sorter->sortKeyEnabled())
+    return false;
+
+  mSortTokens.resize(size());
+  for(int i=0; i<size(); ++i)
+    mSortTokens[i] = mList[i].get();
+  return sorter->computeSortKeys(&mSortTokens[0], size());
+}
+//------------------------------------------------------------------------------
+void RenderQueue::sort(RenderQueueSorter* sorter, Camera* camera)
+{
+  VL_CHECK( sorter )
+
+  computeCameraDistances(sorter, camera);
+
+  if ( computeSortKeys(sorter) )
+  {
+    const int count = size();
+    mSortItems.resize(count);
+    mSortItemsTmp.resize(count);
+    for(int i=0; i<count; ++i)
+    {
+      mSortItems[i].mKey   = mSortTokens[i]->mSortKey;
+      mSortItems[i].mIndex = i;
+    }
+    if ( radixSort(&mSortItems[0], &mSortItemsTmp[0], count) != &mSortItems[0] )
+      mSortItems.swap(mSortItemsTmp);
+    applySortItems();
+  }
+  else
+    std::sort( mList.begin(), mList.begin() + size(), Sorter( sorter ) );
+}
+//------------------------------------------------------------------------------
+void RenderQueue::sortCoherent(RenderQueueSorter* sorter, Camera* camera)
+{
+  VL_CHECK( sorter )
+
+  if ( sorter != mCoherenceSorter )
+    resetCoherence();
+  mCoherenceSorter = sorter;
+
+  computeCameraDistances(sorter, camera);
+
+  if (size() <= 1)
+  {
+    resetCoherence();
+    return;
+  }
+
+  const bool use_keys = computeSortKeys(sorter);
+  const int count = size();
+  const int prev_count = (int)mCoherenceActors.size();
+  mSortTokens.resize(count);
+  mSortItems.resize(count);
+  mSortItemsTmp.resize(count);
+  mSortActors.resize(count);
+
+  // gather the keys and the Actors in queue order
+  for(int i=0; i<count; ++i)
+  {
+    mSortTokens[i] = mList[i].get();
+    mSortItemsTmp[i].mKey   = use_keys ? mSortTokens[i]->mSortKey : 0;
+    mSortItemsTmp[i].mIndex = i;
+    mSortActors[i] = mSortTokens[i]->mActor->serialNumber();
+  }
+
+  // Match the queued Actors against last frame's ones, which were queued in a very similar order: the Actors that left
+  // the queue are skipped looking a few Actors ahead, the ones not found are considered as entering the queue.
+  // mCoherenceSlots[p] is the token that takes the sorted position p of the previous frame.
+
+  SortItem* items = &mSortItems[0];
+  mCoherenceSlots.assign(prev_count, -1);
+  int kept_count = 0;
+  int entering_count = 0;
+  for(int i=0, j=0; i<count; ++i)
+  {
+    int match = -1;
+    for(int k=j; k<prev_count && k<=j+CoherenceLookAhead; ++k)
+    {
+      if (mCoherenceActors[k] == mSortActors[i])
+      {
+        match = k;
+        break;
+      }
+    }
+    if (match != -1)
+    {
+      mCoherenceSlots[ mCoherencePositions[match] ] = i;
+      j = match + 1;
+      ++kept_count;
+    }
+    else
+      // the entering tokens are temporarily stored at the end of mSortItems in reverse order
+      items[count - 1 - entering_count++] = mSortItemsTmp[i];
+  }
+
+  // arrange the kept tokens in last frame's order
+
+  for(int p=0, w=0; p<prev_count; ++p)
+  {
+    if (mCoherenceSlots[p] != -1)
+      items[w++] = mSortItemsTmp[ mCoherenceSlots[p] ];
+  }
+
+  if (use_keys)
+    mergeDisplaced(kept_count, SortItemLess(), true);
+  else
+    mergeDisplaced(kept_count, SortItemTokenLess(sorter, &mSortTokens[0]), false);
+
+  recordCoherence();
+  applySortItems();
+}
+//------------------------------------------------------------------------------
+template<class Less>
+void RenderQueue::mergeDisplaced(int kept_count, const Less& less, bool use_keys)
+{
+  // Extracts the tokens that are out of order, sorts them together with the entering ones and merges them back.
+  // The first kept_count items are in last frame's order, the entering ones are at the end of mSortItems in reverse order.
+
+  const int count = size();
+  SortItem* items = &mSortItems[0];
+  SortItem* displaced = &mSortItemsTmp[0];
+
+  // Keep a sorted subsequence of the items in place and move the others to 'displaced'. When an item is smaller
+  // than the last kept one both are removed: the number of removed items is at most twice the minimum number of
+  // items that need to be removed to make the sequence sorted.
+  int sorted_count = 0;
+  int displaced_count = 0;
+  for(int i=0; i<kept_count; ++i)
+  {
+    if (sorted_count && less(items[i], items[sorted_count-1]))
+    {
+      displaced[displaced_count++] = items[--sorted_count];
+      displaced[displaced_count++] = items[i];
+    }
+    else
+      items[sorted_count++] = items[i];
+  }
+  std::reverse_copy(items + kept_count, items + count, displaced + displaced_count);
+  displaced_count += count - kept_count;
+
+  if (use_keys)
+  {
+    // the tail of mSortItems is free and can be used as scratch buffer
+    SortItem* sorted_displaced = radixSort(displaced, items + sorted_count, displaced_count);
+    if (sorted_displaced != displaced)
+      std::copy(sorted_displaced, sorted_displaced + displaced_count, displaced);
+  }
+  else
+    std::stable_sort(displaced, displaced + displaced_count, less);
+
+  // merge backwards in place: the displaced tokens go after the kept ones with the same key
+  int ikept = sorted_count - 1;
+  int idisp = displaced_count - 1;
+  for(int w = count - 1; idisp >= 0; --w)
+  {
+    if (ikept >= 0 && less(displaced[idisp], items[ikept]))
+      items[w] = items[ikept--];
+    else
+      items[w] = displaced[idisp--];
+  }
+}
+//------------------------------------------------------------------------------
+void RenderQueue::resetCoherence()
+{
+  mCoherenceSorter = NULL;
+  mCoherenceActors.clear();
+  mCoherencePositions.clear();
+  mSortActors.clear();
+}
+//------------------------------------------------------------------------------
+void RenderQueue::recordCoherence()
+{
+  const int count = size();
+  mCoherenceActors.swap(mSortActors);
+  mCoherencePositions.resize(count);
+  for(int p=0; p<count; ++p)
+    mCoherencePositions[ mSortItems[p].mIndex ] = p;
+}
+//------------------------------------------------------------------------------
+void RenderQueue::applySortItems()
+{
+  // write the sorted tokens followed by the unused ones in mSortList and swap it with mList
+  const int count = size();
+  mSortList.resize(mList.size());
+  for(int i=0; i<count; ++i)
+    mSortList[i] = mSortTokens[ mSortItems[i].mIndex ];
+  for(size_t i=count; i<mList.size(); ++i)
+    mSortList[i] = mList[i];
+  mList.swap(mSortList);
+}
+//------------------------------------------------------------------------------
+RenderQueue::SortItem* RenderQueue::radixSort(SortItem* items, SortItem* tmp, int count)
+{
+  if (count < 256)
+  {
+    // small queues: a stable comparison sort is cheaper than the radix passes
+    std::stable_sort( items, items + count, SortItemLess() );
+    return items;
+  }
+
+  // LSD radix sort, 8 bits per pass: the histograms of all the passes are computed at once.
+  std::vector<int> histograms(8 * 256, 0);
+  for(int i=0; i<count; ++i)
+  {
+    u64 key = items[i].mKey;
+    for(int pass=0; pass<8; ++pass, key >>= 8)
+      ++histograms[pass * 256 + (int)(key & 0xFF)];
+  }
+
+  SortItem* src = items;
+  SortItem* dst = tmp;
+  for(int pass=0; pass<8; ++pass)
+  {
+    int* histogram = &histograms[pass * 256];
+    const int shift = pass * 8;
+
+    // skip the passes in which all the keys have the same digit
+    if ( histogram[ (src[0].mKey >> shift) & 0xFF ] == count )
+      continue;
+
+    int offset = 0;
+    for(int digit=0; digit<256; ++digit)
+    {
+      int digit_count = histogram[digit];
+      histogram[digit] = offset;
+      offset += digit_count;
+    }
+
+    for(int i=0; i<count; ++i)
+      dst[ histogram[ (src[i].mKey >> shift) & 0xFF ]++ ] = src[i];
+
+    std::swap(src, dst);
+  }
+
+  return src;
+}
+//------------------------------------------------------------------------------
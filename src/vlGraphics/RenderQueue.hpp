@@ -42,12 +42,12 @@ namespace vl
   /**
    * The RenderQueue class collects a list of RenderToken objects to be sorted and rendered.
   */
-  class RenderQueue: public Object
+  class VLGRAPHICS_EXPORT RenderQueue: public Object
   {
     VL_INSTRUMENT_CLASS(vl::RenderQueue, Object)
 
   public:
-    RenderQueue(): mSize(0), mSizeMP(0)
+    RenderQueue(): mSize(0), mSizeMP(0), mCoherenceSorter(NULL)
     {
       VL_DEBUG_SET_OBJECT_NAME()
       mList.reserve(100);
@@ -92,31 +92,24 @@ namespace vl
       return mSize;
     }
 
-    void sort(RenderQueueSorter* sorter, Camera* camera)
-    {
-      if (sorter->mightNeedZCameraDistance())
-      {
-        for(int i=0; i<size(); ++i)
-        {
-          RenderToken* tok = at(i);
-          vec3 center = tok->mRenderable->boundingBox().isNull() ? vec3(0,0,0) : tok->mRenderable->boundingBox().center();
-          if ( sorter->confirmZCameraDistanceNeed(tok) )
-          {
-            if (tok->mActor->transform())
-              // tok->mCameraDistance = ( camera->viewMatrix() * (tok->mActor->transform()->worldMatrix() * center) ).lengthSquared();
-              tok->mCameraDistance = -( camera->viewMatrix() * (tok->mActor->transform()->worldMatrix() * center) ).z();
-            else
-              // tok->mCameraDistance = ( camera->viewMatrix() * /* I* */ center ).lengthSquared();
-              tok->mCameraDistance = -( camera->viewMatrix() * /* I* */ center ).z();
-          }
-          else
-            tok->mCameraDistance = 0;
-        }
-      }
+    /** Sorts the first size() tokens using the given sorter.
+      * If RenderQueueSorter::sortKeyEnabled() and RenderQueueSorter::computeSortKeys() succeeds the tokens are radix sorted by
+      * RenderToken::mSortKey, otherwise they are sorted using the RenderQueueSorter's comparison operator. */
+    void sort(RenderQueueSorter* sorter, Camera* camera);
 
-      VL_CHECK( sorter )
-      std::sort( mList.begin(), mList.begin() + size(), Sorter( sorter ) );
-    }
+    /** Like sort() but exploits the frame to frame coherence of the queue: the queued Actors are matched against the ones of the
+      * previous call and their tokens are arranged in the order computed by the previous call, then the tokens that are out of order
+      * are extracted, sorted together with the ones of the Actors that entered the queue and merged back.
+      * Sorting an almost unchanged queue is thus close to linear.
+      * The order of the tokens with the same sort key can differ from the one produced by sort().
+      * If the RenderQueueSorter does not provide sort keys its comparison operator is used instead: this is where the
+      * coherence pays the most since the tokens are not sorted from scratch with a comparison sort. */
+    void sortCoherent(RenderQueueSorter* sorter, Camera* camera);
+
+    /** Forgets the order recorded by sortCoherent(), the next call will sort the queue from scratch.
+      * The Actors are recognized across frames by their Actor::serialNumber(), so the recorded order stays valid
+      * even if some of its Actors are deleted in the meantime: they are simply considered as leaving the queue. */
+    void resetCoherence();
 
   private:
     class Sorter
@@ -132,11 +125,36 @@ namespace vl
       const RenderQueueSorter* mRenderQueueSorter;
     };
 
+    struct SortItem
+    {
+      u64 mKey;
+      int mIndex; // index in mSortTokens
+    };
+
+    void computeCameraDistances(RenderQueueSorter* sorter, Camera* camera);
+    bool computeSortKeys(RenderQueueSorter* sorter);
+    void applySortItems();
+    void recordCoherence();
+
+    template<class Less> void mergeDisplaced(int kept_count, const Less& less, bool use_keys);
+
+    static SortItem* radixSort(SortItem* items, SortItem* tmp, int count);
+
   protected:
     std::vector< ref<RenderToken> > mList;
     std::vector< ref<RenderToken> > mListMP;
     int mSize;
     int mSizeMP;
+    std::vector<RenderToken*> mSortTokens;
+    std::vector<SortItem> mSortItems;
+    std::vector<SortItem> mSortItemsTmp;
+    std::vector< ref<RenderToken> > mSortList;
+    // sortCoherent() state: the serial numbers of the Actors in the order they were queued during the last frame and their sorted position.
+    const RenderQueueSorter* mCoherenceSorter;
+    std::vector<int> mCoherenceActors;
+    std::vector<int> mCoherencePositions;
+    std::vector<int> mCoherenceSlots;
+    std::vector<int> mSortActors;
   };
   //------------------------------------------------------------------------------
   typedef std::map< float, ref<RenderQueue> > TRenderQueueMap;
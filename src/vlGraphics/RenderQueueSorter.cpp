@@ -0,0 +1,295 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/RenderQueueSorter.hpp>
+#include <algorithm>
+#include <cstring>
+
+using namespace vl;
+
+namespace
+{
+  //! Assigns consecutive ids to pointers in the order in which they are first seen.
+  class PointerIds
+  {
+  public:
+    PointerIds(): mCount(0), mLastPtr(NULL), mLastId(-1), mNullId(-1)
+    {
+      rehash(64);
+    }
+
+    int id(const void* ptr)
+    {
+      // consecutive tokens often share the same object
+      if (ptr == mLastPtr && mLastId != -1)
+        return mLastId;
+      mLastPtr = ptr;
+      if (ptr == NULL)
+      {
+        if (mNullId == -1)
+        {
+          mNullId = mCount++;
+          mPointers.push_back(NULL);
+        }
+        return mLastId = mNullId;
+      }
+      size_t slot = hash(ptr) & mMask;
+      for( ; mKeys[slot] != NULL; slot = (slot + 1) & mMask )
+      {
+        if (mKeys[slot] == ptr)
+          return mLastId = mIds[slot];
+      }
+      mLastId = mCount++;
+      mKeys[slot] = ptr;
+      mIds[slot]  = mLastId;
+      mPointers.push_back(ptr);
+      // keep the load factor below 1/2
+      if ( (size_t)mCount * 2 > mKeys.size() )
+        rehash(mKeys.size() * 2);
+      return mLastId;
+    }
+
+    int count() const { return mCount; }
+
+    //! The pointers indexed by id.
+    const std::vector<const void*>& pointers() const { return mPointers; }
+
+  private:
+    void rehash(size_t capacity)
+    {
+      mMask = capacity - 1;
+      mKeys.assign(capacity, NULL);
+      mIds.resize(capacity);
+      for(size_t id=0; id<mPointers.size(); ++id)
+      {
+        if (mPointers[id] == NULL)
+          continue;
+        size_t slot = hash(mPointers[id]) & mMask;
+        while( mKeys[slot] != NULL )
+          slot = (slot + 1) & mMask;
+        mKeys[slot] = mPointers[id];
+        mIds[slot]  = (int)id;
+      }
+    }
+
+    static size_t hash(const void* ptr)
+    {
+      u64 h = (u64)(size_t)ptr;
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      return (size_t)h;
+    }
+
+  private:
+    std::vector<const void*> mKeys;
+    std::vector<int> mIds;
+    std::vector<const void*> mPointers;
+    size_t mMask;
+    int mCount;
+    const void* mLastPtr;
+    int mLastId;
+    int mNullId;
+  };
+
+  //! Orders the Shaders by GLSLProgram, RenderStateSet, EnableSet and pointer like RenderQueueSorterAggressive.
+  class ShaderStateLess
+  {
+  public:
+    bool operator()(const void* pa, const void* pb) const
+    {
+      const Shader* a = (const Shader*)pa;
+      const Shader* b = (const Shader*)pb;
+      if ( a->glslProgram() != b->glslProgram() )
+        return a->glslProgram() < b->glslProgram();
+      else
+      if ( a->getRenderStateSet() != b->getRenderStateSet() )
+        return a->getRenderStateSet() < b->getRenderStateSet();
+      else
+      if ( a->getEnableSet() != b->getEnableSet() )
+        return a->getEnableSet() < b->getEnableSet();
+      else
+        return a < b;
+    }
+  };
+
+  //! Number of bits needed to store the values in [0, range].
+  inline int bitCount(u64 range)
+  {
+    int bits = 0;
+    for( ; range; range >>= 1 )
+      ++bits;
+    return bits;
+  }
+
+  //! Appends \p bits bits to the least significant end of \p key.
+  inline u64 append(u64 key, int bits, u64 value)
+  {
+    return bits >= 64 ? value : (key << bits) | value;
+  }
+
+  //! Maps a float to an unsigned integer with the same ordering.
+  inline u32 sortableFloat(float value)
+  {
+    u32 bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+  }
+
+  struct TokenFields
+  {
+    int mBlock;
+    int mEffectRank;
+    int mActorRank;
+    int mBlending;
+    int mShaderId;
+    int mRenderableId;
+    u32 mDepth;
+    int mDepthMode;
+  };
+}
+//------------------------------------------------------------------------------
+bool RenderQueueSorter::buildSortKeys(RenderToken* const* tokens, int count, int flags) const
+{
+  if (count <= 0)
+    return true;
+
+  std::vector<TokenFields> fields(count);
+  PointerIds shader_ids;
+  PointerIds renderable_ids;
+
+  // gather the fields and their ranges
+
+  int min_block = 0, max_block = 0, min_effect_rank = 0, max_effect_rank = 0, min_actor_rank = 0, max_actor_rank = 0;
+  bool has_depth = false;
+  for(int i=0; i<count; ++i)
+  {
+    const RenderToken* tok = tokens[i];
+    TokenFields& f = fields[i];
+
+    if (flags & SK_Ranks)
+    {
+      int block       = f.mBlock      = tok->mActor->renderBlock();
+      int effect_rank = f.mEffectRank = tok->mEffectRenderRank;
+      int actor_rank  = f.mActorRank  = tok->mActor->renderRank();
+      if (i == 0)
+      {
+        min_block = max_block = block;
+        min_effect_rank = max_effect_rank = effect_rank;
+        min_actor_rank = max_actor_rank = actor_rank;
+      }
+      else
+      {
+        min_block = std::min(min_block, block); max_block = std::max(max_block, block);
+        min_effect_rank = std::min(min_effect_rank, effect_rank); max_effect_rank = std::max(max_effect_rank, effect_rank);
+        min_actor_rank = std::min(min_actor_rank, actor_rank); max_actor_rank = std::max(max_actor_rank, actor_rank);
+      }
+    }
+
+    f.mBlending     = (flags & SK_Blending) && tok->mShader->isBlendingEnabled() ? 1 : 0;
+    f.mShaderId     = (flags & SK_Shader)     ? shader_ids.id(tok->mShader)         : 0;
+    f.mRenderableId = (flags & SK_Renderable) ? renderable_ids.id(tok->mRenderable) : 0;
+    f.mDepthMode    = sortKeyDepth(tok);
+    f.mDepth        = 0;
+    if (f.mDepthMode != SKD_None)
+    {
+      has_depth = true;
+      f.mDepth = sortableFloat( (float)tok->mCameraDistance );
+      if (f.mDepthMode == SKD_BackToFront)
+        f.mDepth = ~f.mDepth;
+    }
+  }
+
+  // reorder the shader ids by render state
+
+  std::vector<int> shader_remap;
+  if ( (flags & SK_Shader) && (flags & SK_ShaderState) )
+  {
+    std::vector<const void*> shaders = shader_ids.pointers();
+    std::sort( shaders.begin(), shaders.end(), ShaderStateLess() );
+    PointerIds sorted_ids;
+    for(size_t i=0; i<shaders.size(); ++i)
+      sorted_ids.id(shaders[i]);
+    shader_remap.resize(shaders.size());
+    for(size_t i=0; i<shaders.size(); ++i)
+      shader_remap[i] = sorted_ids.id( shader_ids.pointers()[i] );
+  }
+
+  // compute the bit layout
+
+  const int block_bits       = bitCount( (u64)((i64)max_block       - min_block) );
+  const int effect_rank_bits = bitCount( (u64)((i64)max_effect_rank - min_effect_rank) );
+  const int actor_rank_bits  = bitCount( (u64)((i64)max_actor_rank  - min_actor_rank) );
+  const int blending_bits    = (flags & SK_Blending) ? 1 : 0;
+  const int shader_bits      = bitCount( shader_ids.count() ? shader_ids.count() - 1 : 0 );
+  const int renderable_bits  = bitCount( renderable_ids.count() ? renderable_ids.count() - 1 : 0 );
+
+  const int group_bits = block_bits + effect_rank_bits + actor_rank_bits + blending_bits;
+  const int payload_bits = 64 - group_bits;
+  const int id_bits = shader_bits + renderable_bits;
+  const int depth_bits = std::min(32, payload_bits);
+  if ( id_bits > payload_bits || (has_depth && depth_bits < 16) )
+    return false;
+  // the ids are truncated to what is left after the depth: they only break ties between tokens at the same depth
+  const int tail_bits = payload_bits - depth_bits;
+  const int tail_shift = std::max(0, id_bits - tail_bits);
+
+  // pack the keys
+
+  for(int i=0; i<count; ++i)
+  {
+    const TokenFields& f = fields[i];
+
+    u64 key = 0;
+    if (flags & SK_Ranks)
+    {
+      key = append(key, block_bits,       (u64)((i64)f.mBlock      - min_block));
+      key = append(key, effect_rank_bits, (u64)((i64)f.mEffectRank - min_effect_rank));
+      key = append(key, actor_rank_bits,  (u64)((i64)f.mActorRank  - min_actor_rank));
+    }
+    if (flags & SK_Blending)
+      key = append(key, 1, f.mBlending);
+
+    u64 ids = append( shader_remap.empty() ? (u64)f.mShaderId : (u64)shader_remap[f.mShaderId], renderable_bits, (u64)f.mRenderableId );
+    if (f.mDepthMode != SKD_None)
+    {
+      key = append(key, depth_bits, (u64)(f.mDepth >> (32 - depth_bits)));
+      key = append(key, tail_bits, ids >> tail_shift);
+    }
+    else
+      key = append(key, payload_bits, ids);
+
+    tokens[i]->mSortKey = key;
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
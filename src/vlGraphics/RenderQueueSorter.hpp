@@ -42,18 +42,68 @@ namespace vl
   /**
    * The RenderQueueSorter class is the abstract base class of all the algorithms used to sort a set of RenderToken.
   */
-  class RenderQueueSorter: public Object
+  class VLGRAPHICS_EXPORT RenderQueueSorter: public Object
   {
     VL_INSTRUMENT_ABSTRACT_CLASS(vl::RenderQueueSorter, Object)
 
   public:
-    RenderQueueSorter()
+    RenderQueueSorter(): mSortKeyEnabled(false)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
     virtual bool operator()(const RenderToken* a, const RenderToken* b) const = 0;
     virtual bool confirmZCameraDistanceNeed(const RenderToken*) const = 0;
     virtual bool mightNeedZCameraDistance() const = 0;
+
+    /** Computes the RenderToken::mSortKey of the given tokens, used when sortKeyEnabled() is \p true.
+      * The key keeps the render block, the ranks, the opaque/translucent split and the depth order of operator(), but it does not
+      * reproduce operator() exactly:
+      * - Renderables, and Shaders except for RenderQueueSorterAggressive, are ordered by their first appearance in the queue
+      *   instead of by pointer value.
+      * - Depths are compared in single precision and may be quantized further when the ranks need many bits, so tokens
+      *   at almost the same distance can be ordered by Shader and Renderable instead.
+      * So the tokens are still grouped as operator() groups them, but the order of the groups can differ from the one of operator().
+      * Returns \p false if the sorter does not support sort keys or if the ordering cannot be packed in 64 bits, in which case the
+      * RenderQueue is sorted using operator().
+      * \note Subclasses of the built-in sorters that reimplement operator() should also reimplement this function. */
+    virtual bool computeSortKeys(RenderToken* const* /*tokens*/, int /*count*/) const { return false; }
+
+    /** Whether the RenderQueue should use computeSortKeys() and a radix sort instead of sorting with operator() (default is \p false).
+      * The radix sort is faster on large queues but the rendering order can differ from operator(), see computeSortKeys(). */
+    void setSortKeyEnabled(bool enabled) { mSortKeyEnabled = enabled; }
+
+    /** Whether the RenderQueue should use computeSortKeys() and a radix sort instead of sorting with operator() (default is \p false). */
+    bool sortKeyEnabled() const { return mSortKeyEnabled; }
+
+  protected:
+    //! Fields packed by buildSortKeys() from the most to the least significant.
+    enum
+    {
+      SK_Ranks       = 0x01, //!< Actor render block, Effect render rank and Actor render rank.
+      SK_Blending    = 0x02, //!< Opaque objects first, translucent objects last.
+      SK_Shader      = 0x04, //!< Shader.
+      SK_Renderable  = 0x08, //!< Renderable.
+      SK_ShaderState = 0x10  //!< Order the Shaders by GLSLProgram, RenderStateSet and EnableSet.
+    };
+
+    //! Depth ordering used by buildSortKeys().
+    enum ESortKeyDepth
+    {
+      SKD_None,        //!< The token is not sorted by depth.
+      SKD_BackToFront, //!< Decreasing RenderToken::mCameraDistance.
+      SKD_FrontToBack  //!< Increasing RenderToken::mCameraDistance.
+    };
+
+    //! The depth ordering of the given token, used by buildSortKeys(). The tokens sharing the same ranks and blending must return the same value.
+    virtual ESortKeyDepth sortKeyDepth(const RenderToken*) const { return SKD_None; }
+
+    //! Packs the fields specified by \p flags and the depth returned by sortKeyDepth() in the tokens' sort keys.
+    //! The Shaders and Renderables are given dense indices so that the key only needs as many bits as the distinct objects.
+    //! The depth is stored as the bits of its single precision representation and is quantized further when less than 32 bits are left.
+    bool buildSortKeys(RenderToken* const* tokens, int count, int flags) const;
+
+  protected:
+    bool mSortKeyEnabled;
   };
   //------------------------------------------------------------------------------
   // RenderQueueSorterByShader
@@ -75,6 +125,10 @@ namespace vl
     {
       return a->mShader < b->mShader;
     }
+    virtual bool computeSortKeys(RenderToken* const* tokens, int count) const
+    {
+      return buildSortKeys(tokens, count, SK_Shader);
+    }
   };
   //------------------------------------------------------------------------------
   // RenderQueueSorterByRenderable
@@ -96,6 +150,10 @@ namespace vl
     {
       return a->mRenderable < b->mRenderable;
     }
+    virtual bool computeSortKeys(RenderToken* const* tokens, int count) const
+    {
+      return buildSortKeys(tokens, count, SK_Renderable);
+    }
   };
   //------------------------------------------------------------------------------
   // RenderQueueSorterBasic
@@ -133,6 +191,10 @@ namespace vl
       else
         return a->mRenderable < b->mRenderable;
     }
+    virtual bool computeSortKeys(RenderToken* const* tokens, int count) const
+    {
+      return buildSortKeys(tokens, count, SK_Ranks | SK_Shader | SK_Renderable);
+    }
   };
   //------------------------------------------------------------------------------
   // RenderQueueSorterStandard
@@ -211,9 +273,20 @@ namespace vl
         return a->mRenderable < b->mRenderable;
     }
 
+    virtual bool computeSortKeys(RenderToken* const* tokens, int count) const
+    {
+      int flags = SK_Ranks | SK_Shader | SK_Renderable;
+      if (mDepthSortMode != AlwaysDepthSort)
+        flags |= SK_Blending;
+      return buildSortKeys(tokens, count, flags);
+    }
+
     EDepthSortMode depthSortMode() const { return mDepthSortMode; }
     void setDepthSortMode(EDepthSortMode mode) { mDepthSortMode = mode; }
 
+  protected:
+    virtual ESortKeyDepth sortKeyDepth(const RenderToken* a) const { return confirmZCameraDistanceNeed(a) ? SKD_BackToFront : SKD_None; }
+
   public:
     EDepthSortMode mDepthSortMode;
   };
@@ -285,6 +358,14 @@ namespace vl
       else
         return a->mRenderable < b->mRenderable;
     }
+
+    virtual bool computeSortKeys(RenderToken* const* tokens, int count) const
+    {
+      return buildSortKeys(tokens, count, SK_Ranks | SK_Blending | SK_Shader | SK_Renderable);
+    }
+
+  protected:
+    virtual ESortKeyDepth sortKeyDepth(const RenderToken* a) const { return a->mShader->isBlendingEnabled() ? SKD_BackToFront : SKD_FrontToBack; }
   };
   //------------------------------------------------------------------------------
   // RenderQueueSorterAggressive
@@ -365,9 +446,20 @@ namespace vl
         return a->mRenderable < b->mRenderable;
     }
 
+    virtual bool computeSortKeys(RenderToken* const* tokens, int count) const
+    {
+      int flags = SK_Ranks | SK_Shader | SK_ShaderState | SK_Renderable;
+      if (mDepthSortMode != AlwaysDepthSort)
+        flags |= SK_Blending;
+      return buildSortKeys(tokens, count, flags);
+    }
+
     EDepthSortMode depthSortMode() const { return mDepthSortMode; }
     void setDepthSortMode(EDepthSortMode mode) { mDepthSortMode = mode; }
 
+  protected:
+    virtual ESortKeyDepth sortKeyDepth(const RenderToken* a) const { return confirmZCameraDistanceNeed(a) ? SKD_BackToFront : SKD_None; }
+
   public:
     EDepthSortMode mDepthSortMode;
   };
@@ -49,7 +49,7 @@ namespace vl
     VL_INSTRUMENT_CLASS(vl::RenderToken, Object)
 
   public:
-    RenderToken(): mNextPass(NULL), mActor(NULL), mShader(NULL), mEffectRenderRank(0), mCameraDistance(0.0)
+    RenderToken(): mNextPass(NULL), mActor(NULL), mShader(NULL), mEffectRenderRank(0), mCameraDistance(0.0), mSortKey(0)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
@@ -61,6 +61,8 @@ namespace vl
     int mEffectRenderRank;
     // Z distance from the camera. Used for object Z-sorting.
     real mCameraDistance;
+    // Sort key computed by RenderQueueSorter::computeSortKeys().
+    u64 mSortKey;
   };
   //------------------------------------------------------------------------------
 }
@@ -48,6 +48,9 @@ Renderer::Renderer()
 
   mDummyEnables  = new EnableSet;
   mDummyStateSet = new RenderStateSet;
+
+  mUniformUpdatesIssued  = 0;
+  mUniformUpdatesSkipped = 0;
 }
 //------------------------------------------------------------------------------
 namespace
@@ -86,6 +89,9 @@ const RenderQueue* Renderer::render(const RenderQueue* render_queue, Camera* cur
 {
   VL_CHECK_OGL()
 
+  mUniformUpdatesIssued  = 0;
+  mUniformUpdatesSkipped = 0;
+
   // skip if renderer is disabled
 
   if (enableMask() == 0)
@@ -331,7 +337,7 @@ const RenderQueue* Renderer::render(const RenderQueue* render_queue, Camera* cur
       {
         VL_CHECK( cur_glsl_prog_uniform_set && cur_glsl_prog_uniform_set->uniforms().size() );
         VL_CHECK( shader->getRenderStateSet()->glslProgram() && shader->getRenderStateSet()->glslProgram()->handle() )
-        cur_glsl_program->applyUniformSet( cur_glsl_prog_uniform_set );
+        cur_glsl_program->applyUniformSet( cur_glsl_prog_uniform_set, &mUniformUpdatesIssued, &mUniformUpdatesSkipped );
       }
 
       VL_CHECK_OGL()
@@ -341,7 +347,7 @@ const RenderQueue* Renderer::render(const RenderQueue* render_queue, Camera* cur
       {
         VL_CHECK( cur_shader_uniform_set && cur_shader_uniform_set->uniforms().size() );
         VL_CHECK( shader->getRenderStateSet()->glslProgram() && shader->getRenderStateSet()->glslProgram()->handle() )
-        cur_glsl_program->applyUniformSet( cur_shader_uniform_set );
+        cur_glsl_program->applyUniformSet( cur_shader_uniform_set, &mUniformUpdatesIssued, &mUniformUpdatesSkipped );
       }
 
       VL_CHECK_OGL()
@@ -351,7 +357,7 @@ const RenderQueue* Renderer::render(const RenderQueue* render_queue, Camera* cur
       {
         VL_CHECK( cur_actor_uniform_set && cur_actor_uniform_set->uniforms().size() );
         VL_CHECK( shader->getRenderStateSet()->glslProgram() && shader->getRenderStateSet()->glslProgram()->handle() )
-        cur_glsl_program->applyUniformSet( cur_actor_uniform_set );
+        cur_glsl_program->applyUniformSet( cur_actor_uniform_set, &mUniformUpdatesIssued, &mUniformUpdatesSkipped );
       }
 
       VL_CHECK_OGL()
@@ -80,6 +80,12 @@ namespace vl
     /** The Framebuffer on which the rendering is performed. */
     Framebuffer* framebuffer() { return mFramebuffer.get(); }
 
+    /** Number of uniform values transmitted with glUniform* during the last render(). */
+    int uniformUpdatesIssued() const { return mUniformUpdatesIssued; }
+
+    /** Number of uniform values not transmitted during the last render() because the GLSLProgram already held them, see GLSLProgram::setUniformDeltaBinding(). */
+    int uniformUpdatesSkipped() const { return mUniformUpdatesSkipped; }
+
   protected:
     ref<Framebuffer> mFramebuffer;
 
@@ -90,6 +96,9 @@ namespace vl
     std::map<unsigned int, ref<Shader> > mShaderOverrideMask;
 
     ref<ProjViewTransfCallback> mProjViewTransfCallback;
+
+    int mUniformUpdatesIssued;
+    int mUniformUpdatesSkipped;
   };
   //------------------------------------------------------------------------------
 }
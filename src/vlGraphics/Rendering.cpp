@@ -37,6 +37,7 @@
 #include <vlGraphics/GLSL.hpp>
 #include <vlCore/Log.hpp>
 #include <vlCore/Say.hpp>
+#include <vlCore/Thread.hpp>
 
 using namespace vl;
 
@@ -46,7 +47,9 @@ Rendering::Rendering():
   mCullingEnabled(true),
   mEvaluateLOD(true),
   mShaderAnimationEnabled(true),
-  mNearFarClippingPlanesOptimized(false)
+  mNearFarClippingPlanesOptimized(false),
+  mTemporalCoherenceEnabled(false),
+  mThreadCount(1)
 {
   VL_DEBUG_SET_OBJECT_NAME()
   mRenderQueueSorter  = new RenderQueueSorterStandard;
@@ -68,6 +71,8 @@ Rendering& Rendering::operator=(const Rendering& other)
   mEvaluateLOD              = other.mEvaluateLOD;
   mShaderAnimationEnabled   = other.mShaderAnimationEnabled;
   mNearFarClippingPlanesOptimized = other.mNearFarClippingPlanesOptimized;
+  mTemporalCoherenceEnabled = other.mTemporalCoherenceEnabled;
+  mThreadCount              = other.mThreadCount;
 
   mRenderQueueSorter   = other.mRenderQueueSorter;
   /*mActorQueue        = other.mActorQueue;*/
@@ -236,7 +241,12 @@ void Rendering::render()
   // sort the rendering queue according to this renderer sorting algorithm
 
   if (renderQueueSorter())
-    renderQueue()->sort( renderQueueSorter(), camera() );
+  {
+    if (temporalCoherenceEnabled())
+      renderQueue()->sortCoherent( renderQueueSorter(), camera() );
+    else
+      renderQueue()->sort( renderQueueSorter(), camera() );
+  }
 
   // --- RENDER THE QUEUE: loop through the renderers, feeding the output of one as input for the next ---
 
@@ -267,6 +277,48 @@ void Rendering::render()
   VL_CHECK_OGL()
 }
 //------------------------------------------------------------------------------
+// Evaluates chunks of Actors in parallel: each chunk stores its results in its own buffer,
+// the buffers are then consumed in chunk order to generate the RenderToken-s.
+class Rendering::FillTasks: public ParallelTasks
+{
+public:
+  struct ActorInfo
+  {
+    Actor* mActor;
+    Effect* mEffect;
+    int mEffectLod;
+    int mGeometryLod;
+  };
+
+  FillTasks(Rendering* rendering, ActorCollection* actors, int chunk_count): mRendering(rendering), mActors(actors)
+  {
+    mChunks.resize(chunk_count);
+  }
+
+  virtual void runTask(int ichunk)
+  {
+    std::vector<ActorInfo>& chunk = mChunks[ichunk];
+    chunk.clear();
+    int begin = (int)((long long)mActors->size() * ichunk / mChunks.size());
+    int end   = (int)((long long)mActors->size() * (ichunk+1) / mChunks.size());
+    for(int iactor=begin; iactor<end; ++iactor)
+    {
+      ActorInfo info;
+      info.mActor  = mActors->at(iactor);
+      info.mEffect = mRendering->evaluateActor(info.mActor, info.mEffectLod, info.mGeometryLod, true);
+      if (info.mEffect)
+        chunk.push_back(info);
+    }
+  }
+
+  std::vector< std::vector<ActorInfo> >& chunks() { return mChunks; }
+
+protected:
+  Rendering* mRendering;
+  ActorCollection* mActors;
+  std::vector< std::vector<ActorInfo> > mChunks;
+};
+//------------------------------------------------------------------------------
 void Rendering::fillRenderQueue( ActorCollection* actor_list )
 {
   if (actor_list == NULL)
@@ -281,125 +333,169 @@ void Rendering::fillRenderQueue( ActorCollection* actor_list )
   if (enableMask() == 0)
     return;
 
-  RenderQueue* list = renderQueue();
   std::set<Shader*> shader_set;
 
+  int thread_count = threadCount() > 0 ? threadCount() : Thread::hardwareConcurrency();
+  if (thread_count > 1 && actor_list->size() > 1)
+  {
+    // Renderables can be shared among Actors: update their bounds here so that the threads only read them.
+    for(int iactor=0; iactor < actor_list->size(); iactor++)
+    {
+      Renderable* renderable = actor_list->at(iactor)->lod(0);
+      if (renderable && renderable->boundsDirty())
+        renderable->computeBounds();
+    }
+
+    // use more chunks than threads to balance the load
+    int chunk_count = thread_count * 8 < actor_list->size() ? thread_count * 8 : actor_list->size();
+    FillTasks tasks(this, actor_list, chunk_count);
+    Thread::runTasks(&tasks, chunk_count, thread_count);
+
+    // shader animation and resource initialization can issue OpenGL commands and call user code: keep them on this thread.
+    for(int ichunk=0; ichunk<chunk_count; ++ichunk)
+    {
+      const std::vector<FillTasks::ActorInfo>& chunk = tasks.chunks()[ichunk];
+      for(size_t i=0; i<chunk.size(); ++i)
+        fillRenderTokens(chunk[i].mActor, chunk[i].mEffect, chunk[i].mEffectLod, chunk[i].mGeometryLod, shader_set);
+    }
+    return;
+  }
+
   // iterate actor list
 
   for(int iactor=0; iactor < actor_list->size(); iactor++)
   {
     Actor* actor = actor_list->at(iactor);
+    int effect_lod = 0;
+    int geometry_lod = 0;
+    Effect* effect = evaluateActor(actor, effect_lod, geometry_lod, false);
+    if (effect)
+      fillRenderTokens(actor, effect, effect_lod, geometry_lod, shader_set);
+  }
+}
+//------------------------------------------------------------------------------
+Effect* Rendering::evaluateActor( Actor* actor, int& effect_lod, int& geometry_lod, bool multithreaded )
+{
+  VL_CHECK(actor->lod(0))
 
-    VL_CHECK(actor->lod(0))
+  if ( !isEnabled(actor->enableMask()) )
+    return NULL;
 
-    if ( !isEnabled(actor->enableMask()) )
-      continue;
+  // update the Actor's bounds
+  actor->computeBounds();
 
-    // update the Actor's bounds
-    actor->computeBounds();
+  Effect* effect = actor->effect();
+  VL_CHECK(effect)
 
-    Effect* effect = actor->effect();
-    VL_CHECK(effect)
+  // effect override
+  
+  for( std::map< unsigned int, ref<Effect> >::iterator eom_it = mEffectOverrideMask.begin(); 
+       eom_it != mEffectOverrideMask.end(); 
+       ++eom_it )
+  {
+    if (eom_it->first & actor->enableMask())
+      effect = eom_it->second.get();
+  }
 
-    // effect override
-    
-    for( std::map< unsigned int, ref<Effect> >::iterator eom_it = mEffectOverrideMask.begin(); 
-         eom_it != mEffectOverrideMask.end(); 
-         ++eom_it )
-    {
-      if (eom_it->first & actor->enableMask())
-        effect = eom_it->second.get();
-    }
+  if ( !isEnabled(effect->enableMask()) )
+    return NULL;
 
-    if ( !isEnabled(effect->enableMask()) )
-      continue;
+  // --------------- LOD evaluation ---------------
 
-    // --------------- LOD evaluation ---------------
+  // Effect::evaluateLOD() stores the active LOD in the Effect, which can be shared among Actors evaluated by different threads.
+  if (multithreaded)
+    effect_lod = effect->lodEvaluator() ? effect->lodEvaluator()->evaluate( actor, camera() ) : effect->activeLod();
+  else
+    effect_lod = effect->evaluateLOD( actor, camera() );
 
-    int effect_lod = effect->evaluateLOD( actor, camera() );
+  geometry_lod = 0;
+  if ( evaluateLOD() )
+    geometry_lod = actor->evaluateLOD( camera() );
 
-    int geometry_lod = 0;
-    if ( evaluateLOD() )
-      geometry_lod = actor->evaluateLOD( camera() );
+  return effect;
+}
+//------------------------------------------------------------------------------
+void Rendering::fillRenderTokens( Actor* actor, Effect* effect, int effect_lod, int geometry_lod, std::set<Shader*>& shader_set )
+{
+  RenderQueue* list = renderQueue();
 
-    // --------------- M U L T I   P A S S I N G ---------------
+  // --------------- M U L T I   P A S S I N G ---------------
 
-    RenderToken* prev_pass = NULL;
-    const int pass_count = effect->lod(effect_lod)->size();
-    for(int ipass=0; ipass<pass_count; ++ipass)
-    {
-      // setup the shader to be used for this pass
+  RenderToken* prev_pass = NULL;
+  const int pass_count = effect->lod(effect_lod)->size();
+  for(int ipass=0; ipass<pass_count; ++ipass)
+  {
+    // setup the shader to be used for this pass
 
-      Shader* shader = effect->lod(effect_lod)->at(ipass);
+    Shader* shader = effect->lod(effect_lod)->at(ipass);
 
-      // --------------- fill render token ---------------
+    // --------------- fill render token ---------------
 
-      // create a render token
-      RenderToken* tok = list->newToken(prev_pass != NULL);
+    // create a render token
+    RenderToken* tok = list->newToken(prev_pass != NULL);
 
-      // multipass chain: implemented as a linked list
-      if ( prev_pass != NULL )
-        prev_pass->mNextPass = tok;
-      prev_pass = tok;
-      tok->mNextPass = NULL;
-      // track the current state
-      tok->mActor = actor;
-      tok->mRenderable = actor->lod(geometry_lod);
-      // set the shader used (multipassing shader or effect->shader())
-      tok->mShader = shader;
+    // multipass chain: implemented as a linked list
+    if ( prev_pass != NULL )
+      prev_pass->mNextPass = tok;
+    prev_pass = tok;
+    tok->mNextPass = NULL;
+    // track the current state
+    tok->mActor = actor;
+    tok->mRenderable = actor->lod(geometry_lod);
+    // set the shader used (multipassing shader or effect->shader())
+    tok->mShader = shader;
 
-      if ( shaderAnimationEnabled() )
+    if ( shaderAnimationEnabled() )
+    {
+      VL_CHECK(frameClock() >= 0)
+      if( frameClock() >= 0 )
       {
-        VL_CHECK(frameClock() >= 0)
-        if( frameClock() >= 0 )
+        // note that the condition is != as opposed to <
+        if ( shader->lastUpdateTime() != frameClock() && shader->shaderAnimator() && shader->shaderAnimator()->isEnabled() )
         {
-          // note that the condition is != as opposed to <
-          if ( shader->lastUpdateTime() != frameClock() && shader->shaderAnimator() && shader->shaderAnimator()->isEnabled() )
-          {
-            // update
-            shader->shaderAnimator()->updateShader( shader, camera(), frameClock() );
+          // update
+          shader->shaderAnimator()->updateShader( shader, camera(), frameClock() );
 
-            // note that we update this after
-            shader->setLastUpdateTime( frameClock() );
-          }
+          // note that we update this after
+          shader->setLastUpdateTime( frameClock() );
         }
       }
+    }
 
-      if ( automaticResourceInit() && shader_set.find(shader) == shader_set.end() )
-      {
-        shader_set.insert(shader);
+    if ( automaticResourceInit() && shader_set.find(shader) == shader_set.end() )
+    {
+      shader_set.insert(shader);
 
-        // link GLSLProgram
-        if (shader->glslProgram() && !shader->glslProgram()->linked())
-        {
-          shader->glslProgram()->linkProgram();
-          VL_CHECK( shader->glslProgram()->linked() );
-        }
+      // link GLSLProgram
+      if (shader->glslProgram() && !shader->glslProgram()->linked())
+      {
+        shader->glslProgram()->linkProgram();
+        VL_CHECK( shader->glslProgram()->linked() );
+      }
 
-        // lazy texture creation
-        if ( shader->gocRenderStateSet() )
+      // lazy texture creation
+      if ( shader->gocRenderStateSet() )
+      {
+        size_t count = shader->gocRenderStateSet()->renderStatesCount();
+        RenderStateSlot* states = shader->gocRenderStateSet()->renderStates();
+        for( size_t i=0; i<count; ++i )
         {
-          size_t count = shader->gocRenderStateSet()->renderStatesCount();
-          RenderStateSlot* states = shader->gocRenderStateSet()->renderStates();
-          for( size_t i=0; i<count; ++i )
+          if (states[i].mRS->type() == RS_TextureSampler)
           {
-            if (states[i].mRS->type() == RS_TextureSampler)
+            TextureSampler* tex_unit = static_cast<TextureSampler*>( states[i].mRS.get() );
+            VL_CHECK(tex_unit);
+            if (tex_unit)
             {
-              TextureSampler* tex_unit = static_cast<TextureSampler*>( states[i].mRS.get() );
-              VL_CHECK(tex_unit);
-              if (tex_unit)
-              {
-                if (tex_unit->texture() && tex_unit->texture()->setupParams())
-                  tex_unit->texture()->createTexture();
-              }
+              if (tex_unit->texture() && tex_unit->texture()->setupParams())
+                tex_unit->texture()->createTexture();
             }
           }
-          
         }
+        
       }
-
-      tok->mEffectRenderRank = effect->renderRank();
     }
+
+    tok->mEffectRenderRank = effect->renderRank();
   }
 }
 //------------------------------------------------------------------------------
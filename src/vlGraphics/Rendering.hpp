@@ -167,6 +167,13 @@ namespace vl
     Only Shader[s] belonging to visible Actor[s] are animated. */
     bool shaderAnimationEnabled() const { return mShaderAnimationEnabled; }
 
+    /** Whether the render queue should be sorted using RenderQueue::sortCoherent(), which reuses the order computed during the
+    previous frame and is much faster when the set of visible Actors and their order change little from frame to frame. */
+    void setTemporalCoherenceEnabled(bool enabled) { mTemporalCoherenceEnabled = enabled; }
+
+    /** Whether the render queue should be sorted using RenderQueue::sortCoherent(). */
+    bool temporalCoherenceEnabled() const { return mTemporalCoherenceEnabled; }
+
     /** Whether the installed SceneManager[s] should perform Actor culling or not in order to maximize the rendering performances. */
     void setCullingEnabled(bool enabled) { mCullingEnabled = enabled; }
     
@@ -196,11 +203,26 @@ namespace vl
     /** A bitmask/Effect map used to everride the Effect of those Actors whose enable mask satisfy the following condition: (Actors::enableMask() & bitmask) != 0. */
     std::map<unsigned int, ref<Effect> >& effectOverrideMask() { return mEffectOverrideMask; }
 
+    /** The number of threads used by fillRenderQueue() to compute the Actors' bounds and to evaluate their Effect and LODs.
+      * 1 (default) disables multithreading, 0 uses Thread::hardwareConcurrency() threads. The per-thread results are merged
+      * in Actor order so the RenderQueue is identical to the one generated using a single thread.
+      * \note When multithreading is enabled the LODEvaluator-s installed on Actors and Effects must be thread safe
+      * and Effect::activeLod() is not updated. */
+    void setThreadCount(int count) { mThreadCount = count; }
+
+    /** The number of threads used by fillRenderQueue(), see setThreadCount(). */
+    int threadCount() const { return mThreadCount; }
+
   protected:
     void fillRenderQueue( ActorCollection* actor_list );
     ActorCollection* actorQueue() { return mActorQueue.get(); }
     RenderQueue* renderQueue() { return mRenderQueue.get(); }
 
+  private:
+    class FillTasks;
+    Effect* evaluateActor( Actor* actor, int& effect_lod, int& geometry_lod, bool multithreaded );
+    void fillRenderTokens( Actor* actor, Effect* effect, int effect_lod, int geometry_lod, std::set<Shader*>& shader_set );
+
   protected:
     ref<RenderQueueSorter> mRenderQueueSorter;
     ref<ActorCollection> mActorQueue;
@@ -216,6 +238,8 @@ namespace vl
     bool mEvaluateLOD;
     bool mShaderAnimationEnabled;
     bool mNearFarClippingPlanesOptimized;
+    bool mTemporalCoherenceEnabled;
+    int mThreadCount;
   };
 }
 
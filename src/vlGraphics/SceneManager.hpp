@@ -66,6 +66,7 @@ namespace vl
    * - SceneManager
    * - SceneManagerActorKdTree
    * - SceneManagerActorTree
+   * - SceneManagerLinearBVH
    * - SceneManagerPortals
    * - Actor
   */
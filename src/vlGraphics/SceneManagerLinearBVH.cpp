@@ -0,0 +1,381 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/SceneManagerLinearBVH.hpp>
+#include <vlGraphics/ActorKdTree.hpp>
+#include <vlGraphics/Camera.hpp>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+  #define VL_LINEAR_BVH_SSE 1
+  #include <xmmintrin.h>
+#else
+  #define VL_LINEAR_BVH_SSE 0
+#endif
+
+using namespace vl;
+
+namespace
+{
+  enum EBoxSide { BS_Outside, BS_Intersecting, BS_Inside };
+
+  //! Maximum number of planes tested with SSE, frustums with more planes use ScalarPlanes.
+  const int MaxSSEPlanes = 8;
+
+  //-----------------------------------------------------------------------------
+  // ScalarPlanes
+  //-----------------------------------------------------------------------------
+  //! Plane-box and plane-sphere tests with the same semantics of Frustum::cull().
+  class ScalarPlanes
+  {
+  public:
+    ScalarPlanes(const Frustum& frustum)
+    {
+      mCount = (int)frustum.planes().size();
+      mPlanes.resize(mCount * 4);
+      for(int i=0; i<mCount; ++i)
+      {
+        mPlanes[i*4+0] = (float)frustum.plane(i).normal().x();
+        mPlanes[i*4+1] = (float)frustum.plane(i).normal().y();
+        mPlanes[i*4+2] = (float)frustum.plane(i).normal().z();
+        mPlanes[i*4+3] = (float)frustum.plane(i).origin();
+      }
+    }
+
+    EBoxSide classifyBox(float minx, float miny, float minz, float maxx, float maxy, float maxz) const
+    {
+      EBoxSide side = BS_Inside;
+      for(int i=0; i<mCount; ++i)
+      {
+        const float* p = &mPlanes[i*4];
+        // the corner farthest along the normal and the opposite one
+        float nearest  = p[0] * (p[0] >= 0 ? minx : maxx) + p[1] * (p[1] >= 0 ? miny : maxy) + p[2] * (p[2] >= 0 ? minz : maxz) - p[3];
+        float farthest = p[0] * (p[0] >= 0 ? maxx : minx) + p[1] * (p[1] >= 0 ? maxy : miny) + p[2] * (p[2] >= 0 ? maxz : minz) - p[3];
+        if (nearest >= 0)
+          return BS_Outside;
+        if (farthest >= 0)
+          side = BS_Intersecting;
+      }
+      return side;
+    }
+
+    bool cullSphere(float x, float y, float z, float radius) const
+    {
+      for(int i=0; i<mCount; ++i)
+      {
+        const float* p = &mPlanes[i*4];
+        if (p[0]*x + p[1]*y + p[2]*z - p[3] > radius)
+          return true;
+      }
+      return false;
+    }
+
+  protected:
+    std::vector<float> mPlanes;
+    int mCount;
+  };
+
+#if VL_LINEAR_BVH_SSE
+  //-----------------------------------------------------------------------------
+  // SSEPlanes
+  //-----------------------------------------------------------------------------
+  //! Tests up to MaxSSEPlanes planes four at a time, the unused lanes contain planes that never cull.
+  class SSEPlanes
+  {
+  public:
+    SSEPlanes(const Frustum& frustum)
+    {
+      VL_CHECK(frustum.planes().size() <= (size_t)MaxSSEPlanes)
+      float nx[MaxSSEPlanes], ny[MaxSSEPlanes], nz[MaxSSEPlanes], o[MaxSSEPlanes];
+      int count = (int)frustum.planes().size();
+      for(int i=0; i<MaxSSEPlanes; ++i)
+      {
+        nx[i] = i < count ? (float)frustum.plane(i).normal().x() : 0;
+        ny[i] = i < count ? (float)frustum.plane(i).normal().y() : 0;
+        nz[i] = i < count ? (float)frustum.plane(i).normal().z() : 0;
+        o[i]  = i < count ? (float)frustum.plane(i).origin()     : 1;
+      }
+      mGroups = count > 4 ? 2 : 1;
+      for(int g=0; g<mGroups; ++g)
+      {
+        mNX[g] = _mm_loadu_ps(nx + g*4);
+        mNY[g] = _mm_loadu_ps(ny + g*4);
+        mNZ[g] = _mm_loadu_ps(nz + g*4);
+        mO[g]  = _mm_loadu_ps(o + g*4);
+        mPosX[g] = _mm_cmpge_ps(mNX[g], _mm_setzero_ps());
+        mPosY[g] = _mm_cmpge_ps(mNY[g], _mm_setzero_ps());
+        mPosZ[g] = _mm_cmpge_ps(mNZ[g], _mm_setzero_ps());
+      }
+    }
+
+    static __m128 select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+    __m128 distance(int g, __m128 x, __m128 y, __m128 z) const
+    {
+      __m128 d = _mm_mul_ps(mNX[g], x);
+      d = _mm_add_ps(d, _mm_mul_ps(mNY[g], y));
+      d = _mm_add_ps(d, _mm_mul_ps(mNZ[g], z));
+      return _mm_sub_ps(d, mO[g]);
+    }
+
+    EBoxSide classifyBox(float minx, float miny, float minz, float maxx, float maxy, float maxz) const
+    {
+      const __m128 min_x = _mm_set1_ps(minx);
+      const __m128 min_y = _mm_set1_ps(miny);
+      const __m128 min_z = _mm_set1_ps(minz);
+      const __m128 max_x = _mm_set1_ps(maxx);
+      const __m128 max_y = _mm_set1_ps(maxy);
+      const __m128 max_z = _mm_set1_ps(maxz);
+      const __m128 zero = _mm_setzero_ps();
+      int intersecting = 0;
+      for(int g=0; g<mGroups; ++g)
+      {
+        __m128 nearest = distance(g, select(mPosX[g], min_x, max_x), select(mPosY[g], min_y, max_y), select(mPosZ[g], min_z, max_z));
+        if (_mm_movemask_ps(_mm_cmpge_ps(nearest, zero)))
+          return BS_Outside;
+        __m128 farthest = distance(g, select(mPosX[g], max_x, min_x), select(mPosY[g], max_y, min_y), select(mPosZ[g], max_z, min_z));
+        intersecting |= _mm_movemask_ps(_mm_cmpge_ps(farthest, zero));
+      }
+      return intersecting ? BS_Intersecting : BS_Inside;
+    }
+
+    bool cullSphere(float x, float y, float z, float radius) const
+    {
+      const __m128 r = _mm_set1_ps(radius);
+      int culled = 0;
+      for(int g=0; g<mGroups; ++g)
+        culled |= _mm_movemask_ps(_mm_cmpgt_ps(distance(g, _mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(z)), r));
+      return culled != 0;
+    }
+
+  protected:
+    __m128 mNX[2], mNY[2], mNZ[2], mO[2];
+    __m128 mPosX[2], mPosY[2], mPosZ[2];
+    int mGroups;
+  };
+#endif
+}
+//-----------------------------------------------------------------------------
+// SceneManagerLinearBVH
+//-----------------------------------------------------------------------------
+namespace
+{
+  //! Visits the nodes in order, skipping the culled subtrees.
+  template<class Planes>
+  void cullNodes(const Planes& planes, ActorCollection& list, unsigned enable_mask, ActorCollection& actors,
+                 const float* minx, const float* miny, const float* minz, const float* maxx, const float* maxy, const float* maxz, 
+                 const int* skip, const int* node_actors, int node_count,
+                 const float* ax, const float* ay, const float* az, const float* ar)
+  {
+    for(int i=0; i<node_count; )
+    {
+      EBoxSide side = planes.classifyBox(minx[i], miny[i], minz[i], maxx[i], maxy[i], maxz[i]);
+      if (side == BS_Outside)
+        i = skip[i];
+      else
+      if (side == BS_Inside)
+      {
+        // the whole subtree is visible
+        for(int j=node_actors[i], end=node_actors[skip[i]]; j<end; ++j)
+          if (enable_mask & actors[j]->enableMask())
+            list.push_back(actors.at(j));
+        i = skip[i];
+      }
+      else
+      {
+        for(int j=node_actors[i], end=node_actors[i+1]; j<end; ++j)
+          if ((enable_mask & actors[j]->enableMask()) && !planes.cullSphere(ax[j], ay[j], az[j], ar[j]))
+            list.push_back(actors.at(j));
+        ++i;
+      }
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+SceneManagerLinearBVH::SceneManagerLinearBVH()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mActors.setAutomaticDelete(false);
+  mNodeActors.push_back(0);
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::extractVisibleActors(ActorCollection& list, const Camera* camera)
+{
+  if (!cullingEnabled())
+  {
+    extractActors(list);
+    return;
+  }
+
+  if (mNodeSkip.empty())
+    return;
+
+#if VL_LINEAR_BVH_SSE
+  if (camera->frustum().planes().size() <= (size_t)MaxSSEPlanes)
+  {
+    cullNodes( SSEPlanes(camera->frustum()), list, enableMask(), mActors,
+               &mNodeMinX[0], &mNodeMinY[0], &mNodeMinZ[0], &mNodeMaxX[0], &mNodeMaxY[0], &mNodeMaxZ[0], 
+               &mNodeSkip[0], &mNodeActors[0], nodeCount(), 
+               mActorX.empty() ? NULL : &mActorX[0], mActorY.empty() ? NULL : &mActorY[0], mActorZ.empty() ? NULL : &mActorZ[0], mActorRadius.empty() ? NULL : &mActorRadius[0] );
+    return;
+  }
+#endif
+
+  cullNodes( ScalarPlanes(camera->frustum()), list, enableMask(), mActors,
+             &mNodeMinX[0], &mNodeMinY[0], &mNodeMinZ[0], &mNodeMaxX[0], &mNodeMaxY[0], &mNodeMaxZ[0], 
+             &mNodeSkip[0], &mNodeActors[0], nodeCount(), 
+             mActorX.empty() ? NULL : &mActorX[0], mActorY.empty() ? NULL : &mActorY[0], mActorZ.empty() ? NULL : &mActorZ[0], mActorRadius.empty() ? NULL : &mActorRadius[0] );
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::extractActors(ActorCollection& list)
+{
+  for(int i=0; i<mActors.size(); ++i)
+    list.push_back(mActors.at(i));
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::clear()
+{
+  mActors.clear();
+  mNodeMinX.clear();
+  mNodeMinY.clear();
+  mNodeMinZ.clear();
+  mNodeMaxX.clear();
+  mNodeMaxY.clear();
+  mNodeMaxZ.clear();
+  mNodeSkip.clear();
+  mNodeActors.clear();
+  mNodeActors.push_back(0);
+  mActorX.clear();
+  mActorY.clear();
+  mActorZ.clear();
+  mActorRadius.clear();
+  setBoundsDirty(true);
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::compile(ActorTreeAbstract* tree)
+{
+  clear();
+  mNodeActors.clear();
+  appendNode(tree);
+  // end of the Actor[s] of the last node
+  mNodeActors.push_back(mActors.size());
+  mActorX.resize(mActors.size());
+  mActorY.resize(mActors.size());
+  mActorZ.resize(mActors.size());
+  mActorRadius.resize(mActors.size());
+  refitBounds();
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::compile(ActorCollection& actors, int thread_count)
+{
+  ref<ActorKdTree> tree = new ActorKdTree;
+  tree->buildKdTreeSAH(actors, 100, thread_count);
+  compile(tree.get());
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::appendNode(ActorTreeAbstract* node)
+{
+  const int index = nodeCount();
+  mNodeMinX.push_back(0);
+  mNodeMinY.push_back(0);
+  mNodeMinZ.push_back(0);
+  mNodeMaxX.push_back(0);
+  mNodeMaxY.push_back(0);
+  mNodeMaxZ.push_back(0);
+  mNodeSkip.push_back(0);
+  mNodeActors.push_back(mActors.size());
+  for(int i=0; i<node->actors()->size(); ++i)
+    mActors.push_back(node->actors()->at(i));
+  for(int i=0; i<node->childrenCount(); ++i)
+    if (node->child(i))
+      appendNode(node->child(i));
+  mNodeSkip[index] = nodeCount();
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::refitBounds()
+{
+  for(int i=0; i<mActors.size(); ++i)
+  {
+    mActors[i]->computeBounds();
+    setActorBounds(i);
+  }
+
+  // children come after their parent: visit the nodes backwards
+  std::vector<AABB> aabb(nodeCount());
+  for(int i=nodeCount()-1; i>=0; --i)
+  {
+    for(int j=mNodeActors[i]; j<mNodeActors[i+1]; ++j)
+      aabb[i] += mActors[j]->boundingBox();
+    for(int child=i+1; child<mNodeSkip[i]; child=mNodeSkip[child])
+      aabb[i] += aabb[child];
+    setNodeBounds(i, aabb[i]);
+  }
+
+  setBoundsDirty(true);
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::setNodeBounds(int node, const AABB& aabb)
+{
+  const float inf = std::numeric_limits<float>::max();
+  if (mNodeActors[node] == mNodeActors[mNodeSkip[node]])
+  {
+    // empty subtree: always culled
+    mNodeMinX[node] = mNodeMinY[node] = mNodeMinZ[node] = +inf;
+    mNodeMaxX[node] = mNodeMaxY[node] = mNodeMaxZ[node] = -inf;
+  }
+  else
+  if (aabb.isNull())
+  {
+    // Actor[s] without bounds: never culled
+    mNodeMinX[node] = mNodeMinY[node] = mNodeMinZ[node] = -inf;
+    mNodeMaxX[node] = mNodeMaxY[node] = mNodeMaxZ[node] = +inf;
+  }
+  else
+  {
+    mNodeMinX[node] = (float)aabb.minCorner().x();
+    mNodeMinY[node] = (float)aabb.minCorner().y();
+    mNodeMinZ[node] = (float)aabb.minCorner().z();
+    mNodeMaxX[node] = (float)aabb.maxCorner().x();
+    mNodeMaxY[node] = (float)aabb.maxCorner().y();
+    mNodeMaxZ[node] = (float)aabb.maxCorner().z();
+  }
+}
+//-----------------------------------------------------------------------------
+void SceneManagerLinearBVH::setActorBounds(int actor)
+{
+  const Sphere& sphere = mActors[actor]->boundingSphere();
+  mActorX[actor] = (float)sphere.center().x();
+  mActorY[actor] = (float)sphere.center().y();
+  mActorZ[actor] = (float)sphere.center().z();
+  // null spheres are never culled
+  mActorRadius[actor] = sphere.isNull() ? std::numeric_limits<float>::max() : (float)sphere.radius();
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,121 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef SceneManagerLinearBVH_INCLUDE_ONCE
+#define SceneManagerLinearBVH_INCLUDE_ONCE
+
+#include <vlGraphics/SceneManager.hpp>
+#include <vlGraphics/Actor.hpp>
+#include <vector>
+
+namespace vl
+{
+  class ActorTreeAbstract;
+
+//-------------------------------------------------------------------------------------------------------------------------------------------
+// SceneManagerLinearBVH
+//-------------------------------------------------------------------------------------------------------------------------------------------
+  /**
+   * A SceneManager that culls a compiled, linearized snapshot of a bounding volume hierarchy.
+   *
+   * The nodes of the hierarchy are stored in depth-first order in contiguous arrays, with the bounding boxes of the nodes
+   * and the bounding spheres of the Actor[s] stored as separate arrays of coordinates. Each node stores the index of the first
+   * node following its subtree so that the culling is a simple loop over the arrays: culled subtrees are skipped in one step,
+   * and the Actor[s] of subtrees entirely inside the frustum are appended without further tests. 
+   * When SSE is available the frustum planes are tested four at a time.
+   *
+   * The hierarchy is a snapshot: Actor[s] added to or removed from the source tree after compile() are not seen until compile()
+   * is called again. If the Actor[s] only moved, refitBounds() updates the bounds without changing the hierarchy.
+   *
+   * \sa
+   * - Actor
+   * - ActorKdTree
+   * - ActorTree
+   * - SceneManager
+   * - SceneManagerActorKdTree
+   * - SceneManagerActorTree
+  */
+  class VLGRAPHICS_EXPORT SceneManagerLinearBVH: public SceneManager
+  {
+    VL_INSTRUMENT_CLASS(vl::SceneManagerLinearBVH, SceneManager)
+
+  public:
+    SceneManagerLinearBVH();
+
+    virtual void extractVisibleActors(ActorCollection& list, const Camera* camera);
+
+    virtual void extractActors(ActorCollection& list);
+
+    //! Compiles the hierarchy from the given tree, for example an ActorKdTree or an ActorTree. The tree is not referenced after the compilation.
+    void compile(ActorTreeAbstract* tree);
+
+    //! Builds an ActorKdTree with ActorKdTree::buildKdTreeSAH() and compiles it.
+    void compile(ActorCollection& actors, int thread_count=1);
+
+    //! Recomputes the bounds of the Actor[s] and of the nodes, without changing the hierarchy.
+    void refitBounds();
+
+    //! Removes all the nodes and Actor[s].
+    void clear();
+
+    //! The number of nodes of the compiled hierarchy.
+    int nodeCount() const { return (int)mNodeSkip.size(); }
+
+    //! The number of Actor[s] of the compiled hierarchy.
+    int actorCount() const { return mActors.size(); }
+
+  protected:
+    void appendNode(ActorTreeAbstract* node);
+    void setNodeBounds(int node, const AABB& aabb);
+    void setActorBounds(int actor);
+
+  protected:
+    ActorCollection mActors;
+    // node bounds
+    std::vector<float> mNodeMinX;
+    std::vector<float> mNodeMinY;
+    std::vector<float> mNodeMinZ;
+    std::vector<float> mNodeMaxX;
+    std::vector<float> mNodeMaxY;
+    std::vector<float> mNodeMaxZ;
+    //! Index of the first node following the subtree.
+    std::vector<int> mNodeSkip;
+    //! Index of the first Actor of the node, the Actor[s] of a node end where the ones of the next node begin.
+    std::vector<int> mNodeActors;
+    // Actor bounding spheres
+    std::vector<float> mActorX;
+    std::vector<float> mActorY;
+    std::vector<float> mActorZ;
+    std::vector<float> mActorRadius;
+  };
+}
+
+#endif
@@ -142,49 +142,17 @@ void Text::render_Implementation(const Actor* actor, const Shader*, const Camera
   glNormal3fv( gl_context->normal().ptr() );
 }
 //-----------------------------------------------------------------------------
-void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& color, const fvec2& offset) const
+void Text::updateLayout() const
 {
-  if(!mFont)
-  {
-    Log::error("Text::renderText() error: no Font assigned to the Text object.\n");
-    VL_TRAP()
+  if (!mFont || !font()->mFT_Face)
     return;
-  }
 
-  if (!font()->mFT_Face)
-  {
-    Log::error("Text::renderText() error: invalid FT_Face: probably you tried to load an unsupported font format.\n");
-    VL_TRAP()
+  if (!mLayoutDirty && mLayoutFont == mFont.get() && mLayoutFontVersion == mFont->glyphsVersion())
     return;
-  }
-
-  int viewport[] = { camera->viewport()->x(), camera->viewport()->y(), camera->viewport()->width(), camera->viewport()->height() };
-
-  if (viewport[2] < 1) viewport[2] = 1;
-  if (viewport[3] < 1) viewport[3] = 1;
-
-  // note that we only save and restore the server side states
-
-  if (mode() == Text2D)
-  {
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    VL_CHECK_OGL();
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    // glLoadIdentity();
-    // gluOrtho2D( -0.5f, viewport[2]-0.5f, -0.5f, viewport[3]-0.5f );
-
-    // clever trick part #1
-    fmat4 mat = fmat4::getOrtho(-0.5f, viewport[2]-0.5f, -0.5f, viewport[3]-0.5f, -1, +1);
-    mat.e(2,2) = 1.0f; // preserve the z value from the incoming vertex.
-    mat.e(2,3) = 0.0f;
-    glLoadMatrixf(mat.ptr());
 
-    VL_CHECK_OGL();
-  }
+  mLayoutVertices.clear();
+  mLayoutTexCoords.clear();
+  mLayoutRuns.clear();
 
   AABB rbbox = rawboundingRect( text() ); // for text alignment
   VL_CHECK(rbbox.maxCorner().z() == 0)
@@ -195,78 +163,19 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
   VL_CHECK(bbox.maxCorner().z() == 0)
   VL_CHECK(bbox.minCorner().z() == 0)
 
-  // basic render states
+  // the glyphs are created by rawboundingRect(), which might discard the cached glyphs if the font was modified
+  mLayoutRawBoundingRect = rbbox;
+  mLayoutFont = mFont.get();
+  mLayoutFontVersion = mFont->glyphsVersion();
+  mLayoutDirty = false;
 
   fvec2 pen(0,0);
 
-  float texc[] = { 0,0, 0,0, 0,0, 0,0 };
-  VL_glActiveTexture( GL_TEXTURE0 );
-  glEnable(GL_TEXTURE_2D);
-  VL_glClientActiveTexture( GL_TEXTURE0 );
-  glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-  glTexCoordPointer(2, GL_FLOAT, 0, texc);
-
-  // Constant color
-  glColor4f( color.r(), color.g(), color.b(), color.a() );
-
-  // Constant normal
-  glNormal3f( 0, 0, 1 );
-
-  fvec3 vect[4];
-  glEnableClientState( GL_VERTEX_ARRAY );
-  glVertexPointer(3, GL_FLOAT, 0, vect[0].ptr());
-
   FT_Long has_kerning = FT_HAS_KERNING( font()->mFT_Face );
   FT_UInt previous = 0;
 
-  // viewport alignment
-  fmat4 m = mMatrix;
-
-  int w = camera->viewport()->width();
-  int h = camera->viewport()->height();
-
-  if (w < 1) w = 1;
-  if (h < 1) h = 1;
-
-  if ( !(actor && actor->transform()) && mode() == Text2D )
-  {
-    if (viewportAlignment() & AlignHCenter)
-    {
-      VL_CHECK( !(viewportAlignment() & AlignRight) )
-      VL_CHECK( !(viewportAlignment() & AlignLeft) )
-      // vect[i].x() += int((viewport[2]-1.0f) / 2.0f);
-      m.translate( (float)int((w-1.0f) / 2.0f), 0, 0);
-    }
-
-    if (viewportAlignment() & AlignRight)
-    {
-      VL_CHECK( !(viewportAlignment() & AlignHCenter) )
-      VL_CHECK( !(viewportAlignment() & AlignLeft) )
-      // vect[i].x() += int(viewport[2]-1.0f);
-      m.translate( (float)int(w-1.0f), 0, 0);
-    }
-
-    if (viewportAlignment() & AlignTop)
-    {
-      VL_CHECK( !(viewportAlignment() & AlignBottom) )
-      VL_CHECK( !(viewportAlignment() & AlignVCenter) )
-      // vect[i].y() += int(viewport[3]-1.0f);
-      m.translate( 0, (float)int(h-1.0f), 0);
-    }
-
-    if (viewportAlignment() & AlignVCenter)
-    {
-      VL_CHECK( !(viewportAlignment() & AlignTop) )
-      VL_CHECK( !(viewportAlignment() & AlignBottom) )
-      // vect[i].y() += int((viewport[3]-1.0f) / 2.0f);
-      m.translate( 0, (float)int((h-1.0f) / 2.0f), 0);
-    }
-  }
-
   // split the text in different lines
 
-  VL_CHECK(text().length())
-
   std::vector< String > lines;
   lines.push_back( String() );
   for(int i=0; i<text().length(); ++i)
@@ -280,6 +189,36 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
       lines.back() += text()[i];
   }
 
+  // alignment
+  fvec2 align_offset(0,0);
+  if (alignment() & AlignHCenter)
+  {
+    VL_CHECK( !(alignment() & AlignRight) )
+    VL_CHECK( !(alignment() & AlignLeft) )
+    align_offset.x() -= (int)(bbox.width() / 2.0f);
+  }
+
+  if (alignment() & AlignRight)
+  {
+    VL_CHECK( !(alignment() & AlignHCenter) )
+    VL_CHECK( !(alignment() & AlignLeft) )
+    align_offset.x() -= (int)bbox.width();
+  }
+
+  if (alignment() & AlignTop)
+  {
+    VL_CHECK( !(alignment() & AlignBottom) )
+    VL_CHECK( !(alignment() & AlignVCenter) )
+    align_offset.y() -= (int)bbox.height();
+  }
+
+  if (alignment() & AlignVCenter)
+  {
+    VL_CHECK( !(alignment() & AlignTop) )
+    VL_CHECK( !(alignment() & AlignBottom) )
+    align_offset.y() -= int(bbox.height() / 2.0);
+  }
+
   for(unsigned iline=0; iline<lines.size(); iline++)
   {
     // strip spaces at the beginning and at the end of the line
@@ -366,23 +305,24 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
 
       if (glyph->textureHandle())
       {
-        glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
-
-        texc[0] = glyph->s0();
-        texc[1] = glyph->t1();
-        
-        texc[2] = glyph->s1();
-        texc[3] = glyph->t1();
+        if ( mLayoutRuns.empty() || mLayoutRuns.back().mTexture != glyph->textureHandle() )
+        {
+          TextureRun run;
+          run.mTexture = glyph->textureHandle();
+          run.mFirst   = (int)mLayoutVertices.size();
+          run.mCount   = 0;
+          mLayoutRuns.push_back(run);
+        }
+        mLayoutRuns.back().mCount += 4;
 
-        texc[4] = glyph->s1();
-        texc[5] = glyph->t0();
-        
-        texc[6] = glyph->s0();
-        texc[7] = glyph->t0();
+        mLayoutTexCoords.push_back( fvec2(glyph->s0(), glyph->t1()) );
+        mLayoutTexCoords.push_back( fvec2(glyph->s1(), glyph->t1()) );
+        mLayoutTexCoords.push_back( fvec2(glyph->s1(), glyph->t0()) );
+        mLayoutTexCoords.push_back( fvec2(glyph->s0(), glyph->t0()) );
 
         int left = layout() == RightToLeftText ? -glyph->left() : +glyph->left();
 
-        // triangle strip layout
+        fvec2 vect[4];
 
         vect[0].x() = pen.x() + glyph->width()*0 + left -1;
         vect[0].y() = pen.y() + glyph->height()*0 + glyph->top() - glyph->height() -1;
@@ -396,129 +336,24 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
         vect[3].x() = pen.x() + glyph->width()*0 + left -1;
         vect[3].y() = pen.y() + glyph->height()*1 + glyph->top() - glyph->height() +1;
 
-        if (layout() == RightToLeftText)
-        {
-  #if (1)
-          vect[0].x() -= glyph->width()-1 +2;
-          vect[1].x() -= glyph->width()-1 +2;
-          vect[2].x() -= glyph->width()-1 +2;
-          vect[3].x() -= glyph->width()-1 +2;
-  #endif
-        }
-
-        vect[0].y() -= mFont->mHeight;
-        vect[1].y() -= mFont->mHeight;
-        vect[2].y() -= mFont->mHeight;
-        vect[3].y() -= mFont->mHeight;
-
-  #if (1)
-        // normalize coordinate orgin to the bottom/left corner
-        vect[0] -= (fvec3)bbox.minCorner();
-        vect[1] -= (fvec3)bbox.minCorner();
-        vect[2] -= (fvec3)bbox.minCorner();
-        vect[3] -= (fvec3)bbox.minCorner();
-  #endif
-
-  #if (1)
-        vect[0].x() += applied_margin + displace;
-        vect[1].x() += applied_margin + displace;
-        vect[2].x() += applied_margin + displace;
-        vect[3].x() += applied_margin + displace;
-
-        vect[0].y() += applied_margin;
-        vect[1].y() += applied_margin;
-        vect[2].y() += applied_margin;
-        vect[3].y() += applied_margin;
-  #endif
-
-        // apply offset for outline rendering
-        vect[0].x() += offset.x();
-        vect[0].y() += offset.y();
-        vect[1].x() += offset.x();
-        vect[1].y() += offset.y();
-        vect[2].x() += offset.x();
-        vect[2].y() += offset.y();
-        vect[3].x() += offset.x();
-        vect[3].y() += offset.y();
-
-        // alignment
         for(int i=0; i<4; ++i)
         {
-          if (alignment() & AlignHCenter)
-          {
-            VL_CHECK( !(alignment() & AlignRight) )
-            VL_CHECK( !(alignment() & AlignLeft) )
-            vect[i].x() -= (int)(bbox.width() / 2.0f);
-          }
-
-          if (alignment() & AlignRight)
-          {
-            VL_CHECK( !(alignment() & AlignHCenter) )
-            VL_CHECK( !(alignment() & AlignLeft) )
-            vect[i].x() -= (int)bbox.width();
-          }
-
-          if (alignment() & AlignTop)
-          {
-            VL_CHECK( !(alignment() & AlignBottom) )
-            VL_CHECK( !(alignment() & AlignVCenter) )
-            vect[i].y() -= (int)bbox.height();
-          }
-
-          if (alignment() & AlignVCenter)
-          {
-            VL_CHECK( !(alignment() & AlignTop) )
-            VL_CHECK( !(alignment() & AlignBottom) )
-            vect[i].y() -= int(bbox.height() / 2.0);
-          }
-        }
+          if (layout() == RightToLeftText)
+            vect[i].x() -= glyph->width()-1 +2;
 
-        // apply text transform
-        vect[0] = m * vect[0];
-        vect[1] = m * vect[1];
-        vect[2] = m * vect[2];
-        vect[3] = m * vect[3];
+          vect[i].y() -= mFont->mHeight;
 
-        // actor's transform following in Text2D
-        if ( actor->transform() && mode() == Text2D )
-        {
-          vec4 v(0,0,0,1);
-          v = actor->transform()->worldMatrix() * v;
-
-          camera->project(v,v);
-
-          // from screen space to viewport space
-          v.x() -= viewport[0];
-          v.y() -= viewport[1];
-
-          v.x() = (float)int(v.x());
-          v.y() = (float)int(v.y());
-
-          vect[0].x() += (float)v.x();
-          vect[0].y() += (float)v.y();
-          vect[1].x() += (float)v.x();
-          vect[1].y() += (float)v.y();
-          vect[2].x() += (float)v.x();
-          vect[2].y() += (float)v.y();
-          vect[3].x() += (float)v.x();
-          vect[3].y() += (float)v.y();
-
-          // clever trick part #2
-          vect[0].z() = 
-          vect[1].z() = 
-          vect[2].z() = 
-          vect[3].z() = float((v.z() - 0.5f) / 0.5f);
-        }
+          // normalize coordinate orgin to the bottom/left corner
+          vect[i].x() -= (float)bbox.minCorner().x();
+          vect[i].y() -= (float)bbox.minCorner().y();
+
+          vect[i].x() += applied_margin + displace;
+          vect[i].y() += applied_margin;
 
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4); VL_CHECK_OGL();
+          vect[i] += align_offset;
 
-        #if (0)
-          glDisable(GL_TEXTURE_2D);
-          glColor3fv(vec3(1,0,0).ptr());
-          glDrawArrays(GL_LINE_LOOP, 0, 4);
-          glColor4fv(color.ptr());
-          glEnable(GL_TEXTURE_2D);
-        #endif
+          mLayoutVertices.push_back(vect[i]);
+        }
       }
 
       if (just_space && lines[iline][c] == ' ' && iline != lines.size()-1)
@@ -549,8 +384,161 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
         pen.x() -= glyph->advance().x();
         // pen.y() -= glyph->advance().y();
       }
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+// The matrix that maps the cached layout vertices to the viewport (Text2D) or to the Actor's space (Text3D).
+fmat4 Text::textMatrix(const Transform* follow, const Camera* camera, const fvec2& offset) const
+{
+  // viewport alignment
+  fmat4 m = mMatrix;
+
+  int w = camera->viewport()->width();
+  int h = camera->viewport()->height();
+
+  if (w < 1) w = 1;
+  if (h < 1) h = 1;
 
+  if ( !follow && mode() == Text2D )
+  {
+    if (viewportAlignment() & AlignHCenter)
+    {
+      VL_CHECK( !(viewportAlignment() & AlignRight) )
+      VL_CHECK( !(viewportAlignment() & AlignLeft) )
+      m.translate( (float)int((w-1.0f) / 2.0f), 0, 0);
+    }
+
+    if (viewportAlignment() & AlignRight)
+    {
+      VL_CHECK( !(viewportAlignment() & AlignHCenter) )
+      VL_CHECK( !(viewportAlignment() & AlignLeft) )
+      m.translate( (float)int(w-1.0f), 0, 0);
     }
+
+    if (viewportAlignment() & AlignTop)
+    {
+      VL_CHECK( !(viewportAlignment() & AlignBottom) )
+      VL_CHECK( !(viewportAlignment() & AlignVCenter) )
+      m.translate( 0, (float)int(h-1.0f), 0);
+    }
+
+    if (viewportAlignment() & AlignVCenter)
+    {
+      VL_CHECK( !(viewportAlignment() & AlignTop) )
+      VL_CHECK( !(viewportAlignment() & AlignBottom) )
+      m.translate( 0, (float)int((h-1.0f) / 2.0f), 0);
+    }
+  }
+
+  // the cached vertices are transformed by: the outline/shadow offset, the text matrix and the actor's screen position
+  m = m * fmat4::getTranslation(offset.x(), offset.y(), 0);
+
+  // actor's transform following in Text2D
+  if ( follow && mode() == Text2D )
+  {
+    vec4 v(0,0,0,1);
+    v = follow->worldMatrix() * v;
+
+    camera->project(v,v);
+
+    // from screen space to viewport space
+    v.x() -= camera->viewport()->x();
+    v.y() -= camera->viewport()->y();
+
+    v.x() = (float)int(v.x());
+    v.y() = (float)int(v.y());
+
+    m = fmat4::getTranslation((float)v.x(), (float)v.y(), 0) * m;
+
+    // clever trick part #2
+    m.e(2,0) = 0;
+    m.e(2,1) = 0;
+    m.e(2,2) = 0;
+    m.e(2,3) = float((v.z() - 0.5f) / 0.5f);
+  }
+
+  return m;
+}
+//-----------------------------------------------------------------------------
+void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& color, const fvec2& offset) const
+{
+  if(!mFont)
+  {
+    Log::error("Text::renderText() error: no Font assigned to the Text object.\n");
+    VL_TRAP()
+    return;
+  }
+
+  if (!font()->mFT_Face)
+  {
+    Log::error("Text::renderText() error: invalid FT_Face: probably you tried to load an unsupported font format.\n");
+    VL_TRAP()
+    return;
+  }
+
+  updateLayout();
+
+  if (mLayoutVertices.empty())
+    return;
+
+  int viewport[] = { camera->viewport()->x(), camera->viewport()->y(), camera->viewport()->width(), camera->viewport()->height() };
+
+  if (viewport[2] < 1) viewport[2] = 1;
+  if (viewport[3] < 1) viewport[3] = 1;
+
+  fmat4 m = textMatrix( actor ? actor->transform() : NULL, camera, offset );
+
+  // note that we only save and restore the server side states
+
+  if (mode() == Text2D)
+  {
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    // glLoadIdentity();
+    // gluOrtho2D( -0.5f, viewport[2]-0.5f, -0.5f, viewport[3]-0.5f );
+
+    // clever trick part #1
+    fmat4 mat = fmat4::getOrtho(-0.5f, viewport[2]-0.5f, -0.5f, viewport[3]-0.5f, -1, +1);
+    mat.e(2,2) = 1.0f; // preserve the z value from the incoming vertex.
+    mat.e(2,3) = 0.0f;
+    glLoadMatrixf(mat.ptr());
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadMatrixf(m.ptr());
+    VL_CHECK_OGL();
+  }
+  else
+  {
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glMultMatrixf(m.ptr());
+    VL_CHECK_OGL();
+  }
+
+  // basic render states
+
+  VL_glActiveTexture( GL_TEXTURE0 );
+  glEnable(GL_TEXTURE_2D);
+  VL_glClientActiveTexture( GL_TEXTURE0 );
+  glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+  glTexCoordPointer(2, GL_FLOAT, 0, mLayoutTexCoords[0].ptr());
+
+  // Constant color
+  glColor4f( color.r(), color.g(), color.b(), color.a() );
+
+  // Constant normal
+  glNormal3f( 0, 0, 1 );
+
+  glEnableClientState( GL_VERTEX_ARRAY );
+  glVertexPointer(2, GL_FLOAT, 0, mLayoutVertices[0].ptr());
+
+  // one draw call per atlas texture
+  for(size_t i=0; i<mLayoutRuns.size(); ++i)
+  {
+    glBindTexture( GL_TEXTURE_2D, mLayoutRuns[i].mTexture );
+    glDrawArrays( GL_QUADS, mLayoutRuns[i].mFirst, mLayoutRuns[i].mCount ); VL_CHECK_OGL();
   }
 
   glDisableClientState( GL_VERTEX_ARRAY ); VL_CHECK_OGL();
@@ -558,11 +546,11 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
 
   VL_CHECK_OGL();
 
+  glMatrixMode(GL_MODELVIEW);
+  glPopMatrix(); VL_CHECK_OGL()
+
   if (mode() == Text2D)
   {
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix(); VL_CHECK_OGL()
-
     glMatrixMode(GL_PROJECTION);
     glPopMatrix(); VL_CHECK_OGL()
   }
@@ -811,13 +799,22 @@ void Text::renderBorder(const Actor* actor, const Camera* camera) const
 //! the Text's matrix transform and the eventual actor's transform
 AABB Text::boundingRect() const
 {
-  return boundingRect(text());
+  updateLayout();
+  if (!mLayoutDirty)
+    return alignedBoundingRect(mLayoutRawBoundingRect);
+  else
+    return boundingRect(text());
 }
 //-----------------------------------------------------------------------------
 AABB Text::boundingRect(const String& text) const
+{
+  return alignedBoundingRect( rawboundingRect( text ) );
+}
+//-----------------------------------------------------------------------------
+AABB Text::alignedBoundingRect(const AABB& raw_bbox) const
 {
   int applied_margin = backgroundEnabled() || borderEnabled() ? margin() : 0;
-  AABB bbox = rawboundingRect( text );
+  AABB bbox = raw_bbox;
   bbox.setMaxCorner( bbox.maxCorner() + vec3(2.0f*applied_margin,2.0f*applied_margin,0) );
 
   // normalize coordinate orgin to the bottom/left corner
@@ -41,9 +41,17 @@
 
 namespace vl
 {
+  class Transform;
+
   /**
    * A Renderable that renders text with a given Font.
+   *
+   * The quads of all the glyphs of the text are generated once into a single vertex array and regenerated only when
+   * the text, the Font or the layout settings change. Since the glyphs are packed into the Font's atlas textures the
+   * whole text, including its shadow and outline, is usually rendered with one texture bind and one draw call per pass.
+   * Many Text2D labels can also be rendered together by a TextBatch.
    * \sa
+   * - TextBatch
    * - Actor
    * - VectorGraphics
   */
@@ -51,16 +59,19 @@ namespace vl
   {
     VL_INSTRUMENT_CLASS(vl::Text, Renderable)
 
+    friend class TextBatch;
+
   public:
     Text(): mColor(1,1,1,1), mBorderColor(0,0,0,1), mBackgroundColor(1,1,1,1), mOutlineColor(0,0,0,1), mShadowColor(0,0,0,0.5f), mShadowVector(2,-2), 
       mInterlineSpacing(5), mAlignment(AlignBottom|AlignLeft), mViewportAlignment(AlignBottom|AlignLeft), mMargin(5), mMode(Text2D), mLayout(LeftToRightText), mTextAlignment(TextAlignLeft), 
-      mBorderEnabled(false), mBackgroundEnabled(false), mOutlineEnabled(false), mShadowEnabled(false), mKerningEnabled(true) 
+      mBorderEnabled(false), mBackgroundEnabled(false), mOutlineEnabled(false), mShadowEnabled(false), mKerningEnabled(true),
+      mLayoutDirty(true), mLayoutFont(NULL), mLayoutFontVersion(0)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
 
     const String& text() const { return mText; }
-    void setText(const String& text) { mText = text; }
+    void setText(const String& text) { mText = text; mLayoutDirty = true; }
 
     const fvec4& color() const { return mColor; }
     void setColor(const fvec4& color) { mColor = color; }
@@ -81,17 +92,17 @@ namespace vl
     void setShadowVector(const fvec2& shadow_vector) { mShadowVector = shadow_vector; }
 
     int margin() const { return mMargin; }
-    void setMargin(int margin) { mMargin = margin; }
+    void setMargin(int margin) { mMargin = margin; mLayoutDirty = true; }
 
     const Font* font() const { return mFont.get(); }
     Font* font() { return mFont.get(); }
-    void setFont(Font* font) { mFont = font; }
+    void setFont(Font* font) { mFont = font; mLayoutDirty = true; }
 
     const fmat4 matrix() const { return mMatrix; }
     void setMatrix(const fmat4& matrix) { mMatrix = matrix; }
 
     int  alignment() const { return mAlignment; }
-    void setAlignment(int  align) { mAlignment = align; }
+    void setAlignment(int  align) { mAlignment = align; mLayoutDirty = true; }
 
     int  viewportAlignment() const { return mViewportAlignment; }
     void setViewportAlignment(int  align) { mViewportAlignment = align; }
@@ -103,19 +114,19 @@ namespace vl
     void setMode(ETextMode mode) { mMode = mode; }
 
     ETextLayout layout() const { return mLayout; }
-    void setLayout(ETextLayout layout) { mLayout = layout; }
+    void setLayout(ETextLayout layout) { mLayout = layout; mLayoutDirty = true; }
 
     ETextAlign textAlignment() const { return mTextAlignment; }
-    void setTextAlignment(ETextAlign align) { mTextAlignment = align; }
+    void setTextAlignment(ETextAlign align) { mTextAlignment = align; mLayoutDirty = true; }
 
     bool borderEnabled() const { return mBorderEnabled; }
-    void setBorderEnabled(bool border) { mBorderEnabled = border; }
+    void setBorderEnabled(bool border) { mBorderEnabled = border; mLayoutDirty = true; }
 
     bool backgroundEnabled() const { return mBackgroundEnabled; }
-    void setBackgroundEnabled(bool background) { mBackgroundEnabled = background; }
+    void setBackgroundEnabled(bool background) { mBackgroundEnabled = background; mLayoutDirty = true; }
 
     bool kerningEnabled() const { return mKerningEnabled; }
-    void setKerningEnabled(bool kerning) { mKerningEnabled = kerning; }
+    void setKerningEnabled(bool kerning) { mKerningEnabled = kerning; mLayoutDirty = true; }
 
     bool outlineEnabled() const { return mOutlineEnabled; }
     void setOutlineEnabled(bool outline) { mOutlineEnabled = outline; }
@@ -140,11 +151,36 @@ namespace vl
 
     virtual void deleteBufferObject() {}
 
+    /**
+     * Generates, if needed, the quads of all the glyphs of the text: 4 vertices and 4 texture coordinates per glyph, in the
+     * same space used by boundingRect(), i.e. before the Text's matrix and the Actor's transform are applied.
+     * Called automatically before rendering. Requires an active OpenGL context if new glyphs need to be created.
+     */
+    void updateLayout() const;
+
+    //! The vertices generated by updateLayout(), 4 per glyph.
+    const std::vector<fvec2>& layoutVertices() const { return mLayoutVertices; }
+
+    //! The texture coordinates generated by updateLayout(), 4 per glyph.
+    const std::vector<fvec2>& layoutTexCoords() const { return mLayoutTexCoords; }
+
+  protected:
+    //! A range of glyph quads sharing the same atlas texture.
+    struct TextureRun
+    {
+      unsigned int mTexture;
+      int mFirst;
+      int mCount;
+    };
+
   protected:
+    //! The matrix applied to the layout vertices: Text matrix, viewport alignment, \p offset and, if \p follow is not NULL, its screen position.
+    fmat4 textMatrix(const Transform* follow, const Camera* camera, const fvec2& offset) const;
     void renderText(const Actor*, const Camera* camera, const fvec4& color, const fvec2& offset) const;
     void renderBackground(const Actor* actor, const Camera* camera) const;
     void renderBorder(const Actor* actor, const Camera* camera) const;
     AABB rawboundingRect(const String& text) const;
+    AABB alignedBoundingRect(const AABB& raw_bbox) const;
 
   protected:
     mutable ref<Font> mFont;
@@ -168,6 +204,14 @@ namespace vl
     bool mOutlineEnabled;
     bool mShadowEnabled;
     bool mKerningEnabled;
+    // layout cache
+    mutable std::vector<fvec2> mLayoutVertices;
+    mutable std::vector<fvec2> mLayoutTexCoords;
+    mutable std::vector<TextureRun> mLayoutRuns;
+    mutable AABB mLayoutRawBoundingRect;
+    mutable bool mLayoutDirty;
+    mutable const Font* mLayoutFont;
+    mutable int mLayoutFontVersion;
   };
 }
 
@@ -0,0 +1,182 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlGraphics/TextBatch.hpp>
+#include <vlGraphics/OpenGLContext.hpp>
+#include <vlGraphics/Camera.hpp>
+
+using namespace vl;
+
+namespace
+{
+  //! The layers of the labels, rendered in this order.
+  enum { ShadowLayer, OutlineLayer, TextLayer, LayerCount };
+}
+//-----------------------------------------------------------------------------
+TextBatch::Bucket& TextBatch::bucket(int layer, unsigned int texture) const
+{
+  for(size_t i=0; i<mBuckets.size(); ++i)
+  {
+    if (mBuckets[i].mLayer == layer && mBuckets[i].mTexture == texture)
+      return mBuckets[i];
+  }
+  mBuckets.push_back(Bucket());
+  mBuckets.back().mLayer = layer;
+  mBuckets.back().mTexture = texture;
+  return mBuckets.back();
+}
+//-----------------------------------------------------------------------------
+void TextBatch::appendQuads(const Text* text, const fmat4& m, int layer, const fvec2& offset, const fvec4& color) const
+{
+  const std::vector<fvec2>& verts = text->layoutVertices();
+  const std::vector<fvec2>& texc = text->layoutTexCoords();
+  for(size_t irun=0; irun<text->mLayoutRuns.size(); ++irun)
+  {
+    const Text::TextureRun& run = text->mLayoutRuns[irun];
+    Bucket& b = bucket(layer, run.mTexture);
+    size_t start = b.mVertices.size();
+    b.mVertices.resize(start + run.mCount);
+    b.mTexCoords.insert(b.mTexCoords.end(), texc.begin() + run.mFirst, texc.begin() + run.mFirst + run.mCount);
+    b.mColors.resize(start + run.mCount, color);
+    // same as the matrix set up by Text::renderText() applied to vertices with z = 0
+    for(int i=0; i<run.mCount; ++i)
+    {
+      const fvec2& v = verts[run.mFirst + i];
+      const float x = v.x() + offset.x();
+      const float y = v.y() + offset.y();
+      b.mVertices[start + i] = fvec3( m.e(0,0)*x + m.e(0,1)*y + m.e(0,3), m.e(1,0)*x + m.e(1,1)*y + m.e(1,3), m.e(2,0)*x + m.e(2,1)*y + m.e(2,3) );
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+void TextBatch::render_Implementation(const Actor*, const Shader*, const Camera* camera, OpenGLContext* gl_context) const
+{
+  gl_context->bindVAS(NULL, false, false);
+
+  mLastDrawCount = 0;
+  for(size_t i=0; i<mBuckets.size(); ++i)
+  {
+    mBuckets[i].mVertices.clear();
+    mBuckets[i].mTexCoords.clear();
+    mBuckets[i].mColors.clear();
+  }
+
+  // collect the quads of all the labels, the Text matrices are applied here instead of by OpenGL
+  for(size_t i=0; i<mEntries.size(); ++i)
+  {
+    const Text* text = mEntries[i].mText.get();
+    VL_CHECK(text->mode() == Text2D)
+    if (text->mode() != Text2D || !text->font() || text->text().empty())
+      continue;
+    text->updateLayout();
+    if (text->layoutVertices().empty())
+      continue;
+
+    const fmat4 m = text->textMatrix( mEntries[i].mFollow.get(), camera, fvec2(0,0) );
+    if (text->shadowEnabled())
+      appendQuads( text, m, ShadowLayer, text->shadowVector(), text->shadowColor() );
+    if (text->outlineEnabled())
+    {
+      appendQuads( text, m, OutlineLayer, fvec2(-1,0), text->outlineColor() );
+      appendQuads( text, m, OutlineLayer, fvec2(+1,0), text->outlineColor() );
+      appendQuads( text, m, OutlineLayer, fvec2(0,-1), text->outlineColor() );
+      appendQuads( text, m, OutlineLayer, fvec2(0,+1), text->outlineColor() );
+    }
+    appendQuads( text, m, TextLayer, fvec2(0,0), text->color() );
+  }
+
+  int viewport[] = { camera->viewport()->width(), camera->viewport()->height() };
+  if (viewport[0] < 1) viewport[0] = 1;
+  if (viewport[1] < 1) viewport[1] = 1;
+
+  // same projection as Text2D, see Text::renderText()
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  fmat4 mat = fmat4::getOrtho(-0.5f, viewport[0]-0.5f, -0.5f, viewport[1]-0.5f, -1, +1);
+  mat.e(2,2) = 1.0f; // preserve the z value from the incoming vertex.
+  mat.e(2,3) = 0.0f;
+  glLoadMatrixf(mat.ptr());
+
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+  VL_CHECK_OGL();
+
+  // like Text the glyphs don't write to the z-buffer
+  GLboolean depth_mask=0;
+  glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+  glDepthMask(GL_FALSE);
+
+  VL_glActiveTexture( GL_TEXTURE0 );
+  glEnable(GL_TEXTURE_2D);
+  VL_glClientActiveTexture( GL_TEXTURE0 );
+  glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+  glEnableClientState( GL_VERTEX_ARRAY );
+  glEnableClientState( GL_COLOR_ARRAY );
+  glNormal3f( 0, 0, 1 );
+
+  // one draw call per layer and atlas texture
+  for(int layer=0; layer<LayerCount; ++layer)
+  {
+    for(size_t i=0; i<mBuckets.size(); ++i)
+    {
+      const Bucket& b = mBuckets[i];
+      if (b.mLayer != layer || b.mVertices.empty())
+        continue;
+      glBindTexture( GL_TEXTURE_2D, b.mTexture );
+      glVertexPointer(3, GL_FLOAT, 0, b.mVertices[0].ptr());
+      glTexCoordPointer(2, GL_FLOAT, 0, b.mTexCoords[0].ptr());
+      glColorPointer(4, GL_FLOAT, 0, b.mColors[0].ptr());
+      glDrawArrays( GL_QUADS, 0, (int)b.mVertices.size() ); VL_CHECK_OGL();
+      ++mLastDrawCount;
+    }
+  }
+
+  glDisableClientState( GL_COLOR_ARRAY );
+  glDisableClientState( GL_VERTEX_ARRAY );
+  glDisableClientState( GL_TEXTURE_COORD_ARRAY ); VL_CHECK_OGL();
+
+  glDepthMask(depth_mask);
+
+  glMatrixMode(GL_MODELVIEW);
+  glPopMatrix();
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix(); VL_CHECK_OGL()
+
+  glDisable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D,0);
+
+  // restore the right color and normal since we changed them
+  glColor4fv( gl_context->color().ptr() );
+  glNormal3fv( gl_context->normal().ptr() );
+}
+//-----------------------------------------------------------------------------
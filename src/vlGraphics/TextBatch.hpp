@@ -0,0 +1,129 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#ifndef TextBatch_INCLUDE_ONCE
+#define TextBatch_INCLUDE_ONCE
+
+#include <vlGraphics/Text.hpp>
+#include <vlCore/Transform.hpp>
+#include <vector>
+
+namespace vl
+{
+  /**
+   * A Renderable that renders the glyphs of many Text2D labels with a few draw calls.
+   *
+   * Rendering each label through its own Actor costs at least one draw call, plus the matrix and texture setup, per label
+   * and per pass. TextBatch instead transforms the cached quads of all its Text objects (see Text::updateLayout()) on the
+   * CPU every frame and renders them with a single glDrawArrays() per layer and per atlas texture, using a per-vertex color.
+   * The layers are rendered in this order: the shadows of all the labels, their outlines and finally their text, so the
+   * shadow of a label never covers the text of another one.
+   *
+   * Each Text keeps its own text, Font, colors, matrix, alignment, viewport alignment, shadow and outline settings.
+   * A Text can also follow a Transform, like a Text2D assigned to an Actor with a Transform does.
+   * Only Text2D labels are rendered, and their background and border are not rendered by the batch.
+   * The Effect used to render the TextBatch should enable blending as for Text.
+   * \sa
+   * - Text
+   * - Font
+  */
+  class VLGRAPHICS_EXPORT TextBatch: public Renderable
+  {
+    VL_INSTRUMENT_CLASS(vl::TextBatch, Renderable)
+
+  public:
+    TextBatch(): mLastDrawCount(0)
+    {
+      VL_DEBUG_SET_OBJECT_NAME()
+    }
+
+    //! Adds a Text to the batch, if \p follow is not NULL the Text is placed at the screen position of its origin.
+    void addText(Text* text, Transform* follow=NULL)
+    {
+      Entry entry;
+      entry.mText = text;
+      entry.mFollow = follow;
+      mEntries.push_back(entry);
+    }
+
+    //! Removes all the Text objects from the batch.
+    void clear() { mEntries.clear(); }
+
+    int textCount() const { return (int)mEntries.size(); }
+
+    Text* text(int i) { return mEntries[i].mText.get(); }
+    const Text* text(int i) const { return mEntries[i].mText.get(); }
+
+    Transform* follow(int i) { return mEntries[i].mFollow.get(); }
+    const Transform* follow(int i) const { return mEntries[i].mFollow.get(); }
+
+    //! The number of glDrawArrays() issued by the last rendering.
+    int lastDrawCount() const { return mLastDrawCount; }
+
+    virtual void render_Implementation(const Actor* actor, const Shader* shader, const Camera* camera, OpenGLContext* gl_context) const;
+    void computeBounds_Implementation() { setBoundingBox(AABB()); setBoundingSphere(Sphere()); }
+
+    // Renderable interface implementation.
+
+    virtual void updateDirtyBufferObject(EBufferObjectUpdateMode) {}
+
+    virtual void deleteBufferObject() {}
+
+  protected:
+    struct Entry
+    {
+      ref<Text> mText;
+      ref<Transform> mFollow;
+    };
+
+    //! The quads of one layer using the same atlas texture.
+    struct Bucket
+    {
+      int mLayer;
+      unsigned int mTexture;
+      std::vector<fvec3> mVertices;
+      std::vector<fvec2> mTexCoords;
+      std::vector<fvec4> mColors;
+    };
+
+    void appendQuads(const Text* text, const fmat4& m, int layer, const fvec2& offset, const fvec4& color) const;
+    Bucket& bucket(int layer, unsigned int texture) const;
+
+  protected:
+    std::vector<Entry> mEntries;
+    // rebuilt at every rendering, kept to reuse their memory
+    mutable std::vector<Bucket> mBuckets;
+    mutable int mLastDrawCount;
+  };
+}
+
+#endif
@@ -879,9 +879,10 @@ bool Texture::setMipLevel(int mip_level, const Image* img, bool gen_mipmaps)
 
   glBindTexture( dimension(), mHandle ); VL_CHECK_OGL()
 
-  int w = width()  + (border()?2:0);
-  int h = height() + (border()?2:0);
-  int d = depth()  + (border()?2:0);
+  // the size of the mipmap level, not of the texture
+  int w = img->width()  + (border()?2:0);
+  int h = img->height() + (border()?2:0);
+  int d = img->depth()  + (border()?2:0);
   int is_compressed = (int)img->format() == (int)internalFormat() && isCompressedFormat( internalFormat() );
 
   bool use_glu = false;
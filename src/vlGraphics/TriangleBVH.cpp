@@ -0,0 +1,664 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/TriangleBVH.hpp>
+#include <vlGraphics/Geometry.hpp>
+#include <limits>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+  #define VL_TRIANGLE_BVH_SSE 1
+  #include <xmmintrin.h>
+#else
+  #define VL_TRIANGLE_BVH_SSE 0
+#endif
+
+using namespace vl;
+
+namespace
+{
+  //! The traversal stacks are sized accordingly, deeper nodes become leaves.
+  const int MaxDepth = 64;
+
+  //! Number of bins of the SAH builder.
+  const int BinCount = 16;
+
+  inline float halfArea(const float* mn, const float* mx)
+  {
+    float dx = mx[0] - mn[0];
+    float dy = mx[1] - mn[1];
+    float dz = mx[2] - mn[2];
+    return dx*dy + dy*dz + dz*dx;
+  }
+
+  inline void growBounds(float* mn, float* mx, const float* bmin, const float* bmax)
+  {
+    for(int i=0; i<3; ++i)
+    {
+      mn[i] = bmin[i] < mn[i] ? bmin[i] : mn[i];
+      mx[i] = bmax[i] > mx[i] ? bmax[i] : mx[i];
+    }
+  }
+
+  inline void resetBounds(float* mn, float* mx)
+  {
+    mn[0] = mn[1] = mn[2] = +std::numeric_limits<float>::max();
+    mx[0] = mx[1] = mx[2] = -std::numeric_limits<float>::max();
+  }
+
+  //-----------------------------------------------------------------------------
+  // RayData
+  //-----------------------------------------------------------------------------
+  //! Ray origin, direction and inverse direction used by the traversal.
+  struct RayData
+  {
+    RayData(const fvec3& orig, const fvec3& dir)
+    {
+      for(int i=0; i<3; ++i)
+      {
+        mOrig[i] = orig[i];
+        mDir[i]  = dir[i];
+        mInvDir[i] = 1.0f / dir[i];
+      }
+      mOrig[3] = mDir[3] = mInvDir[3] = 0;
+#if VL_TRIANGLE_BVH_SSE
+      mOrig4   = _mm_loadu_ps(mOrig);
+      mInvDir4 = _mm_loadu_ps(mInvDir);
+#endif
+    }
+
+    float mOrig[4];
+    float mDir[4];
+    float mInvDir[4];
+#if VL_TRIANGLE_BVH_SSE
+    __m128 mOrig4;
+    __m128 mInvDir4;
+#endif
+  };
+
+  //! Slab test, returns true if the ray enters the box within [0, tmax] and the entry distance in \p tnear.
+  inline bool rayBox(const float* bmin, const float* bmax, const RayData& ray, float tmax, float& tnear)
+  {
+#if VL_TRIANGLE_BVH_SSE
+    // the 4th lane holds the node offset/count and is ignored
+    __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bmin), ray.mOrig4), ray.mInvDir4);
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bmax), ray.mOrig4), ray.mInvDir4);
+    __m128 lo = _mm_min_ps(t0, t1);
+    __m128 hi = _mm_max_ps(t0, t1);
+    __m128 n = _mm_max_ss(_mm_max_ss(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1,1,1,1))), _mm_max_ss(_mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2,2,2,2)), _mm_setzero_ps()));
+    __m128 f = _mm_min_ss(_mm_min_ss(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1,1,1,1))), _mm_min_ss(_mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2,2,2,2)), _mm_set_ss(tmax)));
+    _mm_store_ss(&tnear, n);
+    return _mm_comile_ss(n, f) != 0;
+#else
+    float n = 0;
+    float f = tmax;
+    for(int i=0; i<3; ++i)
+    {
+      float t0 = (bmin[i] - ray.mOrig[i]) * ray.mInvDir[i];
+      float t1 = (bmax[i] - ray.mOrig[i]) * ray.mInvDir[i];
+      if (t0 > t1)
+        std::swap(t0, t1);
+      n = t0 > n ? t0 : n;
+      f = t1 < f ? t1 : f;
+    }
+    tnear = n;
+    return n <= f;
+#endif
+  }
+
+  //! Double sided Moller-Trumbore test.
+  inline bool rayTriangle(const float* v0, const float* e1, const float* e2, const RayData& ray, float tmax, float& t, float& u, float& v)
+  {
+    const float* d = ray.mDir;
+    float p[] = { d[1]*e2[2] - d[2]*e2[1], d[2]*e2[0] - d[0]*e2[2], d[0]*e2[1] - d[1]*e2[0] };
+    float det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+    if (det == 0)
+      return false;
+    float inv_det = 1.0f / det;
+    float s[] = { ray.mOrig[0] - v0[0], ray.mOrig[1] - v0[1], ray.mOrig[2] - v0[2] };
+    u = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2]) * inv_det;
+    if (u < 0 || u > 1)
+      return false;
+    float q[] = { s[1]*e1[2] - s[2]*e1[1], s[2]*e1[0] - s[0]*e1[2], s[0]*e1[1] - s[1]*e1[0] };
+    v = (d[0]*q[0] + d[1]*q[1] + d[2]*q[2]) * inv_det;
+    if (v < 0 || u + v > 1)
+      return false;
+    t = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2]) * inv_det;
+    return t >= 0 && t <= tmax;
+  }
+}
+//-----------------------------------------------------------------------------
+// TriangleBVH
+//-----------------------------------------------------------------------------
+void TriangleBVH::clear()
+{
+  mNodes.clear();
+  mTriangles.clear();
+  mTriangleInfo.clear();
+  mDrawCalls.clear();
+  mPositions = NULL;
+  mVertexCount = 0;
+  mPositionsTick = 0;
+  mBoundsUpdateTick = 0;
+  mBuilt = false;
+}
+//-----------------------------------------------------------------------------
+bool TriangleBVH::build(Geometry* geom)
+{
+  clear();
+
+  // the snapshot is taken also when the build fails, see isUpToDate()
+  ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
+  geom->boundingBox();
+  mPositions = posarr;
+  mVertexCount = posarr ? posarr->size() : 0;
+  mPositionsTick = posarr ? posarr->bufferChangedTick() : 0;
+  mBoundsUpdateTick = geom->boundsUpdateTick();
+  for(int i=0; i<geom->drawCalls()->size(); ++i)
+    mDrawCalls.push_back( geom->drawCalls()->at(i) );
+  mBuilt = true;
+
+  if (!posarr || !posarr->size())
+    return false;
+
+  // collect the triangles
+  std::vector<TriangleData> triangles;
+  std::vector<BuildRef> refs;
+  for(int idc=0; idc<(int)mDrawCalls.size(); ++idc)
+  {
+    int itri = 0;
+    for(TriangleIterator trit = mDrawCalls[idc]->triangleIterator(); trit.hasNext(); trit.next(), ++itri)
+    {
+      TriangleInfo info;
+      info.mIndex[0] = trit.a();
+      info.mIndex[1] = trit.b();
+      info.mIndex[2] = trit.c();
+      info.mDrawCall = idc;
+      info.mDrawCallIndex = itri;
+      VL_CHECK( info.mIndex[0] < (int)mVertexCount && info.mIndex[1] < (int)mVertexCount && info.mIndex[2] < (int)mVertexCount )
+
+      fvec3 a = posarr->getAsVec3(info.mIndex[0]);
+      fvec3 b = posarr->getAsVec3(info.mIndex[1]);
+      fvec3 c = posarr->getAsVec3(info.mIndex[2]);
+
+      TriangleData tri;
+      BuildRef ref;
+      for(int k=0; k<3; ++k)
+      {
+        tri.mV0[k] = a[k];
+        tri.mE1[k] = b[k] - a[k];
+        tri.mE2[k] = c[k] - a[k];
+        ref.mMin[k] = a[k] < b[k] ? (a[k] < c[k] ? a[k] : c[k]) : (b[k] < c[k] ? b[k] : c[k]);
+        ref.mMax[k] = a[k] > b[k] ? (a[k] > c[k] ? a[k] : c[k]) : (b[k] > c[k] ? b[k] : c[k]);
+        ref.mCenter[k] = (ref.mMin[k] + ref.mMax[k]) * 0.5f;
+      }
+      ref.mTriangle = (int)triangles.size();
+      triangles.push_back(tri);
+      mTriangleInfo.push_back(info);
+      refs.push_back(ref);
+    }
+  }
+
+  if (refs.empty())
+  {
+    mTriangleInfo.clear();
+    return false;
+  }
+
+  mNodes.reserve( refs.size() * 2 / (mMaxLeafSize > 1 ? mMaxLeafSize : 1) + 1 );
+  buildNode(refs, 0, (int)refs.size(), 0);
+
+  // store the triangles in leaf order
+  std::vector<TriangleInfo> info;
+  info.reserve(refs.size());
+  mTriangles.reserve(refs.size());
+  for(size_t i=0; i<refs.size(); ++i)
+  {
+    mTriangles.push_back( triangles[refs[i].mTriangle] );
+    info.push_back( mTriangleInfo[refs[i].mTriangle] );
+  }
+  mTriangleInfo.swap(info);
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+int TriangleBVH::buildNode(std::vector<BuildRef>& refs, int start, int end, int depth)
+{
+  int inode = (int)mNodes.size();
+  mNodes.push_back(Node());
+
+  float mn[3], mx[3], cmn[3], cmx[3];
+  resetBounds(mn, mx);
+  resetBounds(cmn, cmx);
+  for(int i=start; i<end; ++i)
+  {
+    growBounds(mn, mx, refs[i].mMin, refs[i].mMax);
+    growBounds(cmn, cmx, refs[i].mCenter, refs[i].mCenter);
+  }
+  for(int k=0; k<3; ++k)
+  {
+    mNodes[inode].mMin[k] = mn[k];
+    mNodes[inode].mMax[k] = mx[k];
+  }
+
+  int count = end - start;
+  if (count <= mMaxLeafSize || depth >= MaxDepth-1)
+  {
+    mNodes[inode].mOffset = start;
+    mNodes[inode].mCount  = count;
+    return inode;
+  }
+
+  // split along the axis with the largest centroid extent
+  int axis = 0;
+  for(int k=1; k<3; ++k)
+    if (cmx[k] - cmn[k] > cmx[axis] - cmn[axis])
+      axis = k;
+  float extent = cmx[axis] - cmn[axis];
+
+  int mid = start + count / 2;
+  if (extent > 0)
+  {
+    // binned SAH
+    int bin_count[BinCount];
+    float bin_min[BinCount][3], bin_max[BinCount][3];
+    for(int b=0; b<BinCount; ++b)
+    {
+      bin_count[b] = 0;
+      resetBounds(bin_min[b], bin_max[b]);
+    }
+    float scale = BinCount * 0.9999f / extent;
+    for(int i=start; i<end; ++i)
+    {
+      int b = (int)((refs[i].mCenter[axis] - cmn[axis]) * scale);
+      b = b < BinCount ? b : BinCount-1;
+      ++bin_count[b];
+      growBounds(bin_min[b], bin_max[b], refs[i].mMin, refs[i].mMax);
+    }
+
+    // right to left sweep
+    float right_cost[BinCount];
+    float rmn[3], rmx[3];
+    resetBounds(rmn, rmx);
+    int rcount = 0;
+    for(int b=BinCount-1; b>0; --b)
+    {
+      rcount += bin_count[b];
+      if (bin_count[b])
+        growBounds(rmn, rmx, bin_min[b], bin_max[b]);
+      right_cost[b] = rcount ? halfArea(rmn, rmx) * rcount : 0;
+    }
+
+    // left to right sweep, split between bin b-1 and bin b
+    float lmn[3], lmx[3];
+    resetBounds(lmn, lmx);
+    int lcount = 0;
+    int best_split = -1;
+    float best_cost = std::numeric_limits<float>::max();
+    for(int b=1; b<BinCount; ++b)
+    {
+      lcount += bin_count[b-1];
+      if (bin_count[b-1])
+        growBounds(lmn, lmx, bin_min[b-1], bin_max[b-1]);
+      if (lcount == 0 || lcount == count)
+        continue;
+      float cost = halfArea(lmn, lmx) * lcount + right_cost[b];
+      if (cost < best_cost)
+      {
+        best_cost = cost;
+        best_split = b;
+      }
+    }
+
+    if (best_split > 0)
+    {
+      // partition the references around the split bin
+      int i = start;
+      int j = end - 1;
+      while(i <= j)
+      {
+        int b = (int)((refs[i].mCenter[axis] - cmn[axis]) * scale);
+        b = b < BinCount ? b : BinCount-1;
+        if (b < best_split)
+          ++i;
+        else
+          std::swap(refs[i], refs[j--]);
+      }
+      mid = i;
+    }
+  }
+  // all the centroids coincide: any split will do
+  VL_CHECK(mid > start && mid < end)
+
+  buildNode(refs, start, mid, depth+1);
+  int right = buildNode(refs, mid, end, depth+1);
+  mNodes[inode].mOffset = right;
+  mNodes[inode].mCount  = 0;
+  return inode;
+}
+//-----------------------------------------------------------------------------
+bool TriangleBVH::isUpToDate(const Geometry* geom) const
+{
+  const ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
+  if (!mBuilt || posarr != mPositions.get())
+    return false;
+  if (posarr && (posarr->size() != mVertexCount || posarr->bufferChangedTick() != mPositionsTick))
+    return false;
+  if (geom->boundsDirty() || geom->boundsUpdateTick() != mBoundsUpdateTick)
+    return false;
+  if (geom->drawCalls()->size() != (int)mDrawCalls.size())
+    return false;
+  for(int i=0; i<geom->drawCalls()->size(); ++i)
+    if (geom->drawCalls()->at(i) != mDrawCalls[i].get())
+      return false;
+  return true;
+}
+//-----------------------------------------------------------------------------
+AABB TriangleBVH::boundingBox() const
+{
+  AABB aabb;
+  if (!mNodes.empty())
+  {
+    aabb.setMinCorner( mNodes[0].mMin[0], mNodes[0].mMin[1], mNodes[0].mMin[2] );
+    aabb.setMaxCorner( mNodes[0].mMax[0], mNodes[0].mMax[1], mNodes[0].mMax[2] );
+  }
+  return aabb;
+}
+//-----------------------------------------------------------------------------
+bool TriangleBVH::intersectClosest(const fvec3& orig, const fvec3& dir, float tmax, Hit& hit) const
+{
+  hit = Hit();
+  float tnear = 0;
+  if (mNodes.empty())
+    return false;
+  RayData ray(orig, dir);
+  if (!rayBox(mNodes[0].mMin, mNodes[0].mMax, ray, tmax, tnear))
+    return false;
+
+  int stack[MaxDepth*2];
+  float stack_t[MaxDepth*2];
+  int sp = 0;
+  int inode = 0;
+  for(;;)
+  {
+    const Node& node = mNodes[inode];
+    if (node.mCount)
+    {
+      for(int i=node.mOffset; i<node.mOffset+node.mCount; ++i)
+      {
+        const TriangleData& tri = mTriangles[i];
+        float t, u, v;
+        if (rayTriangle(tri.mV0, tri.mE1, tri.mE2, ray, tmax, t, u, v))
+        {
+          tmax = t;
+          hit.t = t;
+          hit.u = u;
+          hit.v = v;
+          hit.triangle = i;
+        }
+      }
+    }
+    else
+    {
+      // visit the nearest child first
+      int c0 = inode + 1;
+      int c1 = node.mOffset;
+      float t0 = 0, t1 = 0;
+      bool h0 = rayBox(mNodes[c0].mMin, mNodes[c0].mMax, ray, tmax, t0);
+      bool h1 = rayBox(mNodes[c1].mMin, mNodes[c1].mMax, ray, tmax, t1);
+      if (h0 && h1)
+      {
+        if (t1 < t0)
+        {
+          std::swap(c0, c1);
+          std::swap(t0, t1);
+        }
+        stack[sp] = c1;
+        stack_t[sp] = t1;
+        ++sp;
+        inode = c0;
+        continue;
+      }
+      else
+      if (h0 || h1)
+      {
+        inode = h0 ? c0 : c1;
+        continue;
+      }
+    }
+
+    // pop the next node still closer than the current hit
+    for(inode=-1; sp && inode == -1; )
+    {
+      --sp;
+      if (stack_t[sp] <= tmax)
+        inode = stack[sp];
+    }
+    if (inode == -1)
+      break;
+  }
+
+  return hit.triangle != -1;
+}
+//-----------------------------------------------------------------------------
+bool TriangleBVH::intersectAny(const fvec3& orig, const fvec3& dir, float tmax) const
+{
+  if (mNodes.empty())
+    return false;
+  RayData ray(orig, dir);
+  int stack[MaxDepth*2];
+  int sp = 0;
+  stack[sp++] = 0;
+  while(sp)
+  {
+    const Node& node = mNodes[stack[--sp]];
+    float tnear = 0;
+    if (!rayBox(node.mMin, node.mMax, ray, tmax, tnear))
+      continue;
+    if (node.mCount)
+    {
+      for(int i=node.mOffset; i<node.mOffset+node.mCount; ++i)
+      {
+        const TriangleData& tri = mTriangles[i];
+        float t, u, v;
+        if (rayTriangle(tri.mV0, tri.mE1, tri.mE2, ray, tmax, t, u, v))
+          return true;
+      }
+    }
+    else
+    {
+      stack[sp++] = node.mOffset;
+      stack[sp++] = (int)(&node - &mNodes[0]) + 1;
+    }
+  }
+  return false;
+}
+//-----------------------------------------------------------------------------
+void TriangleBVH::intersectAll(const fvec3& orig, const fvec3& dir, float tmax, std::vector<Hit>& hits) const
+{
+  if (mNodes.empty())
+    return;
+  RayData ray(orig, dir);
+  int stack[MaxDepth*2];
+  int sp = 0;
+  stack[sp++] = 0;
+  while(sp)
+  {
+    const Node& node = mNodes[stack[--sp]];
+    float tnear = 0;
+    if (!rayBox(node.mMin, node.mMax, ray, tmax, tnear))
+      continue;
+    if (node.mCount)
+    {
+      for(int i=node.mOffset; i<node.mOffset+node.mCount; ++i)
+      {
+        const TriangleData& tri = mTriangles[i];
+        Hit hit;
+        if (rayTriangle(tri.mV0, tri.mE1, tri.mE2, ray, tmax, hit.t, hit.u, hit.v))
+        {
+          hit.triangle = i;
+          hits.push_back(hit);
+        }
+      }
+    }
+    else
+    {
+      stack[sp++] = node.mOffset;
+      stack[sp++] = (int)(&node - &mNodes[0]) + 1;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+void TriangleBVH::intersectPacket(const fvec3* orig, const fvec3* dir, int count, float tmax, Hit* hits) const
+{
+#if VL_TRIANGLE_BVH_SSE
+  for(int base=0; base<count; base+=4)
+  {
+    int lanes = count - base < 4 ? count - base : 4;
+    for(int i=0; i<lanes; ++i)
+      hits[base+i] = Hit();
+    if (mNodes.empty())
+      continue;
+
+    // SoA packet, the unused lanes replicate the first ray
+    float ox[4], oy[4], oz[4], dx[4], dy[4], dz[4];
+    for(int i=0; i<4; ++i)
+    {
+      int r = base + (i < lanes ? i : 0);
+      ox[i] = orig[r].x(); oy[i] = orig[r].y(); oz[i] = orig[r].z();
+      dx[i] = dir[r].x();  dy[i] = dir[r].y();  dz[i] = dir[r].z();
+    }
+    const __m128 one  = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 OX = _mm_loadu_ps(ox), OY = _mm_loadu_ps(oy), OZ = _mm_loadu_ps(oz);
+    __m128 DX = _mm_loadu_ps(dx), DY = _mm_loadu_ps(dy), DZ = _mm_loadu_ps(dz);
+    __m128 IX = _mm_div_ps(one, DX), IY = _mm_div_ps(one, DY), IZ = _mm_div_ps(one, DZ);
+    __m128 T = _mm_set1_ps(tmax);
+    __m128 U = zero, V = zero;
+    int tri_hit[4] = { -1, -1, -1, -1 };
+
+    int stack[MaxDepth*2];
+    int sp = 0;
+    stack[sp++] = 0;
+    while(sp)
+    {
+      int inode = stack[--sp];
+      const Node& node = mNodes[inode];
+
+      // 4 rays against the node box
+      __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.mMin[0]), OX), IX);
+      __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.mMax[0]), OX), IX);
+      __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.mMin[1]), OY), IY);
+      __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.mMax[1]), OY), IY);
+      __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.mMin[2]), OZ), IZ);
+      __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.mMax[2]), OZ), IZ);
+      __m128 tn = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)), _mm_max_ps(_mm_min_ps(tz0, tz1), zero));
+      __m128 tf = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)), _mm_min_ps(_mm_max_ps(tz0, tz1), T));
+      if (!_mm_movemask_ps(_mm_cmple_ps(tn, tf)))
+        continue;
+
+      if (node.mCount)
+      {
+        // 4 rays against each triangle, Moller-Trumbore
+        for(int i=node.mOffset; i<node.mOffset+node.mCount; ++i)
+        {
+          const TriangleData& tri = mTriangles[i];
+          __m128 e1x = _mm_set1_ps(tri.mE1[0]), e1y = _mm_set1_ps(tri.mE1[1]), e1z = _mm_set1_ps(tri.mE1[2]);
+          __m128 e2x = _mm_set1_ps(tri.mE2[0]), e2y = _mm_set1_ps(tri.mE2[1]), e2z = _mm_set1_ps(tri.mE2[2]);
+          __m128 px = _mm_sub_ps(_mm_mul_ps(DY, e2z), _mm_mul_ps(DZ, e2y));
+          __m128 py = _mm_sub_ps(_mm_mul_ps(DZ, e2x), _mm_mul_ps(DX, e2z));
+          __m128 pz = _mm_sub_ps(_mm_mul_ps(DX, e2y), _mm_mul_ps(DY, e2x));
+          __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+          __m128 inv_det = _mm_div_ps(one, det);
+          __m128 sx = _mm_sub_ps(OX, _mm_set1_ps(tri.mV0[0]));
+          __m128 sy = _mm_sub_ps(OY, _mm_set1_ps(tri.mV0[1]));
+          __m128 sz = _mm_sub_ps(OZ, _mm_set1_ps(tri.mV0[2]));
+          __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv_det);
+          __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+          __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+          __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+          __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, qx), _mm_mul_ps(DY, qy)), _mm_mul_ps(DZ, qz)), inv_det);
+          __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv_det);
+          __m128 mask = _mm_cmpneq_ps(det, zero);
+          mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+          mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+          mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+          mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+          mask = _mm_and_ps(mask, _mm_cmplt_ps(t, T));
+          int bits = _mm_movemask_ps(mask);
+          if (bits)
+          {
+            T = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, T));
+            U = _mm_or_ps(_mm_and_ps(mask, u), _mm_andnot_ps(mask, U));
+            V = _mm_or_ps(_mm_and_ps(mask, v), _mm_andnot_ps(mask, V));
+            for(int k=0; k<4; ++k)
+              if (bits & (1<<k))
+                tri_hit[k] = i;
+          }
+        }
+      }
+      else
+      {
+        // visit first the child closer to the origin of the first ray
+        int c0 = inode + 1;
+        int c1 = node.mOffset;
+        const Node& n0 = mNodes[c0];
+        const Node& n1 = mNodes[c1];
+        float d = (n1.mMin[0] + n1.mMax[0] - n0.mMin[0] - n0.mMax[0]) * dx[0] +
+                  (n1.mMin[1] + n1.mMax[1] - n0.mMin[1] - n0.mMax[1]) * dy[0] +
+                  (n1.mMin[2] + n1.mMax[2] - n0.mMin[2] - n0.mMax[2]) * dz[0];
+        if (d < 0)
+          std::swap(c0, c1);
+        stack[sp++] = c1;
+        stack[sp++] = c0;
+      }
+    }
+
+    float t[4], u[4], v[4];
+    _mm_storeu_ps(t, T);
+    _mm_storeu_ps(u, U);
+    _mm_storeu_ps(v, V);
+    for(int i=0; i<lanes; ++i)
+    {
+      if (tri_hit[i] == -1)
+        continue;
+      hits[base+i].t = t[i];
+      hits[base+i].u = u[i];
+      hits[base+i].v = v[i];
+      hits[base+i].triangle = tri_hit[i];
+    }
+  }
+#else
+  for(int i=0; i<count; ++i)
+    intersectClosest(orig[i], dir[i], tmax, hits[i]);
+#endif
+}
+//-----------------------------------------------------------------------------
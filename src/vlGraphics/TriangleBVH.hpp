@@ -0,0 +1,193 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef TriangleBVH_INCLUDE_ONCE
+#define TriangleBVH_INCLUDE_ONCE
+
+#include <vlGraphics/link_config.hpp>
+#include <vlGraphics/DrawCall.hpp>
+#include <vlGraphics/Array.hpp>
+#include <vlCore/Vector3.hpp>
+#include <vlCore/AABB.hpp>
+#include <vector>
+
+namespace vl
+{
+  class Geometry;
+  //-----------------------------------------------------------------------------
+  // TriangleBVH
+  //-----------------------------------------------------------------------------
+  /**
+   * A bounding volume hierarchy of the triangles of a Geometry used to accelerate ray queries, see RayIntersector.
+   *
+   * The hierarchy is built in object space with a binned SAH and is stored as a flat array of nodes in depth first order.
+   * The triangles are stored in leaf order as one vertex plus two edges, ready for the Moller-Trumbore test, together with
+   * the vertex indices and the DrawCall they come from. On x86 the ray-box tests are done with SSE, 4 rays at a time
+   * for intersectPacket().
+   *
+   * A TriangleBVH is a snapshot: it remembers the position array and its ArrayAbstract::bufferChangedTick(), the DrawCall[s]
+   * and the bounds-update-tick of the Geometry it was built from, see isUpToDate(). A failed build() is a snapshot too, so that
+   * a Geometry without triangles is not rebuilt at every query. Usually you don't need to create one yourself, Geometry::triangleBVH() builds
+   * it lazily and keeps it cached.
+   *
+   * \sa
+   * - RayIntersector
+   * - Geometry::triangleBVH()
+   */
+  class VLGRAPHICS_EXPORT TriangleBVH: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::TriangleBVH, Object)
+
+  public:
+    //! A ray/triangle intersection.
+    struct Hit
+    {
+      Hit(): t(0), u(0), v(0), triangle(-1) {}
+      //! Distance along the ray in units of the ray direction.
+      float t;
+      //! Barycentric coordinates of the intersection point relative to the second and third vertex.
+      float u, v;
+      //! Index of the triangle inside the TriangleBVH, -1 if no triangle was hit.
+      int triangle;
+    };
+
+  public:
+    TriangleBVH(): mMaxLeafSize(4), mVertexCount(0), mPositionsTick(0), mBoundsUpdateTick(0), mBuilt(false)
+    {
+      VL_DEBUG_SET_OBJECT_NAME()
+    }
+
+    //! Builds the hierarchy from the triangles of the given Geometry, the vertex positions are taken from 
+    //! Geometry::vertexArray() or from the VA_Position generic vertex attribute.
+    //! \returns false if the Geometry has no vertex positions or no triangles.
+    bool build(Geometry* geom);
+
+    //! Returns true if build() has been called, successfully or not, with the current vertex positions, DrawCall[s] and bounds of the given Geometry.
+    //! In-place edits of the positions are detected through ArrayAbstract::bufferChangedTick(), ie. call setBufferObjectDirty() after them.
+    bool isUpToDate(const Geometry* geom) const;
+
+    //! Removes all the nodes and triangles.
+    void clear();
+
+    //! Maximum number of triangles per leaf, 4 by default.
+    void setMaxLeafSize(int size) { mMaxLeafSize = size; }
+    //! Maximum number of triangles per leaf, 4 by default.
+    int maxLeafSize() const { return mMaxLeafSize; }
+
+    //! Finds the closest triangle intersected by the ray \p orig + \p dir * t with 0 <= t <= \p tmax.
+    //! Triangles are considered double sided.
+    bool intersectClosest(const fvec3& orig, const fvec3& dir, float tmax, Hit& hit) const;
+
+    //! Returns true as soon as any triangle is intersected by the ray \p orig + \p dir * t with 0 <= t <= \p tmax, useful for occlusion queries.
+    bool intersectAny(const fvec3& orig, const fvec3& dir, float tmax) const;
+
+    //! Appends to \p hits all the triangles intersected by the ray \p orig + \p dir * t with 0 <= t <= \p tmax, in no particular order.
+    void intersectAll(const fvec3& orig, const fvec3& dir, float tmax, std::vector<Hit>& hits) const;
+
+    //! Closest hit query for \p count rays, the rays are traversed in packets of 4 sharing the same node visits.
+    //! Packets work best with coherent rays, for example the rays of adjacent pixels.
+    //! \param orig Array of \p count ray origins.
+    //! \param dir Array of \p count ray directions.
+    //! \param tmax Maximum distance of the hits.
+    //! \param hits [out] Array of \p count hits, Hit::triangle is -1 for the rays that do not intersect anything.
+    void intersectPacket(const fvec3* orig, const fvec3* dir, int count, float tmax, Hit* hits) const;
+
+    //! The number of triangles.
+    int triangleCount() const { return (int)mTriangleInfo.size(); }
+
+    //! The number of nodes.
+    int nodeCount() const { return (int)mNodes.size(); }
+
+    //! Bounding box of the triangles in object space.
+    AABB boundingBox() const;
+
+    //! The vertex indices of the given triangle.
+    const int* triangleIndices(int tri) const { return mTriangleInfo[tri].mIndex; }
+
+    //! The DrawCall the given triangle comes from.
+    const DrawCall* triangleDrawCall(int tri) const { return mDrawCalls[mTriangleInfo[tri].mDrawCall].get(); }
+    //! The DrawCall the given triangle comes from.
+    DrawCall* triangleDrawCall(int tri) { return mDrawCalls[mTriangleInfo[tri].mDrawCall].get(); }
+
+    //! The index of the given triangle inside its DrawCall, as enumerated by DrawCall::triangleIterator().
+    int triangleDrawCallIndex(int tri) const { return mTriangleInfo[tri].mDrawCallIndex; }
+
+  protected:
+    //! 32 bytes node, inner nodes have mCount == 0 and their second child at mOffset, the first one follows the node.
+    struct Node
+    {
+      float mMin[3];
+      int mOffset;
+      float mMax[3];
+      int mCount;
+    };
+
+    //! First vertex and two edges, ready for the Moller-Trumbore test.
+    struct TriangleData
+    {
+      float mV0[3];
+      float mE1[3];
+      float mE2[3];
+    };
+
+    struct TriangleInfo
+    {
+      int mIndex[3];
+      int mDrawCall;
+      int mDrawCallIndex;
+    };
+
+    struct BuildRef
+    {
+      float mMin[3];
+      float mMax[3];
+      float mCenter[3];
+      int mTriangle;
+    };
+
+    int buildNode(std::vector<BuildRef>& refs, int start, int end, int depth);
+
+  protected:
+    std::vector<Node> mNodes;
+    std::vector<TriangleData> mTriangles;
+    std::vector<TriangleInfo> mTriangleInfo;
+    int mMaxLeafSize;
+    // build state
+    std::vector< ref<DrawCall> > mDrawCalls;
+    ref<ArrayAbstract> mPositions;
+    size_t mVertexCount;
+    long long mPositionsTick;
+    long long mBoundsUpdateTick;
+    bool mBuilt;
+  };
+}
+
+#endif
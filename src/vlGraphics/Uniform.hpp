@@ -44,6 +44,8 @@
 
 namespace vl
 {
+  struct UniformInfo;
+
   //------------------------------------------------------------------------------
   // Uniform
   //------------------------------------------------------------------------------
@@ -55,8 +57,14 @@ namespace vl
    * - Shader
    * - Actor
    * - UniformSet
+   *
+   * \par Delta binding
+   * Every time the value of a Uniform is set it receives a new, globally unique, stamp() which GLSLProgram::applyUniformSet()
+   * uses to skip the glUniform* call when the program already holds that exact value. A Uniform whose values have been
+   * accessed through the non-const rawData() is excluded from delta binding and is always transmitted, since writes 
+   * through the returned pointer can't be tracked.
   */
-  class Uniform: public Object
+  class VLGRAPHICS_EXPORT Uniform: public Object
   {
     VL_INSTRUMENT_CLASS(vl::Uniform, Object)
 
@@ -64,21 +72,28 @@ namespace vl
 
   public:
 
-    Uniform(): mType(UT_NONE)
+    Uniform(): mType(UT_NONE), mRawDataAccess(false)
     {
       VL_DEBUG_SET_OBJECT_NAME()
+      resetLocationCache();
+      touch();
     }
 
-    Uniform(const char* name): mType(UT_NONE) 
+    Uniform(const char* name): mType(UT_NONE), mRawDataAccess(false)
     {
       VL_DEBUG_SET_OBJECT_NAME()
       mName = name;
+      resetLocationCache();
+      touch();
     }
 
+    //! The clone gets its own stamp() and location cache.
     ref<Uniform> clone() const
     {
       ref<Uniform> uniform  = new Uniform;
       *uniform = *this;
+      uniform->resetLocationCache();
+      uniform->touch();
       return uniform;
     }
 
@@ -86,10 +101,16 @@ namespace vl
     const std::string& name() const { return mName; }
     
     //! Returns the name of the uniform variable
-    std::string& name() { return mName; }
+    std::string& name() { resetLocationCache(); return mName; }
     
     //! Sets the name of the uniform variable
-    void setName(const char* name) { mName = name; }
+    void setName(const char* name) { resetLocationCache(); mName = name; }
+
+    //! Change stamp of the uniform's value: a new, globally unique, non-zero value is assigned every time the uniform is set.
+    int stamp() const { return mStamp; }
+
+    //! Assigns a new stamp() to the uniform, forcing GLSLProgram::applyUniformSet() to transmit it again.
+    void touch() { mStamp = nextStamp(); }
 
     // generic array setters
 
@@ -285,14 +306,15 @@ namespace vl
       }
     }
 
-    void* rawData() { if (mData.empty()) return NULL; else return &mData[0]; }
+    //! Returns the raw values of the uniform for writing. From now on the uniform is always transmitted by GLSLProgram::applyUniformSet(), see "Delta binding".
+    void* rawData() { mRawDataAccess = true; touch(); if (mData.empty()) return NULL; else return &mData[0]; }
 
     const void* rawData() const { if (mData.empty()) return NULL; else return &mData[0]; }
 
   protected:
     VL_COMPILE_TIME_CHECK( sizeof(int) == sizeof(float) )
-    void initData(int count) { mData.resize(count); }
-    void initDouble(int count) { mData.resize(count*2); }
+    void initData(int count) { mData.resize(count); touch(); }
+    void initDouble(int count) { mData.resize(count*2); touch(); }
     int singleCount() const { return (int)mData.size(); }
     int doubleCount() const { VL_CHECK((mData.size() & 0x1) == 0 ); return (int)(mData.size() >> 1); }
     const double* doubleData() const { VL_CHECK(!mData.empty()); VL_CHECK((mData.size() & 0x1) == 0 ); return (double*)&mData[0]; }
@@ -300,9 +322,32 @@ namespace vl
     const int* intData() const { VL_CHECK(!mData.empty()); return (int*)&mData[0]; }
     const unsigned int* uintData() const { VL_CHECK(!mData.empty()); return (unsigned int*)&mData[0]; }
 
+    static int nextStamp();
+
+    void resetLocationCache() const
+    {
+      for(int i=0; i<LocationCacheSize; ++i)
+      {
+        mLocationCache[i].ProgramId = 0;
+        mLocationCache[i].Info = NULL;
+      }
+      mLocationCacheNext = 0;
+    }
+
     EUniformType mType;
     std::vector<int> mData;
     std::string mName;
+    int mStamp;
+    bool mRawDataAccess;
+    // location cache, see GLSLProgram::applyUniformSet(): a few entries so that a Uniform shared by several programs does not thrash it
+    enum { LocationCacheSize = 4 };
+    struct LocationCacheEntry
+    {
+      int ProgramId;
+      const UniformInfo* Info;
+    };
+    mutable LocationCacheEntry mLocationCache[LocationCacheSize];
+    mutable int mLocationCacheNext;
   };
 }
 
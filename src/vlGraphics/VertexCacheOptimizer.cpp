@@ -0,0 +1,394 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/VertexCacheOptimizer.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <algorithm>
+
+using namespace vl;
+
+namespace
+{
+  // FIFO vertex cache simulated with timestamps: a vertex is in the cache if less than cache_size misses happened since it was loaded.
+  class FifoCache
+  {
+  public:
+    FifoCache(size_t vert_count, int cache_size): mTimeStamps(vert_count, 0), mTime(cache_size+1), mCacheSize(cache_size) {}
+
+    //! Returns true on a cache miss
+    bool access(u32 v)
+    {
+      if (mTime - mTimeStamps[v] > mCacheSize)
+      {
+        mTimeStamps[v] = mTime++;
+        return true;
+      }
+      return false;
+    }
+
+    int accessTriangle(const u32* tri) { return access(tri[0]) + access(tri[1]) + access(tri[2]); }
+
+    bool used(u32 v) const { return mTimeStamps[v] != 0; }
+
+    void flush() { mTime += mCacheSize + 1; }
+
+    int timeStamp(u32 v) const { return mTimeStamps[v]; }
+
+    int time() const { return mTime; }
+
+  private:
+    std::vector<int> mTimeStamps;
+    int mTime;
+    int mCacheSize;
+  };
+
+  bool isTrianglePrimitive(EPrimitiveType type)
+  {
+    switch(type)
+    {
+      case PT_TRIANGLES:
+      case PT_TRIANGLE_STRIP:
+      case PT_TRIANGLE_FAN:
+      case PT_QUADS:
+      case PT_QUAD_STRIP:
+      case PT_POLYGON:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  class ClusterKeyGreater
+  {
+  public:
+    ClusterKeyGreater(const std::vector<real>& keys): mKeys(keys) {}
+    bool operator()(u32 a, u32 b) const { return mKeys[a] > mKeys[b]; }
+  private:
+    const std::vector<real>& mKeys;
+  };
+}
+//-----------------------------------------------------------------------------
+size_t VertexCacheOptimizer::simulateCache(const u32* indices, size_t index_count, size_t vert_count, int cache_size, size_t* unique_verts)
+{
+  FifoCache cache(vert_count, cache_size);
+  size_t misses = 0;
+  size_t unique = 0;
+  for(size_t i=0; i<index_count; ++i)
+  {
+    VL_CHECK(indices[i] < vert_count)
+    bool first_use = !cache.used(indices[i]);
+    if (cache.access(indices[i]))
+    {
+      ++misses;
+      unique += first_use ? 1 : 0;
+    }
+  }
+  if (unique_verts)
+    *unique_verts = unique;
+  return misses;
+}
+//-----------------------------------------------------------------------------
+void VertexCacheOptimizer::optimizeTriangles(std::vector<u32>& indices, size_t vert_count, int cache_size, std::vector<u32>* clusters)
+{
+  if (clusters)
+    clusters->clear();
+
+  const size_t tri_count = indices.size() / 3;
+  if (!tri_count || !vert_count)
+    return;
+
+  // vertex -> triangle adjacency
+  std::vector<u32> offsets(vert_count+1, 0);
+  for(size_t i=0; i<tri_count*3; ++i)
+  {
+    VL_CHECK(indices[i] < vert_count)
+    ++offsets[indices[i]+1];
+  }
+  for(size_t v=0; v<vert_count; ++v)
+    offsets[v+1] += offsets[v];
+  std::vector<u32> adjacency(tri_count*3);
+  std::vector<u32> cursor(offsets.begin(), offsets.end()-1);
+  for(size_t t=0; t<tri_count; ++t)
+    for(int j=0; j<3; ++j)
+      adjacency[ cursor[indices[t*3+j]]++ ] = (u32)t;
+
+  // number of triangles still to be emitted for each vertex
+  std::vector<int> live(vert_count);
+  for(size_t v=0; v<vert_count; ++v)
+    live[v] = offsets[v+1] - offsets[v];
+
+  FifoCache cache(vert_count, cache_size);
+  std::vector<unsigned char> emitted(tri_count, 0);
+  std::vector<u32> dead_end;
+  std::vector<u32> candidates;
+  std::vector<u32> out;
+  dead_end.reserve(tri_count*3);
+  out.reserve(tri_count*3);
+  size_t next_vertex = 0;
+
+  if (clusters)
+    clusters->push_back(0);
+
+  int fanning = 0;
+  while(fanning >= 0)
+  {
+    // emit all the triangles around the fanning vertex
+    candidates.clear();
+    for(u32 k=offsets[fanning]; k<offsets[fanning+1]; ++k)
+    {
+      u32 t = adjacency[k];
+      if (emitted[t])
+        continue;
+      for(int j=0; j<3; ++j)
+      {
+        u32 v = indices[t*3+j];
+        out.push_back(v);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        cache.access(v);
+      }
+      emitted[t] = 1;
+    }
+
+    // choose the next fanning vertex: the oldest candidate that will still be in the cache after emitting its triangles
+    fanning = -1;
+    int best_priority = -1;
+    for(size_t i=0; i<candidates.size(); ++i)
+    {
+      u32 v = candidates[i];
+      if (live[v] > 0)
+      {
+        int priority = 0;
+        int age = cache.time() - cache.timeStamp(v);
+        if (age + 2*live[v] <= cache_size)
+          priority = age;
+        if (priority > best_priority)
+        {
+          best_priority = priority;
+          fanning = (int)v;
+        }
+      }
+    }
+
+    // dead end: pick a recently used vertex or the next one in input order
+    if (fanning < 0)
+    {
+      while(!dead_end.empty() && fanning < 0)
+      {
+        u32 v = dead_end.back();
+        dead_end.pop_back();
+        if (live[v] > 0)
+          fanning = (int)v;
+      }
+      for( ; next_vertex<vert_count && fanning < 0; ++next_vertex)
+      {
+        if (live[next_vertex] > 0)
+          fanning = (int)next_vertex;
+      }
+      if (fanning >= 0 && clusters && clusters->back() != out.size()/3)
+        clusters->push_back((u32)(out.size()/3));
+    }
+  }
+
+  VL_CHECK(out.size() == tri_count*3)
+  indices.swap(out);
+}
+//-----------------------------------------------------------------------------
+void VertexCacheOptimizer::reorderForOverdraw(std::vector<u32>& indices, const ArrayAbstract* positions, const std::vector<u32>& clusters, int cache_size, float threshold)
+{
+  const size_t tri_count = indices.size() / 3;
+  if (!tri_count || !positions || clusters.empty())
+    return;
+
+  const size_t vert_count = positions->size();
+  FifoCache cache(vert_count, cache_size);
+
+  // split the clusters where the ACMR of the partial cluster is close enough to the one of the whole cluster
+  std::vector<u32> bounds;
+  for(size_t c=0; c<clusters.size(); ++c)
+  {
+    const u32 begin = clusters[c];
+    const u32 end   = c+1 < clusters.size() ? clusters[c+1] : (u32)tri_count;
+
+    cache.flush();
+    int misses = 0;
+    for(u32 t=begin; t<end; ++t)
+      misses += cache.accessTriangle(&indices[t*3]);
+    const float max_acmr = threshold * misses / (end - begin);
+
+    cache.flush();
+    bounds.push_back(begin);
+    u32 sub_begin = begin;
+    misses = 0;
+    for(u32 t=begin; t<end; ++t)
+    {
+      misses += cache.accessTriangle(&indices[t*3]);
+      if (t+1 < end && (float)misses / (t+1 - sub_begin) <= max_acmr)
+      {
+        bounds.push_back(t+1);
+        sub_begin = t+1;
+        misses = 0;
+        cache.flush();
+      }
+    }
+  }
+  bounds.push_back((u32)tri_count);
+
+  // area weighted centroid and normal of each cluster and of the whole mesh
+  const size_t cluster_count = bounds.size() - 1;
+  std::vector<vec3> centroids(cluster_count);
+  std::vector<vec3> normals(cluster_count);
+  vec3 mesh_centroid;
+  real mesh_area = 0;
+  for(size_t c=0; c<cluster_count; ++c)
+  {
+    vec3 centroid_sum;
+    real area_sum = 0;
+    for(u32 t=bounds[c]; t<bounds[c+1]; ++t)
+    {
+      vec3 a = positions->getAsVec3(indices[t*3+0]);
+      vec3 b = positions->getAsVec3(indices[t*3+1]);
+      vec3 d = positions->getAsVec3(indices[t*3+2]);
+      vec3 n = cross(b-a, d-a);
+      real area = n.length() * 0.5f;
+      normals[c] += n;
+      centroid_sum += (a+b+d) * (area / 3);
+      area_sum += area;
+    }
+    centroids[c] = area_sum > 0 ? centroid_sum / area_sum : centroid_sum;
+    mesh_centroid += centroid_sum;
+    mesh_area += area_sum;
+  }
+  if (mesh_area > 0)
+    mesh_centroid /= mesh_area;
+
+  // clusters facing away from the center are more likely to occlude the others
+  std::vector<real> keys(cluster_count);
+  std::vector<u32> order(cluster_count);
+  for(size_t c=0; c<cluster_count; ++c)
+  {
+    keys[c] = dot(centroids[c] - mesh_centroid, normals[c].normalize());
+    order[c] = (u32)c;
+  }
+  std::stable_sort(order.begin(), order.end(), ClusterKeyGreater(keys));
+
+  std::vector<u32> out;
+  out.reserve(indices.size());
+  for(size_t i=0; i<cluster_count; ++i)
+    out.insert(out.end(), indices.begin() + bounds[order[i]]*3, indices.begin() + bounds[order[i]+1]*3);
+  indices.swap(out);
+}
+//-----------------------------------------------------------------------------
+bool VertexCacheOptimizer::optimize(Geometry* geom)
+{
+  mACMRBefore = mACMRAfter = mATVRBefore = mATVRAfter = 0;
+
+  ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(VA_Position) ? geom->vertexAttribArray(VA_Position)->data() : NULL;
+  if (!posarr || !posarr->size())
+  {
+    Log::warning("VertexCacheOptimizer::optimize() : no vertices found.\n");
+    return false;
+  }
+  const size_t vert_count = posarr->size();
+
+  size_t tri_count = 0;
+  size_t misses_before = 0, misses_after = 0;
+  size_t unique_before = 0, unique_after = 0;
+  std::vector<u32> indices;
+  std::vector<u32> clusters;
+  for(int idraw=0; idraw<geom->drawCalls()->size(); ++idraw)
+  {
+    DrawCall* dc = geom->drawCalls()->at(idraw);
+    if (!isTrianglePrimitive(dc->primitiveType()))
+      continue;
+
+    indices.clear();
+    for(TriangleIterator trit = dc->triangleIterator(); trit.hasNext(); trit.next())
+    {
+      indices.push_back( trit.a() );
+      indices.push_back( trit.b() );
+      indices.push_back( trit.c() );
+    }
+    if (indices.empty())
+      continue;
+
+    size_t unique = 0;
+    misses_before += simulateCache(&indices[0], indices.size(), vert_count, cacheSize(), &unique);
+    unique_before += unique;
+    tri_count += indices.size() / 3;
+
+    optimizeTriangles(indices, vert_count, cacheSize(), &clusters);
+    if (optimizeOverdraw())
+      reorderForOverdraw(indices, posarr, clusters, cacheSize(), overdrawThreshold());
+
+    misses_after += simulateCache(&indices[0], indices.size(), vert_count, cacheSize(), &unique);
+    unique_after += unique;
+
+    ref<DrawElementsUInt> de = new DrawElementsUInt(PT_TRIANGLES, dc->instances());
+    de->setEnabled(dc->isEnabled());
+    de->indexBuffer()->resize(indices.size());
+    memcpy(de->indexBuffer()->ptr(), &indices[0], sizeof(indices[0])*indices.size());
+    geom->drawCalls()->set(idraw, de.get());
+  }
+
+  if (!tri_count)
+  {
+    Log::warning("VertexCacheOptimizer::optimize() : no triangles found.\n");
+    return false;
+  }
+
+  mACMRBefore = (float)misses_before / tri_count;
+  mACMRAfter  = (float)misses_after  / tri_count;
+  mATVRBefore = unique_before ? (float)misses_before / unique_before : 0;
+  mATVRAfter  = unique_after  ? (float)misses_after  / unique_after  : 0;
+
+  // Geometry::sortVertices() supports only DrawElements* without primitive restart
+  if (optimizeVertexFetch())
+  {
+    bool sortable = true;
+    for(int idraw=0; idraw<geom->drawCalls()->size(); ++idraw)
+    {
+      DrawCall* dc = geom->drawCalls()->at(idraw);
+      sortable &= (dc->as<DrawElementsUInt>() || dc->as<DrawElementsUShort>() || dc->as<DrawElementsUByte>()) && !dc->primitiveRestartEnabled();
+    }
+    if (sortable)
+      geom->sortVertices();
+    else
+      Log::debug("VertexCacheOptimizer::optimize() : vertex fetch optimization skipped, it requires DrawElements* without primitive restart.\n");
+  }
+
+  Log::debug( Say("VertexCacheOptimizer : cache=%n, tris=%n, ACMR=%.3n -> %.3n, ATVR=%.3n -> %.3n\n") << cacheSize() << tri_count << mACMRBefore << mACMRAfter << mATVRBefore << mATVRAfter );
+
+  return true;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef VertexCacheOptimizer_INCLUDE_ONCE
+#define VertexCacheOptimizer_INCLUDE_ONCE
+
+#include <vlGraphics/Geometry.hpp>
+#include <vector>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // VertexCacheOptimizer
+  //-----------------------------------------------------------------------------
+  /**
+   * Reorders the triangles of a Geometry for post-transform vertex cache reuse, an alternative to TriangleStripGenerator
+   * better suited for modern hardware which prefers indexed triangle lists.
+   *
+   * optimize() performs the following steps:
+   * - all the triangle based DrawCalls (triangles, strips, fans, quads and polygons) are converted into PT_TRIANGLES DrawElementsUInt,
+   *   the other DrawCalls are left untouched.
+   * - the triangles are reordered using the Tipsify algorithm, see optimizeTriangles().
+   * - if optimizeOverdraw() is enabled the clusters of triangles generated by Tipsify are sorted so that the ones more likely to 
+   *   occlude the others are drawn first, see reorderForOverdraw().
+   * - if optimizeVertexFetch() is enabled the vertices are sorted in order of first use using Geometry::sortVertices().
+   *
+   * The average cache miss ratio (ACMR, transformed vertices per triangle) and the average transform to vertex ratio 
+   * (ATVR, transformed vertices per used vertex) are computed by simulating a FIFO cache of cacheSize() entries before and after
+   * the optimization, see acmrBefore(), acmrAfter(), atvrBefore() and atvrAfter().
+   *
+   * Based on: Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", SIGGRAPH 2007.
+   */
+  class VLGRAPHICS_EXPORT VertexCacheOptimizer: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::VertexCacheOptimizer, Object)
+
+  public:
+    VertexCacheOptimizer(): mCacheSize(16), mOverdrawThreshold(1.05f), mOptimizeOverdraw(false), mOptimizeVertexFetch(true),
+                            mACMRBefore(0), mACMRAfter(0), mATVRBefore(0), mATVRAfter(0) {}
+
+    //! Optimizes the triangles of the given Geometry.
+    //! \returns false if the Geometry has no vertices or no triangles.
+    bool optimize(Geometry* geom);
+
+    //! The size of the simulated FIFO vertex cache, 16 by default.
+    void setCacheSize(int size) { mCacheSize = size; }
+    //! The size of the simulated FIFO vertex cache, 16 by default.
+    int cacheSize() const { return mCacheSize; }
+
+    //! Enables the overdraw reordering, disabled by default.
+    void setOptimizeOverdraw(bool on) { mOptimizeOverdraw = on; }
+    //! Enables the overdraw reordering, disabled by default.
+    bool optimizeOverdraw() const { return mOptimizeOverdraw; }
+
+    //! How much the ACMR can grow (1.05 = 5%) to split the triangles in smaller clusters for the overdraw reordering.
+    void setOverdrawThreshold(float threshold) { mOverdrawThreshold = threshold; }
+    //! How much the ACMR can grow (1.05 = 5%) to split the triangles in smaller clusters for the overdraw reordering.
+    float overdrawThreshold() const { return mOverdrawThreshold; }
+
+    //! Enables the reordering of the vertices for fetch locality, enabled by default.
+    void setOptimizeVertexFetch(bool on) { mOptimizeVertexFetch = on; }
+    //! Enables the reordering of the vertices for fetch locality, enabled by default.
+    bool optimizeVertexFetch() const { return mOptimizeVertexFetch; }
+
+    //! ACMR of the triangles before the last optimize().
+    float acmrBefore() const { return mACMRBefore; }
+    //! ACMR of the triangles after the last optimize().
+    float acmrAfter() const { return mACMRAfter; }
+    //! ATVR of the triangles before the last optimize().
+    float atvrBefore() const { return mATVRBefore; }
+    //! ATVR of the triangles after the last optimize().
+    float atvrAfter() const { return mATVRAfter; }
+
+    //! Reorders a triangle list for vertex cache reuse using the Tipsify algorithm.
+    //! \param indices The triangle list, 3 indices per triangle, all smaller than \p vert_count.
+    //! \param vert_count The number of vertices.
+    //! \param cache_size The size of the target vertex cache.
+    //! \param clusters [out] If not NULL returns the index of the first triangle of each cluster, i.e. where the algorithm restarted from a new region of the mesh.
+    static void optimizeTriangles(std::vector<u32>& indices, size_t vert_count, int cache_size, std::vector<u32>* clusters=NULL);
+
+    //! Sorts the clusters of an optimized triangle list so that the ones facing outwards, more likely to occlude the others, are drawn first.
+    //! The clusters are further split wherever the ACMR of the partial cluster is within \p threshold times the ACMR of the whole cluster.
+    static void reorderForOverdraw(std::vector<u32>& indices, const ArrayAbstract* positions, const std::vector<u32>& clusters, int cache_size, float threshold);
+
+    //! Simulates a FIFO vertex cache and returns the number of transformed vertices.
+    //! \param unique_verts [out] If not NULL returns the number of distinct vertices used.
+    static size_t simulateCache(const u32* indices, size_t index_count, size_t vert_count, int cache_size, size_t* unique_verts=NULL);
+
+  protected:
+    int mCacheSize;
+    float mOverdrawThreshold;
+    bool mOptimizeOverdraw;
+    bool mOptimizeVertexFetch;
+    float mACMRBefore;
+    float mACMRAfter;
+    float mATVRBefore;
+    float mATVRAfter;
+  };
+}
+
+#endif
@@ -33,6 +33,9 @@
 #include <vlCore/TextStream.hpp>
 #include <vlCore/VirtualFile.hpp>
 #include <vlCore/VirtualDirectory.hpp>
+#include <vlCore/DiskFile.hpp>
+#include <vlCore/MemoryFile.hpp>
+#include <vlCore/Thread.hpp>
 #include <vlCore/VisualizationLibrary.hpp>
 #include <vlCore/FileSystem.hpp>
 #include <vlGraphics/DoubleVertexRemover.hpp>
@@ -41,7 +44,11 @@
 #include <vlGraphics/Actor.hpp>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 using namespace vl;
 
@@ -57,6 +64,382 @@ namespace
       vec.reserve( vec.size() + alloc_step );
     vec.push_back(data);
   }
+
+  /*
+   * Fast parser: the file is split in line-aligned chunks parsed in parallel then merged in file order.
+   */
+  inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+  inline const char* skipBlanks(const char* p, const char* end)
+  {
+    while( p != end && isBlank(*p) )
+      ++p;
+    return p;
+  }
+
+  inline const char* skipToken(const char* p, const char* end)
+  {
+    while( p != end && !isBlank(*p) )
+      ++p;
+    return p;
+  }
+
+  inline const char* trimEnd(const char* begin, const char* end)
+  {
+    while( end != begin && isBlank(end[-1]) )
+      --end;
+    return end;
+  }
+
+  std::string trimmedString(const char* p, const char* end)
+  {
+    p = skipBlanks(p, end);
+    return std::string(p, trimEnd(p, end));
+  }
+
+  inline const char* parseInt(const char* p, const char* end, int& value)
+  {
+    bool negative = false;
+    if ( p != end && (*p == '-' || *p == '+') )
+      negative = *p++ == '-';
+    int v = 0;
+    for( ; p != end && *p >= '0' && *p <= '9'; ++p )
+      v = v * 10 + (*p - '0');
+    value = negative ? -v : v;
+    return p;
+  }
+
+  // Parses a decimal number without requiring a zero terminated string, unusual notations (nan, inf, hex etc.) go through strtod().
+  const char* parseFloat(const char* p, const char* end, float& value)
+  {
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* start = p;
+    bool negative = false;
+    if ( p != end && (*p == '-' || *p == '+') )
+      negative = *p++ == '-';
+
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any_digit = false;
+    for( ; p != end && *p >= '0' && *p <= '9'; ++p )
+    {
+      any_digit = true;
+      if (digits < 18)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+      }
+      else
+        ++exponent;
+    }
+    if ( p != end && *p == '.' )
+    {
+      for( ++p; p != end && *p >= '0' && *p <= '9'; ++p )
+      {
+        any_digit = true;
+        if (digits < 18)
+        {
+          mantissa = mantissa * 10 + (*p - '0');
+          digits += mantissa != 0;
+          --exponent;
+        }
+      }
+    }
+    if ( any_digit && p != end && (*p == 'e' || *p == 'E') )
+    {
+      const char* q = p + 1;
+      bool negative_exp = false;
+      if ( q != end && (*q == '-' || *q == '+') )
+        negative_exp = *q++ == '-';
+      if ( q != end && *q >= '0' && *q <= '9' )
+      {
+        int e = 0;
+        for( ; q != end && *q >= '0' && *q <= '9'; ++q )
+          e = e < 10000 ? e * 10 + (*q - '0') : e;
+        exponent += negative_exp ? -e : e;
+        p = q;
+      }
+    }
+
+    if ( !any_digit || (p != end && !isBlank(*p) && *p != '/') )
+    {
+      char buf[64];
+      const char* tok_end = skipToken(start, end);
+      size_t len = std::min( (size_t)(tok_end - start), sizeof(buf) - 1 );
+      memcpy(buf, start, len);
+      buf[len] = 0;
+      value = (float)strtod(buf, NULL);
+      return tok_end;
+    }
+
+    double v = (double)mantissa;
+    if (exponent < 0)
+      v = exponent >= -22 ? v / pow10[-exponent] : v * pow(10.0, exponent);
+    else
+    if (exponent > 0)
+      v = exponent <= 22 ? v * pow10[exponent] : v * pow(10.0, exponent);
+    value = (float)(negative ? -v : v);
+    return p;
+  }
+
+  // Returns true if the line [begin, eol) continues on the next one.
+  inline bool continuesLine(const char* begin, const char* eol)
+  {
+    const char* last = trimEnd(begin, eol);
+    return last != begin && last[-1] == '\\';
+  }
+
+  // Returns the beginning of the first line following \p p which does not continue the previous one.
+  const char* nextLineStart(const char* p, const char* end)
+  {
+    while( p < end )
+    {
+      const char* eol = (const char*)memchr(p, '\n', end - p);
+      if (!eol)
+        return end;
+      if (!continuesLine(p, eol))
+        return eol + 1;
+      p = eol + 1;
+    }
+    return end;
+  }
+
+  //! The o, usemtl and mtllib statements of an ObjChunk, along with the number of face elements preceding them.
+  struct ObjStatement
+  {
+    typedef enum { OS_Object, OS_UseMtl, OS_MtlLib } EType;
+
+    EType mType;
+    std::string mName;
+    size_t mFaceCount;
+    size_t mPosCount;
+    size_t mTexCount;
+    size_t mNrmCount;
+  };
+
+  //! A line-aligned portion of an OBJ file. Relative (negative) face indices are stored chunk-local and listed
+  //! in the fixup vectors: they become global once the number of vertices in the previous chunks is known.
+  class ObjChunk
+  {
+  public:
+    ObjChunk(): mBegin(NULL), mEnd(NULL) {}
+
+    void parse()
+    {
+      std::string joined;
+      const char* p = mBegin;
+      while( p < mEnd )
+      {
+        const char* eol = (const char*)memchr(p, '\n', mEnd - p);
+        if (!eol)
+          eol = mEnd;
+        const char* next = eol == mEnd ? mEnd : eol + 1;
+        const char* first = skipBlanks(p, eol);
+
+        if ( first != eol && *first != '#' && continuesLine(first, eol) )
+        {
+          // note: comments cannot be multiline
+          joined = std::string(first, trimEnd(first, eol) - 1) + ' ';
+          while( next < mEnd )
+          {
+            p = next;
+            eol = (const char*)memchr(p, '\n', mEnd - p);
+            if (!eol)
+              eol = mEnd;
+            next = eol == mEnd ? mEnd : eol + 1;
+            const char* b = skipBlanks(p, eol);
+            if ( !continuesLine(b, eol) )
+            {
+              joined += std::string(b, trimEnd(b, eol));
+              break;
+            }
+            joined += std::string(b, trimEnd(b, eol) - 1) + ' ';
+          }
+          parseLine( joined.data(), joined.data() + joined.size() );
+        }
+        else
+        if ( first != eol && *first != '#' )
+          parseLine( first, eol );
+
+        p = next;
+      }
+    }
+
+    void parseLine(const char* p, const char* end)
+    {
+      const char* cmd_end = skipToken(p, end);
+      size_t cmd_len = cmd_end - p;
+      const char* args = skipBlanks(cmd_end, end);
+
+      if (cmd_len == 1 && p[0] == 'v') // Geometric vertices
+      {
+        fvec4 v(0, 0, 0, 1);
+        for(int i=0; i<3 && args != end; ++i)
+          args = skipBlanks( parseFloat(args, end, v[i]), end );
+        mCoords.push_back(v);
+      }
+      else
+      if (cmd_len == 2 && p[0] == 'v' && (p[1] == 't' || p[1] == 'n')) // Texture vertices, vertex normals
+      {
+        fvec3 v(0, 0, 0);
+        for(int i=0; i<3 && args != end; ++i)
+          args = skipBlanks( parseFloat(args, end, v[i]), end );
+        if (p[1] == 't')
+          mTexCoords.push_back(v);
+        else
+          mNormals.push_back(v);
+      }
+      else
+      if (cmd_len == 1 && p[0] == 'f') // Face
+      {
+        int face_type = 0;
+        while( args != end )
+        {
+          int iv = 0;
+          args = parseInt(args, end, iv);
+          addIndex(mFacePos, mPosFixups, iv, (int)mCoords.size());
+          if (args != end && *args == '/')
+          {
+            ++args;
+            if (args != end && *args != '/' && !isBlank(*args))
+            {
+              int ivt = 0;
+              args = parseInt(args, end, ivt);
+              addIndex(mFaceTex, mTexFixups, ivt, (int)mTexCoords.size());
+            }
+            if (args != end && *args == '/')
+            {
+              int ivn = 0;
+              args = parseInt(args+1, end, ivn);
+              addIndex(mFaceNrm, mNrmFixups, ivn, (int)mNormals.size());
+            }
+          }
+          ++face_type;
+          args = skipBlanks( skipToken(args, end), end );
+        }
+        VL_CHECK(face_type > 2)
+        mFaceType.push_back(face_type);
+      }
+      else
+      if (cmd_len == 1 && p[0] == 'o') // Object name
+        addStatement(ObjStatement::OS_Object, args, end);
+      else
+      if (cmd_len == 6 && strncmp(p, "usemtl", 6) == 0) // Material name
+        addStatement(ObjStatement::OS_UseMtl, args, end);
+      else
+      if (cmd_len == 6 && strncmp(p, "mtllib", 6) == 0) // Material library
+        addStatement(ObjStatement::OS_MtlLib, args, end);
+    }
+
+    // 1-based absolute indices become 0-based, relative ones are rebased later
+    void addIndex(std::vector<int>& indices, std::vector<size_t>& fixups, int index, int local_count)
+    {
+      if (index > 0)
+        indices.push_back(index - 1);
+      else
+      {
+        fixups.push_back(indices.size());
+        indices.push_back(local_count + index);
+      }
+    }
+
+    void addStatement(ObjStatement::EType type, const char* args, const char* end)
+    {
+      mStatements.push_back(ObjStatement());
+      ObjStatement& st = mStatements.back();
+      st.mType = type;
+      st.mName = std::string(args, trimEnd(args, end));
+      st.mFaceCount = mFaceType.size();
+      st.mPosCount = mFacePos.size();
+      st.mTexCount = mFaceTex.size();
+      st.mNrmCount = mFaceNrm.size();
+    }
+
+    void release()
+    {
+      std::vector<int>().swap(mFacePos);
+      std::vector<int>().swap(mFaceTex);
+      std::vector<int>().swap(mFaceNrm);
+      std::vector<int>().swap(mFaceType);
+      std::vector<size_t>().swap(mPosFixups);
+      std::vector<size_t>().swap(mTexFixups);
+      std::vector<size_t>().swap(mNrmFixups);
+      std::vector<ObjStatement>().swap(mStatements);
+    }
+
+    void rebase()
+    {
+      for(size_t i=0; i<mPosFixups.size(); ++i)
+        mFacePos[mPosFixups[i]] += mCoordsBase;
+      for(size_t i=0; i<mTexFixups.size(); ++i)
+        mFaceTex[mTexFixups[i]] += mTexCoordsBase;
+      for(size_t i=0; i<mNrmFixups.size(); ++i)
+        mFaceNrm[mNrmFixups[i]] += mNormalsBase;
+    }
+
+  public:
+    const char* mBegin;
+    const char* mEnd;
+    std::vector<fvec4> mCoords;
+    std::vector<fvec3> mNormals;
+    std::vector<fvec3> mTexCoords;
+    std::vector<int> mFacePos;
+    std::vector<int> mFaceTex;
+    std::vector<int> mFaceNrm;
+    std::vector<int> mFaceType;
+    std::vector<size_t> mPosFixups;
+    std::vector<size_t> mTexFixups;
+    std::vector<size_t> mNrmFixups;
+    std::vector<ObjStatement> mStatements;
+    int mCoordsBase;
+    int mNormalsBase;
+    int mTexCoordsBase;
+  };
+
+  class ObjParseTasks: public ParallelTasks
+  {
+  public:
+    ObjParseTasks(std::vector<ObjChunk>& chunks): mChunks(chunks) {}
+
+    virtual void runTask(int index) { mChunks[index].parse(); }
+
+  private:
+    std::vector<ObjChunk>& mChunks;
+  };
+
+  // copies the chunks' vertices in the global arrays and rebases their relative indices
+  class ObjMergeTasks: public ParallelTasks
+  {
+  public:
+    ObjMergeTasks(std::vector<ObjChunk>& chunks, std::vector<fvec4>& coords, std::vector<fvec3>& normals, std::vector<fvec3>& tex_coords)
+      : mChunks(chunks), mCoords(coords), mNormals(normals), mTexCoords(tex_coords) {}
+
+    virtual void runTask(int index)
+    {
+      ObjChunk& chunk = mChunks[index];
+      std::copy( chunk.mCoords.begin(),    chunk.mCoords.end(),    mCoords.begin()    + chunk.mCoordsBase );
+      std::copy( chunk.mNormals.begin(),   chunk.mNormals.end(),   mNormals.begin()   + chunk.mNormalsBase );
+      std::copy( chunk.mTexCoords.begin(), chunk.mTexCoords.end(), mTexCoords.begin() + chunk.mTexCoordsBase );
+      std::vector<fvec4>().swap(chunk.mCoords);
+      std::vector<fvec3>().swap(chunk.mNormals);
+      std::vector<fvec3>().swap(chunk.mTexCoords);
+      chunk.rebase();
+    }
+
+  private:
+    std::vector<ObjChunk>& mChunks;
+    std::vector<fvec4>& mCoords;
+    std::vector<fvec3>& mNormals;
+    std::vector<fvec3>& mTexCoords;
+  };
+
+  template<class T>
+  void appendRange(std::vector<T>& dst, const std::vector<T>& src, size_t begin, size_t end)
+  {
+    dst.insert( dst.end(), src.begin() + begin, src.begin() + end );
+  }
 }
 //-----------------------------------------------------------------------------
 // ObjTexture
@@ -307,19 +690,49 @@ ref<ResourceDatabase> ObjLoader::loadOBJ( VirtualFile* file )
     Log::error("loadOBJ() called with NULL argument.\n");
     return NULL;
   }
+
+  mCoords.clear();
+  mNormals.clear();
+  mTexCoords.clear();
+  mMaterials.clear();
+  mMeshes.clear();
+
+  bool ok = fastParsing() ? parseOBJFast(file) : parseOBJ(file);
+  if (!ok)
+    return NULL;
+
+  return buildResources(file);
+}
+//-----------------------------------------------------------------------------
+void ObjLoader::loadMaterialLibrary( VirtualFile* file, const String& mtllib )
+{
+  // creates the path for the mtl
+  String path = file->path().extractPath() + mtllib;
+  ref<VirtualFile> vfile = defFileSystem()->locateFile(path, file->path().extractPath());
+  if (vfile)
+  {
+    // reads the material
+    std::vector<ObjMaterial> mats;
+    loadObjMaterials(vfile.get(), mats);
+    // updates the material library
+    for(size_t i=0; i < mats.size(); ++i)
+      mMaterials[mats[i].objectName()] = new ObjMaterial(mats[i]);
+  }
+  else
+  {
+    Log::error( Say("Could not find OBJ material file '%s'.\n") << path );
+  }
+}
+//-----------------------------------------------------------------------------
+bool ObjLoader::parseOBJ( VirtualFile* file )
+{
   ref<TextStream> stream = new TextStream(file);
   if ( !stream->inputFile()->open(OM_ReadOnly) )
   {
     Log::error( Say("loadOBJ(): could not open source file.\n") );
-    return NULL;
+    return false;
   }
 
-  mCoords.clear();
-  // std::vector<float> mNormals;
-  // std::vector<float> mTexCoords;
-  std::map< std::string, ref<ObjMaterial> > mMaterials;
-  std::vector< ref<ObjMesh> > mMeshes;
-
   ref<ObjMaterial> cur_material;
   ref<ObjMesh> cur_mesh;
 
@@ -630,24 +1043,7 @@ ref<ResourceDatabase> ObjLoader::loadOBJ( VirtualFile* file )
     else
     if (strcmp(cmd,"mtllib") == 0) // Material library
     {
-      // creates the path for the mtl
-      String path = file->path().extractPath() + String(line.c_str()+7).trim();
-      ref<VirtualFile> vfile = defFileSystem()->locateFile(path, file->path().extractPath());
-      std::string str_file = file->path().toStdString();
-      std::string str_path = path.toStdString();
-      if (vfile)
-      {
-        // reads the material
-        std::vector<ObjMaterial> mats;
-        loadObjMaterials(vfile.get(), mats);
-        // updates the material library
-        for(size_t i=0; i < mats.size(); ++i)
-          mMaterials[mats[i].objectName()] = new ObjMaterial(mats[i]);
-      }
-      else
-      {
-        Log::error( Say("Could not find OBJ material file '%s'.\n") << path );
-      }
+      loadMaterialLibrary( file, String(line.c_str()+7).trim() );
     }
     /*else
     if (strcmp(cmd,"shadow_obj") == 0) // Shadow casting
@@ -667,6 +1063,165 @@ ref<ResourceDatabase> ObjLoader::loadOBJ( VirtualFile* file )
     }*/
   }
 
+  stream->inputFile()->close();
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool ObjLoader::parseOBJFast( VirtualFile* file )
+{
+  // access the whole file in memory: map disk files, read memory files in place, read anything else at once
+
+  const char* data = NULL;
+  long long size = 0;
+  std::vector<char> buffer;
+
+  DiskFile* disk_file = file->as<DiskFile>();
+  bool unmap = disk_file && !disk_file->mappedMemory();
+  if (disk_file)
+  {
+    data = (const char*)disk_file->mapMemory();
+    size = disk_file->mappedSize();
+  }
+
+  MemoryFile* mem_file = file->as<MemoryFile>();
+  if (mem_file)
+  {
+    data = (const char*)mem_file->ptr();
+    size = mem_file->size();
+  }
+
+  if (!data)
+  {
+    if ( !file->open(OM_ReadOnly) )
+    {
+      Log::error( Say("loadOBJ(): could not open source file.\n") );
+      return false;
+    }
+    size = file->size();
+    if (size > 0)
+    {
+      buffer.resize((size_t)size);
+      size = file->read(&buffer[0], size);
+      data = &buffer[0];
+    }
+    file->close();
+  }
+
+  if (!data || size <= 0)
+    return true;
+
+  // split the file in line-aligned chunks and parse them in parallel
+
+  const char* end = data + size;
+  const long long min_chunk_size = 1024*1024;
+  int thread_count = threadCount() > 0 ? threadCount() : Thread::hardwareConcurrency();
+  int chunk_count = (int)std::min( (size + min_chunk_size - 1) / min_chunk_size, (long long)thread_count * 8 );
+
+  std::vector<ObjChunk> chunks(chunk_count);
+  const char* chunk_begin = data;
+  for(int i=0; i<chunk_count; ++i)
+  {
+    chunks[i].mBegin = chunk_begin;
+    chunks[i].mEnd = i == chunk_count-1 ? end : nextLineStart( std::max(chunk_begin, data + size / chunk_count * (i+1)), end );
+    chunk_begin = chunks[i].mEnd;
+  }
+
+  ObjParseTasks parse_tasks(chunks);
+  Thread::runTasks(&parse_tasks, chunk_count, thread_count);
+
+  // merge vertices
+
+  int coords_count = 0;
+  int normals_count = 0;
+  int tex_coords_count = 0;
+  for(int i=0; i<chunk_count; ++i)
+  {
+    chunks[i].mCoordsBase    = coords_count;
+    chunks[i].mNormalsBase   = normals_count;
+    chunks[i].mTexCoordsBase = tex_coords_count;
+    coords_count     += (int)chunks[i].mCoords.size();
+    normals_count    += (int)chunks[i].mNormals.size();
+    tex_coords_count += (int)chunks[i].mTexCoords.size();
+  }
+  mCoords.resize(coords_count);
+  mNormals.resize(normals_count);
+  mTexCoords.resize(tex_coords_count);
+
+  ObjMergeTasks merge_tasks(chunks, mCoords, mNormals, mTexCoords);
+  Thread::runTasks(&merge_tasks, chunk_count, thread_count);
+
+  if (unmap)
+    disk_file->unmapMemory();
+
+  // replay the statements in file order to build the meshes
+
+  ref<ObjMaterial> cur_material;
+  ref<ObjMesh> cur_mesh;
+  std::string object_name;
+  bool starts_new_geom = true;
+
+  for(int i=0; i<chunk_count; ++i)
+  {
+    ObjChunk& chunk = chunks[i];
+    size_t face = 0, pos = 0, tex = 0, nrm = 0;
+    for(size_t j=0; j<=chunk.mStatements.size(); ++j)
+    {
+      // the faces preceding the statement, or the chunk's end
+      size_t face_end = j < chunk.mStatements.size() ? chunk.mStatements[j].mFaceCount : chunk.mFaceType.size();
+      size_t pos_end  = j < chunk.mStatements.size() ? chunk.mStatements[j].mPosCount  : chunk.mFacePos.size();
+      size_t tex_end  = j < chunk.mStatements.size() ? chunk.mStatements[j].mTexCount  : chunk.mFaceTex.size();
+      size_t nrm_end  = j < chunk.mStatements.size() ? chunk.mStatements[j].mNrmCount  : chunk.mFaceNrm.size();
+      if (face_end > face)
+      {
+        // starts new geometry if necessary
+        if (starts_new_geom)
+        {
+          cur_mesh = new ObjMesh;
+          cur_mesh->setObjectName(object_name.c_str());
+          mMeshes.push_back( cur_mesh );
+          starts_new_geom = false;
+          cur_mesh->setMaterial(cur_material.get());
+        }
+        appendRange( cur_mesh->face_type(), chunk.mFaceType, face, face_end );
+        appendRange( cur_mesh->facePositionIndex(), chunk.mFacePos, pos, pos_end );
+        appendRange( cur_mesh->faceTexCoordIndex(), chunk.mFaceTex, tex, tex_end );
+        appendRange( cur_mesh->faceNormalIndex(), chunk.mFaceNrm, nrm, nrm_end );
+      }
+      face = face_end;
+      pos  = pos_end;
+      tex  = tex_end;
+      nrm  = nrm_end;
+
+      if (j == chunk.mStatements.size())
+        break;
+
+      const ObjStatement& st = chunk.mStatements[j];
+      switch(st.mType)
+      {
+      case ObjStatement::OS_Object:
+        starts_new_geom = true;
+        object_name = st.mName;
+        break;
+      case ObjStatement::OS_UseMtl:
+        starts_new_geom = true;
+        // can also become NULL
+        cur_material = mMaterials[st.mName];
+        break;
+      case ObjStatement::OS_MtlLib:
+        loadMaterialLibrary( file, st.mName.c_str() );
+        break;
+      }
+    }
+    // release the chunk as soon as possible
+    chunk.release();
+  }
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+ref<ResourceDatabase> ObjLoader::buildResources( VirtualFile* file )
+{
   ref<ResourceDatabase> res_db = new ResourceDatabase;
 
   // compile the material/effect library
@@ -918,16 +1473,14 @@ ref<ResourceDatabase> ObjLoader::loadOBJ( VirtualFile* file )
     actor->setEffect(effect.get());
   }
 
-  stream->inputFile()->close();
-
   return res_db;
 }
 //-----------------------------------------------------------------------------
-ref<ResourceDatabase> vl::loadOBJ( const String& path )
+ref<ResourceDatabase> vl::loadOBJ( const String& path, bool fast_parsing, int thread_count )
 {
   ref<VirtualFile> file = defFileSystem()->locateFile( path );
   if (file)
-    return loadOBJ( file.get() );
+    return loadOBJ( file.get(), fast_parsing, thread_count );
   else
   {
     Log::error( Say("Could not locate '%s'.\n") << path );
@@ -935,8 +1488,11 @@ ref<ResourceDatabase> vl::loadOBJ( const String& path )
   }
 }
 //-----------------------------------------------------------------------------
-ref<ResourceDatabase> vl::loadOBJ( VirtualFile* file )
+ref<ResourceDatabase> vl::loadOBJ( VirtualFile* file, bool fast_parsing, int thread_count )
 {
-  return ObjLoader().loadOBJ(file);
+  ObjLoader loader;
+  loader.setFastParsing(fast_parsing);
+  loader.setThreadCount(thread_count);
+  return loader.loadOBJ(file);
 }
 //-----------------------------------------------------------------------------
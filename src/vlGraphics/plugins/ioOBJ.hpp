@@ -43,11 +43,11 @@ namespace vl
   class VirtualFile;
 
 //-----------------------------------------------------------------------------
-  //! Loads a Wavefront OBJ file. See also ObjLoader.
-  VLGRAPHICS_EXPORT ref<ResourceDatabase> loadOBJ( const String& path );
+  //! Loads a Wavefront OBJ file. See also ObjLoader, ObjLoader::setFastParsing() and ObjLoader::setThreadCount().
+  VLGRAPHICS_EXPORT ref<ResourceDatabase> loadOBJ( const String& path, bool fast_parsing=false, int thread_count=0 );
 //-----------------------------------------------------------------------------
-  //! Loads a Wavefront OBJ file. See also ObjLoader.
-  VLGRAPHICS_EXPORT ref<ResourceDatabase> loadOBJ( VirtualFile* file );
+  //! Loads a Wavefront OBJ file. See also ObjLoader, ObjLoader::setFastParsing() and ObjLoader::setThreadCount().
+  VLGRAPHICS_EXPORT ref<ResourceDatabase> loadOBJ( VirtualFile* file, bool fast_parsing=false, int thread_count=0 );
 //---------------------------------------------------------------------------
 // LoadWriterOBJ
 //---------------------------------------------------------------------------
@@ -59,18 +59,18 @@ namespace vl
     VL_INSTRUMENT_CLASS(vl::LoadWriterOBJ, ResourceLoadWriter)
 
   public:
-    LoadWriterOBJ(): ResourceLoadWriter("|obj|", "|obj|") {}
+    LoadWriterOBJ(): ResourceLoadWriter("|obj|", "|obj|"), mFastParsing(false), mThreadCount(0) {}
 
     void registerLoadWriter();
 
     ref<ResourceDatabase> loadResource(const String& path) const 
     {
-      return loadOBJ(path);
+      return loadOBJ(path, fastParsing(), threadCount());
     }
 
     ref<ResourceDatabase> loadResource(VirtualFile* file) const
     {
-      return loadOBJ(file);
+      return loadOBJ(file, fastParsing(), threadCount());
     }
 
     //! Not supported yet.
@@ -84,6 +84,20 @@ namespace vl
     {
       return false;
     }
+
+    //! Whether the files are loaded using the fast parallel parser, see ObjLoader::setFastParsing().
+    bool fastParsing() const { return mFastParsing; }
+    //! Whether the files are loaded using the fast parallel parser, see ObjLoader::setFastParsing().
+    void setFastParsing(bool enable) { mFastParsing = enable; }
+
+    //! The number of threads used by the fast parser, see ObjLoader::setThreadCount().
+    int threadCount() const { return mThreadCount; }
+    //! The number of threads used by the fast parser, see ObjLoader::setThreadCount().
+    void setThreadCount(int count) { mThreadCount = count; }
+
+  protected:
+    bool mFastParsing;
+    int mThreadCount;
   };
 //-----------------------------------------------------------------------------
 // ObjTexture
@@ -341,6 +355,8 @@ namespace vl
   class ObjLoader
   {
   public:
+    ObjLoader(): mFastParsing(false), mThreadCount(0) {}
+
     const std::vector<fvec4>& vertexArray() const { return mCoords; }
     const std::vector<fvec3>& normalArray() const { return mNormals; }
     const std::vector<fvec3>& texCoordsArray() const { return mTexCoords; }
@@ -362,12 +378,31 @@ namespace vl
     //! \param materials Is filled with the loaded materials
     void loadObjMaterials(VirtualFile* file, std::vector<ObjMaterial>& materials );
 
+    //! If enabled the OBJ file is memory mapped (see DiskFile::mapMemory()), split into line-aligned chunks and 
+    //! parsed in parallel with a hand-written number parser instead of being read line by line with sscanf(). Disabled by default.
+    void setFastParsing(bool enable) { mFastParsing = enable; }
+    //! Whether the fast parallel parser is used, see setFastParsing().
+    bool fastParsing() const { return mFastParsing; }
+
+    //! The number of threads used by the fast parser, 0 (default) means Thread::hardwareConcurrency().
+    void setThreadCount(int count) { mThreadCount = count; }
+    //! The number of threads used by the fast parser, 0 (default) means Thread::hardwareConcurrency().
+    int threadCount() const { return mThreadCount; }
+
+  protected:
+    bool parseOBJ( VirtualFile* file );
+    bool parseOBJFast( VirtualFile* file );
+    void loadMaterialLibrary( VirtualFile* file, const String& mtllib );
+    ref<ResourceDatabase> buildResources( VirtualFile* file );
+
   protected:
     std::vector<fvec4> mCoords;
     std::vector<fvec3> mNormals;
     std::vector<fvec3> mTexCoords;
     std::map< std::string, ref<ObjMaterial> > mMaterials;
     std::vector< ref<ObjMesh> > mMeshes;
+    bool mFastParsing;
+    int mThreadCount;
   };
 //-----------------------------------------------------------------------------
 }
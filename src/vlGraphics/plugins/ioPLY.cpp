@@ -36,11 +36,192 @@
 #include <vlCore/FileSystem.hpp>
 #include <vlCore/TextStream.hpp>
 #include <vlCore/VirtualFile.hpp>
+#include <vlCore/DiskFile.hpp>
 #include <vlGraphics/Effect.hpp>
 #include <vlGraphics/Actor.hpp>
 #include <vlCore/LoadWriterManager.hpp>
+#include <algorithm>
 
 using namespace vl;
+
+namespace
+{
+  const size_t PlyBlockSize = 1024*1024;
+
+  int plyTypeSize(PlyLoader::EType type)
+  {
+    switch(type)
+    {
+      case PlyLoader::PlyChar:   return 1;
+      case PlyLoader::PlyUChar:  return 1;
+      case PlyLoader::PlyShort:  return 2;
+      case PlyLoader::PlyUShort: return 2;
+      case PlyLoader::PlyInt:    return 4;
+      case PlyLoader::PlyUInt:   return 4;
+      case PlyLoader::PlyFloat:  return 4;
+      case PlyLoader::PlyDouble: return 8;
+      default:
+        return 0;
+    }
+  }
+
+  inline bool isLittleEndianCPU()
+  {
+    unsigned short x = 1;
+    return *(unsigned char*)&x == 1;
+  }
+
+  template<class T, bool swap>
+  inline T loadScalar(const unsigned char* src)
+  {
+    T value;
+    if (swap)
+    {
+      unsigned char tmp[sizeof(T)];
+      for(size_t i=0; i<sizeof(T); ++i)
+        tmp[i] = src[sizeof(T)-1-i];
+      memcpy(&value, tmp, sizeof(T));
+    }
+    else
+      memcpy(&value, src, sizeof(T));
+    return value;
+  }
+
+  // same conversions as PlyScalar::getAsFloat() and PlyScalar::getAsInt()
+  template<class T> inline void storeScalar(float* dst, T value) { *dst = (float)value; }
+  template<class T> inline void storeScalar(unsigned char* dst, T value) { *dst = (unsigned char)(int)value; }
+
+  // decodes one scalar property of \p count fixed-size records into a strided destination
+  template<class T, bool swap, class D>
+  void decodeScalars(const unsigned char* src, size_t stride, size_t count, D* dst, size_t dst_stride)
+  {
+    for(size_t i=0; i<count; ++i, src += stride, dst += dst_stride)
+      storeScalar(dst, loadScalar<T,swap>(src));
+  }
+
+  template<bool swap, class D>
+  void decodeScalars(PlyLoader::EType type, const unsigned char* src, size_t stride, size_t count, D* dst, size_t dst_stride)
+  {
+    switch(type)
+    {
+      case PlyLoader::PlyChar:   decodeScalars<char,           swap>(src, stride, count, dst, dst_stride); break;
+      case PlyLoader::PlyUChar:  decodeScalars<unsigned char,  swap>(src, stride, count, dst, dst_stride); break;
+      case PlyLoader::PlyShort:  decodeScalars<short,          swap>(src, stride, count, dst, dst_stride); break;
+      case PlyLoader::PlyUShort: decodeScalars<unsigned short, swap>(src, stride, count, dst, dst_stride); break;
+      case PlyLoader::PlyInt:    decodeScalars<int,            swap>(src, stride, count, dst, dst_stride); break;
+      case PlyLoader::PlyUInt:   decodeScalars<unsigned int,   swap>(src, stride, count, dst, dst_stride); break;
+      case PlyLoader::PlyFloat:  decodeScalars<float,          swap>(src, stride, count, dst, dst_stride); break;
+      case PlyLoader::PlyDouble: decodeScalars<double,         swap>(src, stride, count, dst, dst_stride); break;
+      default:
+        break;
+    }
+  }
+
+  template<class D>
+  void decodeScalars(PlyLoader::EType type, bool swap, const unsigned char* src, size_t stride, size_t count, D* dst, size_t dst_stride)
+  {
+    if (swap)
+      decodeScalars<true>(type, src, stride, count, dst, dst_stride);
+    else
+      decodeScalars<false>(type, src, stride, count, dst, dst_stride);
+  }
+
+  // decodes 3 consecutive components, e.g. x, y, z, of \p count fixed-size records
+  void decodeVec3(const int* offset, const PlyLoader::EType* type, bool swap, const unsigned char* src, size_t stride, size_t count, float* dst)
+  {
+    bool packed_floats = !swap &&
+                         type[0] == PlyLoader::PlyFloat && type[1] == PlyLoader::PlyFloat && type[2] == PlyLoader::PlyFloat &&
+                         offset[0] >= 0 && offset[1] == offset[0] + 4 && offset[2] == offset[0] + 8;
+    if (packed_floats)
+    {
+      if (stride == 12)
+        memcpy(dst, src, count*12);
+      else
+      {
+        for(size_t i=0; i<count; ++i, src += stride, dst += 3)
+          memcpy(dst, src + offset[0], 12);
+      }
+      return;
+    }
+
+    for(int c=0; c<3; ++c)
+    {
+      if (offset[c] >= 0)
+        decodeScalars(type[c], swap, src + offset[c], stride, count, dst + c, 3);
+      else
+      {
+        for(size_t i=0; i<count; ++i)
+          dst[i*3 + c] = 0;
+      }
+    }
+  }
+
+  int loadAsInt(const unsigned char* src, PlyLoader::EType type, bool swap)
+  {
+    switch(type)
+    {
+      case PlyLoader::PlyChar:   return swap ? (int)loadScalar<char,true>(src)           : (int)loadScalar<char,false>(src);
+      case PlyLoader::PlyUChar:  return swap ? (int)loadScalar<unsigned char,true>(src)  : (int)loadScalar<unsigned char,false>(src);
+      case PlyLoader::PlyShort:  return swap ? (int)loadScalar<short,true>(src)          : (int)loadScalar<short,false>(src);
+      case PlyLoader::PlyUShort: return swap ? (int)loadScalar<unsigned short,true>(src) : (int)loadScalar<unsigned short,false>(src);
+      case PlyLoader::PlyInt:    return swap ? (int)loadScalar<int,true>(src)            : (int)loadScalar<int,false>(src);
+      case PlyLoader::PlyUInt:   return swap ? (int)loadScalar<unsigned int,true>(src)   : (int)loadScalar<unsigned int,false>(src);
+      case PlyLoader::PlyFloat:  return swap ? (int)loadScalar<float,true>(src)          : (int)loadScalar<float,false>(src);
+      case PlyLoader::PlyDouble: return swap ? (int)loadScalar<double,true>(src)         : (int)loadScalar<double,false>(src);
+      default:
+        return 0;
+    }
+  }
+
+  //! Serves the binary body of a PLY file either from a memory mapping or from large blocks read from the VirtualFile.
+  class PlyBlockReader
+  {
+  public:
+    PlyBlockReader(VirtualFile* file): mFile(file), mData(NULL), mPos(0), mSize(0), mMapped(false) {}
+
+    void map(const unsigned char* data, size_t size)
+    {
+      mData = data;
+      mPos = 0;
+      mSize = size;
+      mMapped = true;
+    }
+
+    //! Tries to make at least \p bytes available and returns the number of bytes actually available.
+    size_t request(size_t bytes)
+    {
+      if (mSize - mPos < bytes && !mMapped)
+        refill(bytes);
+      return mSize - mPos;
+    }
+
+    const unsigned char* ptr() const { return mData + mPos; }
+
+    void consume(size_t bytes) { mPos += bytes; }
+
+  private:
+    void refill(size_t bytes)
+    {
+      size_t remaining = mSize - mPos;
+      if (remaining)
+        memmove(&mBuffer[0], &mBuffer[mPos], remaining);
+      if (mBuffer.size() < std::max(bytes, PlyBlockSize))
+        mBuffer.resize(std::max(bytes, PlyBlockSize));
+      long long count = mFile->read(&mBuffer[remaining], mBuffer.size() - remaining);
+      mData = &mBuffer[0];
+      mPos = 0;
+      mSize = remaining + (count > 0 ? (size_t)count : 0);
+    }
+
+  private:
+    VirtualFile* mFile;
+    std::vector<unsigned char> mBuffer;
+    const unsigned char* mData;
+    size_t mPos;
+    size_t mSize;
+    bool mMapped;
+  };
+}
 //-----------------------------------------------------------------------------
 ref<ResourceDatabase> vl::loadPLY(const String& path)
 {
@@ -193,6 +374,9 @@ void PlyLoader::readElements(VirtualFile* file)
     str.push_back( ch );
   } while(true);
 
+  if (readElementsBulk(file))
+    return;
+
   for(unsigned i=0; i<mElements.size(); ++i)
     for(int j=0; j<mElements[i]->elemCount(); ++j)
     {
@@ -200,6 +384,181 @@ void PlyLoader::readElements(VirtualFile* file)
       newElement(mElements[i].get());
     }
 }
+bool PlyLoader::readElementsBulk(VirtualFile* file)
+{
+  // check that all the types are known and that the vertices have a fixed-size layout
+  for(unsigned i=0; i<mElements.size(); ++i)
+  {
+    for(unsigned j=0; j<mElements[i]->properties().size(); ++j)
+    {
+      PlyScalar* scalar = cast<PlyScalar>(mElements[i]->properties()[j].get());
+      PlyScalarList* list = cast<PlyScalarList>(mElements[i]->properties()[j].get());
+      if (scalar && plyTypeSize(scalar->scalarType()) == 0)
+        return false;
+      if (list && (mElements[i]->name() == "vertex" || plyTypeSize(list->countType()) == 0 || plyTypeSize(list->scalarType()) == 0))
+        return false;
+      if (!scalar && !list)
+        return false;
+    }
+  }
+
+  const bool swap = littleEndian() != isLittleEndianCPU();
+
+  // map the whole file if possible, otherwise read it in large blocks
+  PlyBlockReader reader(file);
+  DiskFile* disk_file = file->as<DiskFile>();
+  bool unmap = disk_file && !disk_file->mappedMemory();
+  long long header_size = file->position();
+  if (disk_file && disk_file->mapMemory() && header_size >= 0 && header_size <= disk_file->mappedSize())
+    reader.map((const unsigned char*)disk_file->mappedMemory() + header_size, (size_t)(disk_file->mappedSize() - header_size));
+
+  bool eof = false;
+  for(unsigned i=0; i<mElements.size() && !eof; ++i)
+  {
+    PlyElement* el = mElements[i].get();
+    size_t count = el->elemCount() > 0 ? (size_t)el->elemCount() : 0;
+
+    // fixed-size elements
+    size_t stride = 0;
+    bool fixed = true;
+    for(unsigned j=0; j<el->properties().size(); ++j)
+    {
+      PlyScalar* scalar = cast<PlyScalar>(el->properties()[j].get());
+      if (scalar)
+        stride += plyTypeSize(scalar->scalarType());
+      else
+        fixed = false;
+    }
+
+    if (fixed)
+    {
+      // byte offset and type of x, y, z, nx, ny, nz, red, green, blue, alpha
+      const char* names[] = { "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue", "alpha" };
+      int offset[10];
+      EType type[10];
+      for(int k=0; k<10; ++k)
+      {
+        offset[k] = -1;
+        type[k] = PlyError;
+      }
+      int pos = 0;
+      for(unsigned j=0; j<el->properties().size(); ++j)
+      {
+        PlyScalar* scalar = cast<PlyScalar>(el->properties()[j].get());
+        for(int k=0; k<10; ++k)
+        {
+          if (scalar->name() == names[k])
+          {
+            offset[k] = pos;
+            type[k] = scalar->scalarType();
+          }
+        }
+        pos += plyTypeSize(scalar->scalarType());
+      }
+
+      const bool is_vertex = el->name() == "vertex";
+      const size_t block = stride ? std::max((size_t)1, PlyBlockSize / stride) : count;
+      for(size_t done=0; done<count; )
+      {
+        size_t n = std::min(block, count - done);
+        n = stride ? std::min(n, reader.request(n*stride) / stride) : n;
+        if (n == 0)
+        {
+          eof = true;
+          break;
+        }
+        const unsigned char* src = reader.ptr();
+        if (is_vertex)
+        {
+          size_t index = mVertexIndex + done;
+          VL_CHECK(!mVerts || index + n <= mVerts->size())
+          if (mVerts)
+            decodeVec3(offset+0, type+0, swap, src, stride, n, (float*)mVerts->ptr() + index*3);
+          if (mNormals)
+            decodeVec3(offset+3, type+3, swap, src, stride, n, (float*)mNormals->ptr() + index*3);
+          if (mColors)
+          {
+            unsigned char* dst = mColors->ptr() + index*4;
+            for(int c=0; c<4; ++c)
+            {
+              if (offset[6+c] >= 0)
+                decodeScalars(type[6+c], swap, src + offset[6+c], stride, n, dst + c, 4);
+              else
+              {
+                for(size_t v=0; v<n; ++v)
+                  dst[v*4 + c] = 0;
+              }
+            }
+          }
+        }
+        reader.consume(n*stride);
+        done += n;
+      }
+      if (is_vertex)
+        mVertexIndex += (int)count;
+      continue;
+    }
+
+    // variable-size elements
+    const bool is_face = el->name() == "face";
+    if (is_face)
+      mIndices.reserve(mIndices.size() + count*3);
+    for(size_t v=0; v<count && !eof; ++v)
+    {
+      for(unsigned j=0; j<el->properties().size(); ++j)
+      {
+        PlyScalar* scalar = cast<PlyScalar>(el->properties()[j].get());
+        if (scalar)
+        {
+          size_t size = plyTypeSize(scalar->scalarType());
+          if (reader.request(size) < size)
+          {
+            eof = true;
+            break;
+          }
+          reader.consume(size);
+          continue;
+        }
+
+        PlyScalarList* list = cast<PlyScalarList>(el->properties()[j].get());
+        size_t count_size  = plyTypeSize(list->countType());
+        size_t scalar_size = plyTypeSize(list->scalarType());
+        if (reader.request(count_size) < count_size)
+        {
+          eof = true;
+          break;
+        }
+        int list_size = std::max(0, loadAsInt(reader.ptr(), list->countType(), swap));
+        size_t bytes = count_size + list_size*scalar_size;
+        if (reader.request(bytes) < bytes)
+        {
+          eof = true;
+          break;
+        }
+        if (is_face && list->name() == "vertex_indices")
+        {
+          const unsigned char* src = reader.ptr() + count_size;
+          unsigned int first = loadAsInt(src, list->scalarType(), swap);
+          for(int k=1; k<list_size-1; ++k)
+          {
+            mIndices.push_back( first );
+            mIndices.push_back( loadAsInt(src + k*scalar_size, list->scalarType(), swap) );
+            mIndices.push_back( loadAsInt(src + (k+1)*scalar_size, list->scalarType(), swap) );
+          }
+        }
+        reader.consume(bytes);
+      }
+    }
+  }
+
+  if (eof)
+    Log::error( Say("PlyLoader: unexpected end of file in '%s'.\n") << file->path() );
+
+  if (unmap)
+    disk_file->unmapMemory();
+
+  return true;
+}
 void PlyLoader::readElements(TextStream* text)
 {
   for(unsigned i=0; i<mElements.size(); ++i)
@@ -404,17 +763,25 @@ ref<ResourceDatabase> PlyLoader::loadPly(VirtualFile* file)
     readElements(line_reader.get());
   file->close();
 
-  if (mIndices.empty() || !mVerts)
+  if (!mVerts)
     return NULL;
 
   ref<Geometry> geom = new Geometry;
   geom->setVertexArray(mVerts.get());
   geom->setNormalArray(mNormals.get());
   geom->setColorArray(mColors.get());
-  ref<DrawElementsUInt> de = new DrawElementsUInt(PT_TRIANGLES);
-  geom->drawCalls()->push_back(de.get());
-  de->indexBuffer()->resize(mIndices.size());
-  memcpy(de->indexBuffer()->ptr(), &mIndices[0], sizeof(unsigned int)*mIndices.size());
+  if (mIndices.empty())
+  {
+    // point cloud
+    geom->drawCalls()->push_back( new DrawArrays(PT_POINTS, 0, (int)mVerts->size()) );
+  }
+  else
+  {
+    ref<DrawElementsUInt> de = new DrawElementsUInt(PT_TRIANGLES);
+    geom->drawCalls()->push_back(de.get());
+    de->indexBuffer()->resize(mIndices.size());
+    memcpy(de->indexBuffer()->ptr(), &mIndices[0], sizeof(unsigned int)*mIndices.size());
+  }
 
   // Effect
   ref<Effect> effect = new Effect;
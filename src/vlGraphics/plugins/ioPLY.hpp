@@ -106,6 +106,8 @@ namespace vl
     //! Used by PlyLoader
     class PlyPropertyAbstract: public Object
     {
+      VL_INSTRUMENT_ABSTRACT_CLASS(vl::PlyLoader::PlyPropertyAbstract, Object)
+
     public:
       const String& name() const { return mName; }
       void setName(const String& name) { mName = name; }
@@ -117,6 +119,8 @@ namespace vl
     //! Used by PlyLoader
     class PlyScalar: public PlyPropertyAbstract
     {
+      VL_INSTRUMENT_CLASS(vl::PlyLoader::PlyScalar, PlyPropertyAbstract)
+
     public:
       PlyScalar(): mScalarType(PlyError) { mData.mDouble = 0; }
       void setScalarType(EType type) { mScalarType = type; }
@@ -142,6 +146,8 @@ namespace vl
     //! Used by PlyLoader
     class PlyScalarList: public PlyPropertyAbstract
     {
+      VL_INSTRUMENT_CLASS(vl::PlyLoader::PlyScalarList, PlyPropertyAbstract)
+
     public:
       PlyScalarList(): mScalarType(PlyError), mCountType(PlyError) {}
       void setCountType(EType type) { mCountType = type; }
@@ -182,6 +188,8 @@ namespace vl
     //! Used by PlyLoader
     class PlyElement: public Object
     {
+      VL_INSTRUMENT_CLASS(vl::PlyLoader::PlyElement, Object)
+
     public:
       PlyElement(): mElemCount(0) {}
       const String& name() const { return mName; }
@@ -245,6 +253,9 @@ namespace vl
     bool littleEndian() const { return mLittleEndian; }
     void readElements(VirtualFile* file);
     void readElements(TextStream* text);
+    //! Reads the binary elements in large blocks decoding them straight into the vertex, normal, color and index arrays.
+    //! The file must be positioned right after the header. Returns false without reading anything if some property type is unknown or if the vertices don't have a fixed-size layout.
+    bool readElementsBulk(VirtualFile* file);
     void newElement(PlyElement*el);
     EType translateType(const String& type);
     void analyzeHeader();
@@ -33,7 +33,9 @@
 
 #include <vlVolume/MarchingCubes.hpp>
 #include <vlCore/Time.hpp>
+#include <vlCore/Thread.hpp>
 #include <vlGraphics/DoubleVertexRemover.hpp>
+#include <algorithm>
 
 using namespace vl;
 
@@ -71,6 +73,10 @@ MarchingCubes::MarchingCubes()
 #endif
   mVolumeInfo.setAutomaticDelete(false);
   mHighQualityNormals = true;
+  mThreadCount = 1;
+  mBlockSize = 0;
+  mBlockColors = false;
+  mBlockHighQualityNormals = true;
 }
 //------------------------------------------------------------------------------
 // MarchingCubes
@@ -82,6 +88,11 @@ void MarchingCubes::computeEdges(Volume* vol, float threshold)
   mCubes.clear();
   mCubes.reserve(1024);
 
+  computeEdges(vol, threshold, 0, vol->slices().z(), mVerts, mNorms, mCubes);
+}
+//------------------------------------------------------------------------------
+inline void MarchingCubes::computeEdges(Volume* vol, float threshold, int x, int y, int z, int iedge, bool edge_x, bool edge_y, bool edge_z, std::vector<fvec3>& verts, std::vector<fvec3>& norms)
+{
   /////////////////////////////////////////////////////////////////////////////////
   // note: this funtion can generate double vertices when the 't' is 0.0 or 1.0
   // this is why Geometry::computeNormals() doesn't work well with MarchingCubes
@@ -93,11 +104,94 @@ void MarchingCubes::computeEdges(Volume* vol, float threshold)
   const float dy = vol->cellSize().y() * 0.25f;
   const float dz = vol->cellSize().z() * 0.25f;
   float v0, v1, v2, v3, t;
-  int iedge = 0;
+
+  if (verts.capacity() - verts.size() == 0)
+  {
+    verts.reserve( verts.size() * 2 );
+    norms.reserve( norms.size() * 2 );
+  }
+
+  v0 = vol->value( x,y,z );
+  fvec3 v0_coord = vol->coordinate(x, y, z);
+
+  if (edge_x)
+  {
+    v1 = vol->value( x + 1, y, z );
+    if (v1!=v0)
+    {
+      //if (t>=0 && t<=1.0f)
+      if ( (threshold>=v0 && threshold<=v1) || (threshold>=v1 && threshold<=v0) )
+      {
+        t = (threshold-v0)/(v1-v0);
+        VL_CHECK(t>=-0.001f && t<=1.001f)
+        // emit vertex
+        mEdges[iedge].mX = (int)verts.size();
+        // compute vertex and normal position
+        verts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x + 1, y, z) * t );
+        if (mHighQualityNormals)
+        {
+          fvec3 n;
+          vol->normalHQ(n, verts.back(), dx, dy, dz);
+          norms.push_back(n);
+        }
+      }
+    }
+  }
+  if (edge_y)
+  {
+    v2 = vol->value( x, y + 1, z );
+    if (v2!=v0)
+    {
+      //if (t>=0 && t<=1.0f)
+      if ( (threshold>=v0 && threshold<=v2) || (threshold>=v2 && threshold<=v0) )
+      {
+        t = (threshold-v0)/(v2-v0);
+        VL_CHECK(t>=-0.001f && t<=1.001f)
+        // emit vertex
+        mEdges[iedge].mY = (int)verts.size();
+        // compute vertex and normal position
+        verts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y + 1, z) * t );
+        if (mHighQualityNormals)
+        {
+          fvec3 n;
+          vol->normalHQ(n, verts.back(), dx, dy, dz);
+          norms.push_back(n);
+        }
+      }
+    }
+  }
+  if (edge_z)
+  {
+    v3 = vol->value( x, y, z + 1 );
+    if (v3!=v0)
+    {
+      //if (t>=0 && t<=1.0f)
+      if ( (threshold>=v0 && threshold<=v3) || (threshold>=v3 && threshold<=v0) )
+      {
+        t = (threshold-v0)/(v3-v0);
+        VL_CHECK(t>=-0.001f && t<=1.001f)
+        // emit vertex
+        mEdges[iedge].mZ = (int)verts.size();
+        // compute vertex and normal position
+        verts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y, z + 1) * t );
+        if (mHighQualityNormals)
+        {
+          fvec3 n;
+          vol->normalHQ(n, verts.back(), dx, dy, dz);
+          norms.push_back(n);
+        }
+      }
+    }
+  }
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::computeEdges(Volume* vol, float threshold, int z_begin, int z_end, std::vector<fvec3>& verts, std::vector<fvec3>& norms, std::vector<usvec3>& cubes)
+{
+  int iedge = z_begin * vol->slices().x() * vol->slices().y();
   int w = vol->slices().x() -1;
   int h = vol->slices().y() -1;
   int d = vol->slices().z() -1;
-  for(unsigned short z = 0; z < vol->slices().z(); ++z)
+  for(unsigned short z = (unsigned short)z_begin; z < z_end; ++z)
   {
     for(unsigned short y = 0; y < vol->slices().y(); ++y)
     {
@@ -107,98 +201,26 @@ void MarchingCubes::computeEdges(Volume* vol, float threshold)
         {
           if (vol->cube(x,y,z).includes(threshold))
           {
-            if (mCubes.capacity()-mCubes.size() == 0)
-              mCubes.reserve(mCubes.size()*2);
-            mCubes.push_back( usvec3(x,y,z) );
+            if (cubes.capacity()-cubes.size() == 0)
+              cubes.reserve(cubes.size()*2);
+            cubes.push_back( usvec3(x,y,z) );
           }
           else
             continue;
         }
 
-        if (mVerts.capacity() - mVerts.size() == 0)
-        {
-          mVerts.reserve( mVerts.size() * 2 );
-          mNorms.reserve( mNorms.size() * 2 );
-        }
-
-        v0 = vol->value( x,y,z );
-        fvec3 v0_coord = vol->coordinate(x, y, z);
-
-        if (x != w)
-        {
-          v1 = vol->value( x + 1, y, z );
-          if (v1!=v0)
-          {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v1) || (threshold>=v1 && threshold<=v0) )
-            {
-              t = (threshold-v0)/(v1-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mX = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x + 1, y, z) * t );
-              if (mHighQualityNormals)
-              {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
-              }
-            }
-          }
-        }
-        if (y != h)
-        {
-          v2 = vol->value( x, y + 1, z );
-          if (v2!=v0)
-          {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v2) || (threshold>=v2 && threshold<=v0) )
-            {
-              t = (threshold-v0)/(v2-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mY = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y + 1, z) * t );
-              if (mHighQualityNormals)
-              {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
-              }
-            }
-          }
-        }
-        if (z != d)
-        {
-          v3 = vol->value( x, y, z + 1 );
-          if (v3!=v0)
-          {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v3) || (threshold>=v3 && threshold<=v0) )
-            {
-              t = (threshold-v0)/(v3-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mZ = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y, z + 1) * t );
-              if (mHighQualityNormals)
-              {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
-              }
-            }
-          }
-        }
+        computeEdges(vol, threshold, x, y, z, iedge, x != w, y != h, z != d, verts, norms);
       }
     }
   }
 }
 //------------------------------------------------------------------------------
 void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshold)
+{
+  processCube(x, y, z, vol, threshold, mIndices);
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshold, std::vector<IndexType>& indices)
 {
   int inner_corners = 0;
 
@@ -260,8 +282,8 @@ void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshol
   int ivertex;
   for(int icorner = 0; mTriangleConnectionTable[inner_corners][icorner]>=0; icorner+=3)
   {
-    if (mIndices.capacity() - mIndices.size() == 0)
-      mIndices.reserve( mIndices.size()*2 );
+    if (indices.capacity() - indices.size() == 0)
+      indices.reserve( indices.size()*2 );
 
     ivertex = mTriangleConnectionTable[inner_corners][icorner+0];
     int a = edge_ivert[ivertex];
@@ -288,10 +310,126 @@ void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshol
         continue;
     #endif
 
-    mIndices.push_back((IndexType)a);
-    mIndices.push_back((IndexType)b);
-    mIndices.push_back((IndexType)c);
+    indices.push_back((IndexType)a);
+    indices.push_back((IndexType)b);
+    indices.push_back((IndexType)c);
+  }
+}
+//------------------------------------------------------------------------------
+// MarchingCubes::SlabTasks
+//------------------------------------------------------------------------------
+// Processes a volume split in slabs of z-layers. Each slab emits its vertices in a
+// private array using slab-local indices, then the slabs are laid out one after the 
+// other in z order, exactly like the single threaded path does, and their edge indices
+// are relocated so that cubes straddling two slabs see the vertices of both.
+class MarchingCubes::SlabTasks: public ParallelTasks
+{
+public:
+  typedef enum { ComputeEdges, RelocateVertices, ProcessCubes } EPhase;
+
+  struct Slab
+  {
+    Slab(): mZ0(0), mZ1(0), mVert0(0), mNorm0(0) {}
+    int mZ0, mZ1;
+    int mVert0, mNorm0;
+    std::vector<fvec3> mVerts;
+    std::vector<fvec3> mNorms;
+    std::vector<usvec3> mCubes;
+    std::vector<IndexType> mIndices;
+  };
+
+  SlabTasks(MarchingCubes* mc, Volume* vol, float threshold, int slab_count): 
+    mMarchingCubes(mc), mVolume(vol), mThreshold(threshold), mPhase(ComputeEdges)
+  {
+    mSlabs.resize(slab_count);
+    for(int i=0; i<slab_count; ++i)
+    {
+      mSlabs[i].mZ0 = vol->slices().z() * i / slab_count;
+      mSlabs[i].mZ1 = vol->slices().z() * (i+1) / slab_count;
+    }
   }
+
+  void setPhase(EPhase phase) { mPhase = phase; }
+
+  std::vector<Slab>& slabs() { return mSlabs; }
+
+  virtual void runTask(int index)
+  {
+    Slab& slab = mSlabs[index];
+    const int layer = mVolume->slices().x() * mVolume->slices().y();
+    Edge* edge_begin = &mMarchingCubes->mEdges[0] + slab.mZ0 * layer;
+    Edge* edge_end   = &mMarchingCubes->mEdges[0] + slab.mZ1 * layer;
+
+    switch(mPhase)
+    {
+    case ComputeEdges:
+      // discard the indices left by previous runs so that only this run's vertices get relocated
+      std::fill(edge_begin, edge_end, Edge());
+      mMarchingCubes->computeEdges(mVolume, mThreshold, slab.mZ0, slab.mZ1, slab.mVerts, slab.mNorms, slab.mCubes);
+      break;
+
+    case RelocateVertices:
+      for(Edge* edge = edge_begin; edge != edge_end; ++edge)
+      {
+        if (edge->mX >= 0) edge->mX += slab.mVert0;
+        if (edge->mY >= 0) edge->mY += slab.mVert0;
+        if (edge->mZ >= 0) edge->mZ += slab.mVert0;
+      }
+      if (!slab.mVerts.empty())
+        memcpy(&mMarchingCubes->mVerts[slab.mVert0], &slab.mVerts[0], sizeof(slab.mVerts[0]) * slab.mVerts.size());
+      if (!slab.mNorms.empty())
+        memcpy(&mMarchingCubes->mNorms[slab.mNorm0], &slab.mNorms[0], sizeof(slab.mNorms[0]) * slab.mNorms.size());
+      break;
+
+    case ProcessCubes:
+      for(unsigned int i=0; i<slab.mCubes.size(); ++i)
+        mMarchingCubes->processCube(slab.mCubes[i].x(), slab.mCubes[i].y(), slab.mCubes[i].z(), mVolume, mThreshold, slab.mIndices);
+      break;
+    }
+  }
+
+protected:
+  MarchingCubes* mMarchingCubes;
+  Volume* mVolume;
+  float mThreshold;
+  EPhase mPhase;
+  std::vector<Slab> mSlabs;
+};
+//------------------------------------------------------------------------------
+void MarchingCubes::runParallel(Volume* vol, float threshold, int thread_count)
+{
+  mEdges.resize(vol->slices().x() * vol->slices().y() * vol->slices().z());
+  mCubes.clear();
+
+  // use more slabs than threads to balance the load of unevenly distributed isosurfaces
+  int slab_count = thread_count * 4 < vol->slices().z() ? thread_count * 4 : vol->slices().z();
+  SlabTasks tasks(this, vol, threshold, slab_count);
+  std::vector<SlabTasks::Slab>& slabs = tasks.slabs();
+
+  tasks.setPhase(SlabTasks::ComputeEdges);
+  Thread::runTasks(&tasks, slab_count, thread_count);
+
+  // lay out the slabs' vertices in z order
+  size_t vert_count = mVerts.size();
+  size_t norm_count = mNorms.size();
+  for(int i=0; i<slab_count; ++i)
+  {
+    slabs[i].mVert0 = (int)vert_count;
+    slabs[i].mNorm0 = (int)norm_count;
+    vert_count += slabs[i].mVerts.size();
+    norm_count += slabs[i].mNorms.size();
+  }
+  mVerts.resize(vert_count);
+  mNorms.resize(norm_count);
+
+  tasks.setPhase(SlabTasks::RelocateVertices);
+  Thread::runTasks(&tasks, slab_count, thread_count);
+
+  tasks.setPhase(SlabTasks::ProcessCubes);
+  Thread::runTasks(&tasks, slab_count, thread_count);
+
+  for(int i=0; i<slab_count; ++i)
+    mIndices.insert(mIndices.end(), slabs[i].mIndices.begin(), slabs[i].mIndices.end());
 }
 //------------------------------------------------------------------------------
 void MarchingCubes::reset()
@@ -307,10 +445,25 @@ void MarchingCubes::reset()
   mCubes.clear();
   mEdges.clear();
   mVolumeInfo.clear();
+  mBlocks.clear();
+  mBlockVolumes.clear();
+  mDirtyVertRanges.clear();
+  mDirtyIndexRanges.clear();
 }
 //------------------------------------------------------------------------------
 void MarchingCubes::run(bool generate_colors)
 {
+  if (mBlockSize > 0)
+  {
+    runBlocks(generate_colors);
+    return;
+  }
+
+  mBlocks.clear();
+  mBlockVolumes.clear();
+  mDirtyVertRanges.clear();
+  mDirtyIndexRanges.clear();
+
   mVerts.clear();
   mNorms.clear();
   mIndices.clear();
@@ -330,19 +483,27 @@ void MarchingCubes::run(bool generate_colors)
     if (vol->dataIsDirty())
       vol->setupInternalData();
 
-    // note: this function takes the 90% of the time
-    computeEdges(vol, threshold);
+    int thread_count = mThreadCount > 0 ? mThreadCount : Thread::hardwareConcurrency();
+    if (thread_count > 1 && vol->slices().z() > 1)
+    {
+      runParallel(vol, threshold, thread_count);
+    }
+    else
+    {
+      // note: this function takes the 90% of the time
+      computeEdges(vol, threshold);
 
-    // note: this loop takes the remaining 10% of the time
-    //// the z->y->x order is important in order to minimize cache misses
-    //for(int z = 0; z < mVolume->slices().z()-1; ++z)
-    //  for(int y = 0; y < mVolume->slices().y()-1; ++y)
-    //    for(int x = 0; x < mVolume->slices().x()-1; ++x)
-    //      if(vol->cube(x,y,z).includes(threshold))
-    //        processCube(x, y, z, vol, threshold);
+      // note: this loop takes the remaining 10% of the time
+      //// the z->y->x order is important in order to minimize cache misses
+      //for(int z = 0; z < mVolume->slices().z()-1; ++z)
+      //  for(int y = 0; y < mVolume->slices().y()-1; ++y)
+      //    for(int x = 0; x < mVolume->slices().x()-1; ++x)
+      //      if(vol->cube(x,y,z).includes(threshold))
+      //        processCube(x, y, z, vol, threshold);
 
-    for(unsigned int i=0; i<mCubes.size(); ++i)
-      processCube(mCubes[i].x(), mCubes[i].y(), mCubes[i].z(), vol, threshold);
+      for(unsigned int i=0; i<mCubes.size(); ++i)
+        processCube(mCubes[i].x(), mCubes[i].y(), mCubes[i].z(), vol, threshold);
+    }
 
     int count = (int)mVerts.size() - start;
     mVolumeInfo.at(ivol)->setVert0(start);
@@ -395,6 +556,318 @@ void MarchingCubes::run(bool generate_colors)
   }
 }
 //------------------------------------------------------------------------------
+// MarchingCubes block mode
+//------------------------------------------------------------------------------
+void MarchingCubes::computeBlock(Volume* vol, float threshold, Block& block)
+{
+  block.mVerts.clear();
+  block.mNorms.clear();
+  block.mIndices.clear();
+  mCubes.clear();
+
+  // visit the vertices of the block's cubes, including the ones on the far faces,
+  // but emit only the edges belonging to the block's cubes
+  const int w = vol->slices().x() -1;
+  const int h = vol->slices().y() -1;
+  const int d = vol->slices().z() -1;
+  for(int z = block.mMin.z(); z <= block.mMax.z(); ++z)
+  {
+    for(int y = block.mMin.y(); y <= block.mMax.y(); ++y)
+    {
+      int iedge = block.mMin.x() + y*vol->slices().x() + z*vol->slices().x()*vol->slices().y();
+      for(int x = block.mMin.x(); x <= block.mMax.x(); ++x, ++iedge)
+      {
+        if (x != w && y != h && z != d)
+        {
+          if (vol->cube(x,y,z).includes(threshold))
+          {
+            if (x < block.mMax.x() && y < block.mMax.y() && z < block.mMax.z())
+              mCubes.push_back( usvec3((unsigned short)x, (unsigned short)y, (unsigned short)z) );
+          }
+          else
+            continue;
+        }
+
+        computeEdges(vol, threshold, x, y, z, iedge, x < block.mMax.x(), y < block.mMax.y(), z < block.mMax.z(), block.mVerts, block.mNorms);
+      }
+    }
+  }
+
+  for(unsigned int i=0; i<mCubes.size(); ++i)
+    processCube(mCubes[i].x(), mCubes[i].y(), mCubes[i].z(), vol, threshold, block.mIndices);
+
+  // low quality normals: same as Geometry::computeNormals() but restricted to the block
+  if (!mHighQualityNormals)
+  {
+    block.mNorms.assign(block.mVerts.size(), fvec3(0,0,0));
+    for(size_t i=0; i<block.mIndices.size(); i+=3)
+    {
+      IndexType a = block.mIndices[i+0];
+      IndexType b = block.mIndices[i+1];
+      IndexType c = block.mIndices[i+2];
+      fvec3 n = cross(block.mVerts[b] - block.mVerts[a], block.mVerts[c] - block.mVerts[a]);
+      n.normalize();
+      block.mNorms[a] += n;
+      block.mNorms[b] += n;
+      block.mNorms[c] += n;
+    }
+    for(size_t i=0; i<block.mNorms.size(); ++i)
+      block.mNorms[i].normalize();
+  }
+
+  block.mVertCount  = (int)block.mVerts.size();
+  block.mIndexCount = (int)block.mIndices.size();
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::writeBlock(const Block& block, const fvec3* verts, const fvec3* norms, const IndexType* indices, int index_base, const fvec4& color, bool generate_colors)
+{
+  fvec3* vert_ptr = mVertsArray->begin() + block.mVert0;
+  fvec3* norm_ptr = mNormsArray->begin() + block.mVert0;
+  IndexType* index_ptr = (IndexType*)mDrawElements->indexBuffer()->ptr() + block.mIndex0;
+
+  if (block.mVertCount)
+  {
+    memcpy(vert_ptr, verts, sizeof(fvec3) * block.mVertCount);
+    memcpy(norm_ptr, norms, sizeof(fvec3) * block.mVertCount);
+  }
+  for(int i=block.mVertCount; i<block.mVertCapacity; ++i)
+  {
+    vert_ptr[i] = fvec3(0,0,0);
+    norm_ptr[i] = fvec3(0,0,0);
+  }
+
+  if (generate_colors)
+  {
+    fvec4* color_ptr = mColorArray->begin() + block.mVert0;
+    for(int i=0; i<block.mVertCapacity; ++i)
+      color_ptr[i] = color;
+  }
+
+  // relocate the indices and pad the unused range with degenerate triangles
+  for(int i=0; i<block.mIndexCount; ++i)
+    index_ptr[i] = (IndexType)(indices[i] - index_base + block.mVert0);
+  for(int i=block.mIndexCount; i<block.mIndexCapacity; ++i)
+    index_ptr[i] = (IndexType)block.mVert0;
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::layoutBlocks(bool generate_colors)
+{
+  // keep a copy of the blocks that have not been re-extracted
+  std::vector<Block> old_blocks = mBlocks;
+  mVerts.resize(mVertsArray->size());
+  mNorms.resize(mNormsArray->size());
+  mIndices.resize(mDrawElements->indexBuffer()->size());
+  if (!mVerts.empty())
+  {
+    memcpy(&mVerts[0], mVertsArray->ptr(), mVertsArray->bytesUsed());
+    memcpy(&mNorms[0], mNormsArray->ptr(), mNormsArray->bytesUsed());
+  }
+  if (!mIndices.empty())
+    memcpy(&mIndices[0], mDrawElements->indexBuffer()->ptr(), mDrawElements->indexBuffer()->bytesUsed());
+
+  // leave some room to each block so that small edits can be uploaded in place
+  int vert_count  = 0;
+  int index_count = 0;
+  for(size_t i=0; i<mBlocks.size(); ++i)
+  {
+    Block& block = mBlocks[i];
+    block.mVertCapacity  = block.mVertCount + block.mVertCount / 4 + 8;
+    block.mIndexCapacity = (block.mIndexCount + block.mIndexCount / 4) / 3 * 3 + 24;
+    block.mVert0  = vert_count;
+    block.mIndex0 = index_count;
+    vert_count  += block.mVertCapacity;
+    index_count += block.mIndexCapacity;
+  }
+
+  mVertsArray->resize(vert_count);
+  mNormsArray->resize(vert_count);
+  if (generate_colors)
+    mColorArray->resize(vert_count);
+  else
+    mColorArray->clear();
+  mDrawElements->indexBuffer()->resize(index_count);
+
+  for(int ivol=0; ivol<(int)mBlockVolumes.size(); ++ivol)
+  {
+    const BlockVolume& bvol = mBlockVolumes[ivol];
+    const fvec4& color = mVolumeInfo.at(ivol)->color();
+    for(int i=bvol.mBlock0; i<bvol.mBlock0+bvol.mBlockCount; ++i)
+    {
+      const Block& block = mBlocks[i];
+      if (block.mDirty)
+        writeBlock(block, block.mVertCount ? &block.mVerts[0] : NULL, block.mVertCount ? &block.mNorms[0] : NULL, block.mIndexCount ? &block.mIndices[0] : NULL, 0, color, generate_colors);
+      else
+        writeBlock(block, &mVerts[old_blocks[i].mVert0], &mNorms[old_blocks[i].mVert0], &mIndices[old_blocks[i].mIndex0], old_blocks[i].mVert0, color, generate_colors);
+    }
+  }
+
+  mVerts.clear();
+  mNorms.clear();
+  mIndices.clear();
+
+  mVertsArray->setBufferObjectDirty();
+  mNormsArray->setBufferObjectDirty();
+  mColorArray->setBufferObjectDirty();
+  mDrawElements->indexBuffer()->setBufferObjectDirty(true);
+  mDirtyVertRanges.clear();
+  mDirtyIndexRanges.clear();
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::runBlocks(bool generate_colors)
+{
+  // the layout must be rebuilt from scratch if the volumes, their thresholds or the normals mode changed
+  bool relayout = generate_colors != mBlockColors || mHighQualityNormals != mBlockHighQualityNormals || (int)mBlockVolumes.size() != mVolumeInfo.size();
+  for(int ivol=0; !relayout && ivol<mVolumeInfo.size(); ++ivol)
+  {
+    const BlockVolume& bvol = mBlockVolumes[ivol];
+    const VolumeInfo* info = mVolumeInfo.at(ivol);
+    relayout = bvol.mVolume != info->volume() || bvol.mThreshold != info->threshold() || bvol.mSlices != info->volume()->slices() || bvol.mBlockSize != mBlockSize;
+  }
+
+  if (relayout)
+  {
+    mBlocks.clear();
+    mBlockVolumes.resize(mVolumeInfo.size());
+    for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+    {
+      Volume* vol = mVolumeInfo.at(ivol)->volume();
+      if (vol->dataIsDirty())
+        vol->setupInternalData();
+
+      BlockVolume& bvol = mBlockVolumes[ivol];
+      bvol.mVolume    = vol;
+      bvol.mThreshold = mVolumeInfo.at(ivol)->threshold();
+      bvol.mSlices    = vol->slices();
+      bvol.mBlockSize = mBlockSize;
+      bvol.mBlock0    = (int)mBlocks.size();
+
+      const ivec3 cubes = vol->slices() - ivec3(1,1,1);
+      for(int z=0; z<cubes.z(); z+=mBlockSize)
+      for(int y=0; y<cubes.y(); y+=mBlockSize)
+      for(int x=0; x<cubes.x(); x+=mBlockSize)
+      {
+        Block block;
+        block.mMin = ivec3(x,y,z);
+        block.mMax = vl::min(block.mMin + ivec3(mBlockSize,mBlockSize,mBlockSize), cubes);
+        block.mVert0 = block.mVertCount = block.mVertCapacity = 0;
+        block.mIndex0 = block.mIndexCount = block.mIndexCapacity = 0;
+        block.mDirty = true;
+        mBlocks.push_back(block);
+      }
+      bvol.mBlockCount = (int)mBlocks.size() - bvol.mBlock0;
+    }
+  }
+  else
+  {
+    for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+    {
+      Volume* vol = mVolumeInfo.at(ivol)->volume();
+      if (!vol->dataIsDirty())
+        continue;
+
+      // a voxel is shared by the 8 cubes around it and high quality normals sample the voxels around each vertex
+      const ivec3 dirty_min = vol->dirtyMin() - ivec3(2,2,2);
+      const ivec3 dirty_max = vol->dirtyMax() + ivec3(1,1,1);
+      const BlockVolume& bvol = mBlockVolumes[ivol];
+      for(int i=bvol.mBlock0; i<bvol.mBlock0+bvol.mBlockCount; ++i)
+      {
+        Block& block = mBlocks[i];
+        block.mDirty = block.mMin.x() <= dirty_max.x() && block.mMax.x() > dirty_min.x() &&
+                       block.mMin.y() <= dirty_max.y() && block.mMax.y() > dirty_min.y() &&
+                       block.mMin.z() <= dirty_max.z() && block.mMax.z() > dirty_min.z();
+      }
+
+      vol->setupInternalData();
+    }
+  }
+
+  // re-extract the dirty blocks
+  for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+  {
+    Volume* vol = mVolumeInfo.at(ivol)->volume();
+    mEdges.resize(vol->slices().x() * vol->slices().y() * vol->slices().z());
+    const BlockVolume& bvol = mBlockVolumes[ivol];
+    for(int i=bvol.mBlock0; i<bvol.mBlock0+bvol.mBlockCount; ++i)
+    {
+      if (mBlocks[i].mDirty)
+      {
+        computeBlock(vol, bvol.mThreshold, mBlocks[i]);
+        relayout |= mBlocks[i].mVertCount > mBlocks[i].mVertCapacity || mBlocks[i].mIndexCount > mBlocks[i].mIndexCapacity;
+      }
+    }
+  }
+
+  if (relayout)
+    layoutBlocks(generate_colors);
+  else
+  {
+    // update in place the ranges of the dirty blocks
+    for(int ivol=0; ivol<(int)mBlockVolumes.size(); ++ivol)
+    {
+      const BlockVolume& bvol = mBlockVolumes[ivol];
+      for(int i=bvol.mBlock0; i<bvol.mBlock0+bvol.mBlockCount; ++i)
+      {
+        const Block& block = mBlocks[i];
+        if (!block.mDirty)
+          continue;
+        writeBlock(block, block.mVertCount ? &block.mVerts[0] : NULL, block.mVertCount ? &block.mNorms[0] : NULL, block.mIndexCount ? &block.mIndices[0] : NULL, 0, mVolumeInfo.at(ivol)->color(), generate_colors);
+        mDirtyVertRanges.push_back( ivec2(block.mVert0, block.mVertCapacity) );
+        mDirtyIndexRanges.push_back( ivec2(block.mIndex0, block.mIndexCapacity) );
+      }
+    }
+  }
+
+  // release the temporary data
+  for(size_t i=0; i<mBlocks.size(); ++i)
+  {
+    Block& block = mBlocks[i];
+    block.mDirty = false;
+    std::vector<fvec3>().swap(block.mVerts);
+    std::vector<fvec3>().swap(block.mNorms);
+    std::vector<IndexType>().swap(block.mIndices);
+  }
+
+  for(int ivol=0; ivol<(int)mBlockVolumes.size(); ++ivol)
+  {
+    const BlockVolume& bvol = mBlockVolumes[ivol];
+    int vert0 = bvol.mBlockCount ? mBlocks[bvol.mBlock0].mVert0 : 0;
+    int vert1 = bvol.mBlockCount ? mBlocks[bvol.mBlock0+bvol.mBlockCount-1].mVert0 + mBlocks[bvol.mBlock0+bvol.mBlockCount-1].mVertCapacity : 0;
+    mVolumeInfo.at(ivol)->setVert0(vert0);
+    mVolumeInfo.at(ivol)->setVertC(vert1-vert0);
+  }
+
+  mBlockColors = generate_colors;
+  mBlockHighQualityNormals = mHighQualityNormals;
+}
+//------------------------------------------------------------------------------
+namespace
+{
+  void updateBufferObjectRanges(ArrayAbstract* array, const std::vector<ivec2>& ranges)
+  {
+    if (!array->size())
+      return;
+    BufferObject* bo = array->bufferObject();
+    const size_t bytes_per_vector = array->bytesUsed() / array->size();
+    if (array->isBufferObjectDirty() || !bo->handle() || bo->byteCountBufferObject() != (GLsizeiptr)array->bytesUsed())
+      array->updateBufferObject();
+    else
+    {
+      for(size_t i=0; i<ranges.size(); ++i)
+        bo->setBufferSubData( ranges[i].x() * bytes_per_vector, ranges[i].y() * bytes_per_vector, array->ptr() + ranges[i].x() * bytes_per_vector );
+    }
+  }
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::updateBufferObjects()
+{
+  updateBufferObjectRanges(mVertsArray.get(), mDirtyVertRanges);
+  updateBufferObjectRanges(mNormsArray.get(), mDirtyVertRanges);
+  updateBufferObjectRanges(mColorArray.get(), mDirtyVertRanges);
+  updateBufferObjectRanges(mDrawElements->indexBuffer(), mDirtyIndexRanges);
+  mDirtyVertRanges.clear();
+  mDirtyIndexRanges.clear();
+}
+//------------------------------------------------------------------------------
 void MarchingCubes::updateColor(const fvec3& color, int volume_index)
 {
   if(volume_index>=mVolumeInfo.size())
@@ -501,18 +974,43 @@ ref<Volume> Volume::downsample() const
   return vol;
 }
 //------------------------------------------------------------------------------
+void Volume::setDataDirty(const ivec3& min_corner, const ivec3& max_corner)
+{
+  if (mDataIsDirty)
+  {
+    mDirtyMin = vl::min(mDirtyMin, min_corner);
+    mDirtyMax = vl::max(mDirtyMax, max_corner);
+  }
+  else
+  {
+    mDirtyMin = min_corner;
+    mDirtyMax = max_corner;
+  }
+  mDataIsDirty = true;
+}
+//------------------------------------------------------------------------------
 void Volume::setupInternalData()
 {
   mDataIsDirty = false;
   int w = slices().x() -1;
   int h = slices().y() -1;
   int d = slices().z() -1;
-  mCubes.resize(w*h*d);
-  for(int z = 0; z < d; ++z)
+
+  // update only the cubes sharing a corner with the dirty voxels
+  ivec3 cube_min = vl::max(mDirtyMin - ivec3(1,1,1), ivec3(0,0,0));
+  ivec3 cube_max = vl::min(mDirtyMax + ivec3(1,1,1), ivec3(w,h,d));
+  if ((int)mCubes.size() != w*h*d)
   {
-    for(int y = 0; y < h; ++y)
+    mCubes.resize(w*h*d);
+    cube_min = ivec3(0,0,0);
+    cube_max = ivec3(w,h,d);
+  }
+
+  for(int z = cube_min.z(); z < cube_max.z(); ++z)
+  {
+    for(int y = cube_min.y(); y < cube_max.y(); ++y)
     {
-      for(int x = 0; x < w; ++x)
+      for(int x = cube_min.x(); x < cube_max.x(); ++x)
       {
         float v[] = 
         {
@@ -569,7 +1067,8 @@ void Volume::setup( float* data, bool use_directly, bool copy_data, const fvec3&
   mMinimum = +1;
   mMaximum = -1;
   mAverage = 0;
-  mDataIsDirty = true;
+  mDataIsDirty = false;
+  setDataDirty();
 }
 //------------------------------------------------------------------------------
 void Volume::setup(const Volume& volume)
@@ -578,7 +1077,8 @@ void Volume::setup(const Volume& volume)
   mMinimum = +1;
   mMaximum = -1;
   mAverage = 0;
-  mDataIsDirty = true;
+  mDataIsDirty = false;
+  setDataDirty();
 }
 //------------------------------------------------------------------------------
 float Volume::sampleNearest(float x, float y, float z) const
@@ -134,8 +134,20 @@ namespace vl
     bool dataIsDirty() const { return mDataIsDirty; }
 
     //! Notifies that the data of a Volume has changed and that the internal acceleration structures should be recomputed.
-    void setDataDirty() { mDataIsDirty = true; }
+    void setDataDirty() { setDataDirty(ivec3(0,0,0), mSlices-ivec3(1,1,1)); }
 
+    //! Notifies that only the voxels in the inclusive range [\p min_corner, \p max_corner] have changed.
+    //! Successive calls accumulate the bounding box of the regions until the next setupInternalData().
+    //! MarchingCubes in block mode re-extracts only the blocks touched by such region, see MarchingCubes::setBlockSize().
+    void setDataDirty(const ivec3& min_corner, const ivec3& max_corner);
+
+    //! The first voxel of the region modified since the last setupInternalData(), valid only if dataIsDirty() is \p true.
+    const ivec3& dirtyMin() const { return mDirtyMin; }
+
+    //! The last voxel (included) of the region modified since the last setupInternalData(), valid only if dataIsDirty() is \p true.
+    const ivec3& dirtyMax() const { return mDirtyMax; }
+
+    //! Updates the internal acceleration structures of the cubes touched by the dirty region.
     void setupInternalData();
 
   protected:
@@ -149,6 +161,8 @@ namespace vl
     float mMinimum;
     float mMaximum;
     float mAverage;
+    ivec3 mDirtyMin;
+    ivec3 mDirtyMax;
     bool mDataIsDirty;
 
     std::vector<Cube> mCubes;
@@ -241,6 +255,27 @@ namespace vl
     //! Select hight quality normals for best rendering quality, select low quality normals for best performances.
     bool highQualityNormals() const { return mHighQualityNormals; }
 
+    //! The number of threads used by run(): 1 (default) disables multithreading, 0 uses Thread::hardwareConcurrency() threads.
+    //! When multithreading is enabled each volume is split in slabs along the z axis which are processed in parallel,
+    //! the generated vertices, normals and indices are identical to the ones generated by the single threaded path.
+    void setThreadCount(int count) { mThreadCount = count; }
+    //! The number of threads used by run(): 1 (default) disables multithreading, 0 uses Thread::hardwareConcurrency() threads.
+    int threadCount() const { return mThreadCount; }
+
+    //! Enables the block-structured incremental mode: each volume is split in blocks of \p size x \p size x \p size cubes and
+    //! run() re-extracts only the blocks touched by the regions notified with Volume::setDataDirty(min_corner, max_corner).
+    //! Each block owns a padded range of the vertex and index arrays so that updateBufferObjects() can upload only the 
+    //! ranges modified by the last run(). Changing the volumes, their thresholds or overflowing a block's range rebuilds the whole layout.
+    //! 0 (default) disables the block mode.
+    void setBlockSize(int size) { mBlockSize = size; }
+    //! The size of the blocks used by the incremental mode, 0 if the block mode is disabled.
+    int blockSize() const { return mBlockSize; }
+
+    //! Updates the BufferObjects of the generated arrays after run(), in block mode only the modified ranges are uploaded.
+    //! \note In block mode the arrays are not flagged dirty if the layout did not change, so this function must be called
+    //! (with the OpenGL context active) when rendering using BufferObjects.
+    void updateBufferObjects();
+
   public:
     ref<ArrayFloat3> mVertsArray;
     ref<ArrayFloat3> mNormsArray;
@@ -269,6 +304,35 @@ namespace vl
 #endif
     std::vector<IndexType> mIndices;
 
+    class SlabTasks;
+    void computeEdges(Volume*, float threshold, int z_begin, int z_end, std::vector<fvec3>& verts, std::vector<fvec3>& norms, std::vector<usvec3>& cubes);
+    void computeEdges(Volume*, float threshold, int x, int y, int z, int iedge, bool edge_x, bool edge_y, bool edge_z, std::vector<fvec3>& verts, std::vector<fvec3>& norms);
+    void processCube(int x, int y, int z, Volume* vol, float threshold, std::vector<IndexType>& indices);
+    void runParallel(Volume* vol, float threshold, int thread_count);
+
+    struct Block
+    {
+      ivec3 mMin, mMax; // cube range [mMin, mMax)
+      int mVert0, mVertCount, mVertCapacity;
+      int mIndex0, mIndexCount, mIndexCapacity;
+      bool mDirty;
+      std::vector<fvec3> mVerts;
+      std::vector<fvec3> mNorms;
+      std::vector<IndexType> mIndices;
+    };
+    struct BlockVolume
+    {
+      const Volume* mVolume;
+      float mThreshold;
+      ivec3 mSlices;
+      int mBlockSize;
+      int mBlock0, mBlockCount;
+    };
+    void runBlocks(bool generate_colors);
+    void computeBlock(Volume* vol, float threshold, Block& block);
+    void layoutBlocks(bool generate_colors);
+    void writeBlock(const Block& block, const fvec3* verts, const fvec3* norms, const IndexType* indices, int index_base, const fvec4& color, bool generate_colors);
+
     struct Edge
     {
       Edge(): mX(-1), mY(-1), mZ(-1) {}
@@ -278,6 +342,14 @@ namespace vl
     std::vector<usvec3> mCubes;
     Collection<VolumeInfo> mVolumeInfo;
     bool mHighQualityNormals;
+    int mThreadCount;
+    int mBlockSize;
+    bool mBlockColors;
+    bool mBlockHighQualityNormals;
+    std::vector<Block> mBlocks;
+    std::vector<BlockVolume> mBlockVolumes;
+    std::vector<ivec2> mDirtyVertRanges;
+    std::vector<ivec2> mDirtyIndexRanges;
 
   protected:
     static const int mTriangleConnectionTable[256][16];